@@ -14,7 +14,7 @@ cr::lens::CustomLens::CustomLens()
 
 cr::lens::CustomLens::~CustomLens()
 {
-
+    stopCommandThread();
 }
 
 
@@ -32,6 +32,8 @@ bool cr::lens::CustomLens::openLens(std::string initString)
     m_params.isOpen = true;
     m_params.isConnected = true;
 
+    startCommandThread();
+
     return true;
 }
 
@@ -42,10 +44,18 @@ bool cr::lens::CustomLens::initLens(cr::lens::LensParams& params)
     // Copy params.
     m_params = params;
 
+    // Position mapping by hardware limits.
+    m_zoomMapper.setLinear(m_params.zoomHwWideLimit, m_params.zoomHwTeleLimit);
+    m_focusMapper.setLinear(m_params.focusHwNearLimit,
+                            m_params.focusHwFarLimit);
+    m_irisMapper.setLinear(m_params.irisHwCloseLimit, m_params.irisHwOpenLimit);
+
     // Set connection flags.
     m_params.isOpen = true;
     m_params.isConnected = true;
 
+    startCommandThread();
+
     return true;
 }
 
@@ -53,6 +63,8 @@ bool cr::lens::CustomLens::initLens(cr::lens::LensParams& params)
 
 void cr::lens::CustomLens::closeLens()
 {
+    stopCommandThread();
+
     // Reset connection flags.
     m_params.isOpen = false;
     m_params.isConnected = false;
@@ -81,38 +93,47 @@ bool cr::lens::CustomLens::setParam(cr::lens::LensParam id, float value)
     {
     case cr::lens::LensParam::ZOOM_POS:
     {
-        // Save param.
-        m_params.zoomPos = (int)value;
+        // Save param and hardware position.
+        m_params.zoomHwPos = m_zoomMapper.toHw(
+                    LensPositionMapper::clampPos(value));
+        m_params.zoomPos = m_zoomMapper.toUser(m_params.zoomHwPos);
         return true;
     }
     case cr::lens::LensParam::ZOOM_HW_POS:
     {
-        // Save param.
+        // Save param and user space position.
         m_params.zoomHwPos = (int)value;
+        m_params.zoomPos = m_zoomMapper.toUser(m_params.zoomHwPos);
         return true;
     }
     case cr::lens::LensParam::FOCUS_POS:
     {
-        // Save param.
-        m_params.focusPos = (int)value;
+        // Save param and hardware position.
+        m_params.focusHwPos = m_focusMapper.toHw(
+                    LensPositionMapper::clampPos(value));
+        m_params.focusPos = m_focusMapper.toUser(m_params.focusHwPos);
         return true;
     }
     case cr::lens::LensParam::FOCUS_HW_POS:
     {
-        // Save param.
+        // Save param and user space position.
         m_params.focusHwPos = (int)value;
+        m_params.focusPos = m_focusMapper.toUser(m_params.focusHwPos);
         return true;
     }
     case cr::lens::LensParam::IRIS_POS:
     {
-        // Save param.
-        m_params.irisPos = (int)value;
+        // Save param and hardware position.
+        m_params.irisHwPos = m_irisMapper.toHw(
+                    LensPositionMapper::clampPos(value));
+        m_params.irisPos = m_irisMapper.toUser(m_params.irisHwPos);
         return true;
     }
     case cr::lens::LensParam::IRIS_HW_POS:
     {
-        // Save param.
+        // Save param and user space position.
         m_params.irisHwPos = (int)value;
+        m_params.irisPos = m_irisMapper.toUser(m_params.irisHwPos);
         return true;
     }
     case cr::lens::LensParam::FOCUS_MODE:
@@ -207,38 +228,50 @@ bool cr::lens::CustomLens::setParam(cr::lens::LensParam id, float value)
     }
     case cr::lens::LensParam::ZOOM_HW_TELE_LIMIT:
     {
-        // Save param.
+        // Save param and update position mapping.
         m_params.zoomHwTeleLimit = (int)value;
+        m_zoomMapper.setLinear(m_params.zoomHwWideLimit,
+                               m_params.zoomHwTeleLimit);
         return true;
     }
     case cr::lens::LensParam::ZOOM_HW_WIDE_LIMIT:
     {
-        // Save param.
+        // Save param and update position mapping.
         m_params.zoomHwWideLimit = (int)value;
+        m_zoomMapper.setLinear(m_params.zoomHwWideLimit,
+                               m_params.zoomHwTeleLimit);
         return true;
     }
     case cr::lens::LensParam::FOCUS_HW_FAR_LIMIT:
     {
-        // Save param.
-        m_params.focusHwNearLimit = (int)value;
+        // Save param and update position mapping.
+        m_params.focusHwFarLimit = (int)value;
+        m_focusMapper.setLinear(m_params.focusHwNearLimit,
+                                m_params.focusHwFarLimit);
         return true;
     }
     case cr::lens::LensParam::FOCUS_HW_NEAR_LIMIT:
     {
-        // Save param.
+        // Save param and update position mapping.
         m_params.focusHwNearLimit = (int)value;
+        m_focusMapper.setLinear(m_params.focusHwNearLimit,
+                                m_params.focusHwFarLimit);
         return true;
     }
     case cr::lens::LensParam::IRIS_HW_OPEN_LIMIT:
     {
-        // Save param.
+        // Save param and update position mapping.
         m_params.irisHwOpenLimit = (int)value;
+        m_irisMapper.setLinear(m_params.irisHwCloseLimit,
+                               m_params.irisHwOpenLimit);
         return true;
     }
     case cr::lens::LensParam::IRIS_HW_CLOSE_LIMIT:
     {
-        // Save param.
+        // Save param and update position mapping.
         m_params.irisHwCloseLimit = (int)value;
+        m_irisMapper.setLinear(m_params.irisHwCloseLimit,
+                               m_params.irisHwOpenLimit);
         return true;
     }
     case cr::lens::LensParam::FOCUS_FACTOR:
@@ -482,7 +515,7 @@ float cr::lens::CustomLens::getParam(cr::lens::LensParam id)
     }
     case cr::lens::LensParam::FOCUS_HW_FAR_LIMIT:
     {
-        return (float)m_params.focusHwNearLimit;
+        return (float)m_params.focusHwFarLimit;
     }
     case cr::lens::LensParam::FOCUS_HW_NEAR_LIMIT:
     {
@@ -608,6 +641,96 @@ void cr::lens::CustomLens::getParams(cr::lens::LensParams& params)
 
 bool cr::lens::CustomLens::executeCommand(cr::lens::LensCommand id, float arg)
 {
+    // Check command ID.
+    if (id < LensCommand::ZOOM_TELE ||
+        id > LensCommand::ZOOM_AT_MAGNIFICATION_RATE)
+        return false;
+
+    // Stop commands go to priority lane and drop pending moves of the axis.
+    return m_commandQueue.push(id, arg);
+}
+
+
+
+void cr::lens::CustomLens::addVideoFrame(cr::video::Frame& frame)
+{
+
+}
+
+
+
+bool cr::lens::CustomLens::decodeAndExecuteCommand(uint8_t* data, int size)
+{
+    // Decode command.
+    LensCommand commandId = LensCommand::ZOOM_TELE;
+    LensParam paramId = LensParam::ZOOM_SPEED;
+    float value = 0.0f;
+    switch (Lens::decodeCommand(data, size, paramId, commandId, value))
+    {
+    // COMMAND.
+    case 0:
+        // Execute command.
+        return executeCommand(commandId, value);
+    // SET_PARAM.
+    case 1:
+    {
+        // Set param.
+        return setParam(paramId, value);
+    }
+    default:
+    {
+        return false;
+    }
+    }
+
+    return false;
+}
+
+
+
+void cr::lens::CustomLens::startCommandThread()
+{
+    if (m_commandThread.joinable())
+        return;
+
+    m_stopCommandThread.store(false);
+    m_commandThread = std::thread(&CustomLens::processCommands, this);
+}
+
+
+
+void cr::lens::CustomLens::stopCommandThread()
+{
+    m_stopCommandThread.store(true);
+    if (m_commandThread.joinable())
+        m_commandThread.join();
+    m_commandQueue.clear();
+}
+
+
+
+void cr::lens::CustomLens::processCommands()
+{
+    LensQueuedCommand command;
+    while (!m_stopCommandThread.load())
+    {
+        // Wait with timeout to check stop flag.
+        if (!m_commandQueue.pop(command, 100))
+            continue;
+
+        if (command.type == 0)
+            sendCommand(command.commandId, command.value);
+    }
+}
+
+
+
+bool cr::lens::CustomLens::sendCommand(cr::lens::LensCommand id, float arg)
+{
+    // Argument is used by *_TO_POS and ZOOM_TO_FOV commands which are not
+    // implemented in this example.
+    (void)arg;
+
     // Check command ID.
     switch (id)
     {
@@ -675,41 +798,17 @@ bool cr::lens::CustomLens::executeCommand(cr::lens::LensCommand id, float arg)
     {
         return true;
     }
-    default:
+    case cr::lens::LensCommand::ZOOM_TO_FOV:
     {
-        return false;
-    }
+        return true;
     }
-
-    return false;
-}
-
-
-
-void cr::lens::CustomLens::addVideoFrame(cr::video::Frame& frame)
-{
-
-}
-
-
-
-bool cr::lens::CustomLens::decodeAndExecuteCommand(uint8_t* data, int size)
-{
-    // Decode command.
-    LensCommand commandId = LensCommand::ZOOM_TELE;
-    LensParam paramId = LensParam::ZOOM_SPEED;
-    float value = 0.0f;
-    switch (Lens::decodeCommand(data, size, paramId, commandId, value))
+    case cr::lens::LensCommand::ZOOM_AT_FOV_RATE:
     {
-    // COMMAND.
-    case 0:
-        // Execute command.
-        return executeCommand(commandId);
-    // SET_PARAM.
-    case 1:
+        return true;
+    }
+    case cr::lens::LensCommand::ZOOM_AT_MAGNIFICATION_RATE:
     {
-        // Set param.
-        return setParam(paramId, value);
+        return true;
     }
     default:
     {
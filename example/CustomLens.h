@@ -1,7 +1,11 @@
 #pragma once
 #include <string>
+#include <atomic>
+#include <thread>
 #include <cstdint>
 #include "Lens.h"
+#include "LensCommandQueue.h"
+#include "LensPositionMapper.h"
 
 
 
@@ -10,7 +14,9 @@ namespace cr
 namespace lens
 {
 /**
- * @brief Custom lens controller interface class.
+ * @brief Custom lens controller interface class. Commands are executed by
+ * command thread through LensCommandQueue (hardware exchange can be slow),
+ * so stop commands are executed next regardless of pending moves.
  */
 class CustomLens: public Lens
 {
@@ -87,10 +93,12 @@ public:
     void getParams(LensParams& params);
 
     /**
-     * @brief Execute command.
+     * @brief Execute command. Command is put to command queue and executed by
+     * command thread.
      * @param id Command ID.
      * @param arg Command argument.
-     * @return TRUE if the command executed or FALSE.
+     * @return TRUE if the command accepted or FALSE if command ID is not
+     * valid or queue is full.
      */
     bool executeCommand(LensCommand id, float arg = 0);
 
@@ -113,6 +121,41 @@ private:
 
     /// Lens parameters structure (Default params).
     LensParams m_params;
+    /// Zoom position mapper.
+    LensPositionMapper m_zoomMapper;
+    /// Focus position mapper.
+    LensPositionMapper m_focusMapper;
+    /// Iris position mapper.
+    LensPositionMapper m_irisMapper;
+    /// Command queue.
+    LensCommandQueue m_commandQueue;
+    /// Command thread.
+    std::thread m_commandThread;
+    /// Stop command thread flag.
+    std::atomic<bool> m_stopCommandThread{false};
+
+    /**
+     * @brief Start command thread if it is not running.
+     */
+    void startCommandThread();
+
+    /**
+     * @brief Stop command thread and drop pending commands.
+     */
+    void stopCommandThread();
+
+    /**
+     * @brief Command thread function.
+     */
+    void processCommands();
+
+    /**
+     * @brief Send command to lens hardware. Called by command thread.
+     * @param id Command ID.
+     * @param arg Command argument.
+     * @return TRUE if the command executed or FALSE.
+     */
+    bool sendCommand(LensCommand id, float arg);
 };
 }
 }
@@ -1,8 +1,366 @@
+#include <chrono>
 #include "Lens.h"
 #include "LensVersion.h"
 
 
 
+/**
+ * @brief Encode lens params mask.
+ * @param mask Pointer to params mask.
+ * @param data Pointer to data buffer. Mask takes 7 bytes.
+ */
+static void encodeLensParamsMask(cr::lens::LensParamsMask* mask,
+                                 uint8_t* data)
+{
+    int pos = 0;
+    data[pos] = 0;
+    data[pos] = data[pos] | (mask->zoomPos ? (uint8_t)128 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->zoomHwPos ? (uint8_t)64 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->focusPos ? (uint8_t)32 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->focusHwPos ? (uint8_t)16 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->irisPos ? (uint8_t)8 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->irisHwPos ? (uint8_t)4 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->focusMode ? (uint8_t)2 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->filterMode ? (uint8_t)1 : (uint8_t)0);
+    pos += 1;
+    data[pos] = 0;
+    data[pos] = data[pos] | (mask->afRoiX0 ? (uint8_t)128 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->afRoiY0 ? (uint8_t)64 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->afRoiX1 ? (uint8_t)32 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->afRoiY1 ? (uint8_t)16 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->zoomSpeed ? (uint8_t)8 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->zoomHwSpeed ? (uint8_t)4 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->zoomHwMaxSpeed ? (uint8_t)2 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->focusSpeed ? (uint8_t)1 : (uint8_t)0);
+    pos += 1;
+    data[pos] = 0;
+    data[pos] = data[pos] | (mask->focusHwSpeed ? (uint8_t)128 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->focusHwMaxSpeed ? (uint8_t)64 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->irisSpeed ? (uint8_t)32 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->irisHwSpeed ? (uint8_t)16 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->irisHwMaxSpeed ? (uint8_t)8 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->zoomHwTeleLimit ? (uint8_t)4 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->zoomHwWideLimit ? (uint8_t)2 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->focusHwFarLimit ? (uint8_t)1 : (uint8_t)0);
+    pos += 1;
+    data[pos] = 0;
+    data[pos] = data[pos] | (mask->focusHwNearLimit ? (uint8_t)128 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->irisHwOpenLimit ? (uint8_t)64 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->irisHwCloseLimit ? (uint8_t)32 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->focusFactor ? (uint8_t)16 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->isConnected ? (uint8_t)8 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->afHwSpeed ? (uint8_t)4 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->focusFactorThreshold ? (uint8_t)2 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->refocusTimeoutSec ? (uint8_t)1 : (uint8_t)0);
+    pos += 1;
+    data[pos] = 0;
+    data[pos] = data[pos] | (mask->afIsActive ? (uint8_t)128 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->irisMode ? (uint8_t)64 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->autoAfRoiWidth ? (uint8_t)32 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->autoAfRoiHeight ? (uint8_t)16 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->autoAfRoiBorder ? (uint8_t)8 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->afRoiMode ? (uint8_t)4 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->extenderMode ? (uint8_t)2 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->stabiliserMode ? (uint8_t)1 : (uint8_t)0);
+    pos += 1;
+    data[pos] = 0;
+    data[pos] = data[pos] | (mask->afRange ? (uint8_t)128 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->xFovDeg ? (uint8_t)64 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->yFovDeg ? (uint8_t)32 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->logMode ? (uint8_t)16 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->temperature ? (uint8_t)8 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->isOpen ? (uint8_t)4 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->type ? (uint8_t)2 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->custom1 ? (uint8_t)1 : (uint8_t)0);
+    pos += 1;
+    data[pos] = 0;
+    data[pos] = data[pos] | (mask->custom2 ? (uint8_t)128 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->custom3 ? (uint8_t)64 : (uint8_t)0);
+    data[pos] = data[pos] | (mask->timestamps ? (uint8_t)32 : (uint8_t)0);
+}
+
+
+
+/**
+ * @brief Decode lens params mask.
+ * @param data Pointer to mask data (7 bytes).
+ * @param mask Output params mask.
+ */
+static void decodeLensParamsMask(uint8_t* data,
+                                 cr::lens::LensParamsMask& mask)
+{
+    mask.zoomPos = (data[0] & (uint8_t)128) == (uint8_t)128;
+    mask.zoomHwPos = (data[0] & (uint8_t)64) == (uint8_t)64;
+    mask.focusPos = (data[0] & (uint8_t)32) == (uint8_t)32;
+    mask.focusHwPos = (data[0] & (uint8_t)16) == (uint8_t)16;
+    mask.irisPos = (data[0] & (uint8_t)8) == (uint8_t)8;
+    mask.irisHwPos = (data[0] & (uint8_t)4) == (uint8_t)4;
+    mask.focusMode = (data[0] & (uint8_t)2) == (uint8_t)2;
+    mask.filterMode = (data[0] & (uint8_t)1) == (uint8_t)1;
+    mask.afRoiX0 = (data[1] & (uint8_t)128) == (uint8_t)128;
+    mask.afRoiY0 = (data[1] & (uint8_t)64) == (uint8_t)64;
+    mask.afRoiX1 = (data[1] & (uint8_t)32) == (uint8_t)32;
+    mask.afRoiY1 = (data[1] & (uint8_t)16) == (uint8_t)16;
+    mask.zoomSpeed = (data[1] & (uint8_t)8) == (uint8_t)8;
+    mask.zoomHwSpeed = (data[1] & (uint8_t)4) == (uint8_t)4;
+    mask.zoomHwMaxSpeed = (data[1] & (uint8_t)2) == (uint8_t)2;
+    mask.focusSpeed = (data[1] & (uint8_t)1) == (uint8_t)1;
+    mask.focusHwSpeed = (data[2] & (uint8_t)128) == (uint8_t)128;
+    mask.focusHwMaxSpeed = (data[2] & (uint8_t)64) == (uint8_t)64;
+    mask.irisSpeed = (data[2] & (uint8_t)32) == (uint8_t)32;
+    mask.irisHwSpeed = (data[2] & (uint8_t)16) == (uint8_t)16;
+    mask.irisHwMaxSpeed = (data[2] & (uint8_t)8) == (uint8_t)8;
+    mask.zoomHwTeleLimit = (data[2] & (uint8_t)4) == (uint8_t)4;
+    mask.zoomHwWideLimit = (data[2] & (uint8_t)2) == (uint8_t)2;
+    mask.focusHwFarLimit = (data[2] & (uint8_t)1) == (uint8_t)1;
+    mask.focusHwNearLimit = (data[3] & (uint8_t)128) == (uint8_t)128;
+    mask.irisHwOpenLimit = (data[3] & (uint8_t)64) == (uint8_t)64;
+    mask.irisHwCloseLimit = (data[3] & (uint8_t)32) == (uint8_t)32;
+    mask.focusFactor = (data[3] & (uint8_t)16) == (uint8_t)16;
+    mask.isConnected = (data[3] & (uint8_t)8) == (uint8_t)8;
+    mask.afHwSpeed = (data[3] & (uint8_t)4) == (uint8_t)4;
+    mask.focusFactorThreshold = (data[3] & (uint8_t)2) == (uint8_t)2;
+    mask.refocusTimeoutSec = (data[3] & (uint8_t)1) == (uint8_t)1;
+    mask.afIsActive = (data[4] & (uint8_t)128) == (uint8_t)128;
+    mask.irisMode = (data[4] & (uint8_t)64) == (uint8_t)64;
+    mask.autoAfRoiWidth = (data[4] & (uint8_t)32) == (uint8_t)32;
+    mask.autoAfRoiHeight = (data[4] & (uint8_t)16) == (uint8_t)16;
+    mask.autoAfRoiBorder = (data[4] & (uint8_t)8) == (uint8_t)8;
+    mask.afRoiMode = (data[4] & (uint8_t)4) == (uint8_t)4;
+    mask.extenderMode = (data[4] & (uint8_t)2) == (uint8_t)2;
+    mask.stabiliserMode = (data[4] & (uint8_t)1) == (uint8_t)1;
+    mask.afRange = (data[5] & (uint8_t)128) == (uint8_t)128;
+    mask.xFovDeg = (data[5] & (uint8_t)64) == (uint8_t)64;
+    mask.yFovDeg = (data[5] & (uint8_t)32) == (uint8_t)32;
+    mask.logMode = (data[5] & (uint8_t)16) == (uint8_t)16;
+    mask.temperature = (data[5] & (uint8_t)8) == (uint8_t)8;
+    mask.isOpen = (data[5] & (uint8_t)4) == (uint8_t)4;
+    mask.type = (data[5] & (uint8_t)2) == (uint8_t)2;
+    mask.custom1 = (data[5] & (uint8_t)1) == (uint8_t)1;
+    mask.custom2 = (data[6] & (uint8_t)128) == (uint8_t)128;
+    mask.custom3 = (data[6] & (uint8_t)64) == (uint8_t)64;
+    mask.timestamps = (data[6] & (uint8_t)32) == (uint8_t)32;
+}
+
+
+
+/**
+ * @brief Append ages of params masked in encoded mask.
+ * @param timestamps Params timestamps.
+ * @param data Pointer to encoded params. Mask starts at byte 3.
+ * @param pos Position to write ages. Will be moved to the end of ages.
+ */
+static void encodeTimestamps(uint32_t* timestamps, uint8_t* data, int& pos)
+{
+    uint32_t now = cr::lens::LensParams::getTimeMsec();
+    for (int i = 0; i < 50; ++i)
+    {
+        if ((data[3 + i / 8] & (uint8_t)(128 >> (i % 8))) == 0)
+            continue;
+
+        // Age saturates at 65534 msec, 65535 means unknown.
+        uint16_t age = 0xFFFF;
+        if (timestamps[i] != 0)
+        {
+            uint32_t value = now - timestamps[i];
+            age = value > 0xFFFE ? (uint16_t)0xFFFE : (uint16_t)value;
+        }
+        memcpy(&data[pos], &age, 2); pos += 2;
+    }
+}
+
+
+
+/**
+ * @brief Decode ages of params masked in encoded mask to local timestamps.
+ * @param timestamps Output params timestamps.
+ * @param data Pointer to encoded params. Mask starts at byte 3.
+ * @param dataSize Size of data.
+ * @param pos Position of ages.
+ * @return TRUE if ages decoded or FALSE if not enough data.
+ */
+static bool decodeTimestamps(uint32_t* timestamps, uint8_t* data,
+                             int dataSize, int pos)
+{
+    memset(timestamps, 0, 50 * sizeof(uint32_t));
+    if ((data[9] & (uint8_t)32) == 0)
+        return true;
+
+    uint32_t now = cr::lens::LensParams::getTimeMsec();
+    for (int i = 0; i < 50; ++i)
+    {
+        if ((data[3 + i / 8] & (uint8_t)(128 >> (i % 8))) == 0)
+            continue;
+        if (dataSize < pos + 2)
+            return false;
+        uint16_t age = 0;
+        memcpy(&age, &data[pos], 2); pos += 2;
+        if (age != 0xFFFF)
+        {
+            timestamps[i] = now - age;
+            if (timestamps[i] == 0)
+                timestamps[i] = 1;
+        }
+    }
+
+    return true;
+}
+
+
+
+/**
+ * @brief Convert float to half precision float.
+ * @param value Float value.
+ * @return Half precision float bits.
+ */
+static uint16_t floatToHalf(float value)
+{
+    uint32_t bits = 0;
+    memcpy(&bits, &value, 4);
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x007FFFFF;
+
+    // NaN and infinity.
+    if (((bits >> 23) & 0xFF) == 0xFF)
+        return sign | 0x7C00 | (mantissa != 0 ? 0x0200 : 0);
+    // Overflow.
+    if (exponent >= 31)
+        return sign | 0x7C00;
+    // Underflow and subnormal values.
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+            return sign;
+        mantissa = (mantissa | 0x00800000) >> (1 - exponent);
+        return sign | (uint16_t)((mantissa + 0x00001000) >> 13);
+    }
+
+    // Normal value with rounding.
+    uint16_t half = sign | (uint16_t)(exponent << 10) |
+                    (uint16_t)(mantissa >> 13);
+    if ((mantissa & 0x00001000) != 0)
+        ++half;
+
+    return half;
+}
+
+
+
+/**
+ * @brief Convert half precision float to float.
+ * @param half Half precision float bits.
+ * @return Float value.
+ */
+static float halfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x03FF;
+    uint32_t bits = 0;
+
+    if (exponent == 0)
+    {
+        // Zero and subnormal values.
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x0400) == 0)
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+            mantissa &= 0x03FF;
+            bits = sign | (exponent << 23) | (mantissa << 13);
+        }
+    }
+    else if (exponent == 31)
+    {
+        // NaN and infinity.
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float value = 0.0f;
+    memcpy(&value, &bits, 4);
+
+    return value;
+}
+
+
+
+/**
+ * @brief Write integer as zigzag variable length value (1-5 bytes).
+ * @param data Pointer to data buffer.
+ * @param pos Write position. Will be increased.
+ * @param value Integer value.
+ */
+static void writeVarint(uint8_t* data, int& pos, int value)
+{
+    uint32_t v = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    while (v >= 0x80)
+    {
+        data[pos] = (uint8_t)(v | 0x80); pos += 1;
+        v >>= 7;
+    }
+    data[pos] = (uint8_t)v; pos += 1;
+}
+
+
+
+/**
+ * @brief Read zigzag variable length integer.
+ * @param data Pointer to data.
+ * @param dataSize Size of data.
+ * @param pos Read position. Will be increased.
+ * @param value Output value.
+ * @return TRUE if value read or FALSE if not enough data.
+ */
+static bool readVarint(uint8_t* data, int dataSize, int& pos, int& value)
+{
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (pos >= dataSize)
+            return false;
+        uint8_t byte = data[pos]; pos += 1;
+        v |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            value = (int)(v >> 1) ^ -(int)(v & 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
+/**
+ * @brief FNV-1a hash of data.
+ * @param seed Previous hash value.
+ * @param data Pointer to data.
+ * @param size Size of data.
+ * @return Hash value.
+ */
+static uint64_t hashBytes(uint64_t seed, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; ++i)
+        seed = (seed ^ bytes[i]) * 1099511628211ULL;
+    return seed;
+}
+
+
+
 cr::lens::FovPoint &cr::lens::FovPoint::operator= (const FovPoint &src)
 {
     // Check yourself.
@@ -19,6 +377,122 @@ cr::lens::FovPoint &cr::lens::FovPoint::operator= (const FovPoint &src)
 
 
 
+bool cr::lens::FovPoint::operator== (const FovPoint &src) const
+{
+    return hwZoomPos == src.hwZoomPos && xFovDeg == src.xFovDeg &&
+           yFovDeg == src.yFovDeg;
+}
+
+
+
+uint64_t cr::lens::FovPoint::getHash(uint64_t seed) const
+{
+    seed = hashBytes(seed, &hwZoomPos, 4);
+    seed = hashBytes(seed, &xFovDeg, 4);
+    return hashBytes(seed, &yFovDeg, 4);
+}
+
+
+
+cr::lens::TrackingPoint &cr::lens::TrackingPoint::operator= (
+        const TrackingPoint &src)
+{
+    // Check yourself.
+    if (this == &src)
+        return *this;
+
+    // Copy params.
+    hwZoomPos = src.hwZoomPos;
+    hwFocusPos = src.hwFocusPos;
+
+    return *this;
+}
+
+
+
+bool cr::lens::TrackingPoint::operator== (const TrackingPoint &src) const
+{
+    return hwZoomPos == src.hwZoomPos && hwFocusPos == src.hwFocusPos;
+}
+
+
+
+cr::lens::TrackingCurve &cr::lens::TrackingCurve::operator= (
+        const TrackingCurve &src)
+{
+    // Check yourself.
+    if (this == &src)
+        return *this;
+
+    // Copy params.
+    distanceM = src.distanceM;
+    points = src.points;
+
+    return *this;
+}
+
+
+
+bool cr::lens::TrackingCurve::operator== (const TrackingCurve &src) const
+{
+    return distanceM == src.distanceM && points == src.points;
+}
+
+
+
+uint64_t cr::lens::TrackingCurve::getHash(uint64_t seed) const
+{
+    seed = hashBytes(seed, &distanceM, 4);
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        seed = hashBytes(seed, &points[i].hwZoomPos, 4);
+        seed = hashBytes(seed, &points[i].hwFocusPos, 4);
+    }
+    return seed;
+}
+
+
+
+cr::lens::DistortionPoint &cr::lens::DistortionPoint::operator= (
+        const DistortionPoint &src)
+{
+    // Check yourself.
+    if (this == &src)
+        return *this;
+
+    // Copy params.
+    hwZoomPos = src.hwZoomPos;
+    k1 = src.k1;
+    k2 = src.k2;
+    p1 = src.p1;
+    p2 = src.p2;
+    k3 = src.k3;
+
+    return *this;
+}
+
+
+
+bool cr::lens::DistortionPoint::operator== (const DistortionPoint &src) const
+{
+    return hwZoomPos == src.hwZoomPos && k1 == src.k1 && k2 == src.k2 &&
+           p1 == src.p1 && p2 == src.p2 && k3 == src.k3;
+}
+
+
+
+uint64_t cr::lens::DistortionPoint::getHash(uint64_t seed) const
+{
+    seed = hashBytes(seed, &hwZoomPos, 4);
+    seed = hashBytes(seed, &k1, 4);
+    seed = hashBytes(seed, &k2, 4);
+    seed = hashBytes(seed, &p1, 4);
+    seed = hashBytes(seed, &p2, 4);
+    return hashBytes(seed, &k3, 4);
+}
+
+
+
 cr::lens::LensParams &cr::lens::LensParams::operator= (const cr::lens::LensParams &src)
 {
     // Check yourself.
@@ -78,260 +552,1143 @@ cr::lens::LensParams &cr::lens::LensParams::operator= (const cr::lens::LensParam
     custom2 = src.custom2;
     custom3 = src.custom3;
     fovPoints = src.fovPoints;
+    trackingCurves = src.trackingCurves;
+    distortionPoints = src.distortionPoints;
+    memcpy(timestamps, src.timestamps, sizeof(timestamps));
+
+    return *this;
+}
+
+
+
+uint32_t cr::lens::LensParams::getTimeMsec()
+{
+    uint32_t time = (uint32_t)std::chrono::duration_cast<
+            std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // 0 means unknown timestamp.
+    return time == 0 ? 1 : time;
+}
+
+
+
+void cr::lens::LensParams::setTimestamp(cr::lens::LensParam id)
+{
+    int index = (int)id - 1;
+    if (index >= 0 && index < 50)
+        timestamps[index] = getTimeMsec();
+}
+
+
+
+uint32_t cr::lens::LensParams::getTimestamp(cr::lens::LensParam id)
+{
+    int index = (int)id - 1;
+    if (index < 0 || index >= 50)
+        return 0;
+
+    return timestamps[index];
+}
+
+
+
+int cr::lens::LensParams::getAgeMsec(cr::lens::LensParam id)
+{
+    uint32_t timestamp = getTimestamp(id);
+    if (timestamp == 0)
+        return -1;
+
+    uint32_t age = getTimeMsec() - timestamp;
+
+    return age > 0x7FFFFFFF ? 0x7FFFFFFF : (int)age;
+}
+
+
+
+float cr::lens::LensParams::getParamValue(cr::lens::LensParam id)
+{
+    switch (id)
+    {
+    case LensParam::ZOOM_POS:
+        return (float)zoomPos;
+    case LensParam::ZOOM_HW_POS:
+        return (float)zoomHwPos;
+    case LensParam::FOCUS_POS:
+        return (float)focusPos;
+    case LensParam::FOCUS_HW_POS:
+        return (float)focusHwPos;
+    case LensParam::IRIS_POS:
+        return (float)irisPos;
+    case LensParam::IRIS_HW_POS:
+        return (float)irisHwPos;
+    case LensParam::FOCUS_MODE:
+        return (float)focusMode;
+    case LensParam::FILTER_MODE:
+        return (float)filterMode;
+    case LensParam::AF_ROI_X0:
+        return (float)afRoiX0;
+    case LensParam::AF_ROI_Y0:
+        return (float)afRoiY0;
+    case LensParam::AF_ROI_X1:
+        return (float)afRoiX1;
+    case LensParam::AF_ROI_Y1:
+        return (float)afRoiY1;
+    case LensParam::ZOOM_SPEED:
+        return (float)zoomSpeed;
+    case LensParam::ZOOM_HW_SPEED:
+        return (float)zoomHwSpeed;
+    case LensParam::ZOOM_HW_MAX_SPEED:
+        return (float)zoomHwMaxSpeed;
+    case LensParam::FOCUS_SPEED:
+        return (float)focusSpeed;
+    case LensParam::FOCUS_HW_SPEED:
+        return (float)focusHwSpeed;
+    case LensParam::FOCUS_HW_MAX_SPEED:
+        return (float)focusHwMaxSpeed;
+    case LensParam::IRIS_SPEED:
+        return (float)irisSpeed;
+    case LensParam::IRIS_HW_SPEED:
+        return (float)irisHwSpeed;
+    case LensParam::IRIS_HW_MAX_SPEED:
+        return (float)irisHwMaxSpeed;
+    case LensParam::ZOOM_HW_TELE_LIMIT:
+        return (float)zoomHwTeleLimit;
+    case LensParam::ZOOM_HW_WIDE_LIMIT:
+        return (float)zoomHwWideLimit;
+    case LensParam::FOCUS_HW_FAR_LIMIT:
+        return (float)focusHwFarLimit;
+    case LensParam::FOCUS_HW_NEAR_LIMIT:
+        return (float)focusHwNearLimit;
+    case LensParam::IRIS_HW_OPEN_LIMIT:
+        return (float)irisHwOpenLimit;
+    case LensParam::IRIS_HW_CLOSE_LIMIT:
+        return (float)irisHwCloseLimit;
+    case LensParam::FOCUS_FACTOR:
+        return focusFactor;
+    case LensParam::IS_CONNECTED:
+        return isConnected ? 1.0f : 0.0f;
+    case LensParam::FOCUS_HW_AF_SPEED:
+        return (float)afHwSpeed;
+    case LensParam::FOCUS_FACTOR_THRESHOLD:
+        return focusFactorThreshold;
+    case LensParam::REFOCUS_TIMEOUT_SEC:
+        return (float)refocusTimeoutSec;
+    case LensParam::AF_IS_ACTIVE:
+        return afIsActive ? 1.0f : 0.0f;
+    case LensParam::IRIS_MODE:
+        return (float)irisMode;
+    case LensParam::AUTO_AF_ROI_WIDTH:
+        return (float)autoAfRoiWidth;
+    case LensParam::AUTO_AF_ROI_HEIGHT:
+        return (float)autoAfRoiHeight;
+    case LensParam::AUTO_AF_ROI_BORDER:
+        return (float)autoAfRoiBorder;
+    case LensParam::AF_ROI_MODE:
+        return (float)afRoiMode;
+    case LensParam::EXTENDER_MODE:
+        return (float)extenderMode;
+    case LensParam::STABILIZER_MODE:
+        return (float)stabiliserMode;
+    case LensParam::AF_RANGE:
+        return (float)afRange;
+    case LensParam::X_FOV_DEG:
+        return xFovDeg;
+    case LensParam::Y_FOV_DEG:
+        return yFovDeg;
+    case LensParam::LOG_MODE:
+        return (float)logMode;
+    case LensParam::TEMPERATURE:
+        return temperature;
+    case LensParam::IS_OPEN:
+        return isOpen ? 1.0f : 0.0f;
+    case LensParam::TYPE:
+        return (float)type;
+    case LensParam::CUSTOM_1:
+        return custom1;
+    case LensParam::CUSTOM_2:
+        return custom2;
+    case LensParam::CUSTOM_3:
+        return custom3;
+    default:
+        return -1.0f;
+    }
+}
+
+
+
+bool cr::lens::LensParams::encode(uint8_t* data, int bufferSize, int& size,
+                                  cr::lens::LensParamsMask* mask)
+{
+    // Set mask.
+    cr::lens::LensParamsMask defaultMask;
+    if (mask == nullptr)
+        mask = &defaultMask;
+
+    // Check buffer size.
+    if (bufferSize < (mask->timestamps ? 301 : 201))
+        return false;
+
+    // Encode version.
+    int pos = 0;
+    data[pos] = 0x02; pos += 1;
+    data[pos] = LENS_MAJOR_VERSION; pos += 1;
+    data[pos] = LENS_MINOR_VERSION; pos += 1;
+
+    // Prepare mask.
+    encodeLensParamsMask(mask, &data[pos]);
+    pos += 7;
+
+    // Encode data.
+    if (mask->zoomPos)
+    {
+        memcpy(&data[pos], &zoomPos, 4); pos += 4;
+    }
+    if (mask->zoomHwPos)
+    {
+        memcpy(&data[pos], &zoomHwPos, 4); pos += 4;
+    }
+    if (mask->focusPos)
+    {
+        memcpy(&data[pos], &focusPos, 4); pos += 4;
+    }
+    if (mask->focusHwPos)
+    {
+        memcpy(&data[pos], &focusHwPos, 4); pos += 4;
+    }
+    if (mask->irisPos)
+    {
+        memcpy(&data[pos], &irisPos, 4); pos += 4;
+    }
+    if (mask->irisHwPos)
+    {
+        memcpy(&data[pos], &irisHwPos, 4); pos += 4;
+    }
+    if (mask->focusMode)
+    {
+        memcpy(&data[pos], &focusMode, 4); pos += 4;
+    }
+    if (mask->filterMode)
+    {
+        memcpy(&data[pos], &filterMode, 4); pos += 4;
+    }
+    if (mask->afRoiX0)
+    {
+        memcpy(&data[pos], &afRoiX0, 4); pos += 4;
+    }
+    if (mask->afRoiY0)
+    {
+        memcpy(&data[pos], &afRoiY0, 4); pos += 4;
+    }
+    if (mask->afRoiX1)
+    {
+        memcpy(&data[pos], &afRoiX1, 4); pos += 4;
+    }
+    if (mask->afRoiY1)
+    {
+        memcpy(&data[pos], &afRoiY1, 4); pos += 4;
+    }
+    if (mask->zoomSpeed)
+    {
+        memcpy(&data[pos], &zoomSpeed, 4); pos += 4;
+    }
+    if (mask->zoomHwSpeed)
+    {
+        memcpy(&data[pos], &zoomHwSpeed, 4); pos += 4;
+    }
+    if (mask->zoomHwMaxSpeed)
+    {
+        memcpy(&data[pos], &zoomHwMaxSpeed, 4); pos += 4;
+    }
+    if (mask->focusSpeed)
+    {
+        memcpy(&data[pos], &focusSpeed, 4); pos += 4;
+    }
+    if (mask->focusHwSpeed)
+    {
+        memcpy(&data[pos], &focusHwSpeed, 4); pos += 4;
+    }
+    if (mask->focusHwMaxSpeed)
+    {
+        memcpy(&data[pos], &focusHwMaxSpeed, 4); pos += 4;
+    }
+    if (mask->irisSpeed)
+    {
+        memcpy(&data[pos], &irisSpeed, 4); pos += 4;
+    }
+    if (mask->irisHwSpeed)
+    {
+        memcpy(&data[pos], &irisHwSpeed, 4); pos += 4;
+    }
+    if (mask->irisHwMaxSpeed)
+    {
+        memcpy(&data[pos], &irisHwMaxSpeed, 4); pos += 4;
+    }
+    if (mask->zoomHwTeleLimit)
+    {
+        memcpy(&data[pos], &zoomHwTeleLimit, 4); pos += 4;
+    }
+    if (mask->zoomHwWideLimit)
+    {
+        memcpy(&data[pos], &zoomHwWideLimit, 4); pos += 4;
+    }
+    if (mask->focusHwFarLimit)
+    {
+        memcpy(&data[pos], &focusHwFarLimit, 4); pos += 4;
+    }
+    if (mask->focusHwNearLimit)
+    {
+        memcpy(&data[pos], &focusHwNearLimit, 4); pos += 4;
+    }
+    if (mask->irisHwOpenLimit)
+    {
+        memcpy(&data[pos], &irisHwOpenLimit, 4); pos += 4;
+    }
+    if (mask->irisHwCloseLimit)
+    {
+        memcpy(&data[pos], &irisHwCloseLimit, 4); pos += 4;
+    }
+    if (mask->focusFactor)
+    {
+        memcpy(&data[pos], &focusFactor, 4); pos += 4;
+    }
+    if (mask->isConnected)
+    {
+        data[pos] = isConnected ? 0x01 : 0x00; pos += 1;
+    }
+    if (mask->afHwSpeed)
+    {
+        memcpy(&data[pos], &afHwSpeed, 4); pos += 4;
+    }
+    if (mask->focusFactorThreshold)
+    {
+        memcpy(&data[pos], &focusFactorThreshold, 4); pos += 4;
+    }
+    if (mask->refocusTimeoutSec)
+    {
+        memcpy(&data[pos], &refocusTimeoutSec, 4); pos += 4;
+    }
+    if (mask->afIsActive)
+    {
+        data[pos] = afIsActive ? 0x01 : 0x00; pos += 1;
+    }
+    if (mask->irisMode)
+    {
+        memcpy(&data[pos], &irisMode, 4); pos += 4;
+    }
+    if (mask->autoAfRoiWidth)
+    {
+        memcpy(&data[pos], &autoAfRoiWidth, 4); pos += 4;
+    }
+    if (mask->autoAfRoiHeight)
+    {
+        memcpy(&data[pos], &autoAfRoiHeight, 4); pos += 4;
+    }
+    if (mask->autoAfRoiBorder)
+    {
+        memcpy(&data[pos], &autoAfRoiBorder, 4); pos += 4;
+    }
+    if (mask->afRoiMode)
+    {
+        memcpy(&data[pos], &afRoiMode, 4); pos += 4;
+    }
+    if (mask->extenderMode)
+    {
+        memcpy(&data[pos], &extenderMode, 4); pos += 4;
+    }
+    if (mask->stabiliserMode)
+    {
+        memcpy(&data[pos], &stabiliserMode, 4); pos += 4;
+    }
+    if (mask->afRange)
+    {
+        memcpy(&data[pos], &afRange, 4); pos += 4;
+    }
+    if (mask->xFovDeg)
+    {
+        memcpy(&data[pos], &xFovDeg, 4); pos += 4;
+    }
+    if (mask->yFovDeg)
+    {
+        memcpy(&data[pos], &yFovDeg, 4); pos += 4;
+    }
+    if (mask->logMode)
+    {
+        memcpy(&data[pos], &logMode, 4); pos += 4;
+    }
+    if (mask->temperature)
+    {
+        memcpy(&data[pos], &temperature, 4); pos += 4;
+    }
+    if (mask->isOpen)
+    {
+        data[pos] = isOpen ? 0x01 : 0x00; pos += 1;
+    }
+    if (mask->type)
+    {
+        memcpy(&data[pos], &type, 4); pos += 4;
+    }
+    if (mask->custom1)
+    {
+        memcpy(&data[pos], &custom1, 4); pos += 4;
+    }
+    if (mask->custom2)
+    {
+        memcpy(&data[pos], &custom2, 4); pos += 4;
+    }
+    if (mask->custom3)
+    {
+        memcpy(&data[pos], &custom3, 4); pos += 4;
+    }
+
+    // Append params ages.
+    if (mask->timestamps)
+        encodeTimestamps(timestamps, data, pos);
+
+    size = pos;
+
+    return true;
+}
+
+
+
+bool cr::lens::LensParams::decode(uint8_t* data, int dataSize)
+{
+    // Check data size.
+    if (dataSize < 11)
+        return false;
+
+    // Check header.
+    if (data[0] != 0x02 && data[0] != 0x03)
+        return false;
+
+    // Check version.
+    if (data[1] != LENS_MAJOR_VERSION ||
+        data[2] != LENS_MINOR_VERSION)
+        return false;
+
+    // Compact params.
+    if (data[0] == 0x03)
+        return decodeCompact(data, dataSize);
+
+    int pos = 10;
+    if ((data[3] & (uint8_t)128) == (uint8_t)128)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&zoomPos, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        zoomPos = 0;
+    }
+    if ((data[3] & (uint8_t)64) == (uint8_t)64)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&zoomHwPos, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        zoomHwPos = 0;
+    }
+    if ((data[3] & (uint8_t)32) == (uint8_t)32)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&focusPos, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        focusPos = 0;
+    }
+    if ((data[3] & (uint8_t)16) == (uint8_t)16)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&focusHwPos, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        focusHwPos = 0;
+    }
+    if ((data[3] & (uint8_t)8) == (uint8_t)8)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&irisPos, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        irisPos = 0;
+    }
+    if ((data[3] & (uint8_t)4) == (uint8_t)4)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&irisHwPos, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        irisHwPos = 0;
+    }
+    if ((data[3] & (uint8_t)2) == (uint8_t)2)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&focusMode, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        focusMode = 0;
+    }
+    if ((data[3] & (uint8_t)1) == (uint8_t)1)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&filterMode, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        filterMode = 0;
+    }
+
+
+    if ((data[4] & (uint8_t)128) == (uint8_t)128)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&afRoiX0, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        afRoiX0 = 0;
+    }
+    if ((data[4] & (uint8_t)64) == (uint8_t)64)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&afRoiY0, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        afRoiY0 = 0;
+    }
+    if ((data[4] & (uint8_t)32) == (uint8_t)32)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&afRoiX1, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        afRoiX1 = 0;
+    }
+    if ((data[4] & (uint8_t)16) == (uint8_t)16)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&afRoiY1, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        afRoiY1 = 0;
+    }
+    if ((data[4] & (uint8_t)8) == (uint8_t)8)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&zoomSpeed, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        zoomSpeed = 0;
+    }
+    if ((data[4] & (uint8_t)4) == (uint8_t)4)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&zoomHwSpeed, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        zoomHwSpeed = 0;
+    }
+    if ((data[4] & (uint8_t)2) == (uint8_t)2)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&zoomHwMaxSpeed, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        zoomHwMaxSpeed = 0;
+    }
+    if ((data[4] & (uint8_t)1) == (uint8_t)1)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&focusSpeed, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        focusSpeed = 0;
+    }
+
+
+
+    if ((data[5] & (uint8_t)128) == (uint8_t)128)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&focusHwSpeed, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        focusHwSpeed = 0;
+    }
+    if ((data[5] & (uint8_t)64) == (uint8_t)64)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&focusHwMaxSpeed, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        focusHwMaxSpeed = 0;
+    }
+    if ((data[5] & (uint8_t)32) == (uint8_t)32)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&irisSpeed, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        irisSpeed = 0;
+    }
+    if ((data[5] & (uint8_t)16) == (uint8_t)16)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&irisHwSpeed, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        irisHwSpeed = 0;
+    }
+    if ((data[5] & (uint8_t)8) == (uint8_t)8)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&irisHwMaxSpeed, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        irisHwMaxSpeed = 0;
+    }
+    if ((data[5] & (uint8_t)4) == (uint8_t)4)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&zoomHwTeleLimit, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        zoomHwTeleLimit = 0;
+    }
+    if ((data[5] & (uint8_t)2) == (uint8_t)2)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&zoomHwWideLimit, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        zoomHwWideLimit = 0;
+    }
+    if ((data[5] & (uint8_t)1) == (uint8_t)1)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&focusHwFarLimit, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        focusHwFarLimit = 0;
+    }
+
+
+
+    if ((data[6] & (uint8_t)128) == (uint8_t)128)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&focusHwNearLimit, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        focusHwNearLimit = 0;
+    }
+    if ((data[6] & (uint8_t)64) == (uint8_t)64)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&irisHwOpenLimit, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        irisHwOpenLimit = 0;
+    }
+    if ((data[6] & (uint8_t)32) == (uint8_t)32)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&irisHwCloseLimit, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        irisHwCloseLimit = 0;
+    }
+    if ((data[6] & (uint8_t)16) == (uint8_t)16)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&focusFactor, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        focusFactor = 0;
+    }
+    if ((data[6] & (uint8_t)8) == (uint8_t)8)
+    {
+        if (dataSize < pos + 1)
+            return false;
+        isConnected = data[pos] == 0x00 ? false : true; pos += 1;
+    }
+    else
+    {
+        isConnected = false;
+    }
+    if ((data[6] & (uint8_t)4) == (uint8_t)4)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&afHwSpeed, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        afHwSpeed = 0;
+    }
+    if ((data[6] & (uint8_t)2) == (uint8_t)2)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&focusFactorThreshold, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        focusFactorThreshold = 0;
+    }
+    if ((data[6] & (uint8_t)1) == (uint8_t)1)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&refocusTimeoutSec, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        refocusTimeoutSec = 0;
+    }
+
+
+
+    if ((data[7] & (uint8_t)128) == (uint8_t)128)
+    {
+        if (dataSize < pos + 1)
+            return false;
+        afIsActive = data[pos] == 0x00 ? false : true; pos += 1;
+    }
+    else
+    {
+        afIsActive = false;
+    }
+    if ((data[7] & (uint8_t)64) == (uint8_t)64)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&irisMode, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        irisMode = 0;
+    }
+    if ((data[7] & (uint8_t)32) == (uint8_t)32)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&autoAfRoiWidth, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        autoAfRoiWidth = 0;
+    }
+    if ((data[7] & (uint8_t)16) == (uint8_t)16)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&autoAfRoiHeight, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        autoAfRoiHeight = 0;
+    }
+    if ((data[7] & (uint8_t)8) == (uint8_t)8)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&autoAfRoiBorder, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        autoAfRoiBorder = 0;
+    }
+    if ((data[7] & (uint8_t)4) == (uint8_t)4)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&afRoiMode, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        afRoiMode = 0;
+    }
+    if ((data[7] & (uint8_t)2) == (uint8_t)2)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&extenderMode, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        extenderMode = 0;
+    }
+    if ((data[7] & (uint8_t)1) == (uint8_t)1)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&stabiliserMode, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        stabiliserMode = 0;
+    }
+
+
+    if ((data[8] & (uint8_t)128) == (uint8_t)128)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&afRange, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        afRange = 0;
+    }
+    if ((data[8] & (uint8_t)64) == (uint8_t)64)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&xFovDeg, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        xFovDeg = 0.0f;
+    }
+    if ((data[8] & (uint8_t)32) == (uint8_t)32)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&yFovDeg, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        yFovDeg = 0.0f;
+    }
+    if ((data[8] & (uint8_t)16) == (uint8_t)16)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&logMode, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        logMode = 0;
+    }
+    if ((data[8] & (uint8_t)8) == (uint8_t)8)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&temperature, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        temperature = 0;
+    }
+    if ((data[8] & (uint8_t)4) == (uint8_t)4)
+    {
+        if (dataSize < pos + 1)
+            return false;
+        isOpen = data[pos] == 0x00 ? false : true; pos += 1;
+    }
+    else
+    {
+        isOpen = false;
+    }
+    if ((data[8] & (uint8_t)2) == (uint8_t)2)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&type, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        type = 0;
+    }
+    if ((data[8] & (uint8_t)1) == (uint8_t)1)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&custom1, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        custom1 = 0.0f;
+    }
+
+
+    if ((data[9] & (uint8_t)128) == (uint8_t)128)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&custom2, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        custom2 = 0.0f;
+    }
+    if ((data[9] & (uint8_t)64) == (uint8_t)64)
+    {
+        if (dataSize < pos + 4)
+            return false;
+        memcpy(&custom3, &data[pos], 4); pos += 4;
+    }
+    else
+    {
+        custom3 = 0.0f;
+    }
+
+    initString = "";
+    fovPoints.clear();
+    trackingCurves.clear();
+    distortionPoints.clear();
 
-    return *this;
+    return decodeTimestamps(timestamps, data, dataSize, pos);
 }
 
 
 
-bool cr::lens::LensParams::encode(uint8_t* data, int bufferSize, int& size,
-                                  cr::lens::LensParamsMask* mask)
+bool cr::lens::LensParams::encodeCompact(uint8_t* data, int bufferSize,
+                                         int& size,
+                                         cr::lens::LensParamsMask* mask)
 {
+    // Set mask.
+    cr::lens::LensParamsMask defaultMask;
+    if (mask == nullptr)
+        mask = &defaultMask;
+
     // Check buffer size.
-    if (bufferSize < 201)
+    if (bufferSize < (mask->timestamps ? 334 : 234))
         return false;
 
     // Encode version.
     int pos = 0;
-    data[pos] = 0x02; pos += 1;
+    data[pos] = 0x03; pos += 1;
     data[pos] = LENS_MAJOR_VERSION; pos += 1;
     data[pos] = LENS_MINOR_VERSION; pos += 1;
 
-    // Set mask.
-    cr::lens::LensParamsMask defaultMask;
-    if (mask == nullptr)
-        mask = &defaultMask;
-
     // Prepare mask.
-    data[pos] = 0;
-    data[pos] = data[pos] | (mask->zoomPos ? (uint8_t)128 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->zoomHwPos ? (uint8_t)64 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->focusPos ? (uint8_t)32 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->focusHwPos ? (uint8_t)16 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->irisPos ? (uint8_t)8 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->irisHwPos ? (uint8_t)4 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->focusMode ? (uint8_t)2 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->filterMode ? (uint8_t)1 : (uint8_t)0);
-    pos += 1;
-    data[pos] = 0;
-    data[pos] = data[pos] | (mask->afRoiX0 ? (uint8_t)128 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->afRoiY0 ? (uint8_t)64 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->afRoiX1 ? (uint8_t)32 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->afRoiY1 ? (uint8_t)16 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->zoomSpeed ? (uint8_t)8 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->zoomHwSpeed ? (uint8_t)4 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->zoomHwMaxSpeed ? (uint8_t)2 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->focusSpeed ? (uint8_t)1 : (uint8_t)0);
-    pos += 1;
-    data[pos] = 0;
-    data[pos] = data[pos] | (mask->focusHwSpeed ? (uint8_t)128 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->focusHwMaxSpeed ? (uint8_t)64 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->irisSpeed ? (uint8_t)32 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->irisHwSpeed ? (uint8_t)16 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->irisHwMaxSpeed ? (uint8_t)8 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->zoomHwTeleLimit ? (uint8_t)4 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->zoomHwWideLimit ? (uint8_t)2 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->focusHwFarLimit ? (uint8_t)1 : (uint8_t)0);
-    pos += 1;
-    data[pos] = 0;
-    data[pos] = data[pos] | (mask->focusHwNearLimit ? (uint8_t)128 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->irisHwOpenLimit ? (uint8_t)64 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->irisHwCloseLimit ? (uint8_t)32 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->focusFactor ? (uint8_t)16 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->isConnected ? (uint8_t)8 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->afHwSpeed ? (uint8_t)4 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->focusFactorThreshold ? (uint8_t)2 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->refocusTimeoutSec ? (uint8_t)1 : (uint8_t)0);
-    pos += 1;
-    data[pos] = 0;
-    data[pos] = data[pos] | (mask->afIsActive ? (uint8_t)128 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->irisMode ? (uint8_t)64 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->autoAfRoiWidth ? (uint8_t)32 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->autoAfRoiHeight ? (uint8_t)16 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->autoAfRoiBorder ? (uint8_t)8 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->afRoiMode ? (uint8_t)4 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->extenderMode ? (uint8_t)2 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->stabiliserMode ? (uint8_t)1 : (uint8_t)0);
-    pos += 1;
-    data[pos] = 0;
-    data[pos] = data[pos] | (mask->afRange ? (uint8_t)128 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->xFovDeg ? (uint8_t)64 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->yFovDeg ? (uint8_t)32 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->logMode ? (uint8_t)16 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->temperature ? (uint8_t)8 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->isOpen ? (uint8_t)4 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->type ? (uint8_t)2 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->custom1 ? (uint8_t)1 : (uint8_t)0);
-    pos += 1;
-    data[pos] = 0;
-    data[pos] = data[pos] | (mask->custom2 ? (uint8_t)128 : (uint8_t)0);
-    data[pos] = data[pos] | (mask->custom3 ? (uint8_t)64 : (uint8_t)0);
-    pos += 1;
+    encodeLensParamsMask(mask, &data[pos]);
+    pos += 7;
+
+    // Pack boolean fields to one byte.
+    if (mask->isConnected || mask->afIsActive || mask->isOpen)
+    {
+        data[pos] = 0;
+        data[pos] = data[pos] | (isConnected ? (uint8_t)1 : (uint8_t)0);
+        data[pos] = data[pos] | (afIsActive ? (uint8_t)2 : (uint8_t)0);
+        data[pos] = data[pos] | (isOpen ? (uint8_t)4 : (uint8_t)0);
+        pos += 1;
+    }
 
     // Encode data.
+    uint16_t half = 0;
     if (mask->zoomPos)
     {
-        memcpy(&data[pos], &zoomPos, 4); pos += 4;
+        writeVarint(data, pos, zoomPos);
     }
     if (mask->zoomHwPos)
     {
-        memcpy(&data[pos], &zoomHwPos, 4); pos += 4;
+        writeVarint(data, pos, zoomHwPos);
     }
     if (mask->focusPos)
     {
-        memcpy(&data[pos], &focusPos, 4); pos += 4;
+        writeVarint(data, pos, focusPos);
     }
     if (mask->focusHwPos)
     {
-        memcpy(&data[pos], &focusHwPos, 4); pos += 4;
+        writeVarint(data, pos, focusHwPos);
     }
     if (mask->irisPos)
     {
-        memcpy(&data[pos], &irisPos, 4); pos += 4;
+        writeVarint(data, pos, irisPos);
     }
     if (mask->irisHwPos)
     {
-        memcpy(&data[pos], &irisHwPos, 4); pos += 4;
+        writeVarint(data, pos, irisHwPos);
     }
     if (mask->focusMode)
     {
-        memcpy(&data[pos], &focusMode, 4); pos += 4;
+        writeVarint(data, pos, focusMode);
     }
     if (mask->filterMode)
     {
-        memcpy(&data[pos], &filterMode, 4); pos += 4;
+        writeVarint(data, pos, filterMode);
     }
     if (mask->afRoiX0)
     {
-        memcpy(&data[pos], &afRoiX0, 4); pos += 4;
+        writeVarint(data, pos, afRoiX0);
     }
     if (mask->afRoiY0)
     {
-        memcpy(&data[pos], &afRoiY0, 4); pos += 4;
+        writeVarint(data, pos, afRoiY0);
     }
     if (mask->afRoiX1)
     {
-        memcpy(&data[pos], &afRoiX1, 4); pos += 4;
+        writeVarint(data, pos, afRoiX1);
     }
     if (mask->afRoiY1)
     {
-        memcpy(&data[pos], &afRoiY1, 4); pos += 4;
+        writeVarint(data, pos, afRoiY1);
     }
     if (mask->zoomSpeed)
     {
-        memcpy(&data[pos], &zoomSpeed, 4); pos += 4;
+        writeVarint(data, pos, zoomSpeed);
     }
     if (mask->zoomHwSpeed)
     {
-        memcpy(&data[pos], &zoomHwSpeed, 4); pos += 4;
+        writeVarint(data, pos, zoomHwSpeed);
     }
     if (mask->zoomHwMaxSpeed)
     {
-        memcpy(&data[pos], &zoomHwMaxSpeed, 4); pos += 4;
+        writeVarint(data, pos, zoomHwMaxSpeed);
     }
     if (mask->focusSpeed)
     {
-        memcpy(&data[pos], &focusSpeed, 4); pos += 4;
+        writeVarint(data, pos, focusSpeed);
     }
     if (mask->focusHwSpeed)
     {
-        memcpy(&data[pos], &focusHwSpeed, 4); pos += 4;
+        writeVarint(data, pos, focusHwSpeed);
     }
     if (mask->focusHwMaxSpeed)
     {
-        memcpy(&data[pos], &focusHwMaxSpeed, 4); pos += 4;
+        writeVarint(data, pos, focusHwMaxSpeed);
     }
     if (mask->irisSpeed)
     {
-        memcpy(&data[pos], &irisSpeed, 4); pos += 4;
+        writeVarint(data, pos, irisSpeed);
     }
     if (mask->irisHwSpeed)
     {
-        memcpy(&data[pos], &irisHwSpeed, 4); pos += 4;
+        writeVarint(data, pos, irisHwSpeed);
     }
     if (mask->irisHwMaxSpeed)
     {
-        memcpy(&data[pos], &irisHwMaxSpeed, 4); pos += 4;
+        writeVarint(data, pos, irisHwMaxSpeed);
     }
     if (mask->zoomHwTeleLimit)
     {
-        memcpy(&data[pos], &zoomHwTeleLimit, 4); pos += 4;
+        writeVarint(data, pos, zoomHwTeleLimit);
     }
     if (mask->zoomHwWideLimit)
     {
-        memcpy(&data[pos], &zoomHwWideLimit, 4); pos += 4;
+        writeVarint(data, pos, zoomHwWideLimit);
     }
     if (mask->focusHwFarLimit)
     {
-        memcpy(&data[pos], &focusHwFarLimit, 4); pos += 4;
+        writeVarint(data, pos, focusHwFarLimit);
     }
     if (mask->focusHwNearLimit)
     {
-        memcpy(&data[pos], &focusHwNearLimit, 4); pos += 4;
+        writeVarint(data, pos, focusHwNearLimit);
     }
     if (mask->irisHwOpenLimit)
     {
-        memcpy(&data[pos], &irisHwOpenLimit, 4); pos += 4;
+        writeVarint(data, pos, irisHwOpenLimit);
     }
     if (mask->irisHwCloseLimit)
     {
-        memcpy(&data[pos], &irisHwCloseLimit, 4); pos += 4;
+        writeVarint(data, pos, irisHwCloseLimit);
     }
     if (mask->focusFactor)
     {
         memcpy(&data[pos], &focusFactor, 4); pos += 4;
     }
-    if (mask->isConnected)
-    {
-        data[pos] = isConnected ? 0x01 : 0x00; pos += 1;
-    }
     if (mask->afHwSpeed)
     {
-        memcpy(&data[pos], &afHwSpeed, 4); pos += 4;
+        writeVarint(data, pos, afHwSpeed);
     }
     if (mask->focusFactorThreshold)
     {
-        memcpy(&data[pos], &focusFactorThreshold, 4); pos += 4;
+        half = floatToHalf(focusFactorThreshold);
+        memcpy(&data[pos], &half, 2); pos += 2;
     }
     if (mask->refocusTimeoutSec)
     {
-        memcpy(&data[pos], &refocusTimeoutSec, 4); pos += 4;
-    }
-    if (mask->afIsActive)
-    {
-        data[pos] = afIsActive ? 0x01 : 0x00; pos += 1;
+        writeVarint(data, pos, refocusTimeoutSec);
     }
     if (mask->irisMode)
     {
-        memcpy(&data[pos], &irisMode, 4); pos += 4;
+        writeVarint(data, pos, irisMode);
     }
     if (mask->autoAfRoiWidth)
     {
-        memcpy(&data[pos], &autoAfRoiWidth, 4); pos += 4;
+        writeVarint(data, pos, autoAfRoiWidth);
     }
     if (mask->autoAfRoiHeight)
     {
-        memcpy(&data[pos], &autoAfRoiHeight, 4); pos += 4;
+        writeVarint(data, pos, autoAfRoiHeight);
     }
     if (mask->autoAfRoiBorder)
     {
-        memcpy(&data[pos], &autoAfRoiBorder, 4); pos += 4;
+        writeVarint(data, pos, autoAfRoiBorder);
     }
     if (mask->afRoiMode)
     {
-        memcpy(&data[pos], &afRoiMode, 4); pos += 4;
+        writeVarint(data, pos, afRoiMode);
     }
     if (mask->extenderMode)
     {
-        memcpy(&data[pos], &extenderMode, 4); pos += 4;
+        writeVarint(data, pos, extenderMode);
     }
     if (mask->stabiliserMode)
     {
-        memcpy(&data[pos], &stabiliserMode, 4); pos += 4;
+        writeVarint(data, pos, stabiliserMode);
     }
     if (mask->afRange)
     {
-        memcpy(&data[pos], &afRange, 4); pos += 4;
+        writeVarint(data, pos, afRange);
     }
     if (mask->xFovDeg)
     {
@@ -343,19 +1700,16 @@ bool cr::lens::LensParams::encode(uint8_t* data, int bufferSize, int& size,
     }
     if (mask->logMode)
     {
-        memcpy(&data[pos], &logMode, 4); pos += 4;
+        writeVarint(data, pos, logMode);
     }
     if (mask->temperature)
     {
-        memcpy(&data[pos], &temperature, 4); pos += 4;
-    }
-    if (mask->isOpen)
-    {
-        data[pos] = isOpen ? 0x01 : 0x00; pos += 1;
+        half = floatToHalf(temperature);
+        memcpy(&data[pos], &half, 2); pos += 2;
     }
     if (mask->type)
     {
-        memcpy(&data[pos], &type, 4); pos += 4;
+        writeVarint(data, pos, type);
     }
     if (mask->custom1)
     {
@@ -370,6 +1724,10 @@ bool cr::lens::LensParams::encode(uint8_t* data, int bufferSize, int& size,
         memcpy(&data[pos], &custom3, 4); pos += 4;
     }
 
+    // Append params ages.
+    if (mask->timestamps)
+        encodeTimestamps(timestamps, data, pos);
+
     size = pos;
 
     return true;
@@ -377,446 +1735,388 @@ bool cr::lens::LensParams::encode(uint8_t* data, int bufferSize, int& size,
 
 
 
-bool cr::lens::LensParams::decode(uint8_t* data, int dataSize)
+bool cr::lens::LensParams::decodeCompact(uint8_t* data, int dataSize)
 {
     // Check data size.
-    if (dataSize < 11)
-        return false;
-
-    // Check header.
-    if (data[0] != 0x02)
+    if (dataSize < 10)
         return false;
 
-    // Check version.
-    if (data[1] != LENS_MAJOR_VERSION ||
-        data[2] != LENS_MINOR_VERSION)
-        return false;
+    // Decode mask.
+    cr::lens::LensParamsMask mask;
+    decodeLensParamsMask(&data[3], mask);
 
+    // Decode boolean fields.
     int pos = 10;
-    if ((data[3] & (uint8_t)128) == (uint8_t)128)
+    isConnected = false;
+    afIsActive = false;
+    isOpen = false;
+    if (mask.isConnected || mask.afIsActive || mask.isOpen)
     {
-        if (dataSize < pos + 4)
+        if (dataSize < pos + 1)
+            return false;
+        isConnected = mask.isConnected && (data[pos] & (uint8_t)1) != 0;
+        afIsActive = mask.afIsActive && (data[pos] & (uint8_t)2) != 0;
+        isOpen = mask.isOpen && (data[pos] & (uint8_t)4) != 0;
+        pos += 1;
+    }
+
+    // Decode data.
+    uint16_t half = 0;
+    if (mask.zoomPos)
+    {
+        if (!readVarint(data, dataSize, pos, zoomPos))
             return false;
-        memcpy(&zoomPos, &data[pos], 4); pos += 4;
     }
     else
     {
         zoomPos = 0;
     }
-    if ((data[3] & (uint8_t)64) == (uint8_t)64)
+    if (mask.zoomHwPos)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, zoomHwPos))
             return false;
-        memcpy(&zoomHwPos, &data[pos], 4); pos += 4;
     }
     else
     {
         zoomHwPos = 0;
     }
-    if ((data[3] & (uint8_t)32) == (uint8_t)32)
+    if (mask.focusPos)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, focusPos))
             return false;
-        memcpy(&focusPos, &data[pos], 4); pos += 4;
     }
     else
     {
         focusPos = 0;
     }
-    if ((data[3] & (uint8_t)16) == (uint8_t)16)
+    if (mask.focusHwPos)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, focusHwPos))
             return false;
-        memcpy(&focusHwPos, &data[pos], 4); pos += 4;
     }
     else
     {
         focusHwPos = 0;
     }
-    if ((data[3] & (uint8_t)8) == (uint8_t)8)
+    if (mask.irisPos)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, irisPos))
             return false;
-        memcpy(&irisPos, &data[pos], 4); pos += 4;
     }
     else
     {
         irisPos = 0;
     }
-    if ((data[3] & (uint8_t)4) == (uint8_t)4)
+    if (mask.irisHwPos)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, irisHwPos))
             return false;
-        memcpy(&irisHwPos, &data[pos], 4); pos += 4;
     }
     else
     {
         irisHwPos = 0;
     }
-    if ((data[3] & (uint8_t)2) == (uint8_t)2)
+    if (mask.focusMode)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, focusMode))
             return false;
-        memcpy(&focusMode, &data[pos], 4); pos += 4;
     }
     else
     {
         focusMode = 0;
     }
-    if ((data[3] & (uint8_t)1) == (uint8_t)1)
+    if (mask.filterMode)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, filterMode))
             return false;
-        memcpy(&filterMode, &data[pos], 4); pos += 4;
     }
     else
     {
         filterMode = 0;
     }
-
-
-    if ((data[4] & (uint8_t)128) == (uint8_t)128)
+    if (mask.afRoiX0)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, afRoiX0))
             return false;
-        memcpy(&afRoiX0, &data[pos], 4); pos += 4;
     }
     else
     {
         afRoiX0 = 0;
     }
-    if ((data[4] & (uint8_t)64) == (uint8_t)64)
+    if (mask.afRoiY0)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, afRoiY0))
             return false;
-        memcpy(&afRoiY0, &data[pos], 4); pos += 4;
     }
     else
     {
         afRoiY0 = 0;
     }
-    if ((data[4] & (uint8_t)32) == (uint8_t)32)
+    if (mask.afRoiX1)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, afRoiX1))
             return false;
-        memcpy(&afRoiX1, &data[pos], 4); pos += 4;
     }
     else
     {
         afRoiX1 = 0;
     }
-    if ((data[4] & (uint8_t)16) == (uint8_t)16)
+    if (mask.afRoiY1)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, afRoiY1))
             return false;
-        memcpy(&afRoiY1, &data[pos], 4); pos += 4;
     }
     else
     {
         afRoiY1 = 0;
     }
-    if ((data[4] & (uint8_t)8) == (uint8_t)8)
+    if (mask.zoomSpeed)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, zoomSpeed))
             return false;
-        memcpy(&zoomSpeed, &data[pos], 4); pos += 4;
     }
     else
     {
         zoomSpeed = 0;
     }
-    if ((data[4] & (uint8_t)4) == (uint8_t)4)
+    if (mask.zoomHwSpeed)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, zoomHwSpeed))
             return false;
-        memcpy(&zoomHwSpeed, &data[pos], 4); pos += 4;
     }
     else
     {
         zoomHwSpeed = 0;
     }
-    if ((data[4] & (uint8_t)2) == (uint8_t)2)
+    if (mask.zoomHwMaxSpeed)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, zoomHwMaxSpeed))
             return false;
-        memcpy(&zoomHwMaxSpeed, &data[pos], 4); pos += 4;
     }
     else
     {
         zoomHwMaxSpeed = 0;
     }
-    if ((data[4] & (uint8_t)1) == (uint8_t)1)
+    if (mask.focusSpeed)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, focusSpeed))
             return false;
-        memcpy(&focusSpeed, &data[pos], 4); pos += 4;
     }
     else
     {
         focusSpeed = 0;
     }
-
-
-
-    if ((data[5] & (uint8_t)128) == (uint8_t)128)
+    if (mask.focusHwSpeed)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, focusHwSpeed))
             return false;
-        memcpy(&focusHwSpeed, &data[pos], 4); pos += 4;
     }
     else
     {
         focusHwSpeed = 0;
     }
-    if ((data[5] & (uint8_t)64) == (uint8_t)64)
+    if (mask.focusHwMaxSpeed)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, focusHwMaxSpeed))
             return false;
-        memcpy(&focusHwMaxSpeed, &data[pos], 4); pos += 4;
     }
     else
     {
         focusHwMaxSpeed = 0;
     }
-    if ((data[5] & (uint8_t)32) == (uint8_t)32)
+    if (mask.irisSpeed)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, irisSpeed))
             return false;
-        memcpy(&irisSpeed, &data[pos], 4); pos += 4;
     }
     else
     {
         irisSpeed = 0;
     }
-    if ((data[5] & (uint8_t)16) == (uint8_t)16)
+    if (mask.irisHwSpeed)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, irisHwSpeed))
             return false;
-        memcpy(&irisHwSpeed, &data[pos], 4); pos += 4;
     }
     else
     {
         irisHwSpeed = 0;
     }
-    if ((data[5] & (uint8_t)8) == (uint8_t)8)
+    if (mask.irisHwMaxSpeed)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, irisHwMaxSpeed))
             return false;
-        memcpy(&irisHwMaxSpeed, &data[pos], 4); pos += 4;
     }
     else
     {
         irisHwMaxSpeed = 0;
     }
-    if ((data[5] & (uint8_t)4) == (uint8_t)4)
+    if (mask.zoomHwTeleLimit)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, zoomHwTeleLimit))
             return false;
-        memcpy(&zoomHwTeleLimit, &data[pos], 4); pos += 4;
     }
     else
     {
         zoomHwTeleLimit = 0;
     }
-    if ((data[5] & (uint8_t)2) == (uint8_t)2)
+    if (mask.zoomHwWideLimit)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, zoomHwWideLimit))
             return false;
-        memcpy(&zoomHwWideLimit, &data[pos], 4); pos += 4;
     }
     else
     {
         zoomHwWideLimit = 0;
     }
-    if ((data[5] & (uint8_t)1) == (uint8_t)1)
+    if (mask.focusHwFarLimit)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, focusHwFarLimit))
             return false;
-        memcpy(&focusHwFarLimit, &data[pos], 4); pos += 4;
     }
     else
     {
         focusHwFarLimit = 0;
     }
-
-
-
-    if ((data[6] & (uint8_t)128) == (uint8_t)128)
+    if (mask.focusHwNearLimit)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, focusHwNearLimit))
             return false;
-        memcpy(&focusHwNearLimit, &data[pos], 4); pos += 4;
     }
     else
     {
         focusHwNearLimit = 0;
     }
-    if ((data[6] & (uint8_t)64) == (uint8_t)64)
+    if (mask.irisHwOpenLimit)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, irisHwOpenLimit))
             return false;
-        memcpy(&irisHwOpenLimit, &data[pos], 4); pos += 4;
     }
     else
     {
         irisHwOpenLimit = 0;
     }
-    if ((data[6] & (uint8_t)32) == (uint8_t)32)
-    {
-        if (dataSize < pos + 4)
-            return false;
-        memcpy(&irisHwCloseLimit, &data[pos], 4); pos += 4;
-    }
-    else
-    {
-        irisHwCloseLimit = 0;
-    }
-    if ((data[6] & (uint8_t)16) == (uint8_t)16)
-    {
-        if (dataSize < pos + 4)
-            return false;
-        memcpy(&focusFactor, &data[pos], 4); pos += 4;
-    }
-    else
-    {
-        focusFactor = 0;
-    }
-    if ((data[6] & (uint8_t)8) == (uint8_t)8)
+    if (mask.irisHwCloseLimit)
     {
-        if (dataSize < pos + 1)
+        if (!readVarint(data, dataSize, pos, irisHwCloseLimit))
             return false;
-        isConnected = data[pos] == 0x00 ? false : true; pos += 1;
     }
     else
     {
-        isConnected = false;
+        irisHwCloseLimit = 0;
     }
-    if ((data[6] & (uint8_t)4) == (uint8_t)4)
+    if (mask.focusFactor)
     {
         if (dataSize < pos + 4)
             return false;
-        memcpy(&afHwSpeed, &data[pos], 4); pos += 4;
+        memcpy(&focusFactor, &data[pos], 4); pos += 4;
     }
     else
     {
-        afHwSpeed = 0;
+        focusFactor = 0.0f;
     }
-    if ((data[6] & (uint8_t)2) == (uint8_t)2)
+    if (mask.afHwSpeed)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, afHwSpeed))
             return false;
-        memcpy(&focusFactorThreshold, &data[pos], 4); pos += 4;
     }
     else
     {
-        focusFactorThreshold = 0;
+        afHwSpeed = 0;
     }
-    if ((data[6] & (uint8_t)1) == (uint8_t)1)
+    if (mask.focusFactorThreshold)
     {
-        if (dataSize < pos + 4)
+        if (dataSize < pos + 2)
             return false;
-        memcpy(&refocusTimeoutSec, &data[pos], 4); pos += 4;
+        memcpy(&half, &data[pos], 2); pos += 2;
+        focusFactorThreshold = halfToFloat(half);
     }
     else
     {
-        refocusTimeoutSec = 0;
+        focusFactorThreshold = 0.0f;
     }
-
-
-
-    if ((data[7] & (uint8_t)128) == (uint8_t)128)
+    if (mask.refocusTimeoutSec)
     {
-        if (dataSize < pos + 1)
+        if (!readVarint(data, dataSize, pos, refocusTimeoutSec))
             return false;
-        afIsActive = data[pos] == 0x00 ? false : true; pos += 1;
     }
     else
     {
-        afIsActive = false;
+        refocusTimeoutSec = 0;
     }
-    if ((data[7] & (uint8_t)64) == (uint8_t)64)
+    if (mask.irisMode)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, irisMode))
             return false;
-        memcpy(&irisMode, &data[pos], 4); pos += 4;
     }
     else
     {
         irisMode = 0;
     }
-    if ((data[7] & (uint8_t)32) == (uint8_t)32)
+    if (mask.autoAfRoiWidth)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, autoAfRoiWidth))
             return false;
-        memcpy(&autoAfRoiWidth, &data[pos], 4); pos += 4;
     }
     else
     {
         autoAfRoiWidth = 0;
     }
-    if ((data[7] & (uint8_t)16) == (uint8_t)16)
+    if (mask.autoAfRoiHeight)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, autoAfRoiHeight))
             return false;
-        memcpy(&autoAfRoiHeight, &data[pos], 4); pos += 4;
     }
     else
     {
         autoAfRoiHeight = 0;
     }
-    if ((data[7] & (uint8_t)8) == (uint8_t)8)
+    if (mask.autoAfRoiBorder)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, autoAfRoiBorder))
             return false;
-        memcpy(&autoAfRoiBorder, &data[pos], 4); pos += 4;
     }
     else
     {
         autoAfRoiBorder = 0;
     }
-    if ((data[7] & (uint8_t)4) == (uint8_t)4)
+    if (mask.afRoiMode)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, afRoiMode))
             return false;
-        memcpy(&afRoiMode, &data[pos], 4); pos += 4;
     }
     else
     {
         afRoiMode = 0;
     }
-    if ((data[7] & (uint8_t)2) == (uint8_t)2)
+    if (mask.extenderMode)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, extenderMode))
             return false;
-        memcpy(&extenderMode, &data[pos], 4); pos += 4;
     }
     else
     {
         extenderMode = 0;
     }
-    if ((data[7] & (uint8_t)1) == (uint8_t)1)
+    if (mask.stabiliserMode)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, stabiliserMode))
             return false;
-        memcpy(&stabiliserMode, &data[pos], 4); pos += 4;
     }
     else
     {
         stabiliserMode = 0;
     }
-
-
-    if ((data[8] & (uint8_t)128) == (uint8_t)128)
+    if (mask.afRange)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, afRange))
             return false;
-        memcpy(&afRange, &data[pos], 4); pos += 4;
     }
     else
     {
         afRange = 0;
     }
-    if ((data[8] & (uint8_t)64) == (uint8_t)64)
+    if (mask.xFovDeg)
     {
         if (dataSize < pos + 4)
             return false;
@@ -826,7 +2126,7 @@ bool cr::lens::LensParams::decode(uint8_t* data, int dataSize)
     {
         xFovDeg = 0.0f;
     }
-    if ((data[8] & (uint8_t)32) == (uint8_t)32)
+    if (mask.yFovDeg)
     {
         if (dataSize < pos + 4)
             return false;
@@ -836,47 +2136,36 @@ bool cr::lens::LensParams::decode(uint8_t* data, int dataSize)
     {
         yFovDeg = 0.0f;
     }
-    if ((data[8] & (uint8_t)16) == (uint8_t)16)
+    if (mask.logMode)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, logMode))
             return false;
-        memcpy(&logMode, &data[pos], 4); pos += 4;
     }
     else
     {
         logMode = 0;
     }
-    if ((data[8] & (uint8_t)8) == (uint8_t)8)
-    {
-        if (dataSize < pos + 4)
-            return false;
-        memcpy(&temperature, &data[pos], 4); pos += 4;
-    }
-    else
-    {
-        temperature = 0;
-    }
-    if ((data[8] & (uint8_t)4) == (uint8_t)4)
+    if (mask.temperature)
     {
-        if (dataSize < pos + 1)
+        if (dataSize < pos + 2)
             return false;
-        isOpen = data[pos] == 0x00 ? false : true; pos += 1;
+        memcpy(&half, &data[pos], 2); pos += 2;
+        temperature = halfToFloat(half);
     }
     else
     {
-        isOpen = false;
+        temperature = 0.0f;
     }
-    if ((data[8] & (uint8_t)2) == (uint8_t)2)
+    if (mask.type)
     {
-        if (dataSize < pos + 4)
+        if (!readVarint(data, dataSize, pos, type))
             return false;
-        memcpy(&type, &data[pos], 4); pos += 4;
     }
     else
     {
         type = 0;
     }
-    if ((data[8] & (uint8_t)1) == (uint8_t)1)
+    if (mask.custom1)
     {
         if (dataSize < pos + 4)
             return false;
@@ -886,9 +2175,7 @@ bool cr::lens::LensParams::decode(uint8_t* data, int dataSize)
     {
         custom1 = 0.0f;
     }
-
-
-    if ((data[9] & (uint8_t)128) == (uint8_t)128)
+    if (mask.custom2)
     {
         if (dataSize < pos + 4)
             return false;
@@ -898,11 +2185,11 @@ bool cr::lens::LensParams::decode(uint8_t* data, int dataSize)
     {
         custom2 = 0.0f;
     }
-    if ((data[9] & (uint8_t)64) == (uint8_t)64)
+    if (mask.custom3)
     {
         if (dataSize < pos + 4)
             return false;
-        memcpy(&custom3, &data[pos], 4);
+        memcpy(&custom3, &data[pos], 4); pos += 4;
     }
     else
     {
@@ -911,6 +2198,203 @@ bool cr::lens::LensParams::decode(uint8_t* data, int dataSize)
 
     initString = "";
     fovPoints.clear();
+    trackingCurves.clear();
+    distortionPoints.clear();
+
+    return decodeTimestamps(timestamps, data, dataSize, pos);
+}
+
+
+
+int cr::lens::LensParams::getSerializedSize()
+{
+    // Header, frame size, params, string length, string, number of points,
+    // points, number of tracking curves, curves (distance, number of points
+    // and points), number of distortion points and distortion points.
+    int size = 3 + 4 + 201 + 4 + (int)initString.size() + 4 +
+               (int)fovPoints.size() * 12 + 4;
+    const std::vector<TrackingCurve>& curves = trackingCurves;
+    for (size_t i = 0; i < curves.size(); ++i)
+        size += 8 + (int)curves[i].points.size() * 8;
+    size += 4 + (int)distortionPoints.size() * 24;
+    return size;
+}
+
+
+
+bool cr::lens::LensParams::serialize(uint8_t* data, int bufferSize, int& size)
+{
+    // Check buffer size.
+    int frameSize = getSerializedSize();
+    if (bufferSize < frameSize)
+        return false;
+
+    // Encode version.
+    int pos = 0;
+    data[pos] = 0x04; pos += 1;
+    data[pos] = LENS_MAJOR_VERSION; pos += 1;
+    data[pos] = LENS_MINOR_VERSION; pos += 1;
+    uint32_t value = (uint32_t)frameSize;
+    memcpy(&data[pos], &value, 4); pos += 4;
+
+    // Encode all numeric params.
+    int paramsSize = 0;
+    if (!encode(&data[pos], bufferSize - pos, paramsSize))
+        return false;
+    pos += paramsSize;
+
+    // Encode initialization string.
+    value = (uint32_t)initString.size();
+    memcpy(&data[pos], &value, 4); pos += 4;
+    memcpy(&data[pos], initString.data(), initString.size());
+    pos += (int)initString.size();
+
+    // Encode FOV points.
+    // Tables are read by constant references to avoid copying shared data.
+    const std::vector<FovPoint>& points = fovPoints;
+    value = (uint32_t)points.size();
+    memcpy(&data[pos], &value, 4); pos += 4;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        memcpy(&data[pos], &points[i].hwZoomPos, 4); pos += 4;
+        memcpy(&data[pos], &points[i].xFovDeg, 4); pos += 4;
+        memcpy(&data[pos], &points[i].yFovDeg, 4); pos += 4;
+    }
+
+    // Encode tracking curves.
+    const std::vector<TrackingCurve>& curves = trackingCurves;
+    value = (uint32_t)curves.size();
+    memcpy(&data[pos], &value, 4); pos += 4;
+    for (size_t i = 0; i < curves.size(); ++i)
+    {
+        const TrackingCurve& curve = curves[i];
+        memcpy(&data[pos], &curve.distanceM, 4); pos += 4;
+        value = (uint32_t)curve.points.size();
+        memcpy(&data[pos], &value, 4); pos += 4;
+        for (size_t j = 0; j < curve.points.size(); ++j)
+        {
+            memcpy(&data[pos], &curve.points[j].hwZoomPos, 4); pos += 4;
+            memcpy(&data[pos], &curve.points[j].hwFocusPos, 4); pos += 4;
+        }
+    }
+
+    // Encode distortion points.
+    const std::vector<DistortionPoint>& distortion = distortionPoints;
+    value = (uint32_t)distortion.size();
+    memcpy(&data[pos], &value, 4); pos += 4;
+    for (size_t i = 0; i < distortion.size(); ++i)
+    {
+        const DistortionPoint& point = distortion[i];
+        memcpy(&data[pos], &point.hwZoomPos, 4); pos += 4;
+        memcpy(&data[pos], &point.k1, 4); pos += 4;
+        memcpy(&data[pos], &point.k2, 4); pos += 4;
+        memcpy(&data[pos], &point.p1, 4); pos += 4;
+        memcpy(&data[pos], &point.p2, 4); pos += 4;
+        memcpy(&data[pos], &point.k3, 4); pos += 4;
+    }
+
+    size = pos;
+
+    return true;
+}
+
+
+
+bool cr::lens::LensParams::deserialize(uint8_t* data, int dataSize)
+{
+    // Check data size.
+    if (dataSize < 3 + 4 + 201 + 4 + 4 + 4 + 4)
+        return false;
+
+    // Check header.
+    if (data[0] != 0x04)
+        return false;
+
+    // Check version.
+    if (data[1] != LENS_MAJOR_VERSION ||
+        data[2] != LENS_MINOR_VERSION)
+        return false;
+
+    // Check frame size.
+    uint32_t value = 0;
+    memcpy(&value, &data[3], 4);
+    if (value < 3 + 4 + 201 + 4 + 4 + 4 + 4 || value > (uint32_t)dataSize)
+        return false;
+    dataSize = (int)value;
+
+    // Decode numeric params.
+    int pos = 7;
+    if (!decode(&data[pos], 201))
+        return false;
+    pos += 201;
+
+    // Decode initialization string.
+    memcpy(&value, &data[pos], 4); pos += 4;
+    if (dataSize - pos < 4 || value > (uint32_t)(dataSize - pos - 4))
+        return false;
+    initString.assign((const char*)&data[pos], value);
+    pos += (int)value;
+
+    // Decode FOV points. Tables are interned, so identical tables of
+    // different lenses share memory.
+    memcpy(&value, &data[pos], 4); pos += 4;
+    if (value > (uint32_t)((dataSize - pos) / 12))
+        return false;
+    std::vector<FovPoint> points(value);
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        memcpy(&points[i].hwZoomPos, &data[pos], 4); pos += 4;
+        memcpy(&points[i].xFovDeg, &data[pos], 4); pos += 4;
+        memcpy(&points[i].yFovDeg, &data[pos], 4); pos += 4;
+    }
+    fovPoints = std::move(points);
+    fovPoints.intern();
+
+    // Decode tracking curves.
+    if (dataSize - pos < 4)
+        return false;
+    memcpy(&value, &data[pos], 4); pos += 4;
+    if (value > (uint32_t)((dataSize - pos) / 8))
+        return false;
+    std::vector<TrackingCurve> curves(value);
+    for (size_t i = 0; i < curves.size(); ++i)
+    {
+        TrackingCurve& curve = curves[i];
+        if (dataSize - pos < 8)
+            return false;
+        memcpy(&curve.distanceM, &data[pos], 4); pos += 4;
+        memcpy(&value, &data[pos], 4); pos += 4;
+        if (value > (uint32_t)((dataSize - pos) / 8))
+            return false;
+        curve.points.resize(value);
+        for (size_t j = 0; j < curve.points.size(); ++j)
+        {
+            memcpy(&curve.points[j].hwZoomPos, &data[pos], 4); pos += 4;
+            memcpy(&curve.points[j].hwFocusPos, &data[pos], 4); pos += 4;
+        }
+    }
+    trackingCurves = std::move(curves);
+    trackingCurves.intern();
+
+    // Decode distortion points.
+    if (dataSize - pos < 4)
+        return false;
+    memcpy(&value, &data[pos], 4); pos += 4;
+    if (value > (uint32_t)((dataSize - pos) / 24))
+        return false;
+    std::vector<DistortionPoint> distortion(value);
+    for (size_t i = 0; i < distortion.size(); ++i)
+    {
+        DistortionPoint& point = distortion[i];
+        memcpy(&point.hwZoomPos, &data[pos], 4); pos += 4;
+        memcpy(&point.k1, &data[pos], 4); pos += 4;
+        memcpy(&point.k2, &data[pos], 4); pos += 4;
+        memcpy(&point.p1, &data[pos], 4); pos += 4;
+        memcpy(&point.p2, &data[pos], 4); pos += 4;
+        memcpy(&point.k3, &data[pos], 4); pos += 4;
+    }
+    distortionPoints = std::move(distortion);
+    distortionPoints.intern();
 
     return true;
 }
@@ -1002,3 +2486,237 @@ int cr::lens::Lens::decodeCommand(uint8_t* data,
 
     return -1;
 }
+
+
+
+bool cr::lens::Lens::encodeResponse(uint8_t* data,
+                                    int bufferSize,
+                                    int& size,
+                                    int type,
+                                    int id,
+                                    bool status,
+                                    float value,
+                                    cr::lens::LensParams* params,
+                                    cr::lens::LensParamsMask* mask)
+{
+    // Check buffer size.
+    size = 0;
+    if (bufferSize < 14)
+        return false;
+
+    // Add params snapshot first to keep output unchanged if it doesn't fit.
+    int paramsSize = 0;
+    if (params != nullptr)
+    {
+        if (!params->encode(&data[14], bufferSize - 14, paramsSize, mask))
+            return false;
+    }
+
+    // Fill header.
+    data[0] = 0x05;
+    data[1] = LENS_MAJOR_VERSION;
+    data[2] = LENS_MINOR_VERSION;
+
+    // Fill data.
+    data[3] = (uint8_t)type;
+    memcpy(&data[4], &id, 4);
+    data[8] = status ? 0x01 : 0x00;
+    memcpy(&data[9], &value, 4);
+    data[13] = params == nullptr ? 0x00 : 0x01;
+    size = 14 + paramsSize;
+
+    return true;
+}
+
+
+
+int cr::lens::Lens::decodeResponse(uint8_t* data,
+                                   int size,
+                                   cr::lens::LensParam& paramId,
+                                   cr::lens::LensCommand& commandId,
+                                   bool& status,
+                                   float& value,
+                                   cr::lens::LensParams* params)
+{
+    // Check size.
+    if (size < 14)
+        return -1;
+
+    // Check header and version.
+    if (data[0] != 0x05 || data[1] != LENS_MAJOR_VERSION ||
+        data[2] != LENS_MINOR_VERSION)
+        return -1;
+
+    // Check command type and snapshot flag.
+    if (data[3] > 0x01 || data[13] > 0x01)
+        return -1;
+
+    // Decode params snapshot.
+    if (data[13] == 0x01 && params != nullptr)
+    {
+        if (!params->decode(&data[14], size - 14))
+            return -1;
+    }
+
+    // Extract data.
+    int id = 0;
+    memcpy(&id, &data[4], 4);
+    status = data[8] == 0x00 ? false : true;
+    memcpy(&value, &data[9], 4);
+    if (data[3] == 0x00)
+    {
+        commandId = (LensCommand)id;
+        return 0;
+    }
+
+    paramId = (LensParam)id;
+
+    return 1;
+}
+
+
+
+bool cr::lens::Lens::processCommand(uint8_t* data,
+                                    int size,
+                                    uint8_t* response,
+                                    int responseBufferSize,
+                                    int& responseSize,
+                                    cr::lens::LensParamsMask* mask)
+{
+    responseSize = 0;
+
+    // Decode command to get IDs.
+    LensCommand commandId = LensCommand::ZOOM_TELE;
+    LensParam paramId = LensParam::ZOOM_SPEED;
+    float value = 0.0f;
+    int type = decodeCommand(data, size, paramId, commandId, value);
+    if (type < 0)
+        return false;
+
+    // Execute command.
+    bool status = decodeAndExecuteCommand(data, size);
+
+    // Get effective value.
+    int id = 0;
+    if (type == 1)
+    {
+        id = (int)paramId;
+        if (status)
+            value = getParam(paramId);
+    }
+    else
+    {
+        id = (int)commandId;
+        if (commandId == LensCommand::ZOOM_TO_POS ||
+            commandId == LensCommand::FOCUS_TO_POS ||
+            commandId == LensCommand::IRIS_TO_POS)
+            value = value < 0.0f ? 0.0f : (value > 65535.0f ? 65535.0f : value);
+    }
+
+    // Encode response with params snapshot. If snapshot doesn't fit the
+    // buffer encode response without snapshot to deliver command status.
+    if (mask != nullptr)
+    {
+        LensParams params;
+        getParams(params);
+        if (encodeResponse(response, responseBufferSize, responseSize,
+                           type, id, status, value, &params, mask))
+            return status;
+    }
+    if (!encodeResponse(response, responseBufferSize, responseSize,
+                        type, id, status, value))
+        responseSize = 0;
+
+    return status;
+}
+
+
+
+void cr::lens::Lens::encodeSubscribeCommand(uint8_t* data,
+                                            int& size,
+                                            cr::lens::LensParamsMask* mask,
+                                            float maxRateHz,
+                                            bool compact)
+{
+    // Fill header.
+    data[0] = 0x06;
+    data[1] = LENS_MAJOR_VERSION;
+    data[2] = LENS_MINOR_VERSION;
+
+    // Fill data.
+    if (mask == nullptr)
+        memset(&data[3], 0, 7);
+    else
+        encodeLensParamsMask(mask, &data[3]);
+    if (maxRateHz < 0.0f)
+        maxRateHz = 0.0f;
+    memcpy(&data[10], &maxRateHz, 4);
+    data[14] = compact ? 0x01 : 0x00;
+    size = 15;
+}
+
+
+
+bool cr::lens::Lens::decodeSubscribeCommand(uint8_t* data,
+                                            int size,
+                                            cr::lens::LensParamsMask& mask,
+                                            float& maxRateHz,
+                                            bool& compact)
+{
+    // Check size.
+    if (size != 15)
+        return false;
+
+    // Check header and version.
+    if (data[0] != 0x06 || data[1] != LENS_MAJOR_VERSION ||
+        data[2] != LENS_MINOR_VERSION)
+        return false;
+
+    // Check profile.
+    if (data[14] > 0x01)
+        return false;
+
+    // Extract data.
+    decodeLensParamsMask(&data[3], mask);
+    memcpy(&maxRateHz, &data[10], 4);
+    if (!(maxRateHz >= 0.0f))
+        maxRateHz = 0.0f;
+    compact = data[14] == 0x01;
+
+    return true;
+}
+
+
+
+void cr::lens::Lens::encodeSequence(uint8_t* data, int& size,
+                                    uint32_t sequence)
+{
+    // Fill header.
+    data[0] = 0x07;
+    data[1] = LENS_MAJOR_VERSION;
+    data[2] = LENS_MINOR_VERSION;
+
+    // Fill data.
+    memcpy(&data[3], &sequence, 4);
+    size = 7;
+}
+
+
+
+bool cr::lens::Lens::decodeSequence(uint8_t* data, int size,
+                                    uint32_t& sequence)
+{
+    // Check size.
+    if (size != 7)
+        return false;
+
+    // Check header and version.
+    if (data[0] != 0x07 || data[1] != LENS_MAJOR_VERSION ||
+        data[2] != LENS_MINOR_VERSION)
+        return false;
+
+    // Extract data.
+    memcpy(&sequence, &data[3], 4);
+
+    return true;
+}
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include "Frame.h"
 #include "ConfigReader.h"
+#include "LensCalibrationTable.h"
 
 
 
@@ -32,6 +33,130 @@ public:
      * @return FovPoint object.
      */
     FovPoint& operator= (const FovPoint& src);
+
+    /**
+     * @brief operator ==
+     * @param src Other object.
+     * @return TRUE if objects are equal.
+     */
+    bool operator== (const FovPoint& src) const;
+
+    /**
+     * @brief Get hash of object (for CalibrationTable).
+     * @param seed Previous hash value.
+     * @return Hash value.
+     */
+    uint64_t getHash(uint64_t seed) const;
+};
+
+
+
+/// Zoom-focus tracking point class.
+class TrackingPoint
+{
+public:
+    /// Hardware zoom pos.
+    int hwZoomPos{0};
+    /// Hardware focus pos which keeps object in focus at this zoom pos.
+    int hwFocusPos{0};
+
+    JSON_READABLE(TrackingPoint, hwZoomPos, hwFocusPos);
+
+    /**
+     * @brief operator =
+     * @param src Source object.
+     * @return TrackingPoint object.
+     */
+    TrackingPoint& operator= (const TrackingPoint& src);
+
+    /**
+     * @brief operator ==
+     * @param src Other object.
+     * @return TRUE if objects are equal.
+     */
+    bool operator== (const TrackingPoint& src) const;
+};
+
+
+
+/// Zoom-focus tracking curve class. Focus position vs zoom position for one
+/// object distance.
+class TrackingCurve
+{
+public:
+    /// Object distance, meters. 0 - infinity.
+    float distanceM{0.0f};
+    /// Tracking points.
+    std::vector<TrackingPoint> points{std::vector<TrackingPoint>()};
+
+    JSON_READABLE(TrackingCurve, distanceM, points);
+
+    /**
+     * @brief operator =
+     * @param src Source object.
+     * @return TrackingCurve object.
+     */
+    TrackingCurve& operator= (const TrackingCurve& src);
+
+    /**
+     * @brief operator ==
+     * @param src Other object.
+     * @return TRUE if objects are equal.
+     */
+    bool operator== (const TrackingCurve& src) const;
+
+    /**
+     * @brief Get hash of object (for CalibrationTable).
+     * @param seed Previous hash value.
+     * @return Hash value.
+     */
+    uint64_t getHash(uint64_t seed) const;
+};
+
+
+
+/// Distortion point class. Brown-Conrady distortion coefficients for one
+/// zoom position. Coefficients are defined for image coordinates normalized
+/// by focal length in pixels (calculated from FOV at this zoom position) and
+/// centered at frame center (the same as OpenCV calibration).
+class DistortionPoint
+{
+public:
+    /// Hardware zoom pos.
+    int hwZoomPos{0};
+    /// Radial distortion coefficient k1.
+    float k1{0.0f};
+    /// Radial distortion coefficient k2.
+    float k2{0.0f};
+    /// Tangential distortion coefficient p1.
+    float p1{0.0f};
+    /// Tangential distortion coefficient p2.
+    float p2{0.0f};
+    /// Radial distortion coefficient k3.
+    float k3{0.0f};
+
+    JSON_READABLE(DistortionPoint, hwZoomPos, k1, k2, p1, p2, k3);
+
+    /**
+     * @brief operator =
+     * @param src Source object.
+     * @return DistortionPoint object.
+     */
+    DistortionPoint& operator= (const DistortionPoint& src);
+
+    /**
+     * @brief operator ==
+     * @param src Other object.
+     * @return TRUE if objects are equal.
+     */
+    bool operator== (const DistortionPoint& src) const;
+
+    /**
+     * @brief Get hash of object (for CalibrationTable).
+     * @param seed Previous hash value.
+     * @return Hash value.
+     */
+    uint64_t getHash(uint64_t seed) const;
 };
 
 
@@ -89,10 +214,17 @@ typedef struct LensParamsMask
     bool custom1{true};
     bool custom2{true};
     bool custom3{true};
+    /// Append age of each encoded param (see LensParams::timestamps).
+    bool timestamps{false};
 } LensParamsMask;
 
 
 
+/// Lens params enum. Declared below.
+enum class LensParam;
+
+
+
 /// Lens params class.
 class LensParams
 {
@@ -331,8 +463,22 @@ public:
     float custom3{0.0f};
     /// List of points to calculate fiend of view. Lens controller should
     /// calculate FOV table according to given list f points using
-    /// approximation.
-    std::vector<FovPoint> fovPoints{std::vector<FovPoint>()};
+    /// approximation. Table is shared by copies of params (copy doesn't copy
+    /// points, see CalibrationTable class).
+    CalibrationTable<FovPoint> fovPoints;
+    /// Zoom-focus tracking curves for different object distances. Lens
+    /// controller can keep focus during zoom by moving focus along the curve
+    /// (see LensFocusTracker class). Shared the same way as fovPoints.
+    CalibrationTable<TrackingCurve> trackingCurves;
+    /// List of points with lens distortion coefficients for different zoom
+    /// positions. Coefficients between points are interpolated the same way
+    /// as FOV (see LensDistortion class).
+    CalibrationTable<DistortionPoint> distortionPoints;
+    /// Monotonic time (msec, see getTimeMsec()) of last update of each param
+    /// from lens hardware. Index is param ID (LensParam enum) minus 1. Value 0
+    /// means unknown. Encoded as param ages if mask requests timestamps, so
+    /// decoded timestamps are relative to local monotonic clock.
+    uint32_t timestamps[50]{};
 
     JSON_READABLE(LensParams, initString, focusMode, filterMode,
                   afRoiX0, afRoiY0, afRoiX1, afRoiY1, zoomHwMaxSpeed,
@@ -342,7 +488,8 @@ public:
                   focusFactorThreshold, refocusTimeoutSec, irisMode,
                   autoAfRoiWidth, autoAfRoiHeight, autoAfRoiBorder,
                   afRoiMode, extenderMode, stabiliserMode, afRange,
-                  logMode, type, custom1, custom2, custom3, fovPoints);
+                  logMode, type, custom1, custom2, custom3, fovPoints,
+                  trackingCurves, distortionPoints);
 
     /**
      * @brief operator =
@@ -351,8 +498,45 @@ public:
      */
     LensParams& operator= (const LensParams& src);
 
+    /**
+     * @brief Get monotonic time for param timestamps. Never returns 0.
+     * @return Monotonic time, msec. Wraps around every 49 days, so ages must
+     * be calculated as unsigned difference.
+     */
+    static uint32_t getTimeMsec();
+
+    /**
+     * @brief Set timestamp of param to current monotonic time. Lens controller
+     * should call it when param value read from lens hardware.
+     * @param id Param ID.
+     */
+    void setTimestamp(LensParam id);
+
+    /**
+     * @brief Get timestamp of param.
+     * @param id Param ID.
+     * @return Monotonic time of last update, msec or 0 if unknown.
+     */
+    uint32_t getTimestamp(LensParam id);
+
+    /**
+     * @brief Get age of param value.
+     * @param id Param ID.
+     * @return Time since last update, msec or -1 if unknown.
+     */
+    int getAgeMsec(LensParam id);
+
+    /**
+     * @brief Get param value by ID.
+     * @param id Param ID.
+     * @return Param value or -1 if param not exists.
+     */
+    float getParamValue(LensParam id);
+
     /**
      * @brief Encode params. The method doesn't encode initString and fovPoints.
+     * If mask requests timestamps age of each encoded param (2 bytes) is
+     * appended and buffer must have size >= 301.
      * @param data Pointer to data buffer.
      * @param size Size of data.
      * @param mask Pointer to params mask.
@@ -361,13 +545,69 @@ public:
     bool encode(uint8_t* data, int bufferSize, int& size,
                 LensParamsMask* mask = nullptr);
 
+    /**
+     * @brief Encode params in compact profile for narrowband links. Integer
+     * fields encoded as variable length values (1-5 bytes), boolean fields
+     * packed to one byte, focusFactorThreshold and temperature encoded as half
+     * precision floats. The method doesn't encode initString and fovPoints.
+     * Encoded data can be decoded by decode(...) method.
+     * @param data Pointer to data buffer. Must have size >= 234 or >= 334 if
+     * mask requests timestamps.
+     * @param bufferSize Data buffer size.
+     * @param size Size of encoded data.
+     * @param mask Pointer to params mask.
+     * @return TRUE if params encoded or FALSE if not.
+     */
+    bool encodeCompact(uint8_t* data, int bufferSize, int& size,
+                       LensParamsMask* mask = nullptr);
+
     /**
      * @brief Decode params. The method doesn't decode initString and fovPoints.
+     * Method decodes data encoded by encode(...) or encodeCompact(...) method
+     * (profile is detected by header byte). If data has no param ages all
+     * timestamps are reset to 0 (unknown).
      * @param data Pointer to data.
      * @brief dataSize Size of data.
      * @return TRUE is params decoded or FALSE if not.
      */
     bool decode(uint8_t* data, int dataSize);
+
+    /**
+     * @brief Get size of data serialized by serialize(...) method.
+     * @return Size of serialized data, bytes.
+     */
+    int getSerializedSize();
+
+    /**
+     * @brief Serialize all params including initString, fovPoints,
+     * trackingCurves and distortionPoints. Can be used to transfer complete
+     * lens configuration and calibration tables instead of JSON.
+     * @param data Pointer to data buffer. Must have size >=
+     * getSerializedSize().
+     * @param bufferSize Data buffer size.
+     * @param size Size of serialized data.
+     * @return TRUE if params serialized or FALSE if not.
+     */
+    bool serialize(uint8_t* data, int bufferSize, int& size);
+
+    /**
+     * @brief Deserialize all params serialized by serialize(...) method of
+     * the same major and minor version.
+     * @param data Pointer to data.
+     * @param dataSize Size of data.
+     * @return TRUE is params deserialized or FALSE if not.
+     */
+    bool deserialize(uint8_t* data, int dataSize);
+
+private:
+
+    /**
+     * @brief Decode params encoded by encodeCompact(...) method.
+     * @param data Pointer to data.
+     * @brief dataSize Size of data.
+     * @return TRUE is params decoded or FALSE if not.
+     */
+    bool decodeCompact(uint8_t* data, int dataSize);
 };
 
 
@@ -434,7 +674,26 @@ enum class LensCommand
     /// lens controller should automatically set at least parameters
     /// (LensParam enum): ZOOM_HW_TELE_LIMIT, ZOOM_HW_WIDE_LIMIT,
     /// FOCUS_HW_FAR_LIMIT and FOCUS_HW_NEAR_LIMIT.
-    DETECT_HW_RANGES
+    DETECT_HW_RANGES,
+    /// Move zoom to position which gives horizontal field of view. Lens
+    /// controller should calculate hardware zoom position by FOV points
+    /// (inverse of FOV approximation, see LensFovTable class) and move zoom
+    /// to this position. Command argument: horizontal field of view, degree.
+    /// User should be able to set zoom movement speed via lens parameters.
+    ZOOM_TO_FOV,
+    /// Move zoom with constant rate of horizontal field of view change. Lens
+    /// controller should continuously update hardware zoom speed according
+    /// to FOV points (see LensZoomRate class). Command argument: FOV change
+    /// rate, degree/second. Positive value - zoom tele (FOV decreases),
+    /// negative - zoom wide. Any other zoom command stops constant rate zoom.
+    ZOOM_AT_FOV_RATE,
+    /// Move zoom with constant magnification rate. Lens controller should
+    /// continuously update hardware zoom speed according to FOV points (see
+    /// LensZoomRate class). Command argument: natural logarithm of
+    /// magnification change per second (0.69 - magnification doubles each
+    /// second). Positive value - zoom tele, negative - zoom wide. Any other
+    /// zoom command stops constant rate zoom.
+    ZOOM_AT_MAGNIFICATION_RATE
 };
 
 
@@ -803,6 +1062,119 @@ public:
      * @return TRUE if command decoded and executed or FALSE if not.
      */
     virtual bool decodeAndExecuteCommand(uint8_t* data, int size) = 0;
+
+    /**
+     * @brief Encode command response.
+     * @param data Pointer to data buffer. Must have size >= 14 without params
+     * snapshot, >= 215 with params snapshot or >= 315 with params snapshot
+     * with params ages (see LensParamsMask::timestamps).
+     * @param bufferSize Data buffer size.
+     * @param size Size of encoded data.
+     * @param type Command type: 0 - command, 1 - set param command.
+     * @param id Command ID or param ID.
+     * @param status Command execution status.
+     * @param value Effective (clamped) command argument or param value.
+     * @param params Pointer to params snapshot. Nullptr if snapshot not
+     * required.
+     * @param mask Pointer to params mask for snapshot.
+     * @return TRUE if response encoded or FALSE if not. In case error size
+     * is set to 0.
+     */
+    static bool encodeResponse(uint8_t* data, int bufferSize, int& size,
+                               int type, int id, bool status, float value,
+                               LensParams* params = nullptr,
+                               LensParamsMask* mask = nullptr);
+
+    /**
+     * @brief Decode command response.
+     * @param data Pointer to response data.
+     * @param size Size of data.
+     * @param paramId Output param ID.
+     * @param commandId Output command ID.
+     * @param status Output command execution status.
+     * @param value Output effective command argument or param value.
+     * @param params Pointer to params object to decode snapshot. If response
+     * doesn't include snapshot params object is not changed.
+     * @return 0 - command response decoded, 1 - set param command response
+     * decoded, -1 - error.
+     */
+    static int decodeResponse(uint8_t* data,
+                              int size,
+                              LensParam& paramId,
+                              LensCommand& commandId,
+                              bool& status,
+                              float& value,
+                              LensParams* params = nullptr);
+
+    /**
+     * @brief Decode and execute command and encode response. Method executes
+     * command by decodeAndExecuteCommand(...) method and reads effective value
+     * (clamped param value or command argument) and optional params snapshot,
+     * so remote client gets command result in one round trip.
+     * @param data Pointer to command data.
+     * @param size Size of data.
+     * @param response Pointer to response buffer. Must have size >= 14
+     * without params snapshot, >= 215 with params snapshot or >= 315 with
+     * params snapshot with params ages (see LensParamsMask::timestamps).
+     * @param responseBufferSize Response buffer size.
+     * @param responseSize Size of encoded response.
+     * @param mask Pointer to params mask for snapshot. Nullptr if snapshot not
+     * required. If snapshot doesn't fit response buffer the response is
+     * encoded without snapshot.
+     * @return TRUE if command decoded and executed or FALSE if not.
+     */
+    virtual bool processCommand(uint8_t* data, int size, uint8_t* response,
+                                int responseBufferSize, int& responseSize,
+                                LensParamsMask* mask = nullptr);
+
+    /**
+     * @brief Encode subscribe command. Client sends subscribe command to
+     * register params mask and max update rate. After that lens controller
+     * side pushes encoded params only when masked values change.
+     * @param data Pointer to data buffer. Must have size >= 15.
+     * @param size Size of encoded data.
+     * @param mask Pointer to params mask. If all fields are false the command
+     * cancels subscription.
+     * @param maxRateHz Max update rate, Hz. 0 - no limit.
+     * @param compact Use compact profile (LensParams::encodeCompact(...)).
+     */
+    static void encodeSubscribeCommand(uint8_t* data, int& size,
+                                       LensParamsMask* mask, float maxRateHz,
+                                       bool compact = false);
+
+    /**
+     * @brief Decode subscribe command.
+     * @param data Pointer to command data.
+     * @param size Size of data.
+     * @param mask Output params mask.
+     * @param maxRateHz Output max update rate, Hz.
+     * @param compact Output compact profile flag.
+     * @return TRUE if command decoded or FALSE if not.
+     */
+    static bool decodeSubscribeCommand(uint8_t* data,
+                                       int size,
+                                       LensParamsMask& mask,
+                                       float& maxRateHz,
+                                       bool& compact);
+
+    /**
+     * @brief Encode request sequence number. Client puts it before command
+     * in the same datagram and lens controller side puts it back before
+     * response, so client matches response with request.
+     * @param data Pointer to data buffer. Must have size >= 7.
+     * @param size Size of encoded data.
+     * @param sequence Sequence number.
+     */
+    static void encodeSequence(uint8_t* data, int& size, uint32_t sequence);
+
+    /**
+     * @brief Decode request sequence number.
+     * @param data Pointer to data.
+     * @param size Size of data.
+     * @param sequence Output sequence number.
+     * @return TRUE if sequence number decoded or FALSE if not.
+     */
+    static bool decodeSequence(uint8_t* data, int size, uint32_t& sequence);
 };
 }
 }
\ No newline at end of file
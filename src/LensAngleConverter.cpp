@@ -0,0 +1,136 @@
+#include <cmath>
+#include "LensAngleConverter.h"
+
+
+
+/// Pi.
+#define LENS_PI 3.14159265358979323846f
+
+
+
+/**
+ * @brief Arctangent approximation without branches. Argument is reduced to
+ * [-1, 1) range by identity atan(a) = pi / 4 + atan((a - 1) / (a + 1)) for
+ * a >= 0 instead of conditions (and without sqrt() which sets errno), which
+ * keeps loops vectorizable.
+ * @param t Argument.
+ * @return Arctangent, radians.
+ */
+static inline float fastAtan(float t)
+{
+    float a = std::fabs(t);
+    float r = (a - 1.0f) / (a + 1.0f);
+    float r2 = r * r;
+    float p = LENS_PI / 4.0f + r * (0.99999934f + r2 * (-0.33329856f +
+              r2 * (0.19946536f + r2 * (-0.13908534f + r2 * (0.09642004f +
+              r2 * (-0.05590988f + r2 * (0.02186124f +
+              r2 * -0.00405404f)))))));
+    return std::copysign(p, t);
+}
+
+
+
+/**
+ * @brief Tangent approximation without branches for |x| < pi / 2: ratio of
+ * sine and cosine Taylor polynomials.
+ * @param x Argument, radians.
+ * @return Tangent.
+ */
+static inline float fastTan(float x)
+{
+    float x2 = x * x;
+    float s = x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f +
+              x2 * (-1.0f / 5040.0f + x2 * (1.0f / 362880.0f +
+              x2 * (-1.0f / 39916800.0f))))));
+    float c = 1.0f + x2 * (-0.5f + x2 * (1.0f / 24.0f + x2 * (-1.0f / 720.0f +
+              x2 * (1.0f / 40320.0f + x2 * (-1.0f / 3628800.0f +
+              x2 * (1.0f / 479001600.0f))))));
+    return s / c;
+}
+
+
+
+cr::lens::LensAngleConverter::LensAngleConverter()
+{
+
+}
+
+
+
+cr::lens::LensAngleConverter::~LensAngleConverter()
+{
+
+}
+
+
+
+bool cr::lens::LensAngleConverter::set(float xFovDeg, float yFovDeg,
+                                       int width, int height)
+{
+    if (xFovDeg <= 0.0f || xFovDeg >= 180.0f ||
+        yFovDeg <= 0.0f || yFovDeg >= 180.0f || width <= 0 || height <= 0)
+        return false;
+
+    m_cx = (float)width / 2.0f;
+    m_cy = (float)height / 2.0f;
+    m_fx = m_cx / std::tan(xFovDeg * LENS_PI / 360.0f);
+    m_fy = m_cy / std::tan(yFovDeg * LENS_PI / 360.0f);
+
+    return true;
+}
+
+
+
+bool cr::lens::LensAngleConverter::set(const cr::lens::LensParams& params,
+                                       int width, int height)
+{
+    return set(params.xFovDeg, params.yFovDeg, width, height);
+}
+
+
+
+bool cr::lens::LensAngleConverter::set(const cr::lens::LensState& state,
+                                       int width, int height)
+{
+    return set(state.get(LensParam::X_FOV_DEG),
+               state.get(LensParam::Y_FOV_DEG), width, height);
+}
+
+
+
+void cr::lens::LensAngleConverter::toAngles(const float* x, const float* y,
+                                            float* azimuthDeg,
+                                            float* elevationDeg,
+                                            int count) const
+{
+    // Local copies let compiler keep params in registers.
+    const float cx = m_cx;
+    const float cy = m_cy;
+    const float kx = 1.0f / m_fx;
+    const float ky = 1.0f / m_fy;
+    const float toDeg = 180.0f / LENS_PI;
+
+    for (int i = 0; i < count; ++i)
+        azimuthDeg[i] = fastAtan((x[i] - cx) * kx) * toDeg;
+    for (int i = 0; i < count; ++i)
+        elevationDeg[i] = fastAtan((cy - y[i]) * ky) * toDeg;
+}
+
+
+
+void cr::lens::LensAngleConverter::toPixels(const float* azimuthDeg,
+                                            const float* elevationDeg,
+                                            float* x, float* y,
+                                            int count) const
+{
+    const float cx = m_cx;
+    const float cy = m_cy;
+    const float fx = m_fx;
+    const float fy = m_fy;
+    const float toRad = LENS_PI / 180.0f;
+
+    for (int i = 0; i < count; ++i)
+        x[i] = cx + fx * fastTan(azimuthDeg[i] * toRad);
+    for (int i = 0; i < count; ++i)
+        y[i] = cy - fy * fastTan(elevationDeg[i] * toRad);
+}
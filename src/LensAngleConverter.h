@@ -0,0 +1,103 @@
+#pragma once
+#include "Lens.h"
+#include "LensStateHistory.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/**
+ * @brief Batch converter of pixel coordinates to angular offsets from optical
+ * axis and back. Uses pinhole model derived from current horizontal and
+ * vertical FOV and frame size: focal length in pixels is
+ * (width / 2) / tan(xFov / 2). Azimuth is atan((x - width / 2) / fx),
+ * elevation is atan((height / 2 - y) / fy) (positive up). Arrays are
+ * processed by branch-free loops with polynomial atan, sin and cos
+ * approximations (error < 1e-6 rad) which compilers vectorize (SSE, AVX,
+ * NEON) without intrinsics in release build (-O3). Converter is not changed
+ * by conversion methods and can be used from several threads.
+ */
+class LensAngleConverter
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    LensAngleConverter();
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensAngleConverter();
+
+    /**
+     * @brief Set FOV and frame size.
+     * @param xFovDeg Horizontal FOV, degree. Must be in range (0, 180).
+     * @param yFovDeg Vertical FOV, degree. Must be in range (0, 180).
+     * @param width Frame width, pixels.
+     * @param height Frame height, pixels.
+     * @return TRUE if params accepted or FALSE if not.
+     */
+    bool set(float xFovDeg, float yFovDeg, int width, int height);
+
+    /**
+     * @brief Set FOV from lens params and frame size.
+     * @param params Lens params.
+     * @param width Frame width, pixels.
+     * @param height Frame height, pixels.
+     * @return TRUE if params accepted or FALSE if not.
+     */
+    bool set(const LensParams& params, int width, int height);
+
+    /**
+     * @brief Set FOV from lens state (for example, taken from
+     * LensStateHistory for frame capture time) and frame size.
+     * @param state Lens state.
+     * @param width Frame width, pixels.
+     * @param height Frame height, pixels.
+     * @return TRUE if params accepted or FALSE if not.
+     */
+    bool set(const LensState& state, int width, int height);
+
+    /**
+     * @brief Convert pixel coordinates to angles.
+     * @param x Pixel X coordinates.
+     * @param y Pixel Y coordinates.
+     * @param azimuthDeg Output azimuth offsets, degree.
+     * @param elevationDeg Output elevation offsets, degree.
+     * @param count Number of points.
+     */
+    void toAngles(const float* x, const float* y, float* azimuthDeg,
+                  float* elevationDeg, int count) const;
+
+    /**
+     * @brief Convert angles to pixel coordinates.
+     * @param azimuthDeg Azimuth offsets, degree. Must be in range (-90, 90).
+     * @param elevationDeg Elevation offsets, degree. Must be in range
+     * (-90, 90).
+     * @param x Output pixel X coordinates.
+     * @param y Output pixel Y coordinates.
+     * @param count Number of points.
+     */
+    void toPixels(const float* azimuthDeg, const float* elevationDeg,
+                  float* x, float* y, int count) const;
+
+private:
+
+    /// Frame center X, pixels.
+    float m_cx{0.0f};
+    /// Frame center Y, pixels.
+    float m_cy{0.0f};
+    /// Horizontal focal length, pixels.
+    float m_fx{1.0f};
+    /// Vertical focal length, pixels.
+    float m_fy{1.0f};
+};
+}
+}
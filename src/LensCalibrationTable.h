@@ -0,0 +1,411 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/**
+ * @brief Shared immutable calibration table (list of FOV points, tracking
+ * curves etc.). Table data is reference-counted: copy of table (and copy of
+ * LensParams) doesn't copy points. Data is copied only when table is changed
+ * while it is shared with other tables (copy-on-write). Tables can be
+ * interned by content hash: intern() replaces data by data of any existing
+ * interned table with the same content, so identical tables of many lens
+ * instances take memory only once. Interned data is never changed. Tables
+ * read from JSON and deserialized by LensParams::deserialize(...) are
+ * interned automatically. Class provides std::vector interface and can be
+ * implicitly converted to const std::vector<T>&. Const access doesn't copy
+ * data. Non-const operator[], front(), back(), begin() and end() return
+ * references and iterators for writing (source compatible with
+ * std::vector field) and copy data if it is shared, so code which only
+ * reads table should use const reference or get(). Items are also changed by
+ * set(...), push_back(...), resize(...) or edit() methods. Item type must
+ * provide operator== and getHash(seed) methods. Concurrent access to
+ * different tables sharing the same data is thread-safe, access to the same
+ * table object must be synchronized by user (the same as std::vector).
+ */
+template <class T>
+class CalibrationTable
+{
+public:
+
+    /// Iterator type.
+    typedef typename std::vector<T>::iterator iterator;
+    /// Constant iterator type.
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    /**
+     * @brief Class constructor. Creates empty table.
+     */
+    CalibrationTable() {}
+
+    /**
+     * @brief Class constructor.
+     * @param items List of items.
+     */
+    CalibrationTable(const std::vector<T>& items) { *this = items; }
+
+    /**
+     * @brief Assign list of items.
+     * @param items List of items.
+     * @return Table object.
+     */
+    CalibrationTable& operator= (const std::vector<T>& items)
+    {
+        m_data.reset();
+        if (!items.empty())
+        {
+            m_data = std::make_shared<Data>();
+            m_data->items = items;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Assign list of items without copying.
+     * @param items List of items.
+     * @return Table object.
+     */
+    CalibrationTable& operator= (std::vector<T>&& items)
+    {
+        m_data.reset();
+        if (!items.empty())
+        {
+            m_data = std::make_shared<Data>();
+            m_data->items = std::move(items);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Get list of items.
+     * @return Constant reference to list of items.
+     */
+    const std::vector<T>& get() const
+    {
+        return m_data ? m_data->items : getEmpty();
+    }
+
+    /**
+     * @brief Conversion to list of items.
+     */
+    operator const std::vector<T>&() const { return get(); }
+
+    /**
+     * @brief Get number of items.
+     * @return Number of items.
+     */
+    size_t size() const { return get().size(); }
+
+    /**
+     * @brief Check if table is empty.
+     * @return TRUE if table is empty or FALSE if not.
+     */
+    bool empty() const { return get().empty(); }
+
+    /**
+     * @brief Get item.
+     * @param i Item index.
+     * @return Constant reference to item.
+     */
+    const T& operator[] (size_t i) const { return get()[i]; }
+
+    /**
+     * @brief Get first item.
+     * @return Constant reference to item.
+     */
+    const T& front() const { return get().front(); }
+
+    /**
+     * @brief Get last item.
+     * @return Constant reference to item.
+     */
+    const T& back() const { return get().back(); }
+
+    /**
+     * @brief Get iterator to first item.
+     * @return Constant iterator.
+     */
+    const_iterator begin() const { return get().begin(); }
+
+    /**
+     * @brief Get iterator after last item.
+     * @return Constant iterator.
+     */
+    const_iterator end() const { return get().end(); }
+
+    /**
+     * @brief Get item for writing. Copies data if it is shared. The reference
+     * is valid until table is copied, assigned or interned.
+     * @param i Item index.
+     * @return Reference to item.
+     */
+    T& operator[] (size_t i) { return detach()[i]; }
+
+    /**
+     * @brief Get first item for writing. Copies data if it is shared.
+     * @return Reference to item.
+     */
+    T& front() { return detach().front(); }
+
+    /**
+     * @brief Get last item for writing. Copies data if it is shared.
+     * @return Reference to item.
+     */
+    T& back() { return detach().back(); }
+
+    /**
+     * @brief Get iterator to first item for writing (for example, to sort
+     * table). Copies data if it is shared. Iterators are valid until table is
+     * copied, assigned or interned.
+     * @return Iterator.
+     */
+    iterator begin() { return detach().begin(); }
+
+    /**
+     * @brief Get iterator after last item for writing. Copies data if it is
+     * shared.
+     * @return Iterator.
+     */
+    iterator end() { return detach().end(); }
+
+    /**
+     * @brief Get constant iterator to first item. Doesn't copy data.
+     * @return Constant iterator.
+     */
+    const_iterator cbegin() const { return get().begin(); }
+
+    /**
+     * @brief Get constant iterator after last item. Doesn't copy data.
+     * @return Constant iterator.
+     */
+    const_iterator cend() const { return get().end(); }
+
+    /**
+     * @brief Set item. Copies data if it is shared.
+     * @param i Item index.
+     * @param item Item.
+     */
+    void set(size_t i, const T& item) { detach()[i] = item; }
+
+    /**
+     * @brief Get list of items for writing. Copies data if it is shared. The
+     * reference is valid until table is copied, assigned or interned.
+     * @return Reference to list of items.
+     */
+    std::vector<T>& edit() { return detach(); }
+
+    /**
+     * @brief Add item to the end. Copies data if it is shared.
+     * @param item Item.
+     */
+    void push_back(const T& item) { detach().push_back(item); }
+
+    /**
+     * @brief Resize table. Copies data if it is shared.
+     * @param size New size.
+     */
+    void resize(size_t size) { detach().resize(size); }
+
+    /**
+     * @brief Remove all items. Doesn't change data of other tables.
+     */
+    void clear() { m_data.reset(); }
+
+    /**
+     * @brief Compare content of tables.
+     * @param src Other table.
+     * @return TRUE if tables have the same items.
+     */
+    bool operator== (const CalibrationTable& src) const
+    {
+        return m_data == src.m_data || get() == src.get();
+    }
+
+    /**
+     * @brief Compare content of tables.
+     * @param src Other table.
+     * @return TRUE if tables have different items.
+     */
+    bool operator!= (const CalibrationTable& src) const
+    {
+        return !(*this == src);
+    }
+
+    /**
+     * @brief Check if tables share the same data.
+     * @param src Other table.
+     * @return TRUE if data is shared (or both tables are empty).
+     */
+    bool isSharedWith(const CalibrationTable& src) const
+    {
+        return m_data == src.m_data;
+    }
+
+    /**
+     * @brief Get content hash (FNV-1a over items).
+     * @return Hash value.
+     */
+    uint64_t getHash() const
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (const T& item : get())
+            hash = item.getHash(hash);
+        return hash;
+    }
+
+    /**
+     * @brief Intern table: share data with existing interned table with the
+     * same content or register this table data as interned. Interned data is
+     * never changed (tables copy it before change).
+     */
+    void intern()
+    {
+        if (!m_data || m_data->isInterned)
+            return;
+
+        const uint64_t hash = getHash();
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        // Look for the same content and drop expired data.
+        auto range = registry.tables.equal_range(hash);
+        for (auto it = range.first; it != range.second;)
+        {
+            std::shared_ptr<Data> data = it->second.lock();
+            if (!data)
+            {
+                it = registry.tables.erase(it);
+                continue;
+            }
+            if (data->items == m_data->items)
+            {
+                m_data = data;
+                return;
+            }
+            ++it;
+        }
+
+        m_data->isInterned = true;
+        registry.tables.emplace(hash, m_data);
+    }
+
+    /**
+     * @brief Get number of different interned tables of this type which are
+     * in use.
+     * @return Number of tables.
+     */
+    static int getInternedCount()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        int count = 0;
+        for (auto& table : registry.tables)
+            count += table.second.expired() ? 0 : 1;
+        return count;
+    }
+
+private:
+
+    /// Table data.
+    struct Data
+    {
+        /// Items.
+        std::vector<T> items;
+        /// Data is interned and must not be changed. Set under registry mutex
+        /// and read without it by tables sharing the data.
+        std::atomic<bool> isInterned{false};
+    };
+
+    /// Registry of interned tables.
+    struct Registry
+    {
+        /// Mutex.
+        std::mutex mutex;
+        /// Interned tables by content hash.
+        std::unordered_multimap<uint64_t, std::weak_ptr<Data>> tables;
+    };
+
+    /// Table data. Empty table doesn't have data.
+    std::shared_ptr<Data> m_data;
+
+    /**
+     * @brief Get items for writing. Copies data if it is shared or interned.
+     * @return Reference to list of items.
+     */
+    std::vector<T>& detach()
+    {
+        if (!m_data)
+        {
+            m_data = std::make_shared<Data>();
+        }
+        else if (m_data->isInterned || m_data.use_count() > 1)
+        {
+            std::shared_ptr<Data> data = std::make_shared<Data>();
+            data->items = m_data->items;
+            m_data = data;
+        }
+        return m_data->items;
+    }
+
+    /**
+     * @brief Get empty list.
+     * @return Reference to empty list.
+     */
+    static const std::vector<T>& getEmpty()
+    {
+        static const std::vector<T> empty;
+        return empty;
+    }
+
+    /**
+     * @brief Get registry of interned tables.
+     * @return Registry.
+     */
+    static Registry& getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+};
+
+
+
+/**
+ * @brief Write table to JSON (the same format as std::vector).
+ * @param json JSON object.
+ * @param table Table.
+ */
+template <typename Json, class T>
+void to_json(Json& json, const CalibrationTable<T>& table)
+{
+    json = table.get();
+}
+
+
+
+/**
+ * @brief Read table from JSON (the same format as std::vector). Table is
+ * interned.
+ * @param json JSON object.
+ * @param table Table.
+ */
+template <typename Json, class T>
+void from_json(const Json& json, CalibrationTable<T>& table)
+{
+    table = json.template get<std::vector<T>>();
+    table.intern();
+}
+}
+}
@@ -0,0 +1,200 @@
+#include "LensCommandQueue.h"
+
+
+
+cr::lens::LensCommandQueue::LensCommandQueue(int maxSize)
+{
+    m_maxSize = maxSize < 1 ? 1 : maxSize;
+}
+
+
+
+cr::lens::LensCommandQueue::~LensCommandQueue()
+{
+
+}
+
+
+
+bool cr::lens::LensCommandQueue::push(cr::lens::LensCommand id, float arg)
+{
+    LensQueuedCommand command;
+    command.type = 0;
+    command.commandId = id;
+    command.value = arg;
+    return add(command);
+}
+
+
+
+bool cr::lens::LensCommandQueue::push(cr::lens::LensParam id, float value)
+{
+    LensQueuedCommand command;
+    command.type = 1;
+    command.paramId = id;
+    command.value = value;
+    return add(command);
+}
+
+
+
+bool cr::lens::LensCommandQueue::push(uint8_t* data, int size)
+{
+    // Decode command.
+    LensQueuedCommand command;
+    command.type = Lens::decodeCommand(data, size, command.paramId,
+                                       command.commandId, command.value);
+    if (command.type < 0)
+        return false;
+
+    return add(command);
+}
+
+
+
+bool cr::lens::LensCommandQueue::pop(cr::lens::LensQueuedCommand& command,
+                                     int timeoutMsec)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // Wait command.
+    auto isReady = [this]{ return !m_priority.empty() || !m_normal.empty(); };
+    if (timeoutMsec < 0)
+        m_cond.wait(lock, isReady);
+    else if (!m_cond.wait_for(lock, std::chrono::milliseconds(timeoutMsec),
+                              isReady))
+        return false;
+
+    // Priority lane first.
+    if (!m_priority.empty())
+    {
+        command = m_priority.front();
+        m_priority.pop_front();
+        return true;
+    }
+
+    command = m_normal.front();
+    m_normal.pop_front();
+
+    return true;
+}
+
+
+
+void cr::lens::LensCommandQueue::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_priority.clear();
+    m_normal.clear();
+}
+
+
+
+int cr::lens::LensCommandQueue::size()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (int)(m_priority.size() + m_normal.size());
+}
+
+
+
+bool cr::lens::LensCommandQueue::isStopCommand(cr::lens::LensCommand id)
+{
+    return id == LensCommand::ZOOM_STOP || id == LensCommand::FOCUS_STOP ||
+           id == LensCommand::IRIS_STOP || id == LensCommand::AF_STOP;
+}
+
+
+
+cr::lens::LensAxis cr::lens::LensCommandQueue::getAxis(
+        const cr::lens::LensQueuedCommand& command)
+{
+    // Set param commands which move axis.
+    if (command.type == 1)
+    {
+        switch (command.paramId)
+        {
+        case LensParam::ZOOM_POS:
+        case LensParam::ZOOM_HW_POS:
+            return LensAxis::ZOOM;
+        case LensParam::FOCUS_POS:
+        case LensParam::FOCUS_HW_POS:
+            return LensAxis::FOCUS;
+        case LensParam::IRIS_POS:
+        case LensParam::IRIS_HW_POS:
+            return LensAxis::IRIS;
+        default:
+            return LensAxis::NONE;
+        }
+    }
+
+    // Commands.
+    switch (command.commandId)
+    {
+    case LensCommand::ZOOM_TELE:
+    case LensCommand::ZOOM_WIDE:
+    case LensCommand::ZOOM_TO_POS:
+    case LensCommand::ZOOM_TO_FOV:
+    case LensCommand::ZOOM_AT_FOV_RATE:
+    case LensCommand::ZOOM_AT_MAGNIFICATION_RATE:
+    case LensCommand::ZOOM_STOP:
+        return LensAxis::ZOOM;
+    case LensCommand::FOCUS_FAR:
+    case LensCommand::FOCUS_NEAR:
+    case LensCommand::FOCUS_TO_POS:
+    case LensCommand::FOCUS_STOP:
+        return LensAxis::FOCUS;
+    case LensCommand::IRIS_OPEN:
+    case LensCommand::IRIS_CLOSE:
+    case LensCommand::IRIS_TO_POS:
+    case LensCommand::IRIS_STOP:
+        return LensAxis::IRIS;
+    case LensCommand::AF_START:
+    case LensCommand::AF_STOP:
+        return LensAxis::AF;
+    default:
+        return LensAxis::NONE;
+    }
+}
+
+
+
+bool cr::lens::LensCommandQueue::add(cr::lens::LensQueuedCommand& command)
+{
+    command.pushTime = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (command.type == 0 && isStopCommand(command.commandId))
+        {
+            // Flush pending moves for the same axis.
+            LensAxis axis = getAxis(command);
+            for (auto it = m_normal.begin(); it != m_normal.end();)
+            {
+                if (getAxis(*it) == axis)
+                    it = m_normal.erase(it);
+                else
+                    ++it;
+            }
+
+            // Pending stop for the same axis is enough.
+            for (auto& item : m_priority)
+                if (item.commandId == command.commandId)
+                    return true;
+
+            m_priority.push_back(command);
+        }
+        else
+        {
+            // Check queue size.
+            if ((int)m_normal.size() >= m_maxSize)
+                return false;
+            m_normal.push_back(command);
+        }
+    }
+
+    m_cond.notify_one();
+
+    return true;
+}
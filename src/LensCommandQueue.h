@@ -0,0 +1,158 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Lens axis enum. Used to group commands which move the same lens axis.
+enum class LensAxis
+{
+    /// Command doesn't move any axis.
+    NONE = 0,
+    /// Zoom axis.
+    ZOOM,
+    /// Focus axis.
+    FOCUS,
+    /// Iris axis.
+    IRIS,
+    /// Autofocus algorithm.
+    AF
+};
+
+
+
+/// Queued lens command class.
+class LensQueuedCommand
+{
+public:
+    /// Command type: 0 - command, 1 - set param command. The same values as
+    /// returned by Lens::decodeCommand(...) method.
+    int type{0};
+    /// Command ID. Valid if type == 0.
+    LensCommand commandId{LensCommand::ZOOM_STOP};
+    /// Param ID. Valid if type == 1.
+    LensParam paramId{LensParam::ZOOM_POS};
+    /// Command argument or param value.
+    float value{0.0f};
+    /// Time when command was pushed to the queue.
+    std::chrono::steady_clock::time_point pushTime;
+};
+
+
+
+/**
+ * @brief Lens command queue with priority lane for stop commands. Lens
+ * controllers which execute commands in separate thread (serial port
+ * exchange etc.) should use this queue instead of simple FIFO. Stop commands
+ * (ZOOM_STOP, FOCUS_STOP, IRIS_STOP and AF_STOP) go to the priority lane and
+ * remove all pending move commands for the same axis, so lens stops after
+ * the command which is executing at the moment regardless of queue load.
+ */
+class LensCommandQueue
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     * @param maxSize Maximum number of pending commands in normal lane.
+     */
+    LensCommandQueue(int maxSize = 256);
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensCommandQueue();
+
+    /**
+     * @brief Push command to the queue.
+     * @param id Command ID.
+     * @param arg Command argument.
+     * @return TRUE if the command added or FALSE if queue is full.
+     */
+    bool push(LensCommand id, float arg = 0.0f);
+
+    /**
+     * @brief Push set param command to the queue.
+     * @param id Param ID.
+     * @param value Param value.
+     * @return TRUE if the command added or FALSE if queue is full.
+     */
+    bool push(LensParam id, float value);
+
+    /**
+     * @brief Decode command (see Lens::decodeCommand(...)) and push it to the
+     * queue.
+     * @param data Pointer to command data.
+     * @param size Size of data.
+     * @return TRUE if the command decoded and added or FALSE if not.
+     */
+    bool push(uint8_t* data, int size);
+
+    /**
+     * @brief Get next command. Commands from priority lane returned first.
+     * @param command Output command.
+     * @param timeoutMsec Wait timeout, msec: 0 - no wait, -1 - wait until
+     * command available.
+     * @return TRUE if the command returned or FALSE if timeout expired.
+     */
+    bool pop(LensQueuedCommand& command, int timeoutMsec = -1);
+
+    /**
+     * @brief Remove all pending commands.
+     */
+    void clear();
+
+    /**
+     * @brief Get number of pending commands.
+     * @return Number of commands in both lanes.
+     */
+    int size();
+
+    /**
+     * @brief Check if command is stop command.
+     * @param id Command ID.
+     * @return TRUE if the command is ZOOM_STOP, FOCUS_STOP, IRIS_STOP or
+     * AF_STOP.
+     */
+    static bool isStopCommand(LensCommand id);
+
+    /**
+     * @brief Get axis moved or stopped by command.
+     * @param command Queued command.
+     * @return Lens axis or LensAxis::NONE.
+     */
+    static LensAxis getAxis(const LensQueuedCommand& command);
+
+private:
+
+    /// Max number of commands in normal lane.
+    int m_maxSize{256};
+    /// Priority lane (stop commands).
+    std::deque<LensQueuedCommand> m_priority;
+    /// Normal lane.
+    std::deque<LensQueuedCommand> m_normal;
+    /// Mutex to protect lanes.
+    std::mutex m_mutex;
+    /// Condition variable to notify about new commands.
+    std::condition_variable m_cond;
+
+    /**
+     * @brief Add command to the proper lane.
+     * @param command Command to add.
+     * @return TRUE if the command added or FALSE if queue is full.
+     */
+    bool add(LensQueuedCommand& command);
+};
+}
+}
@@ -0,0 +1,289 @@
+#include <cmath>
+#include <algorithm>
+#include "LensDistortion.h"
+
+
+
+void cr::lens::LensRemapTable::remap(const uint8_t* src, uint8_t* dst,
+                                     int channels) const
+{
+    if (src == nullptr || dst == nullptr || channels <= 0)
+        return;
+
+    const float maxX = (float)(width - 1);
+    const float maxY = (float)(height - 1);
+    const int stride = width * channels;
+    for (int i = 0; i < width * height; ++i)
+    {
+        const float x = mapX[i];
+        const float y = mapY[i];
+        uint8_t* out = &dst[i * channels];
+
+        // Source pixel outside image.
+        if (x < 0.0f || y < 0.0f || x > maxX || y > maxY)
+        {
+            for (int c = 0; c < channels; ++c)
+                out[c] = 0;
+            continue;
+        }
+
+        // Bilinear interpolation.
+        const int x0 = (int)x;
+        const int y0 = (int)y;
+        const int dx = x0 < width - 1 ? channels : 0;
+        const int dy = y0 < height - 1 ? stride : 0;
+        const float wx = x - (float)x0;
+        const float wy = y - (float)y0;
+        const uint8_t* p = &src[y0 * stride + x0 * channels];
+        for (int c = 0; c < channels; ++c)
+        {
+            float top = p[c] + wx * (float)(p[c + dx] - p[c]);
+            float bottom = p[c + dy] + wx * (float)(p[c + dy + dx] -
+                                                    p[c + dy]);
+            out[c] = (uint8_t)(top + wy * (bottom - top) + 0.5f);
+        }
+    }
+}
+
+
+
+cr::lens::LensDistortion::LensDistortion(int cacheSize, int zoomStep)
+{
+    m_cacheSize = cacheSize < 1 ? 1 : cacheSize;
+    m_zoomStep = zoomStep < 1 ? 1 : zoomStep;
+}
+
+
+
+cr::lens::LensDistortion::~LensDistortion()
+{
+
+}
+
+
+
+void cr::lens::LensDistortion::setParams(const cr::lens::LensParams& params)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_fovTable.set(params.fovPoints);
+
+    // Sort points by hardware zoom position.
+    std::vector<DistortionPoint> sorted = params.distortionPoints;
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const DistortionPoint& a, const DistortionPoint& b)
+                     { return a.hwZoomPos < b.hwZoomPos; });
+
+    // Average points with the same hardware zoom position.
+    m_points.clear();
+    size_t i = 0;
+    while (i < sorted.size())
+    {
+        size_t j = i;
+        DistortionPoint point;
+        point.hwZoomPos = sorted[i].hwZoomPos;
+        while (j < sorted.size() && sorted[j].hwZoomPos == point.hwZoomPos)
+        {
+            point.k1 += sorted[j].k1;
+            point.k2 += sorted[j].k2;
+            point.p1 += sorted[j].p1;
+            point.p2 += sorted[j].p2;
+            point.k3 += sorted[j].k3;
+            ++j;
+        }
+        float n = (float)(j - i);
+        point.k1 /= n;
+        point.k2 /= n;
+        point.p1 /= n;
+        point.p2 /= n;
+        point.k3 /= n;
+        m_points.push_back(point);
+        i = j;
+    }
+
+    m_cache.clear();
+    m_calculatedCount = 0;
+    ++m_version;
+}
+
+
+
+bool cr::lens::LensDistortion::setFrameSize(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_width = width;
+    m_height = height;
+    m_cache.clear();
+    m_calculatedCount = 0;
+    ++m_version;
+
+    return true;
+}
+
+
+
+bool cr::lens::LensDistortion::getCoefficients(
+        float hwZoomPos, cr::lens::DistortionPoint& coefficients)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_points.empty())
+        return false;
+
+    interpolate(hwZoomPos, coefficients);
+
+    return true;
+}
+
+
+
+std::shared_ptr<const cr::lens::LensRemapTable>
+cr::lens::LensDistortion::getRemapTable(float hwZoomPos)
+{
+    // Look for table in cache.
+    const int key = (int)std::lround(hwZoomPos / (float)m_zoomStep);
+    const float zoomPos = (float)key * (float)m_zoomStep;
+    DistortionPoint k;
+    float xFov = 0.0f;
+    float yFov = 0.0f;
+    int width = 0;
+    int height = 0;
+    int version = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (Entry& entry : m_cache)
+        {
+            if (entry.key == key)
+            {
+                entry.lastUse = ++m_useCounter;
+                return entry.table;
+            }
+        }
+
+        if (m_points.empty() || m_width == 0 ||
+            !m_fovTable.getFov(zoomPos, xFov, yFov) ||
+            xFov <= 0.0f || xFov >= 180.0f || yFov <= 0.0f || yFov >= 180.0f)
+            return nullptr;
+
+        interpolate(zoomPos, k);
+        width = m_width;
+        height = m_height;
+        version = m_version;
+    }
+
+    // Calculate table without lock so other threads get cached tables.
+    std::shared_ptr<LensRemapTable> table =
+            std::make_shared<LensRemapTable>();
+    table->width = width;
+    table->height = height;
+    table->hwZoomPos = zoomPos;
+    table->mapX.resize((size_t)width * height);
+    table->mapY.resize((size_t)width * height);
+    const float cx = (float)(width - 1) / 2.0f;
+    const float cy = (float)(height - 1) / 2.0f;
+    const float fx = (float)width / 2.0f /
+                     std::tan(xFov * 3.14159265f / 360.0f);
+    const float fy = (float)height / 2.0f /
+                     std::tan(yFov * 3.14159265f / 360.0f);
+    for (int v = 0; v < height; ++v)
+    {
+        const float y = ((float)v - cy) / fy;
+        float* mapX = &table->mapX[(size_t)v * width];
+        float* mapY = &table->mapY[(size_t)v * width];
+        for (int u = 0; u < width; ++u)
+        {
+            // Undistorted pixel to distorted source pixel.
+            const float x = ((float)u - cx) / fx;
+            const float r2 = x * x + y * y;
+            const float radial = 1.0f + r2 * (k.k1 + r2 * (k.k2 + r2 * k.k3));
+            const float xd = x * radial + 2.0f * k.p1 * x * y +
+                             k.p2 * (r2 + 2.0f * x * x);
+            const float yd = y * radial + k.p1 * (r2 + 2.0f * y * y) +
+                             2.0f * k.p2 * x * y;
+            mapX[u] = cx + xd * fx;
+            mapY[u] = cy + yd * fy;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Params changed during calculation. Return table but don't cache it.
+    if (version != m_version)
+        return table;
+
+    // Other thread could calculate the same table.
+    for (Entry& entry : m_cache)
+    {
+        if (entry.key == key)
+        {
+            entry.lastUse = ++m_useCounter;
+            return entry.table;
+        }
+    }
+
+    // Drop least recently used table.
+    if ((int)m_cache.size() >= m_cacheSize)
+    {
+        auto lru = std::min_element(m_cache.begin(), m_cache.end(),
+                                    [](const Entry& a, const Entry& b)
+                                    { return a.lastUse < b.lastUse; });
+        m_cache.erase(lru);
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.lastUse = ++m_useCounter;
+    entry.table = table;
+    m_cache.push_back(entry);
+    ++m_calculatedCount;
+
+    return table;
+}
+
+
+
+int cr::lens::LensDistortion::getCalculatedCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_calculatedCount;
+}
+
+
+
+void cr::lens::LensDistortion::interpolate(
+        float hwZoomPos, cr::lens::DistortionPoint& coefficients)
+{
+    // Out of points range.
+    if (hwZoomPos <= (float)m_points.front().hwZoomPos)
+    {
+        coefficients = m_points.front();
+        coefficients.hwZoomPos = (int)std::lround(hwZoomPos);
+        return;
+    }
+    if (hwZoomPos >= (float)m_points.back().hwZoomPos)
+    {
+        coefficients = m_points.back();
+        coefficients.hwZoomPos = (int)std::lround(hwZoomPos);
+        return;
+    }
+
+    // Find segment and interpolate.
+    size_t i = std::upper_bound(m_points.begin(), m_points.end(), hwZoomPos,
+                                [](float pos, const DistortionPoint& point)
+                                { return pos < (float)point.hwZoomPos; }) -
+               m_points.begin();
+    const DistortionPoint& a = m_points[i - 1];
+    const DistortionPoint& b = m_points[i];
+    float t = (hwZoomPos - (float)a.hwZoomPos) /
+              (float)(b.hwZoomPos - a.hwZoomPos);
+    coefficients.hwZoomPos = (int)std::lround(hwZoomPos);
+    coefficients.k1 = a.k1 + t * (b.k1 - a.k1);
+    coefficients.k2 = a.k2 + t * (b.k2 - a.k2);
+    coefficients.p1 = a.p1 + t * (b.p1 - a.p1);
+    coefficients.p2 = a.p2 + t * (b.p2 - a.p2);
+    coefficients.k3 = a.k3 + t * (b.k3 - a.k3);
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include <mutex>
+#include <memory>
+#include <vector>
+#include "Lens.h"
+#include "LensFovTable.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/**
+ * @brief Undistortion remap table for one zoom position. For each pixel of
+ * undistorted image the table stores coordinates of source pixel in
+ * distorted image (the same format as OpenCV remap maps).
+ */
+class LensRemapTable
+{
+public:
+    /// Frame width, pixels.
+    int width{0};
+    /// Frame height, pixels.
+    int height{0};
+    /// Hardware zoom position the table is calculated for.
+    float hwZoomPos{0.0f};
+    /// Source X coordinates, width * height elements.
+    std::vector<float> mapX;
+    /// Source Y coordinates, width * height elements.
+    std::vector<float> mapY;
+
+    /**
+     * @brief Undistort image with bilinear interpolation. Pixels mapped
+     * outside source image are filled by 0.
+     * @param src Source (distorted) image, 8 bits per channel, interleaved
+     * channels, width * height * channels bytes.
+     * @param dst Output (undistorted) image of the same size. Must not
+     * overlap source image.
+     * @param channels Number of channels (1 - gray, 3 - RGB etc.).
+     */
+    void remap(const uint8_t* src, uint8_t* dst, int channels) const;
+};
+
+
+
+/**
+ * @brief Zoom-dependent lens distortion model. Interpolates Brown-Conrady
+ * coefficients by hardware zoom position according to list of distortion
+ * points (LensParams::distortionPoints) the same way as FOV is interpolated
+ * by FOV points, and keeps cache of precomputed remap tables keyed by
+ * quantized zoom position, so undistortion of each video frame is a table
+ * lookup instead of model evaluation. Tables are shared: cache can drop
+ * table while user still uses it. Class is thread-safe.
+ */
+class LensDistortion
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     * @param cacheSize Max number of remap tables in cache. Each table takes
+     * width * height * 8 bytes.
+     * @param zoomStep Zoom position quantization step, hardware zoom position
+     * units. Positions within the same step share remap table.
+     */
+    LensDistortion(int cacheSize = 4, int zoomStep = 64);
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensDistortion();
+
+    /**
+     * @brief Set lens params: FOV points (to get focal length in pixels) and
+     * distortion points. Clears cache.
+     * @param params Lens params.
+     */
+    void setParams(const LensParams& params);
+
+    /**
+     * @brief Set frame size. Clears cache.
+     * @param width Frame width, pixels.
+     * @param height Frame height, pixels.
+     * @return TRUE if frame size accepted or FALSE if not.
+     */
+    bool setFrameSize(int width, int height);
+
+    /**
+     * @brief Get distortion coefficients for hardware zoom position.
+     * Positions out of points range get coefficients of first or last point.
+     * @param hwZoomPos Hardware zoom position.
+     * @param coefficients Output coefficients (hwZoomPos field is rounded
+     * position).
+     * @return TRUE if coefficients calculated or FALSE if there are no
+     * distortion points.
+     */
+    bool getCoefficients(float hwZoomPos, DistortionPoint& coefficients);
+
+    /**
+     * @brief Get remap table for hardware zoom position. Table is taken from
+     * cache or calculated for quantized zoom position and put to cache
+     * (least recently used table is dropped).
+     * @param hwZoomPos Hardware zoom position.
+     * @return Remap table or nullptr if frame size, FOV points or distortion
+     * points are not set.
+     */
+    std::shared_ptr<const LensRemapTable> getRemapTable(float hwZoomPos);
+
+    /**
+     * @brief Get number of remap tables calculated since last setParams(...)
+     * or setFrameSize(...) call (number of cache misses).
+     * @return Number of calculated tables.
+     */
+    int getCalculatedCount();
+
+private:
+
+    /// Cache entry.
+    struct Entry
+    {
+        /// Quantized zoom position.
+        int key{0};
+        /// Last use counter value.
+        uint64_t lastUse{0};
+        /// Remap table.
+        std::shared_ptr<const LensRemapTable> table;
+    };
+
+    /// Max number of cached tables.
+    int m_cacheSize{4};
+    /// Zoom position quantization step.
+    int m_zoomStep{64};
+    /// Frame width.
+    int m_width{0};
+    /// Frame height.
+    int m_height{0};
+    /// FOV table.
+    LensFovTable m_fovTable;
+    /// Distortion points sorted by zoom position.
+    std::vector<DistortionPoint> m_points;
+    /// Cached tables.
+    std::vector<Entry> m_cache;
+    /// Use counter for LRU.
+    uint64_t m_useCounter{0};
+    /// Number of calculated tables.
+    int m_calculatedCount{0};
+    /// Params version. Changed by setParams(...) and setFrameSize(...) to
+    /// drop tables calculated with old params.
+    int m_version{0};
+    /// Mutex.
+    std::mutex m_mutex;
+
+    /**
+     * @brief Interpolate coefficients without lock.
+     * @param hwZoomPos Hardware zoom position.
+     * @param coefficients Output coefficients.
+     */
+    void interpolate(float hwZoomPos, DistortionPoint& coefficients);
+};
+}
+}
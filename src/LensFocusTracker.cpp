@@ -0,0 +1,227 @@
+#include <cmath>
+#include <algorithm>
+#include "LensFocusTracker.h"
+
+
+
+cr::lens::LensFocusTracker::LensFocusTracker()
+{
+
+}
+
+
+
+cr::lens::LensFocusTracker::~LensFocusTracker()
+{
+
+}
+
+
+
+void cr::lens::LensFocusTracker::setParams(const cr::lens::LensParams& params)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Prepare curves: points sorted by zoom, curves sorted by inverse
+    // distance.
+    m_curves.clear();
+    for (const TrackingCurve& src : params.trackingCurves)
+    {
+        if (src.points.empty())
+            continue;
+        std::vector<TrackingPoint> points = src.points;
+        std::stable_sort(points.begin(), points.end(),
+                         [](const TrackingPoint& a, const TrackingPoint& b)
+                         { return a.hwZoomPos < b.hwZoomPos; });
+        Curve curve;
+        curve.inverseDistance = src.distanceM > 0.0f ?
+                    1.0f / src.distanceM : 0.0f;
+        for (const TrackingPoint& point : points)
+        {
+            curve.zoom.push_back((float)point.hwZoomPos);
+            curve.focus.push_back((float)point.hwFocusPos);
+        }
+        m_curves.push_back(curve);
+    }
+    std::stable_sort(m_curves.begin(), m_curves.end(),
+                     [](const Curve& a, const Curve& b)
+                     { return a.inverseDistance < b.inverseDistance; });
+
+    m_focusMapper.setLinear(params.focusHwNearLimit, params.focusHwFarLimit);
+    m_isLocked = false;
+    m_lastFocusPos = -1.0f;
+}
+
+
+
+void cr::lens::LensFocusTracker::setFocusMapper(
+        const cr::lens::LensPositionMapper& mapper)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_focusMapper = mapper;
+    m_lastFocusPos = -1.0f;
+}
+
+
+
+bool cr::lens::LensFocusTracker::getHwFocus(float hwZoomPos, float distanceM,
+                                            float& hwFocusPos)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_curves.empty())
+        return false;
+
+    hwFocusPos = getFocus(hwZoomPos,
+                          distanceM > 0.0f ? 1.0f / distanceM : 0.0f);
+
+    return true;
+}
+
+
+
+bool cr::lens::LensFocusTracker::getDistance(float hwZoomPos, float hwFocusPos,
+                                             float& distanceM)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_curves.empty())
+        return false;
+
+    float inverseDistance = getInverseDistance(hwZoomPos, hwFocusPos);
+    distanceM = inverseDistance > 0.0f ? 1.0f / inverseDistance : 0.0f;
+
+    return true;
+}
+
+
+
+bool cr::lens::LensFocusTracker::lock(float hwZoomPos, float hwFocusPos)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_curves.empty())
+        return false;
+
+    m_inverseDistance = getInverseDistance(hwZoomPos, hwFocusPos);
+    m_isLocked = true;
+    m_lastFocusPos = -1.0f;
+
+    return true;
+}
+
+
+
+void cr::lens::LensFocusTracker::unlock()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isLocked = false;
+}
+
+
+
+bool cr::lens::LensFocusTracker::isLocked()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_isLocked;
+}
+
+
+
+bool cr::lens::LensFocusTracker::update(float hwZoomPos, float& focusPos,
+                                        float deadband)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_isLocked || m_focusMapper.toHw(0) == m_focusMapper.toHw(65535))
+        return false;
+
+    // Scale hardware focus to user space 0-65535.
+    const float pos = (float)m_focusMapper.toUser(
+                (int)std::lround(getFocus(hwZoomPos, m_inverseDistance)));
+
+    // Skip small changes.
+    if (m_lastFocusPos >= 0.0f && std::abs(pos - m_lastFocusPos) < deadband)
+        return false;
+
+    m_lastFocusPos = pos;
+    focusPos = pos;
+
+    return true;
+}
+
+
+
+float cr::lens::LensFocusTracker::getCurveFocus(const Curve& curve,
+                                                float hwZoomPos)
+{
+    // Out of curve range.
+    if (hwZoomPos <= curve.zoom.front())
+        return curve.focus.front();
+    if (hwZoomPos >= curve.zoom.back())
+        return curve.focus.back();
+
+    // Find segment and interpolate.
+    size_t i = std::upper_bound(curve.zoom.begin(), curve.zoom.end(),
+                                hwZoomPos) - curve.zoom.begin();
+    float k = (hwZoomPos - curve.zoom[i - 1]) /
+              (curve.zoom[i] - curve.zoom[i - 1]);
+
+    return curve.focus[i - 1] + k * (curve.focus[i] - curve.focus[i - 1]);
+}
+
+
+
+float cr::lens::LensFocusTracker::getFocus(float hwZoomPos,
+                                           float inverseDistance)
+{
+    // Out of curves range.
+    if (m_curves.size() == 1 ||
+        inverseDistance <= m_curves.front().inverseDistance)
+        return getCurveFocus(m_curves.front(), hwZoomPos);
+    if (inverseDistance >= m_curves.back().inverseDistance)
+        return getCurveFocus(m_curves.back(), hwZoomPos);
+
+    // Interpolate between two nearest curves.
+    size_t i = 1;
+    while (m_curves[i].inverseDistance < inverseDistance)
+        ++i;
+    const Curve& a = m_curves[i - 1];
+    const Curve& b = m_curves[i];
+    float k = (inverseDistance - a.inverseDistance) /
+              (b.inverseDistance - a.inverseDistance);
+    float focusA = getCurveFocus(a, hwZoomPos);
+    float focusB = getCurveFocus(b, hwZoomPos);
+
+    return focusA + k * (focusB - focusA);
+}
+
+
+
+float cr::lens::LensFocusTracker::getInverseDistance(float hwZoomPos,
+                                                     float hwFocusPos)
+{
+    if (m_curves.size() == 1)
+        return m_curves.front().inverseDistance;
+
+    // Find two nearest curves which focus positions at this zoom bracket
+    // given focus. Focus is monotonic in inverse distance.
+    float focusA = getCurveFocus(m_curves[0], hwZoomPos);
+    for (size_t i = 1; i < m_curves.size(); ++i)
+    {
+        float focusB = getCurveFocus(m_curves[i], hwZoomPos);
+        if ((hwFocusPos - focusA) * (hwFocusPos - focusB) <= 0.0f &&
+            focusA != focusB)
+        {
+            float k = (hwFocusPos - focusA) / (focusB - focusA);
+            return m_curves[i - 1].inverseDistance +
+                   k * (m_curves[i].inverseDistance -
+                        m_curves[i - 1].inverseDistance);
+        }
+        focusA = focusB;
+    }
+
+    // Out of curves range: nearest end curve.
+    float focusFirst = getCurveFocus(m_curves.front(), hwZoomPos);
+    float focusLast = getCurveFocus(m_curves.back(), hwZoomPos);
+    return std::abs(hwFocusPos - focusFirst) <=
+           std::abs(hwFocusPos - focusLast) ?
+                m_curves.front().inverseDistance :
+                m_curves.back().inverseDistance;
+}
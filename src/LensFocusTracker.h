@@ -0,0 +1,156 @@
+#pragma once
+#include <mutex>
+#include <vector>
+#include "Lens.h"
+#include "LensPositionMapper.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/**
+ * @brief Zoom-focus tracker. Keeps focus during zoom by moving focus along
+ * tracking curves (LensParams::trackingCurves) instead of running autofocus
+ * after each zoom move. After focus is found (by autofocus or by user) the
+ * tracker is locked to current zoom and focus positions: object distance is
+ * estimated from tracking curves. During zoom motion controller calls
+ * update(...) with current zoom position and gets focus position for
+ * FOCUS_TO_POS command. Focus between curves is interpolated by inverse
+ * object distance, focus along curve is interpolated by zoom position
+ * (binary search). Class is thread-safe.
+ */
+class LensFocusTracker
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    LensFocusTracker();
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensFocusTracker();
+
+    /**
+     * @brief Set lens params: tracking curves and focus hardware limits.
+     * Unlocks tracker.
+     * @param params Lens params.
+     */
+    void setParams(const LensParams& params);
+
+    /**
+     * @brief Set focus position mapping. Mapping is reset to linear by
+     * setParams(...).
+     * @param mapper Focus position mapper.
+     */
+    void setFocusMapper(const LensPositionMapper& mapper);
+
+    /**
+     * @brief Get hardware focus position for object distance.
+     * @param hwZoomPos Hardware zoom position.
+     * @param distanceM Object distance, meters. 0 - infinity.
+     * @param hwFocusPos Output hardware focus position.
+     * @return TRUE if focus calculated or FALSE if there are no curves.
+     */
+    bool getHwFocus(float hwZoomPos, float distanceM, float& hwFocusPos);
+
+    /**
+     * @brief Estimate object distance by zoom and focus positions.
+     * @param hwZoomPos Hardware zoom position.
+     * @param hwFocusPos Hardware focus position.
+     * @param distanceM Output object distance, meters. 0 - infinity.
+     * @return TRUE if distance estimated or FALSE if there are no curves.
+     */
+    bool getDistance(float hwZoomPos, float hwFocusPos, float& distanceM);
+
+    /**
+     * @brief Lock tracker to object which is in focus now.
+     * @param hwZoomPos Current hardware zoom position.
+     * @param hwFocusPos Current hardware focus position.
+     * @return TRUE if locked or FALSE if there are no curves.
+     */
+    bool lock(float hwZoomPos, float hwFocusPos);
+
+    /**
+     * @brief Unlock tracker (for example, when autofocus started).
+     */
+    void unlock();
+
+    /**
+     * @brief Check if tracker is locked.
+     * @return TRUE if locked or FALSE.
+     */
+    bool isLocked();
+
+    /**
+     * @brief Get focus position for current zoom position.
+     * @param hwZoomPos Current hardware zoom position.
+     * @param focusPos Output focus position 0-65535 (FOCUS_TO_POS command
+     * argument).
+     * @param deadband Min difference between new and last returned focus
+     * position, 0-65535 units.
+     * @return TRUE if new FOCUS_TO_POS command has to be sent or FALSE if
+     * tracker is not locked or focus position didn't change more than
+     * deadband.
+     */
+    bool update(float hwZoomPos, float& focusPos, float deadband = 16.0f);
+
+private:
+
+    /// Prepared tracking curve.
+    struct Curve
+    {
+        /// Inverse object distance, 1/meters.
+        float inverseDistance{0.0f};
+        /// Hardware zoom positions in ascending order.
+        std::vector<float> zoom;
+        /// Hardware focus positions.
+        std::vector<float> focus;
+    };
+
+    /// Curves in ascending order of inverse distance.
+    std::vector<Curve> m_curves;
+    /// Focus position mapper.
+    LensPositionMapper m_focusMapper;
+    /// Tracker is locked.
+    bool m_isLocked{false};
+    /// Inverse distance of locked object.
+    float m_inverseDistance{0.0f};
+    /// Last returned focus position.
+    float m_lastFocusPos{-1.0f};
+    /// Mutex.
+    std::mutex m_mutex;
+
+    /**
+     * @brief Get focus on curve.
+     * @param curve Curve.
+     * @param hwZoomPos Hardware zoom position.
+     * @return Hardware focus position.
+     */
+    static float getCurveFocus(const Curve& curve, float hwZoomPos);
+
+    /**
+     * @brief Get focus for inverse distance.
+     * @param hwZoomPos Hardware zoom position.
+     * @param inverseDistance Inverse object distance, 1/meters.
+     * @return Hardware focus position.
+     */
+    float getFocus(float hwZoomPos, float inverseDistance);
+
+    /**
+     * @brief Get inverse distance by zoom and focus.
+     * @param hwZoomPos Hardware zoom position.
+     * @param hwFocusPos Hardware focus position.
+     * @return Inverse object distance, 1/meters.
+     */
+    float getInverseDistance(float hwZoomPos, float hwFocusPos);
+};
+}
+}
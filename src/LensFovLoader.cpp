@@ -0,0 +1,502 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include "LensFovLoader.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+
+/// Magic number "LFOV".
+#define LENS_FOV_FILE_MAGIC 0x564F464C
+/// Binary file header size.
+#define LENS_FOV_FILE_HEADER_SIZE 12
+/// Binary file point record size.
+#define LENS_FOV_FILE_RECORD_SIZE 12
+/// Size of chunk to read file.
+#define LENS_FOV_FILE_CHUNK_SIZE 65536
+
+
+
+/**
+ * @brief Check if character is CSV values separator.
+ * @param c Character.
+ * @return TRUE if character is separator.
+ */
+static bool isSeparator(char c)
+{
+    return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r';
+}
+
+
+
+/**
+ * @brief Parse decimal number (fixed or exponent notation). Numbers with up
+ * to 15 significant digits and exponent up to 22 are parsed exactly (correctly
+ * rounded), it is enough for float values.
+ * @param p Pointer to text. Moved after number.
+ * @param end End of text.
+ * @param value Output value.
+ * @return TRUE if number parsed or FALSE if not.
+ */
+static bool parseNumber(const char*& p, const char* end, double& value)
+{
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                    1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+                                    1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+                                    1e22};
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    // Mantissa. Extra digits are dropped.
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+    {
+        if (mantissa < 100000000000000000ULL)
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        else
+            ++exponent;
+    }
+    if (p < end && *p == '.')
+    {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+        {
+            if (mantissa < 100000000000000000ULL)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                --exponent;
+            }
+        }
+    }
+    if (digits == 0)
+    {
+        p = start;
+        return false;
+    }
+
+    // Exponent.
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* e = p + 1;
+        bool negativeExponent = false;
+        if (e < end && (*e == '-' || *e == '+'))
+            negativeExponent = *e++ == '-';
+        if (e < end && *e >= '0' && *e <= '9')
+        {
+            int n = 0;
+            for (; e < end && *e >= '0' && *e <= '9'; ++e)
+                n = n < 10000 ? n * 10 + (*e - '0') : n;
+            exponent += negativeExponent ? -n : n;
+            p = e;
+        }
+    }
+
+    value = (double)mantissa;
+    if (exponent > 0)
+        value *= exponent <= 22 ? powers[exponent] : std::pow(10.0, exponent);
+    else if (exponent < 0)
+        value /= exponent >= -22 ? powers[-exponent] :
+                                   std::pow(10.0, -exponent);
+    value = negative ? -value : value;
+
+    return true;
+}
+
+
+
+/**
+ * @brief Parse CSV line with FOV point.
+ * @param p Beginning of line.
+ * @param end End of line (without line feed).
+ * @param point Output FOV point.
+ * @return TRUE if line parsed or FALSE if line has wrong format.
+ */
+static bool parseLine(const char* p, const char* end, cr::lens::FovPoint& point)
+{
+    double values[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        while (p < end && isSeparator(*p))
+            ++p;
+        if (!parseNumber(p, end, values[i]))
+            return false;
+    }
+    while (p < end && isSeparator(*p))
+        ++p;
+    if (p != end || values[0] < (double)INT_MIN || values[0] > (double)INT_MAX)
+        return false;
+
+    point.hwZoomPos = (int)std::lround(values[0]);
+    point.xFovDeg = (float)values[1];
+    point.yFovDeg = (float)values[2];
+
+    return true;
+}
+
+
+
+/**
+ * @brief Read little-endian uint32 regardless of host byte order. Compilers
+ * turn it into one load on little-endian hosts.
+ * @param data Pointer to 4 bytes.
+ * @return Value.
+ */
+static uint32_t readUint32(const uint8_t* data)
+{
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+           ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+
+
+/**
+ * @brief Write little-endian uint32 regardless of host byte order.
+ * @param data Pointer to 4 bytes.
+ * @param value Value.
+ */
+static void writeUint32(uint8_t* data, uint32_t value)
+{
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+}
+
+
+
+/**
+ * @brief Read little-endian float.
+ * @param data Pointer to 4 bytes.
+ * @return Value.
+ */
+static float readFloat(const uint8_t* data)
+{
+    uint32_t bits = readUint32(data);
+    float value = 0.0f;
+    memcpy(&value, &bits, 4);
+    return value;
+}
+
+
+
+/**
+ * @brief Write little-endian float.
+ * @param data Pointer to 4 bytes.
+ * @param value Value.
+ */
+static void writeFloat(uint8_t* data, float value)
+{
+    uint32_t bits = 0;
+    memcpy(&bits, &value, 4);
+    writeUint32(data, bits);
+}
+
+
+
+/**
+ * @brief Parse binary file header.
+ * @param data Header data.
+ * @param count Output number of points.
+ * @return TRUE if header is valid or FALSE if not.
+ */
+static bool parseHeader(const uint8_t* data, uint32_t& count)
+{
+    uint32_t magic = readUint32(&data[0]);
+    uint32_t version = readUint32(&data[4]);
+    count = readUint32(&data[8]);
+    return magic == LENS_FOV_FILE_MAGIC && version == LENS_FOV_FILE_VERSION;
+}
+
+
+
+/**
+ * @brief Parse points records of binary file.
+ * @param data Records data.
+ * @param count Number of records.
+ * @param points Output points.
+ */
+static void parseRecords(const uint8_t* data, size_t count,
+                         cr::lens::FovPoint* points)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint8_t* record = &data[i * LENS_FOV_FILE_RECORD_SIZE];
+        points[i].hwZoomPos = (int32_t)readUint32(&record[0]);
+        points[i].xFovDeg = readFloat(&record[4]);
+        points[i].yFovDeg = readFloat(&record[8]);
+    }
+}
+
+
+
+bool cr::lens::LensFovLoader::readCsv(
+        std::string file, cr::lens::CalibrationTable<FovPoint>& points)
+{
+    FILE* f = fopen(file.c_str(), "rb");
+    if (f == nullptr)
+        return false;
+
+    // Reserve memory by file size (at least ~16 bytes per line).
+    std::vector<FovPoint> items;
+    if (fseek(f, 0, SEEK_END) == 0)
+    {
+        long fileSize = ftell(f);
+        if (fileSize > 0)
+            items.reserve((size_t)fileSize / 16);
+        fseek(f, 0, SEEK_SET);
+    }
+
+    // Read file by chunks. Incomplete line at the end of chunk is moved to
+    // the beginning of buffer.
+    std::vector<char> buffer(LENS_FOV_FILE_CHUNK_SIZE);
+    size_t size = 0;
+    bool isHeaderAllowed = true;
+    bool isEnd = false;
+    while (!isEnd)
+    {
+        size_t n = fread(&buffer[size], 1, buffer.size() - size, f);
+        isEnd = n == 0;
+        size += n;
+
+        const char* p = buffer.data();
+        const char* end = p + size;
+        while (p < end)
+        {
+            const char* eol = (const char*)memchr(p, '\n', end - p);
+            if (eol == nullptr)
+            {
+                // Last line without line feed.
+                if (!isEnd)
+                    break;
+                eol = end;
+            }
+
+            // Skip empty lines and comments.
+            const char* line = p;
+            p = eol < end ? eol + 1 : end;
+            while (line < eol && (*line == ' ' || *line == '\t'))
+                ++line;
+            if (line == eol || *line == '\r' || *line == '#')
+                continue;
+
+            FovPoint point;
+            if (parseLine(line, eol, point))
+            {
+                items.push_back(point);
+            }
+            else if (!isHeaderAllowed ||
+                     (*line >= '0' && *line <= '9') || *line == '-' ||
+                     *line == '+' || *line == '.')
+            {
+                fclose(f);
+                return false;
+            }
+            isHeaderAllowed = false;
+        }
+
+        // Move incomplete line. Line longer than buffer is error.
+        size = end - p;
+        if (size == buffer.size())
+        {
+            fclose(f);
+            return false;
+        }
+        memmove(buffer.data(), p, size);
+    }
+    fclose(f);
+
+    points = std::move(items);
+    points.intern();
+
+    return true;
+}
+
+
+
+bool cr::lens::LensFovLoader::writeCsv(std::string file,
+                                       const std::vector<FovPoint>& points)
+{
+    FILE* f = fopen(file.c_str(), "wb");
+    if (f == nullptr)
+        return false;
+
+    // 9 significant digits are enough to restore float value.
+    bool result = fprintf(f, "hwZoomPos,xFovDeg,yFovDeg\n") > 0;
+    for (size_t i = 0; i < points.size() && result; ++i)
+        result = fprintf(f, "%d,%.9g,%.9g\n", points[i].hwZoomPos,
+                         points[i].xFovDeg, points[i].yFovDeg) > 0;
+
+    return fclose(f) == 0 && result;
+}
+
+
+
+bool cr::lens::LensFovLoader::readBinary(
+        std::string file, cr::lens::CalibrationTable<FovPoint>& points,
+        bool useMmap)
+{
+    std::vector<FovPoint> items;
+    if (useMmap)
+    {
+        // Map file.
+        const uint8_t* data = nullptr;
+        size_t fileSize = 0;
+#if defined(_WIN32)
+        HANDLE fileHandle = CreateFileA(file.c_str(), GENERIC_READ,
+                                        FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                        FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER largeSize;
+        if (!GetFileSizeEx(fileHandle, &largeSize) ||
+            largeSize.QuadPart < LENS_FOV_FILE_HEADER_SIZE)
+        {
+            CloseHandle(fileHandle);
+            return false;
+        }
+        fileSize = (size_t)largeSize.QuadPart;
+        HANDLE mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY,
+                                              0, 0, NULL);
+        CloseHandle(fileHandle);
+        if (mapHandle == nullptr)
+            return false;
+        data = (const uint8_t*)MapViewOfFile(mapHandle, FILE_MAP_READ,
+                                             0, 0, 0);
+        CloseHandle(mapHandle);
+        if (data == nullptr)
+            return false;
+#else
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 ||
+            fileStat.st_size < LENS_FOV_FILE_HEADER_SIZE)
+        {
+            ::close(fd);
+            return false;
+        }
+        fileSize = (size_t)fileStat.st_size;
+        void* ptr = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED)
+            return false;
+        data = (const uint8_t*)ptr;
+#endif
+
+        // Parse points directly from mapped memory.
+        uint32_t count = 0;
+        bool result = parseHeader(data, count) &&
+                      (fileSize - LENS_FOV_FILE_HEADER_SIZE) /
+                      LENS_FOV_FILE_RECORD_SIZE >= count;
+        if (result)
+        {
+            items.resize(count);
+            parseRecords(&data[LENS_FOV_FILE_HEADER_SIZE], count,
+                         items.data());
+        }
+
+#if defined(_WIN32)
+        UnmapViewOfFile(data);
+#else
+        munmap((void*)data, fileSize);
+#endif
+        if (!result)
+            return false;
+    }
+    else
+    {
+        FILE* f = fopen(file.c_str(), "rb");
+        if (f == nullptr)
+            return false;
+
+        // Read header and points by chunks.
+        uint8_t header[LENS_FOV_FILE_HEADER_SIZE];
+        uint32_t count = 0;
+        if (fread(header, 1, sizeof(header), f) != sizeof(header) ||
+            !parseHeader(header, count))
+        {
+            fclose(f);
+            return false;
+        }
+
+        // Check number of points by file size before allocation.
+        long fileSize = -1;
+        if (fseek(f, 0, SEEK_END) == 0)
+            fileSize = ftell(f);
+        if (fileSize < LENS_FOV_FILE_HEADER_SIZE ||
+            fseek(f, LENS_FOV_FILE_HEADER_SIZE, SEEK_SET) != 0 ||
+            (size_t)(fileSize - LENS_FOV_FILE_HEADER_SIZE) /
+            LENS_FOV_FILE_RECORD_SIZE < count)
+        {
+            fclose(f);
+            return false;
+        }
+        std::vector<uint8_t> buffer(LENS_FOV_FILE_CHUNK_SIZE);
+        const size_t chunkCount = buffer.size() / LENS_FOV_FILE_RECORD_SIZE;
+        items.resize(count);
+        for (size_t i = 0; i < count; i += chunkCount)
+        {
+            size_t n = count - i < chunkCount ? count - i : chunkCount;
+            if (fread(buffer.data(), LENS_FOV_FILE_RECORD_SIZE, n, f) != n)
+            {
+                fclose(f);
+                return false;
+            }
+            parseRecords(buffer.data(), n, &items[i]);
+        }
+        fclose(f);
+    }
+
+    points = std::move(items);
+    points.intern();
+
+    return true;
+}
+
+
+
+bool cr::lens::LensFovLoader::writeBinary(std::string file,
+                                          const std::vector<FovPoint>& points)
+{
+    FILE* f = fopen(file.c_str(), "wb");
+    if (f == nullptr)
+        return false;
+
+    // Header.
+    uint8_t header[LENS_FOV_FILE_HEADER_SIZE];
+    writeUint32(&header[0], LENS_FOV_FILE_MAGIC);
+    writeUint32(&header[4], LENS_FOV_FILE_VERSION);
+    writeUint32(&header[8], (uint32_t)points.size());
+    bool result = fwrite(header, 1, sizeof(header), f) == sizeof(header);
+
+    // Points by chunks.
+    std::vector<uint8_t> buffer(LENS_FOV_FILE_CHUNK_SIZE);
+    const size_t chunkCount = buffer.size() / LENS_FOV_FILE_RECORD_SIZE;
+    for (size_t i = 0; i < points.size() && result; i += chunkCount)
+    {
+        size_t n = points.size() - i < chunkCount ? points.size() - i :
+                                                    chunkCount;
+        for (size_t j = 0; j < n; ++j)
+        {
+            uint8_t* record = &buffer[j * LENS_FOV_FILE_RECORD_SIZE];
+            writeUint32(&record[0], (uint32_t)points[i + j].hwZoomPos);
+            writeFloat(&record[4], points[i + j].xFovDeg);
+            writeFloat(&record[8], points[i + j].yFovDeg);
+        }
+        result = fwrite(buffer.data(), LENS_FOV_FILE_RECORD_SIZE, n, f) == n;
+    }
+
+    return fclose(f) == 0 && result;
+}
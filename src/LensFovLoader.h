@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Binary FOV points file format version.
+#define LENS_FOV_FILE_VERSION 1
+
+
+
+/**
+ * @brief Loader of dense FOV points tables (LensParams::fovPoints) produced
+ * by calibration tools. JSON (ConfigReader) builds whole document tree before
+ * points are read, which is slow for tables with thousands of points. Loader
+ * parses files in streaming manner directly to points list. Supported
+ * formats:
+ * - CSV: one point per line "hwZoomPos, xFovDeg, yFovDeg". Values can be
+ *   separated by comma, semicolon, spaces or tabs. Optional header line and
+ *   comment lines (beginning with '#') are skipped.
+ * - Binary (little-endian): magic "LFOV" (4 bytes), format version (uint32),
+ *   number of points (uint32) and points (int32 hwZoomPos, float xFovDeg,
+ *   float yFovDeg for each point). Byte order is converted explicitly, so files
+ *   are portable between hosts. File can be memory-mapped.
+ * Loaded tables are interned (see CalibrationTable), so lenses which load the
+ * same file share one table.
+ */
+class LensFovLoader
+{
+public:
+
+    /**
+     * @brief Read FOV points from CSV file.
+     * @param file File name.
+     * @param points Output FOV points. Not changed in case errors.
+     * @return TRUE if points read or FALSE if file can't be opened or has
+     * wrong format.
+     */
+    static bool readCsv(std::string file, CalibrationTable<FovPoint>& points);
+
+    /**
+     * @brief Write FOV points to CSV file (with header line). Values are
+     * written with precision enough to read the same values back.
+     * @param file File name.
+     * @param points FOV points.
+     * @return TRUE if file written or FALSE if not.
+     */
+    static bool writeCsv(std::string file, const std::vector<FovPoint>& points);
+
+    /**
+     * @brief Read FOV points from binary file.
+     * @param file File name.
+     * @param points Output FOV points. Not changed in case errors.
+     * @param useMmap Map file to memory instead of reading by chunks.
+     * @return TRUE if points read or FALSE if file can't be opened or has
+     * wrong format.
+     */
+    static bool readBinary(std::string file, CalibrationTable<FovPoint>& points,
+                           bool useMmap = true);
+
+    /**
+     * @brief Write FOV points to binary file.
+     * @param file File name.
+     * @param points FOV points.
+     * @return TRUE if file written or FALSE if not.
+     */
+    static bool writeBinary(std::string file,
+                            const std::vector<FovPoint>& points);
+};
+}
+}
@@ -0,0 +1,171 @@
+#include <cmath>
+#include <algorithm>
+#include "LensFovTable.h"
+
+
+
+cr::lens::LensFovTable::LensFovTable()
+{
+
+}
+
+
+
+cr::lens::LensFovTable::LensFovTable(
+        const std::vector<cr::lens::FovPoint>& points)
+{
+    set(points);
+}
+
+
+
+cr::lens::LensFovTable::~LensFovTable()
+{
+
+}
+
+
+
+void cr::lens::LensFovTable::set(const std::vector<cr::lens::FovPoint>& points)
+{
+    m_hwZoomPos.clear();
+    m_xFovDeg.clear();
+    m_yFovDeg.clear();
+
+    // Sort points by hardware zoom position.
+    std::vector<FovPoint> sorted = points;
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const FovPoint& a, const FovPoint& b)
+                     { return a.hwZoomPos < b.hwZoomPos; });
+
+    // Average points with the same hardware zoom position.
+    m_hwZoomPos.reserve(sorted.size());
+    m_xFovDeg.reserve(sorted.size());
+    m_yFovDeg.reserve(sorted.size());
+    size_t i = 0;
+    while (i < sorted.size())
+    {
+        size_t j = i;
+        float xFov = 0.0f;
+        float yFov = 0.0f;
+        while (j < sorted.size() && sorted[j].hwZoomPos == sorted[i].hwZoomPos)
+        {
+            xFov += sorted[j].xFovDeg;
+            yFov += sorted[j].yFovDeg;
+            ++j;
+        }
+        m_hwZoomPos.push_back((float)sorted[i].hwZoomPos);
+        m_xFovDeg.push_back(xFov / (float)(j - i));
+        m_yFovDeg.push_back(yFov / (float)(j - i));
+        i = j;
+    }
+
+    // Check if horizontal FOV is monotonic for inverse lookup.
+    m_isDecreasing = m_xFovDeg.size() < 2 ||
+                     m_xFovDeg.back() <= m_xFovDeg.front();
+    m_isMonotonic = true;
+    for (size_t k = 1; k < m_xFovDeg.size(); ++k)
+    {
+        if (m_isDecreasing ? m_xFovDeg[k] > m_xFovDeg[k - 1] :
+                             m_xFovDeg[k] < m_xFovDeg[k - 1])
+        {
+            m_isMonotonic = false;
+            break;
+        }
+    }
+}
+
+
+
+int cr::lens::LensFovTable::getPointsCount() const
+{
+    return (int)m_hwZoomPos.size();
+}
+
+
+
+bool cr::lens::LensFovTable::getFov(float hwZoomPos, float& xFovDeg,
+                                    float& yFovDeg) const
+{
+    if (m_hwZoomPos.empty())
+        return false;
+
+    // Out of table range.
+    if (hwZoomPos <= m_hwZoomPos.front())
+    {
+        xFovDeg = m_xFovDeg.front();
+        yFovDeg = m_yFovDeg.front();
+        return true;
+    }
+    if (hwZoomPos >= m_hwZoomPos.back())
+    {
+        xFovDeg = m_xFovDeg.back();
+        yFovDeg = m_yFovDeg.back();
+        return true;
+    }
+
+    // Find segment and interpolate.
+    size_t i = std::upper_bound(m_hwZoomPos.begin(), m_hwZoomPos.end(),
+                                hwZoomPos) - m_hwZoomPos.begin();
+    float k = (hwZoomPos - m_hwZoomPos[i - 1]) /
+              (m_hwZoomPos[i] - m_hwZoomPos[i - 1]);
+    xFovDeg = m_xFovDeg[i - 1] + k * (m_xFovDeg[i] - m_xFovDeg[i - 1]);
+    yFovDeg = m_yFovDeg[i - 1] + k * (m_yFovDeg[i] - m_yFovDeg[i - 1]);
+
+    return true;
+}
+
+
+
+bool cr::lens::LensFovTable::getHwZoomPos(float xFovDeg,
+                                          float& hwZoomPos) const
+{
+    if (m_hwZoomPos.empty())
+        return false;
+
+    // Find first point (in order of zoom position) which FOV reaches given
+    // FOV.
+    size_t i = 0;
+    if (m_isMonotonic)
+    {
+        i = m_isDecreasing ?
+            std::lower_bound(m_xFovDeg.begin(), m_xFovDeg.end(), xFovDeg,
+                             [](float a, float b) { return a > b; }) -
+                m_xFovDeg.begin() :
+            std::lower_bound(m_xFovDeg.begin(), m_xFovDeg.end(), xFovDeg) -
+                m_xFovDeg.begin();
+    }
+    else
+    {
+        for (i = 0; i < m_xFovDeg.size(); ++i)
+        {
+            if (m_xFovDeg[i] == xFovDeg || (i > 0 &&
+                (m_xFovDeg[i - 1] - xFovDeg) * (m_xFovDeg[i] - xFovDeg) < 0.0f))
+                break;
+        }
+    }
+
+    // FOV out of table range: nearest point by FOV.
+    if (i == 0)
+    {
+        hwZoomPos = m_hwZoomPos.front();
+        return true;
+    }
+    if (i == m_xFovDeg.size())
+    {
+        size_t nearest = 0;
+        for (size_t k = 1; k < m_xFovDeg.size(); ++k)
+            if (std::abs(m_xFovDeg[k] - xFovDeg) <
+                std::abs(m_xFovDeg[nearest] - xFovDeg))
+                nearest = k;
+        hwZoomPos = m_hwZoomPos[nearest];
+        return true;
+    }
+
+    // Interpolate inside segment.
+    float k = m_xFovDeg[i] == m_xFovDeg[i - 1] ? 0.0f :
+              (xFovDeg - m_xFovDeg[i - 1]) / (m_xFovDeg[i] - m_xFovDeg[i - 1]);
+    hwZoomPos = m_hwZoomPos[i - 1] + k * (m_hwZoomPos[i] - m_hwZoomPos[i - 1]);
+
+    return true;
+}
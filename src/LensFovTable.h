@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/**
+ * @brief Field of view table. Approximates FOV by hardware zoom position
+ * according to list of FOV points (LensParams::fovPoints) using linear
+ * interpolation between points. Points are sorted by hardware zoom position
+ * once, so lookup takes O(log n). Inverse lookup (hardware zoom position for
+ * horizontal FOV) takes O(log n) if FOV is monotonic in zoom position or
+ * O(n) otherwise. Table doesn't have internal lock: it can be read from
+ * several threads but must not be changed at the same time.
+ */
+class LensFovTable
+{
+public:
+
+    /**
+     * @brief Class constructor. Creates empty table.
+     */
+    LensFovTable();
+
+    /**
+     * @brief Class constructor.
+     * @param points List of FOV points in any order.
+     */
+    LensFovTable(const std::vector<FovPoint>& points);
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensFovTable();
+
+    /**
+     * @brief Set FOV points. Points with the same hardware zoom position are
+     * averaged.
+     * @param points List of FOV points in any order.
+     */
+    void set(const std::vector<FovPoint>& points);
+
+    /**
+     * @brief Get number of points in table.
+     * @return Number of points.
+     */
+    int getPointsCount() const;
+
+    /**
+     * @brief Get FOV for hardware zoom position. Positions out of table range
+     * get FOV of first or last point.
+     * @param hwZoomPos Hardware zoom position.
+     * @param xFovDeg Output horizontal FOV, degree.
+     * @param yFovDeg Output vertical FOV, degree.
+     * @return TRUE if FOV calculated or FALSE if table is empty.
+     */
+    bool getFov(float hwZoomPos, float& xFovDeg, float& yFovDeg) const;
+
+    /**
+     * @brief Get hardware zoom position for horizontal FOV (inverse of
+     * getFov(...)). FOV out of table range gets position of the nearest
+     * (by FOV) point. If FOV is not monotonic in zoom position the lowest
+     * position with given FOV is returned.
+     * @param xFovDeg Horizontal FOV, degree.
+     * @param hwZoomPos Output hardware zoom position.
+     * @return TRUE if position calculated or FALSE if table is empty.
+     */
+    bool getHwZoomPos(float xFovDeg, float& hwZoomPos) const;
+
+private:
+
+    /// Hardware zoom positions in ascending order.
+    std::vector<float> m_hwZoomPos;
+    /// Horizontal FOV of points, degree.
+    std::vector<float> m_xFovDeg;
+    /// Vertical FOV of points, degree.
+    std::vector<float> m_yFovDeg;
+    /// Horizontal FOV is monotonic in zoom position.
+    bool m_isMonotonic{true};
+    /// Horizontal FOV decreases with zoom position.
+    bool m_isDecreasing{true};
+};
+}
+}
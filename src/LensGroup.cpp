@@ -0,0 +1,400 @@
+#include <cmath>
+#include "LensGroup.h"
+
+
+
+/// Pi.
+#define LENS_GROUP_PI 3.14159265358979323846
+/// Number of trajectory segments checked for zoom rate limits.
+#define LENS_GROUP_PLAN_STEPS 64
+/// Part of max zoom rate used for trajectory. The rest is reserve to catch up
+/// with trajectory.
+#define LENS_GROUP_RATE_MARGIN 0.8
+
+
+
+cr::lens::LensGroup::LensGroup()
+{
+
+}
+
+
+
+cr::lens::LensGroup::~LensGroup()
+{
+
+}
+
+
+
+bool cr::lens::LensGroup::addLens(cr::lens::Lens& lens, float maxHwZoomRate,
+                                  const cr::lens::LensPositionMapper* mapper)
+{
+    LensParams params;
+    lens.getParams(params);
+    if (params.fovPoints.empty() || maxHwZoomRate <= 0.0f ||
+        params.zoomHwWideLimit == params.zoomHwTeleLimit)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Member member;
+    member.lens = &lens;
+    member.fovTable.set(params.fovPoints);
+    member.hwWide = (float)params.zoomHwWideLimit;
+    member.hwTele = (float)params.zoomHwTeleLimit;
+    member.maxHwRate = maxHwZoomRate;
+    if (mapper != nullptr)
+        member.mapper = *mapper;
+    else
+        member.mapper.setLinear(params.zoomHwWideLimit,
+                                params.zoomHwTeleLimit);
+    m_members.push_back(member);
+    m_isMoving = false;
+
+    return true;
+}
+
+
+
+int cr::lens::LensGroup::getLensCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (int)m_members.size();
+}
+
+
+
+bool cr::lens::LensGroup::setTolerance(float tolerancePercent)
+{
+    // Zero tolerance pauses trajectory forever (NaN is rejected too).
+    if (!(tolerancePercent > 0.0f))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tolerance = tolerancePercent;
+
+    return true;
+}
+
+
+
+bool cr::lens::LensGroup::setStallTimeout(float timeoutSec)
+{
+    if (!(timeoutSec > 0.0f))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stallTimeout = timeoutSec;
+
+    return true;
+}
+
+
+
+bool cr::lens::LensGroup::getFovRange(float& minXFovDeg, float& maxXFovDeg)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return calculateFovRange(minXFovDeg, maxXFovDeg);
+}
+
+
+
+bool cr::lens::LensGroup::zoomToFov(float xFovDeg)
+{
+    // Current positions of lenses are read without lock.
+    std::vector<Lens*> lenses;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_members.empty())
+            return false;
+        for (Member& member : m_members)
+            lenses.push_back(member.lens);
+    }
+    std::vector<float> hwZoomPos(lenses.size());
+    for (size_t i = 0; i < lenses.size(); ++i)
+        hwZoomPos[i] = lenses[i]->getParam(LensParam::ZOOM_HW_POS);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_members.size() != lenses.size())
+        return false;
+
+    // Clamp target FOV to common range.
+    float minXFov = 0.0f;
+    float maxXFov = 0.0f;
+    float startXFov = 0.0f;
+    float startYFov = 0.0f;
+    if (!calculateFovRange(minXFov, maxXFov) ||
+        !m_members.front().fovTable.getFov(hwZoomPos[0], startXFov,
+                                           startYFov))
+        return false;
+    xFovDeg = xFovDeg < minXFov ? minXFov : (xFovDeg > maxXFov ? maxXFov :
+                                                                 xFovDeg);
+    startXFov = startXFov < minXFov ? minXFov :
+                (startXFov > maxXFov ? maxXFov : startXFov);
+    m_startLogTan = std::log(std::tan(startXFov * LENS_GROUP_PI / 360.0));
+    m_endLogTan = std::log(std::tan(xFovDeg * LENS_GROUP_PI / 360.0));
+
+    // Duration: no lens exceeds its max rate at any trajectory segment.
+    m_duration = 0.001;
+    for (Member& member : m_members)
+    {
+        float prevHwPos = 0.0f;
+        member.fovTable.getHwZoomPos(getTrajectoryFov(0.0), prevHwPos);
+        for (int i = 1; i <= LENS_GROUP_PLAN_STEPS; ++i)
+        {
+            float hwPos = 0.0f;
+            member.fovTable.getHwZoomPos(
+                        getTrajectoryFov((double)i / LENS_GROUP_PLAN_STEPS),
+                        hwPos);
+            double duration = std::fabs(hwPos - prevHwPos) *
+                              LENS_GROUP_PLAN_STEPS /
+                              (member.maxHwRate * LENS_GROUP_RATE_MARGIN);
+            m_duration = duration > m_duration ? duration : m_duration;
+            prevHwPos = hwPos;
+        }
+        member.speed = -1;
+    }
+
+    // Sync phase: lenses move to start FOV at max rate. Time limit is travel
+    // time of the slowest lens plus stall timeout.
+    m_syncTimeout = m_stallTimeout;
+    for (size_t i = 0; i < m_members.size(); ++i)
+    {
+        float hwPos = 0.0f;
+        m_members[i].fovTable.getHwZoomPos(getTrajectoryFov(0.0), hwPos);
+        double duration = std::fabs(hwPos - hwZoomPos[i]) /
+                          m_members[i].maxHwRate + m_stallTimeout;
+        m_syncTimeout = duration > m_syncTimeout ? duration : m_syncTimeout;
+    }
+
+    m_progress = 0.0;
+    m_stallTime = 0.0;
+    m_syncTime = 0.0;
+    m_isSyncing = true;
+    m_isMoving = true;
+    m_isFailed = false;
+    m_lastUpdateTime = std::chrono::steady_clock::now();
+
+    return true;
+}
+
+
+
+void cr::lens::LensGroup::stop()
+{
+    std::vector<Lens*> lenses;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isMoving = false;
+        for (Member& member : m_members)
+            lenses.push_back(member.lens);
+    }
+
+    for (Lens* lens : lenses)
+        lens->executeCommand(LensCommand::ZOOM_STOP);
+}
+
+
+
+bool cr::lens::LensGroup::update()
+{
+    float elapsedSec = 0.0f;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto time = std::chrono::steady_clock::now();
+        elapsedSec = std::chrono::duration<float>(
+                    time - m_lastUpdateTime).count();
+        m_lastUpdateTime = time;
+    }
+    return update(elapsedSec);
+}
+
+
+
+bool cr::lens::LensGroup::update(float elapsedSec)
+{
+    // Read zoom positions without lock (lens calls can be slow).
+    std::vector<Lens*> lenses;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_isMoving)
+            return false;
+        for (Member& member : m_members)
+            lenses.push_back(member.lens);
+    }
+    std::vector<float> hwZoomPos(lenses.size());
+    for (size_t i = 0; i < lenses.size(); ++i)
+        hwZoomPos[i] = lenses[i]->getParam(LensParam::ZOOM_HW_POS);
+
+    // Calculate commands.
+    std::vector<int> speed(lenses.size(), -1);
+    std::vector<float> pos(lenses.size(), 0.0f);
+    bool isStalled = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_isMoving || m_members.size() != lenses.size())
+            return m_isMoving;
+
+        // Mismatch between lenses and deviation from trajectory.
+        const float xFov = getTrajectoryFov(m_progress);
+        float minXFov = 0.0f;
+        float maxXFov = 0.0f;
+        bool isOnTrajectory = true;
+        for (size_t i = 0; i < m_members.size(); ++i)
+        {
+            float lensXFov = 0.0f;
+            float lensYFov = 0.0f;
+            m_members[i].fovTable.getFov(hwZoomPos[i], lensXFov, lensYFov);
+            minXFov = i == 0 || lensXFov < minXFov ? lensXFov : minXFov;
+            maxXFov = i == 0 || lensXFov > maxXFov ? lensXFov : maxXFov;
+            if (std::fabs(lensXFov - xFov) / xFov * 100.0f > m_tolerance / 2.0f)
+                isOnTrajectory = false;
+        }
+        m_mismatch = minXFov > 0.0f ? (maxXFov - minXFov) / minXFov * 100.0f :
+                                      0.0f;
+
+        // Move along trajectory only if all lenses follow it.
+        if (isOnTrajectory)
+        {
+            if (m_progress >= 1.0)
+            {
+                m_isMoving = false;
+                return false;
+            }
+            m_progress += elapsedSec > 0.0f ? elapsedSec / m_duration : 1.0;
+            m_progress = m_progress > 1.0 ? 1.0 : m_progress;
+            m_stallTime = 0.0;
+            m_isSyncing = false;
+        }
+        else if (m_isSyncing)
+        {
+            // Lenses which started far from start FOV are not stalled.
+            m_syncTime += elapsedSec > 0.0f ? elapsedSec : 0.0f;
+            if (m_syncTime > m_syncTimeout)
+            {
+                m_isMoving = false;
+                m_isFailed = true;
+                isStalled = true;
+            }
+        }
+        else
+        {
+            // Lens which doesn't catch up within timeout stops the group.
+            m_stallTime += elapsedSec > 0.0f ? elapsedSec : 0.0f;
+            if (m_stallTime > m_stallTimeout)
+            {
+                m_isMoving = false;
+                m_isFailed = true;
+                isStalled = true;
+            }
+        }
+
+        // Position and speed to reach next trajectory point by next tick.
+        const float targetXFov = getTrajectoryFov(m_progress);
+        for (size_t i = 0; i < m_members.size() && !isStalled; ++i)
+        {
+            Member& member = m_members[i];
+            float hwPos = 0.0f;
+            member.fovTable.getHwZoomPos(targetXFov, hwPos);
+            int newSpeed = 100;
+            if (elapsedSec > 0.0f)
+            {
+                float rate = std::fabs(hwPos - hwZoomPos[i]) / elapsedSec;
+                newSpeed = (int)std::ceil(rate / member.maxHwRate * 100.0f);
+                newSpeed = newSpeed < 1 ? 1 : (newSpeed > 100 ? 100 :
+                                                                newSpeed);
+            }
+            if (newSpeed != member.speed)
+            {
+                member.speed = newSpeed;
+                speed[i] = newSpeed;
+            }
+            pos[i] = (float)member.mapper.toUser((int)std::lround(hwPos));
+        }
+    }
+
+    // Stop lenses of stalled group.
+    if (isStalled)
+    {
+        for (Lens* lens : lenses)
+            lens->executeCommand(LensCommand::ZOOM_STOP);
+        return false;
+    }
+
+    // Send commands.
+    for (size_t i = 0; i < lenses.size(); ++i)
+    {
+        if (speed[i] >= 0)
+            lenses[i]->setParam(LensParam::ZOOM_SPEED, (float)speed[i]);
+        lenses[i]->executeCommand(LensCommand::ZOOM_TO_POS, pos[i]);
+    }
+
+    return true;
+}
+
+
+
+bool cr::lens::LensGroup::isMoving()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_isMoving;
+}
+
+
+
+bool cr::lens::LensGroup::isSyncing()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_isMoving && m_isSyncing;
+}
+
+
+
+bool cr::lens::LensGroup::isFailed()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_isFailed;
+}
+
+
+
+float cr::lens::LensGroup::getMismatch()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mismatch;
+}
+
+
+
+bool cr::lens::LensGroup::calculateFovRange(float& minXFovDeg,
+                                            float& maxXFovDeg)
+{
+    if (m_members.empty())
+        return false;
+
+    // Intersection of FOV ranges of lenses.
+    for (size_t i = 0; i < m_members.size(); ++i)
+    {
+        float wideXFov = 0.0f;
+        float teleXFov = 0.0f;
+        float yFov = 0.0f;
+        m_members[i].fovTable.getFov(m_members[i].hwWide, wideXFov, yFov);
+        m_members[i].fovTable.getFov(m_members[i].hwTele, teleXFov, yFov);
+        float minXFov = wideXFov < teleXFov ? wideXFov : teleXFov;
+        float maxXFov = wideXFov < teleXFov ? teleXFov : wideXFov;
+        minXFovDeg = i == 0 || minXFov > minXFovDeg ? minXFov : minXFovDeg;
+        maxXFovDeg = i == 0 || maxXFov < maxXFovDeg ? maxXFov : maxXFovDeg;
+    }
+
+    return minXFovDeg > 0.0f && minXFovDeg <= maxXFovDeg &&
+           maxXFovDeg < 180.0f;
+}
+
+
+
+float cr::lens::LensGroup::getTrajectoryFov(double progress)
+{
+    double logTan = m_startLogTan + (m_endLogTan - m_startLogTan) * progress;
+    return (float)(std::atan(std::exp(logTan)) * 360.0 / LENS_GROUP_PI);
+}
@@ -0,0 +1,231 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include "Lens.h"
+#include "LensFovTable.h"
+#include "LensPositionMapper.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Default time limit of trajectory pause, seconds.
+#define LENS_GROUP_DEFAULT_STALL_TIMEOUT_SEC 2.0f
+
+
+
+/**
+ * @brief Group of lenses with synchronized zoom (for example, day and thermal
+ * cameras of one gimbal). Target horizontal FOV is mapped through FOV table
+ * (LensParams::fovPoints) of each lens, so all lenses show the same field of
+ * view. Move is planned as common FOV trajectory with constant magnification
+ * rate (log of tan(FOV / 2) changes linearly in time). Duration of move is
+ * chosen so no lens exceeds its max zoom rate at any part of trajectory. On
+ * each control tick controller calls update(): group reads zoom positions of
+ * lenses, sends ZOOM_TO_POS command with position of the next trajectory
+ * point to each lens and sets ZOOM_SPEED, so lenses reach the point together
+ * at the end of tick. Move starts with sync phase: lenses which are not at
+ * start FOV (current FOV of first lens) move there at max rate. Trajectory
+ * starts when all lenses reach start FOV. If any lens deviates from
+ * trajectory more than half of tolerance the trajectory is paused until the
+ * lens catches up, so FOV mismatch between lenses stays under tolerance from
+ * the end of sync phase to the end of move. If the lens doesn't catch up
+ * within stall timeout (lens is stuck or doesn't execute commands) the group
+ * stops and reports failure (isFailed()). Sync phase is not counted as
+ * stall: its time limit is travel time of the slowest lens plus stall
+ * timeout. Lenses must outlive the group. Class is thread-safe.
+ */
+class LensGroup
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    LensGroup();
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensGroup();
+
+    /**
+     * @brief Add lens to group. FOV points and zoom hardware limits are read
+     * by Lens::getParams(...). Stops current move.
+     * @param lens Lens controller. Must be initialized.
+     * @param maxHwZoomRate Hardware zoom position change per second at
+     * ZOOM_SPEED 100.
+     * @param mapper Zoom position mapping of lens (must be the same as lens
+     * controller uses for ZOOM_TO_POS command). Null - linear mapping between
+     * zoom hardware limits.
+     * @return TRUE if lens added or FALSE if lens doesn't have FOV points,
+     * zoom hardware limits are equal or rate is not positive.
+     */
+    bool addLens(Lens& lens, float maxHwZoomRate,
+                 const LensPositionMapper* mapper = nullptr);
+
+    /**
+     * @brief Get number of lenses in group.
+     * @return Number of lenses.
+     */
+    int getLensCount();
+
+    /**
+     * @brief Set max FOV mismatch between lenses.
+     * @param tolerancePercent Max difference of horizontal FOV between lenses,
+     * percent of FOV. Default 2 %.
+     * @return TRUE if tolerance set or FALSE if it is not positive.
+     */
+    bool setTolerance(float tolerancePercent);
+
+    /**
+     * @brief Set time limit of trajectory pause. If any lens stays off
+     * trajectory longer the group stops.
+     * @param timeoutSec Stall timeout, seconds. Default
+     * LENS_GROUP_DEFAULT_STALL_TIMEOUT_SEC.
+     * @return TRUE if timeout set or FALSE if it is not positive.
+     */
+    bool setStallTimeout(float timeoutSec);
+
+    /**
+     * @brief Get horizontal FOV range available for all lenses of group.
+     * @param minXFovDeg Output min horizontal FOV (tele), degree.
+     * @param maxXFovDeg Output max horizontal FOV (wide), degree.
+     * @return TRUE if range calculated or FALSE if group is empty or FOV
+     * ranges of lenses don't overlap.
+     */
+    bool getFovRange(float& minXFovDeg, float& maxXFovDeg);
+
+    /**
+     * @brief Start synchronized zoom to horizontal FOV. Method only plans
+     * trajectory and doesn't send commands to lenses. Trajectory starts from
+     * current FOV of first lens after sync phase. FOV out of common range is
+     * clamped.
+     * @param xFovDeg Target horizontal FOV, degree.
+     * @return TRUE if move started or FALSE if FOV range is not available.
+     */
+    bool zoomToFov(float xFovDeg);
+
+    /**
+     * @brief Stop move and send ZOOM_STOP command to all lenses.
+     */
+    void stop();
+
+    /**
+     * @brief Control tick. Time since previous tick is measured by steady
+     * clock.
+     * @return TRUE if group is moving or FALSE if move is finished.
+     */
+    bool update();
+
+    /**
+     * @brief Control tick.
+     * @param elapsedSec Time since previous tick, seconds.
+     * @return TRUE if group is moving or FALSE if move is finished.
+     */
+    bool update(float elapsedSec);
+
+    /**
+     * @brief Check if group is moving.
+     * @return TRUE if group is moving or FALSE.
+     */
+    bool isMoving();
+
+    /**
+     * @brief Check if group moves lenses to start FOV of trajectory. FOV
+     * mismatch can exceed tolerance during sync phase.
+     * @return TRUE if group is in sync phase or FALSE.
+     */
+    bool isSyncing();
+
+    /**
+     * @brief Check if last move was stopped by stall timeout. Flag is reset
+     * by zoomToFov(...).
+     * @return TRUE if move failed or FALSE.
+     */
+    bool isFailed();
+
+    /**
+     * @brief Get FOV mismatch between lenses measured at last update.
+     * @return Max difference of horizontal FOV between lenses, percent.
+     */
+    float getMismatch();
+
+private:
+
+    /// Lens of group.
+    struct Member
+    {
+        /// Lens controller.
+        Lens* lens{nullptr};
+        /// FOV table.
+        LensFovTable fovTable;
+        /// Hardware zoom position which corresponds to 0 user position.
+        float hwWide{0.0f};
+        /// Hardware zoom position which corresponds to 65535 user position.
+        float hwTele{0.0f};
+        /// Max hardware zoom rate, units per second.
+        float maxHwRate{0.0f};
+        /// Zoom position mapper.
+        LensPositionMapper mapper;
+        /// Last set zoom speed, -1 if not set.
+        int speed{-1};
+    };
+
+    /// Lenses.
+    std::vector<Member> m_members;
+    /// Max FOV mismatch, percent.
+    float m_tolerance{2.0f};
+    /// Stall timeout, seconds.
+    float m_stallTimeout{LENS_GROUP_DEFAULT_STALL_TIMEOUT_SEC};
+    /// Group is moving.
+    bool m_isMoving{false};
+    /// Last move was stopped by stall timeout.
+    bool m_isFailed{false};
+    /// Time trajectory is paused, seconds.
+    double m_stallTime{0.0};
+    /// Lenses move to start FOV of trajectory.
+    bool m_isSyncing{false};
+    /// Time of sync phase, seconds.
+    double m_syncTime{0.0};
+    /// Time limit of sync phase, seconds.
+    double m_syncTimeout{0.0};
+    /// Log of tan(FOV / 2) at trajectory start.
+    double m_startLogTan{0.0};
+    /// Log of tan(FOV / 2) at trajectory end.
+    double m_endLogTan{0.0};
+    /// Trajectory duration, seconds.
+    double m_duration{0.0};
+    /// Trajectory progress 0-1.
+    double m_progress{0.0};
+    /// Last measured mismatch, percent.
+    float m_mismatch{0.0f};
+    /// Time of last update.
+    std::chrono::steady_clock::time_point m_lastUpdateTime;
+    /// Mutex.
+    std::mutex m_mutex;
+
+    /**
+     * @brief Calculate FOV range available for all lenses. Must be called
+     * under lock.
+     * @param minXFovDeg Output min horizontal FOV, degree.
+     * @param maxXFovDeg Output max horizontal FOV, degree.
+     * @return TRUE if range calculated or FALSE if not.
+     */
+    bool calculateFovRange(float& minXFovDeg, float& maxXFovDeg);
+
+    /**
+     * @brief Get trajectory FOV.
+     * @param progress Trajectory progress 0-1.
+     * @return Horizontal FOV, degree.
+     */
+    float getTrajectoryFov(double progress);
+};
+}
+}
@@ -0,0 +1,231 @@
+#include <cstring>
+#include "LensKlvEncoder.h"
+
+
+
+/// MISB ST 0601 UAS Datalink Local Set universal key.
+static const uint8_t g_uasLocalSetKey[16] = {
+    0x06, 0x0E, 0x2B, 0x34, 0x02, 0x0B, 0x01, 0x01,
+    0x0E, 0x01, 0x03, 0x01, 0x01, 0x00, 0x00, 0x00};
+
+
+
+/// MISB ST 0601 local tags.
+#define KLV_TAG_CHECKSUM 1
+#define KLV_TAG_PRECISION_TIME_STAMP 2
+#define KLV_TAG_SENSOR_HORIZONTAL_FOV 16
+#define KLV_TAG_SENSOR_VERTICAL_FOV 17
+#define KLV_TAG_UAS_LS_VERSION 65
+
+
+
+/// MISB ST 0601 version written to packets.
+#define KLV_UAS_LS_VERSION 19
+
+
+
+/// Add bytes to MISB ST 0601 checksum (16-bit sum of bytes, bytes with even
+/// offset in high byte).
+static uint16_t addChecksum(uint16_t checksum, const uint8_t* data, int pos,
+                            int size)
+{
+    for (int i = pos; i < pos + size; ++i)
+        checksum += (uint16_t)(data[i] << (8 * ((i + 1) % 2)));
+    return checksum;
+}
+
+
+
+/// Write big-endian uint16 FOV value: 0-180 degree to 0-65535.
+static void writeFov(uint8_t* data, float fovDeg)
+{
+    // NaN fails both comparisons and is written as 0.
+    fovDeg = fovDeg > 0.0f ? (fovDeg < 180.0f ? fovDeg : 180.0f) : 0.0f;
+    uint16_t value = (uint16_t)(fovDeg * 65535.0f / 180.0f + 0.5f);
+    data[0] = (uint8_t)(value >> 8);
+    data[1] = (uint8_t)value;
+}
+
+
+
+/// Write big-endian uint16 position: 0-65535.
+static void writePos(uint8_t* data, float pos)
+{
+    // NaN fails both comparisons and is written as 0.
+    pos = pos > 0.0f ? (pos < 65535.0f ? pos : 65535.0f) : 0.0f;
+    uint16_t value = (uint16_t)(pos + 0.5f);
+    data[0] = (uint8_t)(value >> 8);
+    data[1] = (uint8_t)value;
+}
+
+
+
+/// Check if local tag is written by encoder itself.
+static bool isReservedTag(int tag)
+{
+    return tag == KLV_TAG_CHECKSUM || tag == KLV_TAG_PRECISION_TIME_STAMP ||
+           tag == KLV_TAG_SENSOR_HORIZONTAL_FOV ||
+           tag == KLV_TAG_SENSOR_VERTICAL_FOV || tag == KLV_TAG_UAS_LS_VERSION;
+}
+
+
+
+cr::lens::LensKlvEncoder::LensKlvEncoder(int zoomTag, int focusTag)
+{
+    // Tags of items written by encoder and duplicated tag disable the item.
+    if (zoomTag < 0 || zoomTag > 127 || isReservedTag(zoomTag))
+        zoomTag = 0;
+    if (focusTag < 0 || focusTag > 127 || isReservedTag(focusTag) ||
+        focusTag == zoomTag)
+        focusTag = 0;
+
+    // Key and BER short form length (set below).
+    memset(m_template, 0, sizeof(m_template));
+    memcpy(m_template, g_uasLocalSetKey, 16);
+    int pos = 17;
+
+    // Precision time stamp must be the first item.
+    m_template[pos++] = KLV_TAG_PRECISION_TIME_STAMP;
+    m_template[pos++] = 8;
+    m_timestampPos = pos;
+    pos += 8;
+
+    m_template[pos++] = KLV_TAG_SENSOR_HORIZONTAL_FOV;
+    m_template[pos++] = 2;
+    m_xFovPos = pos;
+    pos += 2;
+
+    m_template[pos++] = KLV_TAG_SENSOR_VERTICAL_FOV;
+    m_template[pos++] = 2;
+    m_yFovPos = pos;
+    pos += 2;
+
+    if (zoomTag != 0)
+    {
+        m_template[pos++] = (uint8_t)zoomTag;
+        m_template[pos++] = 2;
+        m_zoomPos = pos;
+        pos += 2;
+    }
+
+    if (focusTag != 0)
+    {
+        m_template[pos++] = (uint8_t)focusTag;
+        m_template[pos++] = 2;
+        m_focusPos = pos;
+        pos += 2;
+    }
+
+    m_template[pos++] = KLV_TAG_UAS_LS_VERSION;
+    m_template[pos++] = 1;
+    m_template[pos++] = KLV_UAS_LS_VERSION;
+
+    // Checksum must be the last item. Its tag and length are included into
+    // checksum.
+    m_template[pos++] = KLV_TAG_CHECKSUM;
+    m_template[pos++] = 2;
+    m_size = pos + 2;
+    m_template[16] = (uint8_t)(m_size - 17);
+
+    // Value bytes are zero in template, so checksum of template is checksum
+    // of constant bytes.
+    m_checksum = addChecksum(0, m_template, 0, pos);
+}
+
+
+
+cr::lens::LensKlvEncoder::~LensKlvEncoder()
+{
+
+}
+
+
+
+int cr::lens::LensKlvEncoder::getPacketSize() const
+{
+    return m_size;
+}
+
+
+
+bool cr::lens::LensKlvEncoder::encode(const cr::lens::LensParams& params,
+                                      uint64_t timestampUsec, uint8_t* data,
+                                      int bufferSize, int& size) const
+{
+    return encode(params.xFovDeg, params.yFovDeg, (float)params.zoomPos,
+                  (float)params.focusPos, timestampUsec, data, bufferSize,
+                  size);
+}
+
+
+
+bool cr::lens::LensKlvEncoder::encode(const cr::lens::LensState& state,
+                                      uint64_t timestampUsec, uint8_t* data,
+                                      int bufferSize, int& size) const
+{
+    return encode(state.get(LensParam::X_FOV_DEG),
+                  state.get(LensParam::Y_FOV_DEG),
+                  state.get(LensParam::ZOOM_POS),
+                  state.get(LensParam::FOCUS_POS),
+                  timestampUsec, data, bufferSize, size);
+}
+
+
+
+bool cr::lens::LensKlvEncoder::check(const uint8_t* data, int size)
+{
+    if (data == nullptr || size < 21)
+        return false;
+
+    // Check key and length.
+    if (memcmp(data, g_uasLocalSetKey, 16) != 0 || data[16] > 127 ||
+        data[16] != size - 17)
+        return false;
+
+    // Check checksum item.
+    if (data[size - 4] != KLV_TAG_CHECKSUM || data[size - 3] != 2)
+        return false;
+    uint16_t checksum = addChecksum(0, data, 0, size - 2);
+
+    return data[size - 2] == (uint8_t)(checksum >> 8) &&
+           data[size - 1] == (uint8_t)checksum;
+}
+
+
+
+bool cr::lens::LensKlvEncoder::encode(float xFovDeg, float yFovDeg,
+                                      float zoomPos, float focusPos,
+                                      uint64_t timestampUsec, uint8_t* data,
+                                      int bufferSize, int& size) const
+{
+    if (data == nullptr || bufferSize < m_size)
+        return false;
+
+    // Copy template and write values.
+    memcpy(data, m_template, m_size);
+    for (int i = 0; i < 8; ++i)
+        data[m_timestampPos + i] = (uint8_t)(timestampUsec >> (56 - 8 * i));
+    writeFov(&data[m_xFovPos], xFovDeg);
+    writeFov(&data[m_yFovPos], yFovDeg);
+    uint16_t checksum = m_checksum;
+    checksum = addChecksum(checksum, data, m_timestampPos, 8);
+    checksum = addChecksum(checksum, data, m_xFovPos, 2);
+    checksum = addChecksum(checksum, data, m_yFovPos, 2);
+    if (m_zoomPos != 0)
+    {
+        writePos(&data[m_zoomPos], zoomPos);
+        checksum = addChecksum(checksum, data, m_zoomPos, 2);
+    }
+    if (m_focusPos != 0)
+    {
+        writePos(&data[m_focusPos], focusPos);
+        checksum = addChecksum(checksum, data, m_focusPos, 2);
+    }
+
+    // Checksum.
+    data[m_size - 2] = (uint8_t)(checksum >> 8);
+    data[m_size - 1] = (uint8_t)checksum;
+    size = m_size;
+
+    return true;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstdint>
+#include "Lens.h"
+#include "LensStateHistory.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/**
+ * @brief Lens metadata KLV encoder. Writes MISB ST 0601 (UAS Datalink Local
+ * Set) packet with precision time stamp, sensor horizontal and vertical
+ * FOV, local set version and checksum. ST 0601 doesn't define zoom and focus
+ * position items, so they are written (0-65535, uint16) only if local tags
+ * are given in constructor. Given tags override standard ST 0601 meaning of
+ * these tags, so they must be agreed with receivers. Packet layout (key, BER
+ * length, tags and lengths) and checksum of constant bytes are prepared in
+ * constructor, so encoding copies template, writes values and adds values
+ * bytes to checksum without memory allocation. Encoder is not changed by
+ * encode(...) methods and can be shared by many video streams.
+ */
+class LensKlvEncoder
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     * @param zoomTag Local tag for zoom position (1-127) or 0 to not write.
+     * @param focusTag Local tag for focus position (1-127) or 0 to not write.
+     * Tags of items written by encoder (1, 2, 16, 17 and 65) and focus tag
+     * equal to zoom tag are rejected: the item is not written. Other tags
+     * override standard ST 0601 meaning.
+     */
+    LensKlvEncoder(int zoomTag = 0, int focusTag = 0);
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensKlvEncoder();
+
+    /**
+     * @brief Get packet size. All packets have the same size.
+     * @return Packet size, bytes.
+     */
+    int getPacketSize() const;
+
+    /**
+     * @brief Encode packet.
+     * @param params Lens params.
+     * @param timestampUsec Precision time stamp: microseconds since
+     * 1970-01-01 00:00:00 UTC (usually video frame capture time).
+     * @param data Pointer to buffer.
+     * @param bufferSize Buffer size. Must be >= getPacketSize().
+     * @param size Output packet size.
+     * @return TRUE if packet encoded or FALSE if buffer too small.
+     */
+    bool encode(const LensParams& params, uint64_t timestampUsec,
+                uint8_t* data, int bufferSize, int& size) const;
+
+    /**
+     * @brief Encode packet from lens state snapshot (for example, taken from
+     * LensStateHistory for frame capture time).
+     * @param state Lens state.
+     * @param timestampUsec Precision time stamp: microseconds since
+     * 1970-01-01 00:00:00 UTC.
+     * @param data Pointer to buffer.
+     * @param bufferSize Buffer size. Must be >= getPacketSize().
+     * @param size Output packet size.
+     * @return TRUE if packet encoded or FALSE if buffer too small.
+     */
+    bool encode(const LensState& state, uint64_t timestampUsec,
+                uint8_t* data, int bufferSize, int& size) const;
+
+    /**
+     * @brief Check MISB ST 0601 packet: key, length and checksum.
+     * @param data Pointer to packet.
+     * @param size Packet size.
+     * @return TRUE if packet is valid or FALSE.
+     */
+    static bool check(const uint8_t* data, int size);
+
+private:
+
+    /// Packet template.
+    uint8_t m_template[64];
+    /// Packet size.
+    int m_size{0};
+    /// Checksum of constant bytes.
+    uint16_t m_checksum{0};
+    /// Offset of time stamp value.
+    int m_timestampPos{0};
+    /// Offset of horizontal FOV value.
+    int m_xFovPos{0};
+    /// Offset of vertical FOV value.
+    int m_yFovPos{0};
+    /// Offset of zoom position value, 0 if not written.
+    int m_zoomPos{0};
+    /// Offset of focus position value, 0 if not written.
+    int m_focusPos{0};
+
+    /**
+     * @brief Encode packet.
+     * @param xFovDeg Horizontal FOV, degree.
+     * @param yFovDeg Vertical FOV, degree.
+     * @param zoomPos Zoom position.
+     * @param focusPos Focus position.
+     * @param timestampUsec Precision time stamp.
+     * @param data Pointer to buffer.
+     * @param bufferSize Buffer size.
+     * @param size Output packet size.
+     * @return TRUE if packet encoded or FALSE if buffer too small.
+     */
+    bool encode(float xFovDeg, float yFovDeg, float zoomPos, float focusPos,
+                uint64_t timestampUsec, uint8_t* data, int bufferSize,
+                int& size) const;
+};
+}
+}
@@ -0,0 +1,172 @@
+#include "LensParamReader.h"
+
+
+
+cr::lens::LensParamReader::LensParamReader(
+        cr::lens::LensParamQuery query, int freshnessMsec)
+{
+    m_query = query;
+
+    // Entry for each param ID.
+    for (int i = 0; i <= (int)LensParam::CUSTOM_3; ++i)
+    {
+        m_entries.emplace_back(new Entry());
+        m_entries.back()->freshness = std::chrono::milliseconds(
+                    freshnessMsec < 0 ? 0 : freshnessMsec);
+    }
+}
+
+
+
+cr::lens::LensParamReader::~LensParamReader()
+{
+
+}
+
+
+
+void cr::lens::LensParamReader::setFreshness(cr::lens::LensParam id,
+                                                    int freshnessMsec)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry* entry = getEntry(id);
+    if (entry != nullptr)
+        entry->freshness = std::chrono::milliseconds(
+                    freshnessMsec < 0 ? 0 : freshnessMsec);
+}
+
+
+
+int cr::lens::LensParamReader::getFreshness(cr::lens::LensParam id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry* entry = getEntry(id);
+    if (entry == nullptr)
+        return -1;
+
+    return (int)entry->freshness.count();
+}
+
+
+
+float cr::lens::LensParamReader::read(cr::lens::LensParam id)
+{
+    ++m_readsCount;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Entry* entry = getEntry(id);
+    if (entry == nullptr || !m_query)
+        return -1.0f;
+
+    while (true)
+    {
+        // Return fresh cached value.
+        if (entry->isValid && std::chrono::steady_clock::now() - entry->time
+            <= entry->freshness)
+            return entry->value;
+
+        if (!entry->inFlight)
+            break;
+
+        // Wait in-flight query. Result of query started before invalidation
+        // is stale for this caller, so wait its end and check again.
+        uint64_t generation = entry->generation;
+        bool isCurrent = entry->inFlightEpoch == entry->epoch;
+        entry->cond.wait(lock, [entry, generation]
+        {
+            return entry->generation != generation;
+        });
+        if (isCurrent)
+            return entry->result;
+    }
+
+    // Make hardware query without lock.
+    entry->inFlight = true;
+    uint64_t epoch = entry->epoch;
+    entry->inFlightEpoch = epoch;
+    lock.unlock();
+    ++m_queriesCount;
+    float value = 0.0f;
+    try
+    {
+        value = m_query(id);
+    }
+    catch (...)
+    {
+        // Release waiting callers with error value, next read makes new query.
+        lock.lock();
+        entry->inFlight = false;
+        entry->result = -1.0f;
+        ++entry->generation;
+        lock.unlock();
+        entry->cond.notify_all();
+        throw;
+    }
+    lock.lock();
+
+    // Cache value if it was not invalidated during query.
+    entry->inFlight = false;
+    entry->result = value;
+    ++entry->generation;
+    if (entry->epoch == epoch)
+    {
+        entry->value = value;
+        entry->time = std::chrono::steady_clock::now();
+        entry->isValid = true;
+    }
+    lock.unlock();
+    entry->cond.notify_all();
+
+    return value;
+}
+
+
+
+void cr::lens::LensParamReader::invalidate(cr::lens::LensParam id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry* entry = getEntry(id);
+    if (entry == nullptr)
+        return;
+
+    entry->isValid = false;
+    ++entry->epoch;
+}
+
+
+
+void cr::lens::LensParamReader::invalidate()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& entry : m_entries)
+    {
+        entry->isValid = false;
+        ++entry->epoch;
+    }
+}
+
+
+
+int64_t cr::lens::LensParamReader::getQueriesCount()
+{
+    return m_queriesCount.load();
+}
+
+
+
+int64_t cr::lens::LensParamReader::getReadsCount()
+{
+    return m_readsCount.load();
+}
+
+
+
+cr::lens::LensParamReader::Entry*
+cr::lens::LensParamReader::getEntry(cr::lens::LensParam id)
+{
+    int index = (int)id;
+    if (index < (int)LensParam::ZOOM_POS || index >= (int)m_entries.size())
+        return nullptr;
+
+    return m_entries[index].get();
+}
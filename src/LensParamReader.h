@@ -0,0 +1,147 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Hardware query function. Reads param value from lens hardware.
+typedef std::function<float(LensParam)> LensParamQuery;
+
+
+
+/**
+ * @brief Single-flight param reader for hardware-backed lens controllers.
+ * Concurrent reads of the same param share one in-flight hardware query and
+ * all callers get its result. Values younger than per-param freshness budget
+ * are returned from cache without hardware query. Class is thread-safe.
+ */
+class LensParamReader
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     * @param query Hardware query function. Called without internal lock,
+     * never called concurrently for the same param.
+     * @param freshnessMsec Default freshness budget for all params, msec.
+     * 0 - cache is used only to share in-flight queries.
+     */
+    LensParamReader(LensParamQuery query, int freshnessMsec = 0);
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensParamReader();
+
+    /**
+     * @brief Set freshness budget for param.
+     * @param id Param ID.
+     * @param freshnessMsec Freshness budget, msec. Cached value younger than
+     * budget is returned without hardware query.
+     */
+    void setFreshness(LensParam id, int freshnessMsec);
+
+    /**
+     * @brief Get freshness budget of param.
+     * @param id Param ID.
+     * @return Freshness budget, msec or -1 if param ID is invalid.
+     */
+    int getFreshness(LensParam id);
+
+    /**
+     * @brief Read param. Returns cached value if it is fresh, waits result
+     * of in-flight query if another thread reads the same param or makes
+     * hardware query.
+     * @param id Param ID. Exception of hardware query is passed to the
+     * caller which made the query, waiting callers get -1.
+     * @return Param value or -1 if param ID is invalid.
+     */
+    float read(LensParam id);
+
+    /**
+     * @brief Invalidate cached value of param (for example, after set param
+     * command). Result of query which is in flight during invalidation is
+     * returned to callers which were already waiting but not cached. Callers
+     * which read the param after invalidation wait end of that query and
+     * make new one.
+     * @param id Param ID.
+     */
+    void invalidate(LensParam id);
+
+    /**
+     * @brief Invalidate all cached values.
+     */
+    void invalidate();
+
+    /**
+     * @brief Get number of hardware queries. For diagnostics.
+     * @return Number of hardware queries.
+     */
+    int64_t getQueriesCount();
+
+    /**
+     * @brief Get number of reads. For diagnostics.
+     * @return Number of read(...) calls.
+     */
+    int64_t getReadsCount();
+
+private:
+
+    /// Cache entry of one param.
+    struct Entry
+    {
+        /// Freshness budget.
+        std::chrono::milliseconds freshness{0};
+        /// Cached value.
+        float value{0.0f};
+        /// Cached value time.
+        std::chrono::steady_clock::time_point time;
+        /// Cached value is valid.
+        bool isValid{false};
+        /// Query in flight.
+        bool inFlight{false};
+        /// Number of completed queries. Waiters check it to detect result.
+        uint64_t generation{0};
+        /// Invalidation counter.
+        uint64_t epoch{0};
+        /// Invalidation counter at start of in-flight query.
+        uint64_t inFlightEpoch{0};
+        /// Result of last completed query.
+        float result{0.0f};
+        /// Condition variable to wait in-flight query.
+        std::condition_variable cond;
+    };
+
+    /// Hardware query function.
+    LensParamQuery m_query;
+    /// Cache entries by param ID.
+    std::vector<std::unique_ptr<Entry>> m_entries;
+    /// Mutex.
+    std::mutex m_mutex;
+    /// Number of hardware queries.
+    std::atomic<int64_t> m_queriesCount{0};
+    /// Number of reads.
+    std::atomic<int64_t> m_readsCount{0};
+
+    /**
+     * @brief Get cache entry.
+     * @param id Param ID.
+     * @return Pointer to entry or nullptr if param ID is invalid.
+     */
+    Entry* getEntry(LensParam id);
+};
+}
+}
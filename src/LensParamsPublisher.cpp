@@ -0,0 +1,202 @@
+#include <cstring>
+#include "LensParamsPublisher.h"
+#include "LensSubscription.h"
+
+
+
+cr::lens::LensParamsPublisher::LensParamsPublisher()
+{
+
+}
+
+
+
+cr::lens::LensParamsPublisher::~LensParamsPublisher()
+{
+
+}
+
+
+
+int cr::lens::LensParamsPublisher::addSubscriber(
+        cr::lens::LensParamsMask& mask,
+        cr::lens::LensParamsSink sink,
+        float maxRateHz,
+        bool compact)
+{
+    if (!sink)
+        return -1;
+
+    // Group key: mask fields and profile flag.
+    std::string key((const char*)&mask, sizeof(LensParamsMask));
+    key.push_back(compact ? 1 : 0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Add group if not exists.
+    Group& group = m_groups[key];
+    if (group.subscribersCount == 0)
+    {
+        group.mask = mask;
+        group.compact = compact;
+    }
+    ++group.subscribersCount;
+
+    // Add subscriber.
+    Subscriber subscriber;
+    subscriber.key = key;
+    subscriber.group = &group;
+    subscriber.sink = std::make_shared<LensParamsSink>(sink);
+    subscriber.maxRateHz = maxRateHz < 0.0f ? 0.0f : maxRateHz;
+    int id = m_nextId++;
+    m_subscribers[id] = subscriber;
+
+    return id;
+}
+
+
+
+int cr::lens::LensParamsPublisher::addSubscriber(uint8_t* data, int size,
+                                                 cr::lens::LensParamsSink sink)
+{
+    // Decode command.
+    LensParamsMask mask;
+    float maxRateHz = 0.0f;
+    bool compact = false;
+    if (!Lens::decodeSubscribeCommand(data, size, mask, maxRateHz, compact))
+        return -1;
+
+    // Check if at least one param is masked.
+    if (!LensSubscription::hasParams(mask))
+        return -1;
+
+    return addSubscriber(mask, sink, maxRateHz, compact);
+}
+
+
+
+bool cr::lens::LensParamsPublisher::removeSubscriber(int id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_subscribers.find(id);
+    if (it == m_subscribers.end())
+        return false;
+
+    // Remove group if it has no subscribers.
+    auto group = m_groups.find(it->second.key);
+    if (group != m_groups.end() && --group->second.subscribersCount <= 0)
+        m_groups.erase(group);
+
+    m_subscribers.erase(it);
+
+    return true;
+}
+
+
+
+int cr::lens::LensParamsPublisher::getSubscribersCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (int)m_subscribers.size();
+}
+
+
+
+int cr::lens::LensParamsPublisher::publish(cr::lens::LensParams& params)
+{
+    // Sinks to call after unlock.
+    std::vector<std::pair<std::shared_ptr<LensParamsSink>, LensParamsBuffer>>
+            calls;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        calls.reserve(m_subscribers.size());
+        ++m_publishCount;
+
+        // Encode params once per group.
+        uint8_t data[512];
+        for (auto& item : m_groups)
+        {
+            Group& group = item.second;
+            int size = 0;
+            bool result = group.compact ?
+                        params.encodeCompact(data, 512, size, &group.mask) :
+                        params.encode(data, 512, size, &group.mask);
+            ++m_encodeCount;
+            if (!result)
+                continue;
+
+            // Replace buffer only if values changed. Params ages change all
+            // the time and are not compared, but new timestamp of the same
+            // value (hardware re-read) is update.
+            int agesSize = LensSubscription::getAgesSize(data);
+            bool isChanged = !group.buffer ||
+                    (int)group.buffer->size() - group.agesSize !=
+                    size - agesSize ||
+                    memcmp(group.buffer->data(), data, size - agesSize) != 0;
+            for (int i = 0; i < 50 && agesSize > 0 && !isChanged; ++i)
+                if ((data[3 + i / 8] & (uint8_t)(128 >> (i % 8))) != 0 &&
+                    group.timestamps[i] != params.timestamps[i])
+                    isChanged = true;
+            if (agesSize > 0)
+            {
+                memcpy(group.timestamps, params.timestamps,
+                       sizeof(group.timestamps));
+                group.data.assign(data, data + size);
+            }
+            if (!isChanged)
+                continue;
+            group.agesSize = agesSize;
+            group.buffer = std::make_shared<const std::vector<uint8_t>>(
+                        data, data + size);
+            group.bufferPublish = m_publishCount;
+            ++group.version;
+        }
+
+        // Collect subscribers which have to get new buffer.
+        std::chrono::steady_clock::time_point now =
+                std::chrono::steady_clock::now();
+        for (auto& item : m_subscribers)
+        {
+            Subscriber& subscriber = item.second;
+            Group* group = subscriber.group;
+            if (group->version == subscriber.lastVersion)
+                continue;
+
+            // Check min update interval.
+            if (subscriber.maxRateHz > 0.0f && subscriber.lastVersion != 0 &&
+                std::chrono::duration<float>(
+                    now - subscriber.lastTime).count() <
+                1.0f / subscriber.maxRateHz)
+                continue;
+
+            // Buffer encoded by previous publish call has old ages: replace
+            // it by data of this call (values are the same).
+            if (group->agesSize > 0 && group->bufferPublish != m_publishCount)
+            {
+                group->buffer = std::make_shared<const std::vector<uint8_t>>(
+                            group->data);
+                group->bufferPublish = m_publishCount;
+            }
+
+            subscriber.lastVersion = group->version;
+            subscriber.lastTime = now;
+            calls.emplace_back(subscriber.sink, group->buffer);
+        }
+    }
+
+    // Call sinks.
+    for (auto& call : calls)
+        (*call.first)(call.second);
+
+    return (int)calls.size();
+}
+
+
+
+int64_t cr::lens::LensParamsPublisher::getEncodeCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_encodeCount;
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Encoded lens params buffer shared by all subscribers with the same mask.
+typedef std::shared_ptr<const std::vector<uint8_t>> LensParamsBuffer;
+
+
+
+/// Subscriber sink. Called by publisher with encoded params buffer.
+typedef std::function<void(const LensParamsBuffer&)> LensParamsSink;
+
+
+
+/**
+ * @brief Lens params publisher. Encodes each params change once per distinct
+ * mask (and profile) into shared immutable buffer and hands the same buffer
+ * to every subscriber sink, so encode cost doesn't depend on number of
+ * subscribers. Each subscriber gets update only when masked values or their
+ * timestamps changed and its own max update rate allows. Params ages are
+ * current at send time, so buffer sent later to rate limited or new
+ * subscriber doesn't understate staleness. Class is thread-safe.
+ */
+class LensParamsPublisher
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    LensParamsPublisher();
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensParamsPublisher();
+
+    /**
+     * @brief Add subscriber.
+     * @param mask Params mask.
+     * @param sink Subscriber sink.
+     * @param maxRateHz Max update rate, Hz. 0 - no limit.
+     * @param compact Use compact profile (LensParams::encodeCompact(...)).
+     * @return Subscriber ID or -1 if sink not set.
+     */
+    int addSubscriber(LensParamsMask& mask, LensParamsSink sink,
+                      float maxRateHz = 0.0f, bool compact = false);
+
+    /**
+     * @brief Add subscriber by command encoded by
+     * Lens::encodeSubscribeCommand(...).
+     * @param data Pointer to command data.
+     * @param size Size of data.
+     * @param sink Subscriber sink.
+     * @return Subscriber ID or -1 if command not decoded or mask is empty.
+     */
+    int addSubscriber(uint8_t* data, int size, LensParamsSink sink);
+
+    /**
+     * @brief Remove subscriber.
+     * @param id Subscriber ID.
+     * @return TRUE if subscriber removed or FALSE if not exists.
+     */
+    bool removeSubscriber(int id);
+
+    /**
+     * @brief Get number of subscribers.
+     * @return Number of subscribers.
+     */
+    int getSubscribersCount();
+
+    /**
+     * @brief Publish params. Sinks are called from the calling thread after
+     * all buffers encoded.
+     * @param params Current lens params.
+     * @return Number of sinks called.
+     */
+    int publish(LensParams& params);
+
+    /**
+     * @brief Get total number of encode operations. For diagnostics.
+     * @return Number of encode operations since publisher created.
+     */
+    int64_t getEncodeCount();
+
+private:
+
+    /// Group of subscribers with the same mask and profile.
+    struct Group
+    {
+        /// Params mask.
+        LensParamsMask mask;
+        /// Compact profile flag.
+        bool compact{false};
+        /// Last encoded buffer.
+        LensParamsBuffer buffer;
+        /// Size of params ages at the end of buffer.
+        int agesSize{0};
+        /// Data encoded by last publish call. Used to refresh ages of buffer.
+        std::vector<uint8_t> data;
+        /// Params timestamps of last publish call.
+        uint32_t timestamps[50]{};
+        /// Number of publish call which encoded buffer.
+        uint64_t bufferPublish{0};
+        /// Buffer version. Incremented when buffer replaced.
+        uint64_t version{0};
+        /// Number of subscribers.
+        int subscribersCount{0};
+    };
+
+    /// Subscriber.
+    struct Subscriber
+    {
+        /// Group key.
+        std::string key;
+        /// Pointer to group. Map nodes are not moved, so pointer is valid
+        /// while subscriber exists.
+        Group* group{nullptr};
+        /// Sink. Shared to call it outside of lock without copying.
+        std::shared_ptr<LensParamsSink> sink;
+        /// Max update rate, Hz.
+        float maxRateHz{0.0f};
+        /// Last sent buffer version.
+        uint64_t lastVersion{0};
+        /// Last update time.
+        std::chrono::steady_clock::time_point lastTime;
+    };
+
+    /// Groups by key (mask bytes and profile flag).
+    std::map<std::string, Group> m_groups;
+    /// Subscribers by ID.
+    std::map<int, Subscriber> m_subscribers;
+    /// Next subscriber ID.
+    int m_nextId{0};
+    /// Number of encode operations.
+    int64_t m_encodeCount{0};
+    /// Number of publish calls.
+    uint64_t m_publishCount{0};
+    /// Mutex.
+    std::mutex m_mutex;
+};
+}
+}
@@ -0,0 +1,258 @@
+#include <cstring>
+#include <new>
+#include <thread>
+#include "LensParamsShm.h"
+#include "LensVersion.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+
+
+/// Magic number "LNSP".
+#define LENS_PARAMS_SHM_MAGIC 0x50534E4C
+
+
+
+cr::lens::LensParamsShm::LensParamsShm()
+{
+
+}
+
+
+
+cr::lens::LensParamsShm::~LensParamsShm()
+{
+    close();
+}
+
+
+
+bool cr::lens::LensParamsShm::create(std::string name)
+{
+    close();
+
+    // Create and map segment.
+    void* ptr = nullptr;
+#if defined(_WIN32)
+    m_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                  0, sizeof(LensParamsShmHeader),
+                                  name.c_str());
+    if (m_handle == nullptr)
+        return false;
+    ptr = MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0,
+                        sizeof(LensParamsShmHeader));
+    if (ptr == nullptr)
+    {
+        CloseHandle(m_handle);
+        m_handle = nullptr;
+        return false;
+    }
+#else
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, sizeof(LensParamsShmHeader)) != 0)
+    {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    ptr = mmap(nullptr, sizeof(LensParamsShmHeader), PROT_READ | PROT_WRITE,
+               MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return false;
+    }
+#endif
+
+    // Init header. Magic is written last, so readers don't accept partly
+    // initialized segment.
+    m_header = (LensParamsShmHeader*)ptr;
+    m_header->magic = 0;
+    m_header->layoutVersion = LENS_PARAMS_SHM_LAYOUT_VERSION;
+    m_header->majorVersion = LENS_MAJOR_VERSION;
+    m_header->minorVersion = LENS_MINOR_VERSION;
+    new (&m_header->sequence) std::atomic<uint32_t>(0);
+    m_header->dataSize = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = LENS_PARAMS_SHM_MAGIC;
+
+    m_name = name;
+    m_isWriter = true;
+
+    return true;
+}
+
+
+
+bool cr::lens::LensParamsShm::open(std::string name)
+{
+    close();
+
+    // Map segment.
+    void* ptr = nullptr;
+#if defined(_WIN32)
+    m_handle = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (m_handle == nullptr)
+        return false;
+    ptr = MapViewOfFile(m_handle, FILE_MAP_READ, 0, 0,
+                        sizeof(LensParamsShmHeader));
+    if (ptr == nullptr)
+    {
+        CloseHandle(m_handle);
+        m_handle = nullptr;
+        return false;
+    }
+#else
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    ptr = mmap(nullptr, sizeof(LensParamsShmHeader), PROT_READ, MAP_SHARED,
+               fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED)
+        return false;
+#endif
+
+    m_header = (LensParamsShmHeader*)ptr;
+    m_name = name;
+    m_isWriter = false;
+
+    // Check header.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_header->magic != LENS_PARAMS_SHM_MAGIC ||
+        m_header->layoutVersion != LENS_PARAMS_SHM_LAYOUT_VERSION ||
+        m_header->majorVersion != LENS_MAJOR_VERSION ||
+        m_header->minorVersion != LENS_MINOR_VERSION)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+
+
+void cr::lens::LensParamsShm::close()
+{
+    if (m_header == nullptr)
+        return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(m_header);
+    CloseHandle(m_handle);
+    m_handle = nullptr;
+#else
+    munmap(m_header, sizeof(LensParamsShmHeader));
+    if (m_isWriter)
+        shm_unlink(m_name.c_str());
+#endif
+    m_header = nullptr;
+    m_name = "";
+    m_isWriter = false;
+}
+
+
+
+bool cr::lens::LensParamsShm::isOpen()
+{
+    return m_header != nullptr;
+}
+
+
+
+bool cr::lens::LensParamsShm::write(cr::lens::LensParams& params)
+{
+    if (m_header == nullptr || !m_isWriter)
+        return false;
+
+    // Encode params outside of critical section. Timestamps are written
+    // separately.
+    uint8_t data[320];
+    int size = 0;
+    if (!params.encode(data, (int)sizeof(data), size))
+        return false;
+
+    // Odd sequence while data is changing.
+    uint32_t sequence = m_header->sequence.load(std::memory_order_relaxed);
+    m_header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(m_header->data, data, size);
+    m_header->dataSize = (uint32_t)size;
+    memcpy(m_header->timestamps, params.timestamps, sizeof(params.timestamps));
+    m_header->sequence.store(sequence + 2, std::memory_order_release);
+
+    return true;
+}
+
+
+
+bool cr::lens::LensParamsShm::read(cr::lens::LensParams& params,
+                                   int maxRetries)
+{
+    if (m_header == nullptr)
+        return false;
+
+    uint8_t data[320];
+    uint32_t timestamps[50];
+    uint32_t size = 0;
+    for (int i = 0; i <= maxRetries; ++i)
+    {
+        // Let writer finish if it was preempted during update.
+        if (i > 0 && (i & 63) == 0)
+            std::this_thread::yield();
+
+        // Wait while writer changes data.
+        uint32_t sequence = m_header->sequence.load(std::memory_order_acquire);
+        if (sequence == 0)
+            return false;
+        if ((sequence & 1) != 0)
+            continue;
+
+        // Copy data and check that it was not changed.
+        size = m_header->dataSize;
+        if (size > sizeof(data))
+            continue;
+        memcpy(data, m_header->data, size);
+        memcpy(timestamps, m_header->timestamps, sizeof(timestamps));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_header->sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+
+        // Decode clears fields which are not published, keep them.
+        std::string initString = std::move(params.initString);
+        CalibrationTable<FovPoint> fovPoints = std::move(params.fovPoints);
+        CalibrationTable<TrackingCurve> trackingCurves =
+                std::move(params.trackingCurves);
+        CalibrationTable<DistortionPoint> distortionPoints =
+                std::move(params.distortionPoints);
+        bool result = params.decode(data, (int)size);
+        params.initString = std::move(initString);
+        params.fovPoints = std::move(fovPoints);
+        params.trackingCurves = std::move(trackingCurves);
+        params.distortionPoints = std::move(distortionPoints);
+        memcpy(params.timestamps, timestamps, sizeof(timestamps));
+
+        return result;
+    }
+
+    return false;
+}
+
+
+
+uint32_t cr::lens::LensParamsShm::getSequence()
+{
+    if (m_header == nullptr)
+        return 0;
+
+    return m_header->sequence.load(std::memory_order_acquire) & ~(uint32_t)1;
+}
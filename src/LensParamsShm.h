@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Shared memory segment layout version.
+#define LENS_PARAMS_SHM_LAYOUT_VERSION 3
+
+
+
+/// Shared memory segment header. Located at the beginning of segment.
+struct LensParamsShmHeader
+{
+    /// Magic number "LNSP".
+    uint32_t magic;
+    /// Segment layout version.
+    uint16_t layoutVersion;
+    /// Lens class major version.
+    uint8_t majorVersion;
+    /// Lens class minor version.
+    uint8_t minorVersion;
+    /// Sequence counter (seqlock). Odd while writer updates data.
+    std::atomic<uint32_t> sequence;
+    /// Size of params data.
+    uint32_t dataSize;
+    /// Params data encoded by LensParams::encode(...) method (all fields
+    /// without params ages).
+    uint8_t data[320];
+    /// Params timestamps (LensParams::timestamps). Monotonic clock of
+    /// LensParams::getTimeMsec() is common for all processes of one host, so
+    /// timestamps are stored as is and ages are not frozen at write time.
+    uint32_t timestamps[50];
+};
+
+
+
+/**
+ * @brief Lens params shared memory. Lens host process publishes numeric lens
+ * params (all fields except initString and fovPoints) to named shared memory
+ * segment and any number of local processes read them without system calls.
+ * Segment is protected by seqlock: single writer never waits readers and
+ * readers retry if data was changed during read. Segment header has magic
+ * number and layout version to reject incompatible segments.
+ */
+class LensParamsShm
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    LensParamsShm();
+
+    /**
+     * @brief Class destructor. Closes segment.
+     */
+    ~LensParamsShm();
+
+    /**
+     * @brief Create segment (writer side). Segment created by writer is
+     * removed when writer closes it.
+     * @param name Segment name, for example "/lens0".
+     * @return TRUE if segment created or FALSE if not.
+     */
+    bool create(std::string name);
+
+    /**
+     * @brief Open existing segment (reader side).
+     * @param name Segment name.
+     * @return TRUE if segment open or FALSE if not exists or incompatible.
+     */
+    bool open(std::string name);
+
+    /**
+     * @brief Close segment.
+     */
+    void close();
+
+    /**
+     * @brief Get segment open status.
+     * @return TRUE if segment open or FALSE.
+     */
+    bool isOpen();
+
+    /**
+     * @brief Write params to segment. Only one writer allowed.
+     * @param params Lens params.
+     * @return TRUE if params written or FALSE if segment not created.
+     */
+    bool write(LensParams& params);
+
+    /**
+     * @brief Read params from segment.
+     * @param params Output params. Only numeric fields are changed,
+     * initString and calibration tables (fovPoints, trackingCurves,
+     * distortionPoints) are kept.
+     * @param maxRetries Max number of retries if writer changes data during
+     * read.
+     * @return TRUE if params read or FALSE if segment not open, no data
+     * written yet or retries exceeded.
+     */
+    bool read(LensParams& params, int maxRetries = 1000);
+
+    /**
+     * @brief Get update sequence number. Changes after each write, so reader
+     * can check for new params without reading them.
+     * @return Sequence number. 0 if no data written yet.
+     */
+    uint32_t getSequence();
+
+private:
+
+    /// Pointer to segment header.
+    LensParamsShmHeader* m_header{nullptr};
+    /// Segment name.
+    std::string m_name{""};
+    /// Writer flag.
+    bool m_isWriter{false};
+#if defined(_WIN32)
+    /// File mapping handle.
+    void* m_handle{nullptr};
+#endif
+};
+}
+}
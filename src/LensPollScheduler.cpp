@@ -0,0 +1,322 @@
+#include "LensPollScheduler.h"
+
+
+
+cr::lens::LensPollScheduler::LensPollScheduler(
+        std::function<uint32_t()> clock)
+{
+    m_clock = clock ? clock : LensParams::getTimeMsec;
+
+    // Default periods: positions and FOV often, status params rarely, limits,
+    // settings and temperature very rarely.
+    for (int i = (int)LensParam::ZOOM_POS; i <= (int)LensParam::CUSTOM_3; ++i)
+        m_entries[i].periodMsec = 5000;
+    const LensParam fastParams[] = {
+        LensParam::ZOOM_POS, LensParam::ZOOM_HW_POS, LensParam::FOCUS_POS,
+        LensParam::FOCUS_HW_POS, LensParam::IRIS_POS, LensParam::IRIS_HW_POS,
+        LensParam::X_FOV_DEG, LensParam::Y_FOV_DEG, LensParam::FOCUS_FACTOR};
+    for (LensParam id : fastParams)
+        m_entries[(int)id].periodMsec = 100;
+    m_entries[(int)LensParam::IS_CONNECTED].periodMsec = 1000;
+    m_entries[(int)LensParam::AF_IS_ACTIVE].periodMsec = 1000;
+    m_entries[(int)LensParam::TEMPERATURE].periodMsec = 10000;
+
+    // Axes of params.
+    m_entries[(int)LensParam::ZOOM_POS].axis = LensAxis::ZOOM;
+    m_entries[(int)LensParam::ZOOM_HW_POS].axis = LensAxis::ZOOM;
+    m_entries[(int)LensParam::X_FOV_DEG].axis = LensAxis::ZOOM;
+    m_entries[(int)LensParam::Y_FOV_DEG].axis = LensAxis::ZOOM;
+    m_entries[(int)LensParam::FOCUS_POS].axis = LensAxis::FOCUS;
+    m_entries[(int)LensParam::FOCUS_HW_POS].axis = LensAxis::FOCUS;
+    m_entries[(int)LensParam::FOCUS_FACTOR].axis = LensAxis::FOCUS;
+    m_entries[(int)LensParam::IRIS_POS].axis = LensAxis::IRIS;
+    m_entries[(int)LensParam::IRIS_HW_POS].axis = LensAxis::IRIS;
+    m_entries[(int)LensParam::ZOOM_HW_POS].isPosition = true;
+    m_entries[(int)LensParam::FOCUS_HW_POS].isPosition = true;
+    m_entries[(int)LensParam::IRIS_HW_POS].isPosition = true;
+    m_entries[(int)LensParam::ZOOM_POS].isPosition = true;
+    m_entries[(int)LensParam::FOCUS_POS].isPosition = true;
+    m_entries[(int)LensParam::IRIS_POS].isPosition = true;
+
+    m_metricsTime = m_clock();
+}
+
+
+
+cr::lens::LensPollScheduler::~LensPollScheduler()
+{
+
+}
+
+
+
+void cr::lens::LensPollScheduler::setPeriod(cr::lens::LensParam id,
+                                            int periodMsec)
+{
+    if (!isValid(id))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[(int)id].periodMsec = periodMsec < 0 ? 0 : periodMsec;
+    m_entries[(int)id].factor = 1;
+}
+
+
+
+int cr::lens::LensPollScheduler::getPeriod(cr::lens::LensParam id)
+{
+    if (!isValid(id))
+        return -1;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return getEffectivePeriod(m_entries[(int)id], m_clock());
+}
+
+
+
+void cr::lens::LensPollScheduler::setBoost(int periodMsec, int settleMsec)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_boostPeriodMsec = periodMsec < 1 ? 1 : periodMsec;
+    m_settleMsec = settleMsec < 0 ? 0 : settleMsec;
+}
+
+
+
+void cr::lens::LensPollScheduler::setBackoff(int maxFactor, int unchangedCount)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxFactor = maxFactor < 1 ? 1 : maxFactor;
+    m_backoffCount = unchangedCount < 1 ? 1 : unchangedCount;
+}
+
+
+
+void cr::lens::LensPollScheduler::onCommand(cr::lens::LensCommand id)
+{
+    LensQueuedCommand command;
+    command.type = 0;
+    command.commandId = id;
+    LensAxis axis = LensCommandQueue::getAxis(command);
+    if (axis == LensAxis::NONE)
+        return;
+
+    // Autofocus moves focus axis.
+    if (axis == LensAxis::AF)
+        axis = LensAxis::FOCUS;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    setMoving(axis, !LensCommandQueue::isStopCommand(id), m_clock());
+}
+
+
+
+void cr::lens::LensPollScheduler::onSetParam(cr::lens::LensParam id)
+{
+    LensQueuedCommand command;
+    command.type = 1;
+    command.paramId = id;
+    LensAxis axis = LensCommandQueue::getAxis(command);
+    if (axis == LensAxis::NONE)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    setMoving(axis, true, m_clock());
+}
+
+
+
+bool cr::lens::LensPollScheduler::next(cr::lens::LensParam& id, int& waitMsec)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t now = m_clock();
+
+    // Find the most overdue param.
+    int bestIndex = -1;
+    int bestLateness = INT32_MIN;
+    for (int i = (int)LensParam::ZOOM_POS; i <= (int)LensParam::CUSTOM_3; ++i)
+    {
+        Entry& entry = m_entries[i];
+        int period = getEffectivePeriod(entry, now);
+        if (period == 0)
+            continue;
+
+        // Never polled params are due now.
+        int lateness = entry.isPolled ?
+                    (int)(now - entry.pollTime) - period : INT32_MAX / 2;
+        if (lateness > bestLateness)
+        {
+            bestLateness = lateness;
+            bestIndex = i;
+        }
+    }
+
+    if (bestIndex < 0)
+    {
+        waitMsec = 1000;
+        return false;
+    }
+    if (bestLateness < 0)
+    {
+        waitMsec = -bestLateness;
+        return false;
+    }
+
+    // Poll starts now.
+    m_entries[bestIndex].pollTime = now;
+    m_entries[bestIndex].isPolled = true;
+    id = (LensParam)bestIndex;
+    waitMsec = 0;
+
+    return true;
+}
+
+
+
+void cr::lens::LensPollScheduler::onResult(cr::lens::LensParam id,
+                                           float value, int busyUsec)
+{
+    if (!isValid(id))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t now = m_clock();
+    Entry& entry = m_entries[(int)id];
+
+    // Metrics.
+    ++m_pollsCount;
+    m_busyUsec += busyUsec > 0 ? busyUsec : 0;
+
+    // Backoff for unchanged values.
+    bool isChanged = !entry.hasValue || entry.value != value;
+    entry.value = value;
+    entry.hasValue = true;
+    if (isChanged)
+    {
+        entry.factor = 1;
+        entry.unchangedCount = 0;
+    }
+    else if (++entry.unchangedCount >= m_backoffCount)
+    {
+        entry.unchangedCount = 0;
+        entry.factor = entry.factor * 2 > m_maxFactor ?
+                    m_maxFactor : entry.factor * 2;
+    }
+
+    if (!entry.isPosition)
+        return;
+
+    // Position samples of moving axis.
+    Axis& axis = m_axes[(int)entry.axis];
+    if (!axis.isMoving)
+    {
+        entry.hasSample = false;
+        return;
+    }
+    if (entry.hasSample)
+    {
+        uint32_t interval = now - entry.sampleTime;
+        ++m_samplesCount;
+        m_samplesSumMsec += interval;
+        if (interval > m_maxSampleMsec)
+            m_maxSampleMsec = interval;
+    }
+    entry.sampleTime = now;
+    entry.hasSample = true;
+
+    // Axis stopped by itself (reached position or limit).
+    if (isChanged)
+        axis.unchangedCount = 0;
+    else if (++axis.unchangedCount >= 2 * m_backoffCount)
+        setMoving(entry.axis, false, now);
+}
+
+
+
+cr::lens::LensPollMetrics cr::lens::LensPollScheduler::getMetrics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    LensPollMetrics metrics;
+    metrics.pollsCount = m_pollsCount;
+    uint32_t elapsedMsec = m_clock() - m_metricsTime;
+    if (elapsedMsec > 0)
+        metrics.busUtilization = (float)m_busyUsec / 1000.0f /
+                (float)elapsedMsec;
+    if (m_samplesCount > 0)
+        metrics.positionSampleIntervalMsec = (float)m_samplesSumMsec /
+                (float)m_samplesCount;
+    metrics.maxPositionSampleIntervalMsec = (float)m_maxSampleMsec;
+
+    return metrics;
+}
+
+
+
+void cr::lens::LensPollScheduler::resetMetrics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_metricsTime = m_clock();
+    m_pollsCount = 0;
+    m_busyUsec = 0;
+    m_samplesCount = 0;
+    m_samplesSumMsec = 0;
+    m_maxSampleMsec = 0;
+}
+
+
+
+bool cr::lens::LensPollScheduler::isValid(cr::lens::LensParam id)
+{
+    return (int)id >= (int)LensParam::ZOOM_POS &&
+           (int)id <= (int)LensParam::CUSTOM_3;
+}
+
+
+
+bool cr::lens::LensPollScheduler::isBoosted(cr::lens::LensAxis axis,
+                                            uint32_t now)
+{
+    if (axis == LensAxis::NONE)
+        return false;
+
+    Axis& state = m_axes[(int)axis];
+
+    return state.isMoving || (int32_t)(state.boostEndTime - now) > 0;
+}
+
+
+
+int cr::lens::LensPollScheduler::getEffectivePeriod(Entry& entry,
+                                                    uint32_t now)
+{
+    if (entry.periodMsec == 0)
+        return 0;
+
+    if (isBoosted(entry.axis, now))
+        return entry.periodMsec < m_boostPeriodMsec ?
+                    entry.periodMsec : m_boostPeriodMsec;
+
+    return entry.periodMsec * entry.factor;
+}
+
+
+
+void cr::lens::LensPollScheduler::setMoving(cr::lens::LensAxis axis,
+                                            bool isMoving, uint32_t now)
+{
+    Axis& state = m_axes[(int)axis];
+    if (state.isMoving && !isMoving)
+        state.boostEndTime = now + m_settleMsec;
+    state.isMoving = isMoving;
+    state.unchangedCount = 0;
+
+    // Axis params have to react immediately.
+    for (int i = (int)LensParam::ZOOM_POS; i <= (int)LensParam::CUSTOM_3; ++i)
+    {
+        if (m_entries[i].axis != axis)
+            continue;
+        m_entries[i].factor = 1;
+        m_entries[i].unchangedCount = 0;
+        m_entries[i].hasSample = false;
+    }
+}
@@ -0,0 +1,231 @@
+#pragma once
+#include <mutex>
+#include <cstdint>
+#include <functional>
+#include "Lens.h"
+#include "LensCommandQueue.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Poll scheduler metrics.
+class LensPollMetrics
+{
+public:
+    /// Number of polls.
+    int64_t pollsCount{0};
+    /// Bus utilization: time spent for polls divided by elapsed time, 0 - 1.
+    float busUtilization{0.0f};
+    /// Average interval between position samples of moving axes, msec.
+    float positionSampleIntervalMsec{0.0f};
+    /// Max interval between position samples of moving axes, msec.
+    float maxPositionSampleIntervalMsec{0.0f};
+};
+
+
+
+/**
+ * @brief Adaptive polling scheduler for lens controllers which read params
+ * from lens hardware by queries (serial port etc.). Each param has own poll
+ * period. Position params of moving axes (after ZOOM_TELE, FOCUS_FAR etc.
+ * commands) are polled with boost period. Params which don't change are
+ * polled less often (period is doubled after several unchanged values up to
+ * max backoff factor). Communication thread asks scheduler which param to
+ * poll next and reports poll results. Class is thread-safe.
+ */
+class LensPollScheduler
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     * @param clock Monotonic time source, msec. Default is
+     * LensParams::getTimeMsec().
+     */
+    LensPollScheduler(std::function<uint32_t()> clock = nullptr);
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensPollScheduler();
+
+    /**
+     * @brief Set base poll period of param.
+     * @param id Param ID.
+     * @param periodMsec Poll period, msec. 0 - param is not polled.
+     */
+    void setPeriod(LensParam id, int periodMsec);
+
+    /**
+     * @brief Get current (effective) poll period of param taking into account
+     * boost and backoff.
+     * @param id Param ID.
+     * @return Poll period, msec. 0 if param is not polled, -1 if param ID is
+     * invalid.
+     */
+    int getPeriod(LensParam id);
+
+    /**
+     * @brief Set boost poll period for position params of moving axes.
+     * @param periodMsec Boost poll period, msec.
+     * @param settleMsec Time to keep boost after axis stopped, msec.
+     */
+    void setBoost(int periodMsec, int settleMsec = 500);
+
+    /**
+     * @brief Set idle backoff.
+     * @param maxFactor Max poll period multiplier for unchanged params.
+     * @param unchangedCount Number of unchanged values to double period.
+     */
+    void setBackoff(int maxFactor, int unchangedCount = 3);
+
+    /**
+     * @brief Notify scheduler about executed command. Move commands boost
+     * axis, stop commands end boost after settle time.
+     * @param id Command ID.
+     */
+    void onCommand(LensCommand id);
+
+    /**
+     * @brief Notify scheduler about executed set param command. Setting
+     * position params (ZOOM_POS etc.) boosts axis.
+     * @param id Param ID.
+     */
+    void onSetParam(LensParam id);
+
+    /**
+     * @brief Get next param to poll.
+     * @param id Output param ID.
+     * @param waitMsec Output time until next param is due, msec (if method
+     * returns FALSE).
+     * @return TRUE if param has to be polled now or FALSE.
+     */
+    bool next(LensParam& id, int& waitMsec);
+
+    /**
+     * @brief Report poll result.
+     * @param id Param ID.
+     * @param value Param value read from hardware.
+     * @param busyUsec Time the poll has taken on the bus, microseconds.
+     */
+    void onResult(LensParam id, float value, int busyUsec);
+
+    /**
+     * @brief Get metrics since last reset.
+     * @return Metrics.
+     */
+    LensPollMetrics getMetrics();
+
+    /**
+     * @brief Reset metrics.
+     */
+    void resetMetrics();
+
+private:
+
+    /// Param poll state.
+    struct Entry
+    {
+        /// Base poll period, msec.
+        int periodMsec{0};
+        /// Backoff factor.
+        int factor{1};
+        /// Number of consecutive unchanged values.
+        int unchangedCount{0};
+        /// Last poll time, msec.
+        uint32_t pollTime{0};
+        /// Param was polled at least once.
+        bool isPolled{false};
+        /// Last value.
+        float value{0.0f};
+        /// Last value is valid.
+        bool hasValue{false};
+        /// Axis which moves the param.
+        LensAxis axis{LensAxis::NONE};
+        /// Param is axis position.
+        bool isPosition{false};
+        /// Last sample time during motion, msec.
+        uint32_t sampleTime{0};
+        /// Last sample time is valid.
+        bool hasSample{false};
+    };
+
+    /// Axis state.
+    struct Axis
+    {
+        /// Axis is moving.
+        bool isMoving{false};
+        /// Boost end time after stop, msec.
+        uint32_t boostEndTime{0};
+        /// Number of unchanged position samples during motion.
+        int unchangedCount{0};
+    };
+
+    /// Time source.
+    std::function<uint32_t()> m_clock;
+    /// Params by ID.
+    Entry m_entries[51];
+    /// Axes by LensAxis value.
+    Axis m_axes[5];
+    /// Boost poll period, msec.
+    int m_boostPeriodMsec{10};
+    /// Boost settle time, msec.
+    int m_settleMsec{500};
+    /// Max backoff factor.
+    int m_maxFactor{8};
+    /// Number of unchanged values to double period.
+    int m_backoffCount{3};
+    /// Metrics start time, msec.
+    uint32_t m_metricsTime{0};
+    /// Number of polls.
+    int64_t m_pollsCount{0};
+    /// Total bus time, microseconds.
+    int64_t m_busyUsec{0};
+    /// Number of position sample intervals.
+    int64_t m_samplesCount{0};
+    /// Sum of position sample intervals, msec.
+    int64_t m_samplesSumMsec{0};
+    /// Max position sample interval, msec.
+    uint32_t m_maxSampleMsec{0};
+    /// Mutex.
+    std::mutex m_mutex;
+
+    /**
+     * @brief Check if param ID is valid.
+     * @param id Param ID.
+     * @return TRUE if valid or FALSE.
+     */
+    static bool isValid(LensParam id);
+
+    /**
+     * @brief Check if axis is boosted.
+     * @param axis Axis.
+     * @param now Current time, msec.
+     * @return TRUE if boosted or FALSE.
+     */
+    bool isBoosted(LensAxis axis, uint32_t now);
+
+    /**
+     * @brief Get effective poll period.
+     * @param entry Param entry.
+     * @param now Current time, msec.
+     * @return Poll period, msec.
+     */
+    int getEffectivePeriod(Entry& entry, uint32_t now);
+
+    /**
+     * @brief Start or stop axis motion.
+     * @param axis Axis.
+     * @param isMoving Motion flag.
+     * @param now Current time, msec.
+     */
+    void setMoving(LensAxis axis, bool isMoving, uint32_t now);
+};
+}
+}
@@ -0,0 +1,223 @@
+#include <cmath>
+#include "LensPositionMapper.h"
+#include "LensFovTable.h"
+
+
+
+/// Pi.
+#define LENS_POSITION_MAPPER_PI 3.14159265358979323846
+/// Number of hardware range buckets per table segment.
+#define LENS_POSITION_MAPPER_BUCKETS 4
+
+
+
+cr::lens::LensPositionMapper::LensPositionMapper()
+{
+    setLinear(0, 65535);
+}
+
+
+
+cr::lens::LensPositionMapper::LensPositionMapper(int hwMin, int hwMax)
+{
+    setLinear(hwMin, hwMax);
+}
+
+
+
+cr::lens::LensPositionMapper::~LensPositionMapper()
+{
+
+}
+
+
+
+void cr::lens::LensPositionMapper::setLinear(int hwMin, int hwMax)
+{
+    init({hwMin, hwMax});
+}
+
+
+
+bool cr::lens::LensPositionMapper::setTable(const std::vector<int>& hwPositions)
+{
+    if (hwPositions.size() < 2 ||
+        hwPositions.size() > LENS_POSITION_MAPPER_MAX_SEGMENTS + 1)
+        return false;
+
+    // Check monotonicity.
+    const bool isDescending = hwPositions.back() < hwPositions.front();
+    for (size_t i = 1; i < hwPositions.size(); ++i)
+    {
+        if (isDescending ? hwPositions[i] > hwPositions[i - 1] :
+                           hwPositions[i] < hwPositions[i - 1])
+            return false;
+    }
+
+    init(std::vector<int64_t>(hwPositions.begin(), hwPositions.end()));
+
+    return true;
+}
+
+
+
+bool cr::lens::LensPositionMapper::setMagnificationTable(
+        const cr::lens::LensParams& params, int segmentsCount)
+{
+    if (params.fovPoints.empty() || segmentsCount < 1 ||
+        segmentsCount > LENS_POSITION_MAPPER_MAX_SEGMENTS)
+        return false;
+
+    // FOV at hardware limits.
+    LensFovTable fovTable(params.fovPoints);
+    const int hwMin = params.zoomHwWideLimit;
+    const int hwMax = params.zoomHwTeleLimit;
+    float wideXFov = 0.0f;
+    float teleXFov = 0.0f;
+    float yFov = 0.0f;
+    fovTable.getFov((float)hwMin, wideXFov, yFov);
+    fovTable.getFov((float)hwMax, teleXFov, yFov);
+    if (wideXFov <= 0.0f || teleXFov <= 0.0f || wideXFov >= 180.0f ||
+        teleXFov >= 180.0f || wideXFov == teleXFov)
+        return false;
+    const double wideLogTan =
+            std::log(std::tan(wideXFov * LENS_POSITION_MAPPER_PI / 360.0));
+    const double teleLogTan =
+            std::log(std::tan(teleXFov * LENS_POSITION_MAPPER_PI / 360.0));
+
+    // Hardware positions for equal steps of log of tan(FOV / 2). Positions
+    // are limited by hardware limits and made monotone.
+    std::vector<int64_t> hwPositions(segmentsCount + 1);
+    hwPositions.front() = hwMin;
+    hwPositions.back() = hwMax;
+    const int low = hwMin < hwMax ? hwMin : hwMax;
+    const int high = hwMin < hwMax ? hwMax : hwMin;
+    for (int i = 1; i < segmentsCount; ++i)
+    {
+        double logTan = wideLogTan + (teleLogTan - wideLogTan) * i /
+                        segmentsCount;
+        float xFov = (float)(std::atan(std::exp(logTan)) * 360.0 /
+                             LENS_POSITION_MAPPER_PI);
+        float hwPos = 0.0f;
+        fovTable.getHwZoomPos(xFov, hwPos);
+        int64_t pos = std::llround(hwPos);
+        pos = pos < low ? low : (pos > high ? high : pos);
+        if (hwMin < hwMax)
+            pos = pos < hwPositions[i - 1] ? hwPositions[i - 1] : pos;
+        else
+            pos = pos > hwPositions[i - 1] ? hwPositions[i - 1] : pos;
+        hwPositions[i] = pos;
+    }
+
+    init(hwPositions);
+
+    return true;
+}
+
+
+
+int cr::lens::LensPositionMapper::clampPos(float pos)
+{
+    if (!(pos > 0.0f))
+        return 0;
+
+    return pos < 65535.0f ? (int)pos : 65535;
+}
+
+
+
+int cr::lens::LensPositionMapper::toHwByTable(int pos) const
+{
+    const uint64_t n = m_hwPos.size() - 1;
+
+    // Segment index with 32 fractional bits.
+    const uint64_t x = ((uint64_t)pos * m_indexScale) >> 16;
+    const uint64_t i = x >> 32;
+    if (i >= n)
+        return (int)(m_sign * m_hwPos[n]);
+    const uint64_t fraction = x & 0xFFFFFFFFULL;
+
+    // Interpolation inside segment.
+    const uint64_t d = (uint64_t)(m_hwPos[i + 1] - m_hwPos[i]);
+    const int64_t hwPos = m_hwPos[i] +
+                          (int64_t)((d * fraction + 0x80000000ULL) >> 32);
+
+    return (int)(m_sign * hwPos);
+}
+
+
+
+int cr::lens::LensPositionMapper::toUserByTable(int hwPos) const
+{
+    const size_t n = m_hwPos.size() - 1;
+    int64_t pos = m_sign * (int64_t)hwPos;
+    pos = pos < m_hwPos.front() ? m_hwPos.front() :
+          (pos > m_hwPos.back() ? m_hwPos.back() : pos);
+
+    // Find segment from bucket.
+    const uint64_t d = (uint64_t)(pos - m_hwPos.front());
+    size_t i = m_buckets[(d * m_bucketScale) >> 32];
+    while (i + 1 < n && pos > m_hwPos[i + 1])
+        ++i;
+
+    // User position with 44 fractional bits.
+    const uint64_t userPos = m_userStart[i] +
+                             (uint64_t)(pos - m_hwPos[i]) * m_userSlope[i] +
+                             (1ULL << 43);
+    const int result = (int)(userPos >> 44);
+
+    return result > 65535 ? 65535 : result;
+}
+
+
+
+void cr::lens::LensPositionMapper::init(const std::vector<int64_t>& hwPositions)
+{
+    const uint64_t n = hwPositions.size() - 1;
+
+    // Ascending hardware positions.
+    m_sign = hwPositions.back() < hwPositions.front() ? -1 : 1;
+    m_hwPos.resize(n + 1);
+    for (size_t i = 0; i <= n; ++i)
+        m_hwPos[i] = m_sign * hwPositions[i];
+
+    // User positions and slopes of segments.
+    const uint64_t userRange = 65535ULL << 44;
+    const uint64_t segmentUser = userRange / n;
+    const uint64_t remainder = userRange % n;
+    m_userStart.resize(n);
+    m_userSlope.resize(n);
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        const uint64_t d = (uint64_t)(m_hwPos[i + 1] - m_hwPos[i]);
+        m_userStart[i] = segmentUser * i + remainder * i / n;
+        m_userSlope[i] = d == 0 ? 0 : (segmentUser + d / 2) / d;
+    }
+    m_indexScale = ((n << 48) + 32767) / 65535;
+
+    // Scales of linear mapping. Hardware range is less than 2^32. Scales are
+    // rounded symmetrically, so both limits are mapped exactly.
+    const uint64_t hwRange = (uint64_t)(m_hwPos[n] - m_hwPos[0]);
+    m_isLinear = n == 1;
+    m_hwStart = hwPositions[0];
+    m_hwLow = m_sign > 0 ? hwPositions[0] : hwPositions[n];
+    m_hwHigh = m_sign > 0 ? hwPositions[n] : hwPositions[0];
+    m_hwScale = m_sign * (int64_t)(((hwRange << 16) + 32767) / 65535);
+    m_userScale = hwRange == 0 ? 0 : m_sign * (int64_t)(((65535ULL << 32) +
+                  hwRange / 2) / hwRange);
+
+    // Buckets of hardware range with first segment which can contain
+    // position of bucket.
+    const uint64_t bucketsCount = n * LENS_POSITION_MAPPER_BUCKETS;
+    const uint64_t range = (uint64_t)(m_hwPos[n] - m_hwPos[0]) + 1;
+    m_bucketScale = (bucketsCount << 32) / range;
+    m_buckets.resize(bucketsCount);
+    size_t segment = 0;
+    for (uint64_t b = 0; b < bucketsCount; ++b)
+    {
+        const int64_t pos = m_hwPos[0] + (int64_t)(b * range / bucketsCount);
+        while (segment + 1 < n && m_hwPos[segment + 1] < pos)
+            ++segment;
+        m_buckets[b] = (uint32_t)segment;
+    }
+}
@@ -0,0 +1,204 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Max number of segments of position mapping table.
+#define LENS_POSITION_MAPPER_MAX_SEGMENTS 4096
+
+
+
+/**
+ * @brief Mapper of user space positions (0-65535, ZOOM_POS, FOCUS_POS,
+ * IRIS_POS params) to hardware positions and back. Mapping is monotone
+ * piecewise linear table of hardware positions for evenly spaced user
+ * positions. Default mapping is linear between hardware limits (table with
+ * one segment), nonlinear tables (for example, zoom linear in magnification)
+ * give better operator experience. Conversions use only 64-bit integer
+ * arithmetic. Linear mapping is converted inline by one multiplication by
+ * precomputed scale. For tables user to hardware position takes O(1)
+ * (segment index is calculated by multiplication), hardware to user position
+ * takes O(1) by bucket index over hardware range (bucket has segment to start
+ * search and monotone table is passed in a few steps). Conversion results are
+ * rounded to nearest. Class doesn't have internal lock: mapper can be used from
+ * several threads but must not be changed at the same time.
+ */
+class LensPositionMapper
+{
+public:
+
+    /**
+     * @brief Class constructor. Creates linear mapping with hardware range
+     * 0-65535.
+     */
+    LensPositionMapper();
+
+    /**
+     * @brief Class constructor. Creates linear mapping.
+     * @param hwMin Hardware position which corresponds to user position 0.
+     * @param hwMax Hardware position which corresponds to user position 65535.
+     */
+    LensPositionMapper(int hwMin, int hwMax);
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensPositionMapper();
+
+    /**
+     * @brief Set linear mapping.
+     * @param hwMin Hardware position which corresponds to user position 0.
+     * @param hwMax Hardware position which corresponds to user position 65535.
+     */
+    void setLinear(int hwMin, int hwMax);
+
+    /**
+     * @brief Set mapping table.
+     * @param hwPositions Hardware positions for evenly spaced user positions:
+     * first - for user position 0, last - for 65535. Positions must be
+     * monotone (non-decreasing or non-increasing). Number of positions
+     * 2 - LENS_POSITION_MAPPER_MAX_SEGMENTS + 1.
+     * @return TRUE if table set or FALSE if table is not valid (mapping is
+     * not changed).
+     */
+    bool setTable(const std::vector<int>& hwPositions);
+
+    /**
+     * @brief Set zoom mapping linear in magnification: equal steps of user
+     * zoom position change tan(FOV / 2) by equal factor. Table is built by
+     * FOV points (LensParams::fovPoints) between zoom hardware limits.
+     * @param params Lens params.
+     * @param segmentsCount Number of table segments.
+     * @return TRUE if table set or FALSE if there are no FOV points or FOV
+     * doesn't change between hardware limits (mapping is not changed).
+     */
+    bool setMagnificationTable(const LensParams& params,
+                               int segmentsCount = 256);
+
+    /**
+     * @brief Get hardware position for user position.
+     * @param pos User position. Clamped to 0-65535.
+     * @return Hardware position.
+     */
+    int toHw(int pos) const;
+
+    /**
+     * @brief Get user position for hardware position.
+     * @param hwPos Hardware position. Clamped to mapping range.
+     * @return User position 0-65535.
+     */
+    int toUser(int hwPos) const;
+
+    /**
+     * @brief Convert user position from command or param value to integer.
+     * Value is clamped in float before conversion, so out of range values
+     * and NaN are safe.
+     * @param pos User position.
+     * @return Position 0-65535 (0 for NaN).
+     */
+    static int clampPos(float pos);
+
+    /**
+     * @brief Check if mapping is linear.
+     * @return TRUE if mapping is linear (one segment) or FALSE if not.
+     */
+    bool isLinear() const;
+
+private:
+
+    /// Direction of hardware positions: 1 - ascending, -1 - descending.
+    int m_sign{1};
+    /// Hardware positions (multiplied by sign, so ascending) of table.
+    std::vector<int64_t> m_hwPos;
+    /// User position of segment start, 44 fractional bits.
+    std::vector<uint64_t> m_userStart;
+    /// User position change per hardware unit of segment, 44 fractional
+    /// bits.
+    std::vector<uint64_t> m_userSlope;
+    /// First segment for buckets of hardware range.
+    std::vector<uint32_t> m_buckets;
+    /// User position to segment index scale, 48 fractional bits.
+    uint64_t m_indexScale{0};
+    /// Hardware position to bucket index scale, 32 fractional bits.
+    uint64_t m_bucketScale{0};
+    /// Mapping is linear (one segment).
+    bool m_isLinear{true};
+    /// Hardware position for user position 0.
+    int64_t m_hwStart{0};
+    /// Min hardware position.
+    int64_t m_hwLow{0};
+    /// Max hardware position.
+    int64_t m_hwHigh{0};
+    /// Linear mapping hardware position change per user position (negative
+    /// for descending hardware positions), 16 fractional bits.
+    int64_t m_hwScale{0};
+    /// Linear mapping user position change per hardware unit (negative for
+    /// descending hardware positions), 32 fractional bits.
+    int64_t m_userScale{0};
+
+    /**
+     * @brief Get hardware position for user position by table.
+     * @param pos User position 0-65535.
+     * @return Hardware position.
+     */
+    int toHwByTable(int pos) const;
+
+    /**
+     * @brief Get user position for hardware position by table.
+     * @param hwPos Hardware position.
+     * @return User position 0-65535.
+     */
+    int toUserByTable(int hwPos) const;
+
+    /**
+     * @brief Prepare mapping by table.
+     * @param hwPositions Hardware positions. Must be valid.
+     */
+    void init(const std::vector<int64_t>& hwPositions);
+};
+
+
+
+// Conversions are inline: linear mapping takes one multiplication and must
+// not be slower than float scaling in controllers.
+inline int LensPositionMapper::toHw(int pos) const
+{
+    pos = pos < 0 ? 0 : (pos > 65535 ? 65535 : pos);
+    if (!m_isLinear)
+        return toHwByTable(pos);
+
+    return (int)(m_hwStart + ((pos * m_hwScale + 0x8000) >> 16));
+}
+
+
+
+inline int LensPositionMapper::toUser(int hwPos) const
+{
+    if (!m_isLinear)
+        return toUserByTable(hwPos);
+
+    // Product is not negative and result is not above 65535 for position in
+    // hardware range.
+    int64_t pos = hwPos < m_hwLow ? m_hwLow :
+                  (hwPos > m_hwHigh ? m_hwHigh : hwPos);
+
+    return (int)(((pos - m_hwStart) * m_userScale + 0x80000000LL) >> 32);
+}
+
+
+
+inline bool LensPositionMapper::isLinear() const
+{
+    return m_isLinear;
+}
+}
+}
@@ -0,0 +1,444 @@
+#include <cmath>
+#include "LensPredictor.h"
+
+
+
+cr::lens::LensPredictor::LensPredictor()
+{
+
+}
+
+
+
+cr::lens::LensPredictor::~LensPredictor()
+{
+
+}
+
+
+
+void cr::lens::LensPredictor::setParams(const cr::lens::LensParams& params)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Axis& zoom = m_axes[(int)LensAxis::ZOOM];
+    zoom.hwMin = (float)params.zoomHwWideLimit;
+    zoom.hwMax = (float)params.zoomHwTeleLimit;
+    zoom.mapper.setLinear(params.zoomHwWideLimit, params.zoomHwTeleLimit);
+    zoom.hwSpeed = (float)params.zoomHwSpeed;
+    zoom.hwMaxSpeed = (float)params.zoomHwMaxSpeed;
+
+    Axis& focus = m_axes[(int)LensAxis::FOCUS];
+    focus.hwMin = (float)params.focusHwNearLimit;
+    focus.hwMax = (float)params.focusHwFarLimit;
+    focus.mapper.setLinear(params.focusHwNearLimit, params.focusHwFarLimit);
+    focus.hwSpeed = (float)params.focusHwSpeed;
+    focus.hwMaxSpeed = (float)params.focusHwMaxSpeed;
+
+    Axis& iris = m_axes[(int)LensAxis::IRIS];
+    iris.hwMin = (float)params.irisHwCloseLimit;
+    iris.hwMax = (float)params.irisHwOpenLimit;
+    iris.mapper.setLinear(params.irisHwCloseLimit, params.irisHwOpenLimit);
+    iris.hwSpeed = (float)params.irisHwSpeed;
+    iris.hwMaxSpeed = (float)params.irisHwMaxSpeed;
+
+    m_fovTable.set(params.fovPoints);
+}
+
+
+
+void cr::lens::LensPredictor::setPositionMapper(
+        cr::lens::LensAxis axis, const cr::lens::LensPositionMapper& mapper)
+{
+    if (axis != LensAxis::ZOOM && axis != LensAxis::FOCUS &&
+        axis != LensAxis::IRIS)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Axis& state = m_axes[(int)axis];
+    state.mapper = mapper;
+    state.hwMin = (float)mapper.toHw(0);
+    state.hwMax = (float)mapper.toHw(65535);
+}
+
+
+
+void cr::lens::LensPredictor::setSpeedGain(cr::lens::LensAxis axis, float gain)
+{
+    if (axis != LensAxis::ZOOM && axis != LensAxis::FOCUS &&
+        axis != LensAxis::IRIS)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_axes[(int)axis].gain = gain < 0.0f ? 0.0f : gain;
+}
+
+
+
+float cr::lens::LensPredictor::getSpeedGain(cr::lens::LensAxis axis)
+{
+    if (axis != LensAxis::ZOOM && axis != LensAxis::FOCUS &&
+        axis != LensAxis::IRIS)
+        return 0.0f;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_axes[(int)axis].gain;
+}
+
+
+
+bool cr::lens::LensPredictor::addSample(cr::lens::LensParam id, float value,
+                                        uint32_t timeMsec)
+{
+    LensAxis axisId = LensAxis::NONE;
+    switch (id)
+    {
+    case LensParam::ZOOM_HW_POS: axisId = LensAxis::ZOOM; break;
+    case LensParam::FOCUS_HW_POS: axisId = LensAxis::FOCUS; break;
+    case LensParam::IRIS_HW_POS: axisId = LensAxis::IRIS; break;
+    default: return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Axis& axis = m_axes[(int)axisId];
+
+    // Samples must be in time order.
+    if (axis.count > 0 &&
+        (int32_t)(timeMsec - axis.samples[axis.last].time) <= 0)
+        return false;
+
+    axis.last = (axis.last + 1) % m_historySize;
+    axis.samples[axis.last].time = timeMsec;
+    axis.samples[axis.last].pos = value;
+    if (axis.count < m_historySize)
+        ++axis.count;
+
+    // Learn speed gain while axis moves freely (not at target or limit).
+    float velocity = 0.0f;
+    if (!axis.isMoving || axis.hwSpeed <= 0.0f ||
+        !getMeasuredVelocity(axis, velocity))
+        return true;
+    float margin = std::fabs(axis.hwMax - axis.hwMin) * 0.005f;
+    float low = axis.hwMin < axis.hwMax ? axis.hwMin : axis.hwMax;
+    float high = axis.hwMin < axis.hwMax ? axis.hwMax : axis.hwMin;
+    if (value <= low + margin || value >= high - margin ||
+        (axis.hasTarget && std::fabs(axis.target - value) <= margin))
+        return true;
+    float gain = std::fabs(velocity) * 1000.0f / axis.hwSpeed;
+    axis.gain = axis.gain <= 0.0f ? gain : 0.7f * axis.gain + 0.3f * gain;
+
+    return true;
+}
+
+
+
+void cr::lens::LensPredictor::onCommand(cr::lens::LensCommand id, float arg,
+                                        uint32_t timeMsec)
+{
+    if (timeMsec == 0)
+        timeMsec = LensParams::getTimeMsec();
+
+    LensQueuedCommand command;
+    command.type = 0;
+    command.commandId = id;
+    LensAxis axisId = LensCommandQueue::getAxis(command);
+    if (axisId != LensAxis::ZOOM && axisId != LensAxis::FOCUS &&
+        axisId != LensAxis::IRIS)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Axis& axis = m_axes[(int)axisId];
+
+    switch (id)
+    {
+    case LensCommand::ZOOM_TELE:
+    case LensCommand::FOCUS_FAR:
+    case LensCommand::IRIS_OPEN:
+        start(axis, 1, false, 0.0f, timeMsec);
+        break;
+    case LensCommand::ZOOM_WIDE:
+    case LensCommand::FOCUS_NEAR:
+    case LensCommand::IRIS_CLOSE:
+        start(axis, -1, false, 0.0f, timeMsec);
+        break;
+    case LensCommand::ZOOM_TO_POS:
+    case LensCommand::FOCUS_TO_POS:
+    case LensCommand::IRIS_TO_POS:
+        start(axis, 0, true, (float)axis.mapper.toHw(
+                  LensPositionMapper::clampPos(arg)), timeMsec);
+        break;
+    case LensCommand::ZOOM_TO_FOV:
+    {
+        float hwZoomPos = 0.0f;
+        if (m_fovTable.getHwZoomPos(arg, hwZoomPos))
+            start(axis, 0, true, hwZoomPos, timeMsec);
+        break;
+    }
+    case LensCommand::ZOOM_AT_FOV_RATE:
+    case LensCommand::ZOOM_AT_MAGNIFICATION_RATE:
+        start(axis, arg > 0.0f ? 1 : -1, false, 0.0f, timeMsec);
+        break;
+    default:
+        // Stop commands.
+        if (axis.isMoving)
+        {
+            axis.isMoving = false;
+            axis.isStopped = true;
+            axis.stopTime = timeMsec;
+        }
+        break;
+    }
+}
+
+
+
+void cr::lens::LensPredictor::onSetParam(cr::lens::LensParam id, float value,
+                                         uint32_t timeMsec)
+{
+    if (timeMsec == 0)
+        timeMsec = LensParams::getTimeMsec();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Axis& zoom = m_axes[(int)LensAxis::ZOOM];
+    Axis& focus = m_axes[(int)LensAxis::FOCUS];
+    Axis& iris = m_axes[(int)LensAxis::IRIS];
+    const int pos = LensPositionMapper::clampPos(value);
+
+    switch (id)
+    {
+    case LensParam::ZOOM_POS:
+        start(zoom, 0, true, (float)zoom.mapper.toHw(pos), timeMsec);
+        break;
+    case LensParam::ZOOM_HW_POS: start(zoom, 0, true, value, timeMsec); break;
+    case LensParam::FOCUS_POS:
+        start(focus, 0, true, (float)focus.mapper.toHw(pos), timeMsec);
+        break;
+    case LensParam::FOCUS_HW_POS: start(focus, 0, true, value, timeMsec); break;
+    case LensParam::IRIS_POS:
+        start(iris, 0, true, (float)iris.mapper.toHw(pos), timeMsec);
+        break;
+    case LensParam::IRIS_HW_POS: start(iris, 0, true, value, timeMsec); break;
+    case LensParam::ZOOM_SPEED:
+        zoom.hwSpeed = zoom.hwMaxSpeed * value / 100.0f;
+        break;
+    case LensParam::ZOOM_HW_SPEED: zoom.hwSpeed = value; break;
+    case LensParam::ZOOM_HW_MAX_SPEED: zoom.hwMaxSpeed = value; break;
+    case LensParam::FOCUS_SPEED:
+        focus.hwSpeed = focus.hwMaxSpeed * value / 100.0f;
+        break;
+    case LensParam::FOCUS_HW_SPEED: focus.hwSpeed = value; break;
+    case LensParam::FOCUS_HW_MAX_SPEED: focus.hwMaxSpeed = value; break;
+    case LensParam::IRIS_SPEED:
+        iris.hwSpeed = iris.hwMaxSpeed * value / 100.0f;
+        break;
+    case LensParam::IRIS_HW_SPEED: iris.hwSpeed = value; break;
+    case LensParam::IRIS_HW_MAX_SPEED: iris.hwMaxSpeed = value; break;
+    case LensParam::ZOOM_HW_TELE_LIMIT:
+        zoom.hwMax = value;
+        zoom.mapper.setLinear((int)zoom.hwMin, (int)zoom.hwMax);
+        break;
+    case LensParam::ZOOM_HW_WIDE_LIMIT:
+        zoom.hwMin = value;
+        zoom.mapper.setLinear((int)zoom.hwMin, (int)zoom.hwMax);
+        break;
+    case LensParam::FOCUS_HW_FAR_LIMIT:
+        focus.hwMax = value;
+        focus.mapper.setLinear((int)focus.hwMin, (int)focus.hwMax);
+        break;
+    case LensParam::FOCUS_HW_NEAR_LIMIT:
+        focus.hwMin = value;
+        focus.mapper.setLinear((int)focus.hwMin, (int)focus.hwMax);
+        break;
+    case LensParam::IRIS_HW_OPEN_LIMIT:
+        iris.hwMax = value;
+        iris.mapper.setLinear((int)iris.hwMin, (int)iris.hwMax);
+        break;
+    case LensParam::IRIS_HW_CLOSE_LIMIT:
+        iris.hwMin = value;
+        iris.mapper.setLinear((int)iris.hwMin, (int)iris.hwMax);
+        break;
+    default: break;
+    }
+}
+
+
+
+bool cr::lens::LensPredictor::predict(cr::lens::LensParam id,
+                                      uint32_t timeMsec, float& value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    float pos = 0.0f;
+    Axis* axis = nullptr;
+    switch (id)
+    {
+    case LensParam::ZOOM_POS:
+    case LensParam::ZOOM_HW_POS:
+        axis = &m_axes[(int)LensAxis::ZOOM];
+        break;
+    case LensParam::FOCUS_POS:
+    case LensParam::FOCUS_HW_POS:
+        axis = &m_axes[(int)LensAxis::FOCUS];
+        break;
+    case LensParam::IRIS_POS:
+    case LensParam::IRIS_HW_POS:
+        axis = &m_axes[(int)LensAxis::IRIS];
+        break;
+    case LensParam::X_FOV_DEG:
+    case LensParam::Y_FOV_DEG:
+    {
+        float xFovDeg = 0.0f, yFovDeg = 0.0f;
+        if (!predictPos(m_axes[(int)LensAxis::ZOOM], timeMsec, pos) ||
+            !m_fovTable.getFov(pos, xFovDeg, yFovDeg))
+            return false;
+        value = id == LensParam::X_FOV_DEG ? xFovDeg : yFovDeg;
+        return true;
+    }
+    default:
+        return false;
+    }
+
+    if (!predictPos(*axis, timeMsec, pos))
+        return false;
+
+    // Hardware position.
+    if (id == LensParam::ZOOM_HW_POS || id == LensParam::FOCUS_HW_POS ||
+        id == LensParam::IRIS_HW_POS)
+    {
+        value = pos;
+        return true;
+    }
+
+    // Scale to user space 0-65535.
+    value = (float)axis->mapper.toUser((int)std::lround(pos));
+
+    return true;
+}
+
+
+
+void cr::lens::LensPredictor::start(Axis& axis, int direction, bool hasTarget,
+                                    float target, uint32_t time)
+{
+    // Position at motion start defines direction to target.
+    if (hasTarget)
+    {
+        float pos = 0.0f;
+        if (!predictPos(axis, time, pos))
+            pos = target;
+        axis.direction = target > pos ? 1 : (target < pos ? -1 : 0);
+    }
+    else
+    {
+        axis.direction = axis.hwMax >= axis.hwMin ? direction : -direction;
+    }
+
+    axis.hasTarget = hasTarget;
+    axis.target = target;
+    axis.isMoving = true;
+    axis.isStopped = false;
+    axis.startTime = time;
+}
+
+
+
+bool cr::lens::LensPredictor::getMeasuredVelocity(Axis& axis, float& velocity)
+{
+    // Least squares over up to 4 latest samples taken after motion start.
+    int n = 0;
+    double sumT = 0.0, sumP = 0.0, sumTT = 0.0, sumTP = 0.0;
+    uint32_t origin = axis.samples[axis.last].time;
+    for (int i = 0; i < axis.count && n < 4; ++i)
+    {
+        Sample& sample = axis.samples[(axis.last - i + m_historySize) %
+                                      m_historySize];
+        if ((int32_t)(sample.time - axis.startTime) <= 0)
+            break;
+        if (axis.isStopped && (int32_t)(sample.time - axis.stopTime) > 0)
+            continue;
+        double t = (double)(int32_t)(sample.time - origin);
+        sumT += t;
+        sumP += sample.pos;
+        sumTT += t * t;
+        sumTP += t * sample.pos;
+        ++n;
+    }
+    if (n < 2)
+        return false;
+
+    double d = n * sumTT - sumT * sumT;
+    if (d <= 0.0)
+        return false;
+    velocity = (float)((n * sumTP - sumT * sumP) / d);
+
+    return true;
+}
+
+
+
+bool cr::lens::LensPredictor::predictPos(Axis& axis, uint32_t time, float& pos)
+{
+    if (axis.count == 0)
+        return false;
+
+    // Time inside history: interpolate between samples.
+    Sample& last = axis.samples[axis.last];
+    if ((int32_t)(time - last.time) <= 0)
+    {
+        pos = last.pos;
+        for (int i = 1; i < axis.count; ++i)
+        {
+            Sample& prev = axis.samples[(axis.last - i + m_historySize) %
+                                        m_historySize];
+            Sample& next = axis.samples[(axis.last - i + 1 + m_historySize) %
+                                        m_historySize];
+            pos = prev.pos;
+            if ((int32_t)(time - prev.time) >= 0)
+            {
+                float k = (float)(int32_t)(time - prev.time) /
+                          (float)(int32_t)(next.time - prev.time);
+                pos = prev.pos + k * (next.pos - prev.pos);
+                break;
+            }
+        }
+        return true;
+    }
+
+    // Axis doesn't move or sample was taken after stop.
+    pos = last.pos;
+    if (!axis.isMoving && (!axis.isStopped ||
+        (int32_t)(last.time - axis.stopTime) >= 0))
+        return true;
+
+    // Extrapolate from last sample (or motion start) to requested time (or
+    // stop time).
+    uint32_t from = last.time;
+    if ((int32_t)(axis.startTime - from) > 0)
+        from = axis.startTime;
+    uint32_t to = time;
+    if (!axis.isMoving && (int32_t)(axis.stopTime - to) < 0)
+        to = axis.stopTime;
+    int32_t span = (int32_t)(to - from);
+    if (span <= 0)
+        return true;
+
+    // Measured velocity or velocity by commanded speed.
+    float velocity = 0.0f;
+    if (!getMeasuredVelocity(axis, velocity))
+        velocity = (float)axis.direction * axis.gain * axis.hwSpeed / 1000.0f;
+    pos += velocity * (float)span;
+
+    // Limit by hardware limits and target.
+    float low = axis.hwMin < axis.hwMax ? axis.hwMin : axis.hwMax;
+    float high = axis.hwMin < axis.hwMax ? axis.hwMax : axis.hwMin;
+    pos = pos < low ? low : (pos > high ? high : pos);
+    if (axis.hasTarget)
+    {
+        if (axis.direction > 0 && pos > axis.target)
+            pos = axis.target;
+        else if (axis.direction < 0 && pos < axis.target)
+            pos = axis.target;
+    }
+
+    return true;
+}
@@ -0,0 +1,199 @@
+#pragma once
+#include <mutex>
+#include <cstdint>
+#include "Lens.h"
+#include "LensFovTable.h"
+#include "LensCommandQueue.h"
+#include "LensPositionMapper.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/**
+ * @brief Lens axes position predictor. Hardware positions read by periodic
+ * polls are stale between polls, so FOV for current video frame is wrong
+ * during zoom. Predictor estimates zoom, focus and iris positions for any
+ * timestamp from recent timestamped position samples and commanded motion
+ * (direction, target position and hardware speed). Velocity is measured from
+ * samples taken after motion started. Until enough samples are available
+ * velocity is calculated from commanded hardware speed and speed gain
+ * (hardware position units per second per hardware speed unit) which is
+ * learned from previous motions or set by user. Predicted positions are
+ * limited by hardware limits and target position. Class is thread-safe.
+ */
+class LensPredictor
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    LensPredictor();
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensPredictor();
+
+    /**
+     * @brief Set lens params: hardware limits, hardware speeds and FOV points.
+     * @param params Lens params.
+     */
+    void setParams(const LensParams& params);
+
+    /**
+     * @brief Set user space position mapping of axis. Mapping is reset to
+     * linear by setParams(...) and hardware limit params.
+     * @param axis Axis: ZOOM, FOCUS or IRIS.
+     * @param mapper Position mapper.
+     */
+    void setPositionMapper(LensAxis axis, const LensPositionMapper& mapper);
+
+    /**
+     * @brief Set speed gain of axis.
+     * @param axis Axis: ZOOM, FOCUS or IRIS.
+     * @param gain Hardware position units per second per hardware speed unit.
+     */
+    void setSpeedGain(LensAxis axis, float gain);
+
+    /**
+     * @brief Get speed gain of axis (set by user or learned).
+     * @param axis Axis: ZOOM, FOCUS or IRIS.
+     * @return Speed gain or 0 if unknown.
+     */
+    float getSpeedGain(LensAxis axis);
+
+    /**
+     * @brief Add position sample read from hardware.
+     * @param id Param ID: ZOOM_HW_POS, FOCUS_HW_POS or IRIS_HW_POS.
+     * @param value Hardware position.
+     * @param timeMsec Time when position was read, msec
+     * (LensParams::getTimeMsec()).
+     * @return TRUE if sample added or FALSE if param ID not supported.
+     */
+    bool addSample(LensParam id, float value, uint32_t timeMsec);
+
+    /**
+     * @brief Notify predictor about executed command.
+     * @param id Command ID.
+     * @param arg Command argument.
+     * @param timeMsec Time when command was executed, msec. 0 - current time.
+     */
+    void onCommand(LensCommand id, float arg = 0.0f, uint32_t timeMsec = 0);
+
+    /**
+     * @brief Notify predictor about executed set param command. Position
+     * params start motion to target position, speed and limit params update
+     * motion model.
+     * @param id Param ID.
+     * @param value Param value.
+     * @param timeMsec Time when command was executed, msec. 0 - current time.
+     */
+    void onSetParam(LensParam id, float value, uint32_t timeMsec = 0);
+
+    /**
+     * @brief Predict param value for given time.
+     * @param id Param ID: ZOOM_POS, ZOOM_HW_POS, FOCUS_POS, FOCUS_HW_POS,
+     * IRIS_POS, IRIS_HW_POS, X_FOV_DEG or Y_FOV_DEG.
+     * @param timeMsec Time, msec (LensParams::getTimeMsec()). Can be in the
+     * past or in the future.
+     * @param value Output predicted value.
+     * @return TRUE if value predicted or FALSE if param ID not supported,
+     * there are no position samples yet or FOV points are not set.
+     */
+    bool predict(LensParam id, uint32_t timeMsec, float& value);
+
+private:
+
+    /// Max number of position samples per axis.
+    static const int m_historySize = 8;
+
+    /// Position sample.
+    struct Sample
+    {
+        /// Time, msec.
+        uint32_t time{0};
+        /// Hardware position.
+        float pos{0.0f};
+    };
+
+    /// Axis state.
+    struct Axis
+    {
+        /// Position samples ring.
+        Sample samples[m_historySize];
+        /// Index of last sample.
+        int last{-1};
+        /// Number of samples.
+        int count{0};
+        /// Hardware position which corresponds to user position 0.
+        float hwMin{0.0f};
+        /// Hardware position which corresponds to user position 65535.
+        float hwMax{65535.0f};
+        /// User space position mapper.
+        LensPositionMapper mapper;
+        /// Hardware max speed.
+        float hwMaxSpeed{50.0f};
+        /// Commanded hardware speed.
+        float hwSpeed{50.0f};
+        /// Speed gain, 0 if unknown.
+        float gain{0.0f};
+        /// Motion direction in hardware units: -1, 0 or 1.
+        int direction{0};
+        /// Target hardware position is valid.
+        bool hasTarget{false};
+        /// Target hardware position.
+        float target{0.0f};
+        /// Axis is moving.
+        bool isMoving{false};
+        /// Motion start time, msec.
+        uint32_t startTime{0};
+        /// Motion stop time, msec.
+        uint32_t stopTime{0};
+        /// Motion was stopped by command.
+        bool isStopped{false};
+    };
+
+    /// Axes by LensAxis value.
+    Axis m_axes[4];
+    /// FOV table.
+    LensFovTable m_fovTable;
+    /// Mutex.
+    std::mutex m_mutex;
+
+    /**
+     * @brief Start axis motion.
+     * @param axis Axis state.
+     * @param direction Direction in user space: -1 or 1 (0 if target set).
+     * @param hasTarget Target position is valid.
+     * @param target Target hardware position.
+     * @param time Motion start time, msec.
+     */
+    void start(Axis& axis, int direction, bool hasTarget, float target,
+               uint32_t time);
+
+    /**
+     * @brief Get measured velocity from samples taken during motion.
+     * @param axis Axis state.
+     * @param velocity Output velocity, hardware units per msec.
+     * @return TRUE if velocity measured or FALSE if not enough samples.
+     */
+    bool getMeasuredVelocity(Axis& axis, float& velocity);
+
+    /**
+     * @brief Predict hardware position of axis.
+     * @param axis Axis state.
+     * @param time Time, msec.
+     * @param pos Output hardware position.
+     * @return TRUE if predicted or FALSE if there are no samples.
+     */
+    bool predictPos(Axis& axis, uint32_t time, float& pos);
+};
+}
+}
@@ -0,0 +1,251 @@
+#include <chrono>
+#include <sstream>
+#include <cstring>
+#include "LensServer.h"
+#include "LensStreamDecoder.h"
+
+
+
+cr::lens::LensServer::LensServer()
+{
+
+}
+
+
+
+cr::lens::LensServer::~LensServer()
+{
+    stop();
+}
+
+
+
+bool cr::lens::LensServer::start(cr::lens::Lens* lens, std::string initString)
+{
+    stop();
+    if (lens == nullptr)
+        return false;
+
+    // Parse init string.
+    std::string type, address, extra;
+    int port = 0;
+    if (!LensSocket::parseInitString(initString, type, address, port, extra))
+        return false;
+    m_publishPeriodMsec = 10;
+    m_leaseMsec = LENS_SERVER_DEFAULT_LEASE_MSEC;
+    std::istringstream stream(extra);
+    std::string item;
+    try
+    {
+        if (std::getline(stream, item, ';') && !item.empty())
+            m_publishPeriodMsec = std::stoi(item);
+        if (std::getline(stream, item, ';') && !item.empty())
+            m_leaseMsec = std::stoi(item);
+    }
+    catch (...)
+    {
+        return false;
+    }
+    if (m_publishPeriodMsec < 1)
+        m_publishPeriodMsec = 1;
+    if (m_leaseMsec < 1)
+        m_leaseMsec = 1;
+
+    // Open socket.
+    if (!m_socket.open(type, address, port, true))
+        return false;
+
+    // Start server thread.
+    m_lens = lens;
+    m_stopFlag.store(false);
+    m_isRunning.store(true);
+    m_thread = std::thread(&LensServer::process, this);
+
+    return true;
+}
+
+
+
+void cr::lens::LensServer::stop()
+{
+    m_stopFlag.store(true);
+    if (m_thread.joinable())
+        m_thread.join();
+    m_isRunning.store(false);
+    m_socket.close();
+
+    // Remove subscribers.
+    std::lock_guard<std::mutex> lock(m_clientsMutex);
+    for (auto& client : m_clients)
+        m_publisher.removeSubscriber(client.second.id);
+    m_clients.clear();
+}
+
+
+
+bool cr::lens::LensServer::isRunning()
+{
+    return m_isRunning.load();
+}
+
+
+
+int cr::lens::LensServer::getClientsCount()
+{
+    std::lock_guard<std::mutex> lock(m_clientsMutex);
+    return (int)m_clients.size();
+}
+
+
+
+void cr::lens::LensServer::process()
+{
+    // Full params snapshot with ages in responses keeps client cache
+    // consistent.
+    LensParamsMask snapshotMask;
+    snapshotMask.timestamps = true;
+    LensStreamDecoder decoder;
+    LensStreamFrame frame;
+    LensSocketAddress address;
+    LensParams params;
+    uint8_t data[4096];
+    uint8_t response[512];
+    std::chrono::steady_clock::time_point publishTime =
+            std::chrono::steady_clock::now();
+
+    while (!m_stopFlag.load())
+    {
+        // Wait data until next publish time.
+        int waitMsec = (int)std::chrono::duration_cast<
+                std::chrono::milliseconds>(publishTime -
+                                           std::chrono::steady_clock::now())
+                .count();
+        if (waitMsec < 0)
+            waitMsec = 0;
+        int size = m_socket.receive(data, (int)sizeof(data), waitMsec,
+                                    &address);
+
+        // Process frames. Datagram can carry several frames.
+        if (size > 0)
+        {
+            decoder.reset();
+            decoder.put(data, size);
+            bool hasSequence = false;
+            uint32_t sequence = 0;
+            while (decoder.next(frame))
+            {
+                switch (frame.type)
+                {
+                case LensFrameType::SEQUENCE:
+                    hasSequence = Lens::decodeSequence(frame.data, frame.size,
+                                                       sequence);
+                    break;
+                case LensFrameType::COMMAND:
+                case LensFrameType::SET_PARAM:
+                {
+                    // Sequence number of request is put back before response.
+                    int sequenceSize = 0;
+                    if (hasSequence)
+                        Lens::encodeSequence(response, sequenceSize,
+                                             sequence);
+                    hasSequence = false;
+                    int responseSize = 0;
+                    m_lens->processCommand(frame.data, frame.size,
+                                           &response[sequenceSize],
+                                           (int)sizeof(response) -
+                                           sequenceSize, responseSize,
+                                           &snapshotMask);
+                    if (responseSize > 0)
+                        m_socket.sendTo(response, sequenceSize + responseSize,
+                                        address);
+                    break;
+                }
+                case LensFrameType::SUBSCRIBE:
+                    subscribe(frame.data, frame.size, address);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+        else if (size < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // Publish params.
+        std::chrono::steady_clock::time_point now =
+                std::chrono::steady_clock::now();
+        if (now < publishTime)
+            continue;
+        publishTime = now + std::chrono::milliseconds(m_publishPeriodMsec);
+        removeExpiredClients();
+        if (m_publisher.getSubscribersCount() == 0)
+            continue;
+        m_lens->getParams(params);
+        m_publisher.publish(params);
+    }
+}
+
+
+
+void cr::lens::LensServer::subscribe(uint8_t* data, int size,
+                                     const cr::lens::LensSocketAddress& address)
+{
+    std::lock_guard<std::mutex> lock(m_clientsMutex);
+
+    // The same command renews subscription without resetting publisher
+    // state of the client.
+    std::string key = address.getKey();
+    auto client = m_clients.find(key);
+    if (client != m_clients.end() &&
+        client->second.command.size() == (size_t)size &&
+        memcmp(client->second.command.data(), data, size) == 0)
+    {
+        client->second.time = std::chrono::steady_clock::now();
+        return;
+    }
+
+    // Remove previous subscription of the client.
+    if (client != m_clients.end())
+    {
+        m_publisher.removeSubscriber(client->second.id);
+        m_clients.erase(client);
+    }
+
+    // Add subscriber. Empty mask means unsubscribe.
+    LensSocket* socket = &m_socket;
+    int id = m_publisher.addSubscriber(
+                data, size, [socket, address](const LensParamsBuffer& buffer)
+    {
+        socket->sendTo(buffer->data(), (int)buffer->size(), address);
+    });
+    if (id < 0)
+        return;
+    Client& newClient = m_clients[key];
+    newClient.id = id;
+    newClient.command.assign(data, data + size);
+    newClient.time = std::chrono::steady_clock::now();
+}
+
+
+
+void cr::lens::LensServer::removeExpiredClients()
+{
+    std::lock_guard<std::mutex> lock(m_clientsMutex);
+    std::chrono::steady_clock::time_point time =
+            std::chrono::steady_clock::now() -
+            std::chrono::milliseconds(m_leaseMsec);
+    for (auto client = m_clients.begin(); client != m_clients.end();)
+    {
+        if (client->second.time < time)
+        {
+            m_publisher.removeSubscriber(client->second.id);
+            client = m_clients.erase(client);
+        }
+        else
+        {
+            ++client;
+        }
+    }
+}
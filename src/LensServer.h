@@ -0,0 +1,137 @@
+#pragma once
+#include <map>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <string>
+#include "Lens.h"
+#include "LensSocket.h"
+#include "LensParamsPublisher.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Default subscription lease, msec. Clients must renew subscription (send
+/// the same subscribe command again) within lease.
+#define LENS_SERVER_DEFAULT_LEASE_MSEC 5000
+
+
+
+/**
+ * @brief Lens server. Wraps any Lens implementation and gives access to it
+ * over UDP or Unix domain datagram sockets using Lens wire format: executes
+ * commands and set param commands with responses (Lens::processCommand(...))
+ * and pushes params updates to subscribed clients (LensParamsPublisher).
+ * Subscriptions which are not renewed within lease are removed, so clients
+ * which disappear without unsubscribing don't get telemetry forever. Client
+ * side is implemented by RemoteLens class.
+ */
+class LensServer
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    LensServer();
+
+    /**
+     * @brief Class destructor. Stops server.
+     */
+    ~LensServer();
+
+    /**
+     * @brief Start server.
+     * @param lens Pointer to lens controller. Must be valid while server runs.
+     * @param initString Init string. Format for UDP:
+     * "udp;[bind IP];[port];[params publish period, msec];[subscription
+     * lease, msec]" and for Unix domain sockets: "unix;[socket file path];
+     * [params publish period, msec];[subscription lease, msec]". Publish
+     * period (default 10 msec) and subscription lease (default
+     * LENS_SERVER_DEFAULT_LEASE_MSEC) are optional. Lease must be several
+     * times longer than clients renewal period (RemoteLens renews
+     * subscription every REMOTE_LENS_RENEW_PERIOD_MSEC).
+     * @return TRUE if server started or FALSE if not.
+     */
+    bool start(Lens* lens, std::string initString);
+
+    /**
+     * @brief Stop server.
+     */
+    void stop();
+
+    /**
+     * @brief Get server status.
+     * @return TRUE if server running or FALSE.
+     */
+    bool isRunning();
+
+    /**
+     * @brief Get number of subscribed clients.
+     * @return Number of clients.
+     */
+    int getClientsCount();
+
+private:
+
+    /// Lens controller.
+    Lens* m_lens{nullptr};
+    /// Server socket.
+    LensSocket m_socket;
+    /// Params publisher.
+    LensParamsPublisher m_publisher;
+    /// Subscribed client.
+    struct Client
+    {
+        /// Subscriber ID.
+        int id{-1};
+        /// Subscribe command to detect renewal.
+        std::vector<uint8_t> command;
+        /// Last renewal time.
+        std::chrono::steady_clock::time_point time;
+    };
+
+    /// Subscribed clients by client address.
+    std::map<std::string, Client> m_clients;
+    /// Clients map mutex.
+    std::mutex m_clientsMutex;
+    /// Server thread.
+    std::thread m_thread;
+    /// Stop thread flag.
+    std::atomic<bool> m_stopFlag{false};
+    /// Server status.
+    std::atomic<bool> m_isRunning{false};
+    /// Params publish period, msec.
+    int m_publishPeriodMsec{10};
+    /// Subscription lease, msec.
+    int m_leaseMsec{LENS_SERVER_DEFAULT_LEASE_MSEC};
+
+    /**
+     * @brief Server thread function.
+     */
+    void process();
+
+    /**
+     * @brief Add or remove subscriber by subscribe command.
+     * @param data Pointer to subscribe command data.
+     * @param size Size of data.
+     * @param address Client address.
+     */
+    void subscribe(uint8_t* data, int size,
+                   const LensSocketAddress& address);
+
+    /**
+     * @brief Remove subscriptions which were not renewed within lease.
+     */
+    void removeExpiredClients();
+};
+}
+}
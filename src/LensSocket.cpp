@@ -0,0 +1,275 @@
+#include <cstring>
+#include <atomic>
+#include <sstream>
+#include "LensSocket.h"
+#if !defined(_WIN32)
+#include <poll.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#endif
+
+
+
+std::string cr::lens::LensSocketAddress::getKey() const
+{
+    return std::string((const char*)&address, size);
+}
+
+
+
+cr::lens::LensSocket::LensSocket()
+{
+#if defined(_WIN32)
+    // Init Winsock. Multiple calls are allowed.
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+}
+
+
+
+cr::lens::LensSocket::~LensSocket()
+{
+    close();
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+
+
+bool cr::lens::LensSocket::open(std::string type, std::string address,
+                                int port, bool isServer)
+{
+    close();
+
+    if (type == "udp")
+    {
+        // Prepare address.
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+            return false;
+
+        // Create socket.
+        m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (!isOpen())
+            return false;
+
+        int result = isServer ?
+                    bind(m_socket, (sockaddr*)&addr, sizeof(addr)) :
+                    connect(m_socket, (sockaddr*)&addr, sizeof(addr));
+        if (result != 0)
+        {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+#if defined(_WIN32)
+    // Unix sockets are not supported.
+    return false;
+#else
+    if (type != "unix")
+        return false;
+
+    // Prepare address.
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (address.empty() || address.size() >= sizeof(addr.sun_path))
+        return false;
+    strcpy(addr.sun_path, address.c_str());
+
+    // Create socket.
+    m_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (!isOpen())
+        return false;
+
+    if (isServer)
+    {
+        // Remove socket file left by previous run.
+        unlink(address.c_str());
+        if (bind(m_socket, (sockaddr*)&addr, sizeof(addr)) != 0)
+        {
+            close();
+            return false;
+        }
+        m_path = address;
+        return true;
+    }
+
+    // Client has to bind own file to receive responses.
+    static std::atomic<int> counter(0);
+    std::ostringstream path;
+    path << address << "." << getpid() << "." << counter++;
+    sockaddr_un clientAddr;
+    memset(&clientAddr, 0, sizeof(clientAddr));
+    clientAddr.sun_family = AF_UNIX;
+    if (path.str().size() >= sizeof(clientAddr.sun_path))
+    {
+        close();
+        return false;
+    }
+    strcpy(clientAddr.sun_path, path.str().c_str());
+    unlink(clientAddr.sun_path);
+    if (bind(m_socket, (sockaddr*)&clientAddr, sizeof(clientAddr)) != 0)
+    {
+        close();
+        return false;
+    }
+    m_path = path.str();
+
+    if (connect(m_socket, (sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+
+
+void cr::lens::LensSocket::close()
+{
+    if (!isOpen())
+        return;
+
+#if defined(_WIN32)
+    closesocket(m_socket);
+    m_socket = INVALID_SOCKET;
+#else
+    ::close(m_socket);
+    m_socket = -1;
+    if (!m_path.empty())
+        unlink(m_path.c_str());
+#endif
+    m_path = "";
+}
+
+
+
+bool cr::lens::LensSocket::isOpen()
+{
+#if defined(_WIN32)
+    return m_socket != INVALID_SOCKET;
+#else
+    return m_socket >= 0;
+#endif
+}
+
+
+
+bool cr::lens::LensSocket::send(const uint8_t* data, int size)
+{
+    if (!isOpen())
+        return false;
+
+    return ::send(m_socket, (const char*)data, size, 0) == size;
+}
+
+
+
+bool cr::lens::LensSocket::sendTo(const uint8_t* data, int size,
+                                  const cr::lens::LensSocketAddress& address)
+{
+    if (!isOpen())
+        return false;
+
+    return sendto(m_socket, (const char*)data, size, 0,
+                  (const sockaddr*)&address.address, address.size) == size;
+}
+
+
+
+int cr::lens::LensSocket::receive(uint8_t* data, int bufferSize,
+                                  int timeoutMsec,
+                                  cr::lens::LensSocketAddress* address)
+{
+    if (!isOpen())
+        return -1;
+
+    // Wait data.
+#if defined(_WIN32)
+    WSAPOLLFD fd;
+    fd.fd = m_socket;
+    fd.events = POLLRDNORM;
+    fd.revents = 0;
+    int result = WSAPoll(&fd, 1, timeoutMsec);
+#else
+    pollfd fd;
+    fd.fd = m_socket;
+    fd.events = POLLIN;
+    fd.revents = 0;
+    int result = poll(&fd, 1, timeoutMsec);
+#endif
+    if (result == 0)
+        return 0;
+    if (result < 0)
+        return -1;
+
+    // Read datagram.
+    sockaddr_storage addr;
+    socklen_t addrSize = sizeof(addr);
+    int size = (int)recvfrom(m_socket, (char*)data, bufferSize, 0,
+                             (sockaddr*)&addr, &addrSize);
+    if (size < 0)
+        return -1;
+
+    if (address != nullptr)
+    {
+        address->address = addr;
+        address->size = addrSize;
+    }
+
+    return size;
+}
+
+
+
+bool cr::lens::LensSocket::parseInitString(std::string initString,
+                                           std::string& type,
+                                           std::string& address,
+                                           int& port,
+                                           std::string& extra)
+{
+    // Split init string.
+    std::istringstream stream(initString);
+    std::string item;
+    if (!std::getline(stream, type, ';') || !std::getline(stream, address, ';'))
+        return false;
+
+    port = 0;
+    if (type == "udp")
+    {
+        if (!std::getline(stream, item, ';'))
+            return false;
+        try
+        {
+            port = std::stoi(item);
+        }
+        catch (...)
+        {
+            return false;
+        }
+        if (port <= 0 || port > 65535)
+            return false;
+    }
+    else if (type != "unix")
+    {
+        return false;
+    }
+
+    // Rest of init string.
+    std::getline(stream, extra, '\0');
+
+    return true;
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#endif
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Socket address of remote side.
+class LensSocketAddress
+{
+public:
+    /// Address storage.
+    sockaddr_storage address;
+    /// Address size.
+    socklen_t size{0};
+
+    /**
+     * @brief Get address as string key to use in containers.
+     * @return Address bytes as string.
+     */
+    std::string getKey() const;
+};
+
+
+
+/**
+ * @brief Datagram socket used by LensServer and RemoteLens. Supports UDP and
+ * Unix domain datagram sockets (not supported on Windows).
+ */
+class LensSocket
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    LensSocket();
+
+    /**
+     * @brief Class destructor. Closes socket.
+     */
+    ~LensSocket();
+
+    /**
+     * @brief Open socket.
+     * @param type Socket type: "udp" or "unix".
+     * @param address IP address (for UDP) or socket file path (for Unix).
+     * @param port UDP port. Not used for Unix sockets.
+     * @param isServer TRUE - bind socket to given address, FALSE - connect
+     * to given address (client socket).
+     * @return TRUE if socket open or FALSE if not.
+     */
+    bool open(std::string type, std::string address, int port, bool isServer);
+
+    /**
+     * @brief Close socket.
+     */
+    void close();
+
+    /**
+     * @brief Get socket open status.
+     * @return TRUE if socket open or FALSE.
+     */
+    bool isOpen();
+
+    /**
+     * @brief Send data to connected address (client socket).
+     * @param data Pointer to data.
+     * @param size Size of data.
+     * @return TRUE if data sent or FALSE if not.
+     */
+    bool send(const uint8_t* data, int size);
+
+    /**
+     * @brief Send data to given address (server socket).
+     * @param data Pointer to data.
+     * @param size Size of data.
+     * @param address Destination address.
+     * @return TRUE if data sent or FALSE if not.
+     */
+    bool sendTo(const uint8_t* data, int size,
+                const LensSocketAddress& address);
+
+    /**
+     * @brief Receive datagram.
+     * @param data Pointer to data buffer.
+     * @param bufferSize Data buffer size.
+     * @param timeoutMsec Wait timeout, msec.
+     * @param address Pointer to output source address. Can be nullptr.
+     * @return Size of received data, 0 if timeout or -1 in case errors.
+     */
+    int receive(uint8_t* data, int bufferSize, int timeoutMsec,
+                LensSocketAddress* address = nullptr);
+
+    /**
+     * @brief Parse init string "type;address;port;..." or "unix;path;...".
+     * @param initString Init string.
+     * @param type Output socket type: "udp" or "unix".
+     * @param address Output IP address or socket file path.
+     * @param port Output UDP port (0 for Unix sockets).
+     * @param extra Output rest of init string after address part.
+     * @return TRUE if init string parsed or FALSE if not.
+     */
+    static bool parseInitString(std::string initString, std::string& type,
+                                std::string& address, int& port,
+                                std::string& extra);
+
+private:
+
+#if defined(_WIN32)
+    /// Socket handle.
+    SOCKET m_socket{INVALID_SOCKET};
+#else
+    /// Socket handle.
+    int m_socket{-1};
+#endif
+    /// Own socket file path (Unix sockets) to delete on close.
+    std::string m_path{""};
+};
+}
+}
@@ -0,0 +1,209 @@
+#include <thread>
+#include <cstring>
+#include "LensStateHistory.h"
+
+
+
+/// Params which are interpolated between snapshots in order of LensParam
+/// enum: positions, focus factor, FOV and temperature.
+static const char g_interpolatedParams[] =
+        "11111100000000000000000000010000000000000110100000";
+
+
+
+float cr::lens::LensState::get(cr::lens::LensParam id) const
+{
+    if ((int)id < 1 || (int)id > 50)
+        return -1.0f;
+
+    return values[(int)id - 1];
+}
+
+
+
+void cr::lens::LensState::set(cr::lens::LensParam id, float value)
+{
+    if ((int)id < 1 || (int)id > 50)
+        return;
+
+    values[(int)id - 1] = value;
+}
+
+
+
+cr::lens::LensStateHistory::LensStateHistory(int capacity)
+{
+    // Power of two capacity.
+    m_capacity = 2;
+    while (m_capacity < (uint64_t)capacity)
+        m_capacity *= 2;
+    m_slots = new Slot[m_capacity];
+}
+
+
+
+cr::lens::LensStateHistory::~LensStateHistory()
+{
+    delete[] m_slots;
+}
+
+
+
+int cr::lens::LensStateHistory::getCapacity()
+{
+    return (int)m_capacity;
+}
+
+
+
+bool cr::lens::LensStateHistory::push(cr::lens::LensParams& params,
+                                      uint32_t timeMsec)
+{
+    LensState state;
+    state.timeMsec = timeMsec;
+    for (int i = 0; i < 50; ++i)
+        state.values[i] = params.getParamValue((LensParam)(i + 1));
+
+    return push(state);
+}
+
+
+
+bool cr::lens::LensStateHistory::push(const cr::lens::LensState& state)
+{
+    // Check time order.
+    uint64_t count = m_count.load(std::memory_order_relaxed);
+    if (count > 0 && (int32_t)(state.timeMsec - m_lastTime) < 0)
+        return false;
+
+    // Odd sequence while slot is changing.
+    Slot& slot = m_slots[count & (m_capacity - 1)];
+    uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.index = count;
+    memcpy(&slot.state, &state, sizeof(LensState));
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+
+    m_lastTime = state.timeMsec;
+    m_count.store(count + 1, std::memory_order_release);
+
+    return true;
+}
+
+
+
+bool cr::lens::LensStateHistory::get(uint32_t timeMsec,
+                                     cr::lens::LensState& state)
+{
+    LensState before, after;
+    while (true)
+    {
+        uint64_t count = m_count.load(std::memory_order_acquire);
+        if (count == 0)
+            return false;
+
+        // Oldest snapshot which is not overwritten by writer soon.
+        uint64_t first = count > m_capacity - 1 ? count - (m_capacity - 1) : 0;
+        uint64_t last = count - 1;
+
+        // Time after last snapshot.
+        if (!read(last, after))
+            continue;
+        if ((int32_t)(timeMsec - after.timeMsec) >= 0)
+        {
+            state = after;
+            state.timeMsec = timeMsec;
+            return true;
+        }
+
+        // Time before oldest snapshot.
+        if (!read(first, before))
+            continue;
+        if ((int32_t)(timeMsec - before.timeMsec) < 0)
+            return false;
+
+        // Binary search of last snapshot with time <= timeMsec.
+        uint64_t low = first;
+        uint64_t high = last;
+        bool isOverwritten = false;
+        while (high - low > 1)
+        {
+            uint64_t middle = low + (high - low) / 2;
+            LensState probe;
+            if (!read(middle, probe))
+            {
+                isOverwritten = true;
+                break;
+            }
+            if ((int32_t)(timeMsec - probe.timeMsec) >= 0)
+                low = middle;
+            else
+                high = middle;
+        }
+        if (isOverwritten || !read(low, before) || !read(high, after))
+            continue;
+
+        // Interpolate.
+        float k = 0.0f;
+        if (after.timeMsec != before.timeMsec)
+            k = (float)(int32_t)(timeMsec - before.timeMsec) /
+                (float)(int32_t)(after.timeMsec - before.timeMsec);
+        state = before;
+        state.timeMsec = timeMsec;
+        for (int i = 0; i < 50; ++i)
+            if (g_interpolatedParams[i] == '1')
+                state.values[i] += k * (after.values[i] - before.values[i]);
+
+        return true;
+    }
+}
+
+
+
+bool cr::lens::LensStateHistory::getLast(cr::lens::LensState& state)
+{
+    while (true)
+    {
+        uint64_t count = m_count.load(std::memory_order_acquire);
+        if (count == 0)
+            return false;
+        if (read(count - 1, state))
+            return true;
+    }
+}
+
+
+
+uint64_t cr::lens::LensStateHistory::getCount()
+{
+    return m_count.load(std::memory_order_acquire);
+}
+
+
+
+bool cr::lens::LensStateHistory::read(uint64_t index,
+                                      cr::lens::LensState& state)
+{
+    Slot& slot = m_slots[index & (m_capacity - 1)];
+    for (int i = 1; ; ++i)
+    {
+        // Let writer finish if it was preempted during update.
+        if ((i & 63) == 0)
+            std::this_thread::yield();
+
+        // Wait while writer changes slot.
+        uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if ((sequence & 1) != 0)
+            continue;
+
+        // Copy snapshot and check that slot was not changed.
+        uint64_t slotIndex = slot.index;
+        memcpy(&state, &slot.state, sizeof(LensState));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+
+        return slotIndex == index;
+    }
+}
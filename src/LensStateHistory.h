@@ -0,0 +1,142 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Timestamped snapshot of numeric lens params.
+class LensState
+{
+public:
+    /// Snapshot time, msec (LensParams::getTimeMsec()).
+    uint32_t timeMsec{0};
+    /// Param values. Index is (int)LensParam - 1.
+    float values[50]{};
+
+    /**
+     * @brief Get param value.
+     * @param id Param ID.
+     * @return Param value or -1 if param not exists.
+     */
+    float get(LensParam id) const;
+
+    /**
+     * @brief Set param value.
+     * @param id Param ID.
+     * @param value Param value.
+     */
+    void set(LensParam id, float value);
+};
+
+
+
+/**
+ * @brief Timestamp-indexed history of lens state. Fixed-memory ring of
+ * numeric lens params snapshots. One writer (lens controller) pushes
+ * snapshots in time order, any number of readers (video frame consumers)
+ * get lens state at arbitrary timestamp without locks: slots are protected
+ * by sequence counters and readers retry if slot was changed during read.
+ * Lookup by timestamp is binary search over ring, O(log n). Positions,
+ * FOV, focus factor and temperature are interpolated between two nearest
+ * snapshots, other params are taken from snapshot before timestamp.
+ */
+class LensStateHistory
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     * @param capacity Number of snapshots. Rounded up to power of two.
+     */
+    LensStateHistory(int capacity = 256);
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensStateHistory();
+
+    /**
+     * @brief Get capacity.
+     * @return Max number of snapshots in history.
+     */
+    int getCapacity();
+
+    /**
+     * @brief Push lens params snapshot. Must be called from one thread.
+     * @param params Lens params.
+     * @param timeMsec Snapshot time, msec. Must not be less than time of
+     * previous snapshot.
+     * @return TRUE if snapshot added or FALSE if time is out of order.
+     */
+    bool push(LensParams& params, uint32_t timeMsec);
+
+    /**
+     * @brief Push lens state snapshot. Must be called from one thread.
+     * @param state Lens state with snapshot time.
+     * @return TRUE if snapshot added or FALSE if time is out of order.
+     */
+    bool push(const LensState& state);
+
+    /**
+     * @brief Get lens state at given time. Time after last snapshot gets
+     * last snapshot. Lock-free.
+     * @param timeMsec Time, msec.
+     * @param state Output lens state. State time is equal to timeMsec.
+     * @return TRUE if state found or FALSE if history is empty or time is
+     * before the oldest snapshot.
+     */
+    bool get(uint32_t timeMsec, LensState& state);
+
+    /**
+     * @brief Get last snapshot. Lock-free.
+     * @param state Output lens state.
+     * @return TRUE if state found or FALSE if history is empty.
+     */
+    bool getLast(LensState& state);
+
+    /**
+     * @brief Get number of snapshots pushed since creation.
+     * @return Number of snapshots.
+     */
+    uint64_t getCount();
+
+private:
+
+    /// Ring slot.
+    struct Slot
+    {
+        /// Sequence counter. Odd while writer changes slot.
+        std::atomic<uint32_t> sequence{0};
+        /// Snapshot index.
+        uint64_t index{0};
+        /// Snapshot.
+        LensState state;
+    };
+
+    /// Ring slots.
+    Slot* m_slots{nullptr};
+    /// Ring capacity, power of two.
+    uint64_t m_capacity{0};
+    /// Number of pushed snapshots.
+    std::atomic<uint64_t> m_count{0};
+    /// Time of last snapshot.
+    uint32_t m_lastTime{0};
+
+    /**
+     * @brief Read slot.
+     * @param index Snapshot index.
+     * @param state Output snapshot.
+     * @return TRUE if snapshot read or FALSE if slot was overwritten.
+     */
+    bool read(uint64_t index, LensState& state);
+};
+}
+}
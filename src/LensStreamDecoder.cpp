@@ -0,0 +1,354 @@
+#include <cstring>
+#include "LensStreamDecoder.h"
+#include "LensVersion.h"
+
+
+
+/// Max lens data frame size (command response with lens params snapshot in
+/// compact profile with params ages).
+#define LENS_STREAM_MAX_FRAME_SIZE 348
+
+
+
+/// Min and max size of full params frame (LensParams::serialize(...)).
+#define LENS_STREAM_MIN_FULL_FRAME_SIZE 224
+#define LENS_STREAM_MAX_FULL_FRAME_SIZE 0x4000000
+
+
+
+/// Lens params field types in compact profile in order of mask bits:
+/// i - variable length integer, b - boolean (packed to flags byte),
+/// f - float, h - half precision float.
+static const char g_compactFieldTypes[] =
+        "iiiiiiiiiiiiiiiiiiiiiiiiiiifbihibiiiiiiiiffihbifff";
+
+
+
+cr::lens::LensStreamDecoder::LensStreamDecoder(int bufferSize)
+{
+    // Check buffer size.
+    if (bufferSize < 2 * LENS_STREAM_MAX_FRAME_SIZE)
+        bufferSize = 2 * LENS_STREAM_MAX_FRAME_SIZE;
+
+    m_bufferSize = bufferSize;
+    m_buffer.resize(m_bufferSize);
+}
+
+
+
+cr::lens::LensStreamDecoder::~LensStreamDecoder()
+{
+
+}
+
+
+
+int cr::lens::LensStreamDecoder::put(const uint8_t* data, int size)
+{
+    if (data == nullptr || size <= 0)
+        return 0;
+
+    // Get free space.
+    int freeSize = 0;
+    uint8_t* ptr = getWritePtr(freeSize);
+    if (size > freeSize)
+        size = freeSize;
+
+    memcpy(ptr, data, size);
+    m_writePos += size;
+
+    return size;
+}
+
+
+
+uint8_t* cr::lens::LensStreamDecoder::getWritePtr(int& freeSize)
+{
+    // Move unread data to the beginning if not enough space for one frame.
+    if (m_bufferSize - m_writePos < LENS_STREAM_MAX_FRAME_SIZE)
+        compact();
+
+    freeSize = m_bufferSize - m_writePos;
+
+    return &m_buffer[m_writePos];
+}
+
+
+
+void cr::lens::LensStreamDecoder::commit(int size)
+{
+    if (size <= 0)
+        return;
+
+    m_writePos += size;
+    if (m_writePos > m_bufferSize)
+        m_writePos = m_bufferSize;
+}
+
+
+
+bool cr::lens::LensStreamDecoder::next(cr::lens::LensStreamFrame& frame)
+{
+    while (m_readPos < m_writePos)
+    {
+        // Drop rest of frame which doesn't fit into buffer.
+        if (m_dropSize > 0)
+        {
+            int size = m_writePos - m_readPos;
+            if (size > m_dropSize)
+                size = m_dropSize;
+            m_readPos += size;
+            m_dropSize -= size;
+            m_skippedBytes += size;
+            continue;
+        }
+
+        // Check frame.
+        int frameSize = getFrameSize(&m_buffer[m_readPos],
+                                     m_writePos - m_readPos);
+
+        // Need more data.
+        if (frameSize == 0)
+        {
+            // Check if full params frame fits into buffer. Frame header and
+            // header of numeric params are already checked.
+            if (m_buffer[m_readPos] == 0x04 &&
+                m_writePos - m_readPos >= 17)
+            {
+                uint32_t size = 0;
+                memcpy(&size, &m_buffer[m_readPos + 3], 4);
+                if (size > (uint32_t)m_bufferSize)
+                {
+                    m_dropSize = (int)size;
+                    continue;
+                }
+            }
+            return false;
+        }
+
+        // Resynchronize.
+        if (frameSize < 0)
+        {
+            ++m_readPos;
+            ++m_skippedBytes;
+            continue;
+        }
+
+        // Return frame.
+        frame.type = (LensFrameType)m_buffer[m_readPos];
+        frame.data = &m_buffer[m_readPos];
+        frame.size = frameSize;
+        m_readPos += frameSize;
+
+        return true;
+    }
+
+    // All data processed.
+    m_readPos = 0;
+    m_writePos = 0;
+
+    return false;
+}
+
+
+
+void cr::lens::LensStreamDecoder::reset()
+{
+    m_readPos = 0;
+    m_writePos = 0;
+    m_dropSize = 0;
+    m_skippedBytes = 0;
+}
+
+
+
+int cr::lens::LensStreamDecoder::getSkippedBytes()
+{
+    return m_skippedBytes;
+}
+
+
+
+int cr::lens::LensStreamDecoder::getFrameSize(const uint8_t* data, int size)
+{
+    if (size < 1)
+        return 0;
+
+    // Check header.
+    if (data[0] > 0x07)
+        return -1;
+
+    // Check version.
+    if (size < 2)
+        return 0;
+    if (data[1] != LENS_MAJOR_VERSION)
+        return -1;
+    if (size < 3)
+        return 0;
+    if (data[2] != LENS_MINOR_VERSION)
+        return -1;
+
+    // Full params frame has size field.
+    if (data[0] == 0x04)
+    {
+        if (size < 7)
+            return 0;
+        uint32_t frameSize = 0;
+        memcpy(&frameSize, &data[3], 4);
+        if (frameSize < LENS_STREAM_MIN_FULL_FRAME_SIZE ||
+            frameSize > LENS_STREAM_MAX_FULL_FRAME_SIZE)
+            return -1;
+
+        // Full params frame starts with all numeric params (params frame
+        // with all mask bits set and without ages). Checked before frame
+        // size is trusted, so corrupted data doesn't start long drop.
+        if (size < 17)
+            return 0;
+        if (data[7] != 0x02 || data[8] != LENS_MAJOR_VERSION ||
+            data[9] != LENS_MINOR_VERSION || data[16] != 0xC0)
+            return -1;
+        for (int i = 10; i < 16; ++i)
+            if (data[i] != 0xFF)
+                return -1;
+
+        return size < (int)frameSize ? 0 : (int)frameSize;
+    }
+
+    // Command response with optional params snapshot.
+    if (data[0] == 0x05)
+    {
+        if (size < 14)
+            return 0;
+        if (data[3] > 0x01 || data[8] > 0x01 || data[13] > 0x01)
+            return -1;
+        if (data[13] == 0x00)
+            return 14;
+        if (size < 15)
+            return 0;
+        if (data[14] != 0x02 && data[14] != 0x03)
+            return -1;
+        int paramsSize = getFrameSize(&data[14], size - 14);
+        return paramsSize <= 0 ? paramsSize : 14 + paramsSize;
+    }
+
+    // Subscribe command has fixed size.
+    if (data[0] == 0x06)
+    {
+        if (size < 15)
+            return 0;
+        if ((data[9] & (uint8_t)0x1F) != 0 || data[14] > 0x01)
+            return -1;
+        return 15;
+    }
+
+    // Sequence number has fixed size.
+    if (data[0] == 0x07)
+        return size < 7 ? 0 : 7;
+
+    // Command and set param command have fixed size.
+    if (data[0] == 0x00 || data[0] == 0x01)
+    {
+        if (size < 11)
+            return 0;
+
+        // Check ID.
+        int id = 0;
+        memcpy(&id, &data[3], 4);
+        if (data[0] == 0x00 &&
+            (id < (int)LensCommand::ZOOM_TELE ||
+             id > (int)LensCommand::ZOOM_AT_MAGNIFICATION_RATE))
+            return -1;
+        if (data[0] == 0x01 && (id < (int)LensParam::ZOOM_POS ||
+                                id > (int)LensParam::CUSTOM_3))
+            return -1;
+
+        return 11;
+    }
+
+    // Lens params. Size depends on mask.
+    if (size < 10)
+        return 0;
+
+    // Only two bits and timestamps flag used in last byte of mask.
+    if ((data[9] & (uint8_t)0x1F) != 0)
+        return -1;
+
+    // Params ages (2 bytes per param) appended if timestamps flag set.
+    int agesSize = 0;
+    if ((data[9] & (uint8_t)0x20) != 0)
+        for (int i = 0; i < 50; ++i)
+            if ((data[3 + i / 8] & (uint8_t)(128 >> (i % 8))) != 0)
+                agesSize += 2;
+
+    // Lens params in compact profile.
+    if (data[0] == 0x03)
+    {
+        int pos = 10;
+        // Flags byte for boolean fields.
+        if ((data[6] & (uint8_t)8) != 0 || (data[7] & (uint8_t)128) != 0 ||
+            (data[8] & (uint8_t)4) != 0)
+            pos += 1;
+        for (int i = 0; i < 50; ++i)
+        {
+            if ((data[3 + i / 8] & (uint8_t)(128 >> (i % 8))) == 0)
+                continue;
+            switch (g_compactFieldTypes[i])
+            {
+            case 'f': pos += 4; break;
+            case 'h': pos += 2; break;
+            case 'i':
+            {
+                // Skip variable length integer (max 5 bytes).
+                int n = 0;
+                while (true)
+                {
+                    if (pos >= size)
+                        return 0;
+                    if (++n > 5)
+                        return -1;
+                    if ((data[pos++] & (uint8_t)0x80) == 0)
+                        break;
+                }
+                break;
+            }
+            default: break;
+            }
+        }
+
+        pos += agesSize;
+        return size < pos ? 0 : pos;
+    }
+
+    // Count fields. Fields isConnected, afIsActive and isOpen have 1 byte.
+    int frameSize = 10 + agesSize;
+    for (int i = 3; i < 10; ++i)
+    {
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            if ((data[i] & (uint8_t)(1 << bit)) == 0 || (i == 9 && bit == 5))
+                continue;
+            if ((i == 6 && bit == 3) || (i == 7 && bit == 7) ||
+                (i == 8 && bit == 2))
+                frameSize += 1;
+            else
+                frameSize += 4;
+        }
+    }
+
+    return size < frameSize ? 0 : frameSize;
+}
+
+
+
+void cr::lens::LensStreamDecoder::compact()
+{
+    if (m_readPos == 0)
+        return;
+
+    // Only tail of incomplete frame has to be moved.
+    int size = m_writePos - m_readPos;
+    if (size > 0)
+        memmove(m_buffer.data(), &m_buffer[m_readPos], size);
+    m_readPos = 0;
+    m_writePos = size;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Lens data frame types. Values equal to first (header) byte of frame.
+enum class LensFrameType
+{
+    /// Command. Decoded by Lens::decodeCommand(...).
+    COMMAND = 0x00,
+    /// Set param command. Decoded by Lens::decodeCommand(...).
+    SET_PARAM = 0x01,
+    /// Lens params. Decoded by LensParams::decode(...).
+    PARAMS = 0x02,
+    /// Lens params in compact profile. Decoded by LensParams::decode(...).
+    COMPACT_PARAMS = 0x03,
+    /// All lens params including initString and fovPoints. Decoded by
+    /// LensParams::deserialize(...). Frames which don't fit into decoder
+    /// buffer are skipped.
+    FULL_PARAMS = 0x04,
+    /// Command response. Decoded by Lens::decodeResponse(...).
+    RESPONSE = 0x05,
+    /// Subscribe command. Decoded by Lens::decodeSubscribeCommand(...).
+    SUBSCRIBE = 0x06,
+    /// Request sequence number. Decoded by Lens::decodeSequence(...).
+    SEQUENCE = 0x07
+};
+
+
+
+/// Lens stream frame class.
+class LensStreamFrame
+{
+public:
+    /// Frame type.
+    LensFrameType type{LensFrameType::COMMAND};
+    /// Pointer to frame data inside decoder buffer. Valid until next
+    /// put(...) or getWritePtr(...) call.
+    uint8_t* data{nullptr};
+    /// Frame size, bytes.
+    int size{0};
+};
+
+
+
+/**
+ * @brief Lens stream decoder. Splits byte stream (TCP, serial port etc.)
+ * which carries back-to-back commands and lens params frames into separate
+ * frames. Decoder accepts data chunks of any size, resynchronizes on frame
+ * headers and version bytes and returns frames in place from internal
+ * buffer without copying.
+ */
+class LensStreamDecoder
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     * @param bufferSize Internal buffer size. Must be >= 2 * max frame size,
+     * otherwise will be increased automatically.
+     */
+    LensStreamDecoder(int bufferSize = 4096);
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensStreamDecoder();
+
+    /**
+     * @brief Put data chunk to decoder.
+     * @param data Pointer to data.
+     * @param size Size of data.
+     * @return Number of bytes accepted. Can be less than size if internal
+     * buffer is full. In this case user should call next(...) method to get
+     * frames and put rest of data again.
+     */
+    int put(const uint8_t* data, int size);
+
+    /**
+     * @brief Get pointer to free space of internal buffer to write data
+     * directly (for example, from socket) without intermediate copy. After
+     * writing user must call commit(...) method.
+     * @param freeSize Output size of free space.
+     * @return Pointer to free space.
+     */
+    uint8_t* getWritePtr(int& freeSize);
+
+    /**
+     * @brief Commit data written to the pointer returned by getWritePtr(...).
+     * @param size Number of bytes written.
+     */
+    void commit(int size);
+
+    /**
+     * @brief Get next frame.
+     * @param frame Output frame. Frame data points to internal buffer.
+     * @return TRUE if frame available or FALSE if more data required.
+     */
+    bool next(LensStreamFrame& frame);
+
+    /**
+     * @brief Reset decoder. Drops all buffered data.
+     */
+    void reset();
+
+    /**
+     * @brief Get number of bytes skipped during resynchronization.
+     * @return Number of bytes skipped.
+     */
+    int getSkippedBytes();
+
+    /**
+     * @brief Check frame at the beginning of data and get frame size.
+     * @param data Pointer to data.
+     * @param size Size of data.
+     * @return Frame size, 0 if more data required or -1 if data doesn't
+     * start with valid frame.
+     */
+    static int getFrameSize(const uint8_t* data, int size);
+
+private:
+
+    /// Internal buffer.
+    std::vector<uint8_t> m_buffer;
+    /// Internal buffer size.
+    int m_bufferSize{0};
+    /// Read position.
+    int m_readPos{0};
+    /// Write position.
+    int m_writePos{0};
+    /// Number of skipped bytes.
+    int m_skippedBytes{0};
+    /// Number of bytes to drop (rest of frame which doesn't fit into buffer).
+    int m_dropSize{0};
+
+    /**
+     * @brief Move unread data to the beginning of internal buffer.
+     */
+    void compact();
+};
+}
+}
@@ -0,0 +1,171 @@
+#include <cstring>
+#include <cstddef>
+#include "LensSubscription.h"
+
+
+
+cr::lens::LensSubscription::LensSubscription()
+{
+    memset((void*)&m_mask, 0, sizeof(LensParamsMask));
+}
+
+
+
+cr::lens::LensSubscription::~LensSubscription()
+{
+
+}
+
+
+
+bool cr::lens::LensSubscription::subscribe(uint8_t* data, int size)
+{
+    // Decode command.
+    LensParamsMask mask;
+    float maxRateHz = 0.0f;
+    bool compact = false;
+    if (!Lens::decodeSubscribeCommand(data, size, mask, maxRateHz, compact))
+        return false;
+
+    subscribe(mask, maxRateHz, compact);
+
+    return true;
+}
+
+
+
+void cr::lens::LensSubscription::subscribe(cr::lens::LensParamsMask& mask,
+                                           float maxRateHz,
+                                           bool compact)
+{
+    m_mask = mask;
+    m_maxRateHz = maxRateHz < 0.0f ? 0.0f : maxRateHz;
+    m_compact = compact;
+
+    // Check if at least one param is masked.
+    m_isActive = hasParams(m_mask);
+
+    reset();
+}
+
+
+
+void cr::lens::LensSubscription::unsubscribe()
+{
+    memset((void*)&m_mask, 0, sizeof(LensParamsMask));
+    m_isActive = false;
+    reset();
+}
+
+
+
+bool cr::lens::LensSubscription::isActive()
+{
+    return m_isActive;
+}
+
+
+
+cr::lens::LensParamsMask cr::lens::LensSubscription::getMask()
+{
+    return m_mask;
+}
+
+
+
+float cr::lens::LensSubscription::getMaxRate()
+{
+    return m_maxRateHz;
+}
+
+
+
+bool cr::lens::LensSubscription::isCompact()
+{
+    return m_compact;
+}
+
+
+
+bool cr::lens::LensSubscription::update(cr::lens::LensParams& params,
+                                        uint8_t* data,
+                                        int bufferSize,
+                                        int& size)
+{
+    size = 0;
+    if (!m_isActive)
+        return false;
+
+    // Check min update interval.
+    std::chrono::steady_clock::time_point now =
+            std::chrono::steady_clock::now();
+    if (m_maxRateHz > 0.0f && m_lastSize > 0 &&
+        std::chrono::duration<float>(now - m_lastTime).count() <
+        1.0f / m_maxRateHz)
+        return false;
+
+    // Encode params.
+    int encodedSize = 0;
+    if (m_compact)
+    {
+        if (!params.encodeCompact(data, bufferSize, encodedSize, &m_mask))
+            return false;
+    }
+    else
+    {
+        if (!params.encode(data, bufferSize, encodedSize, &m_mask))
+            return false;
+    }
+
+    // Check changes.
+    int valuesSize = encodedSize - getAgesSize(data);
+    if (valuesSize == m_lastSize && memcmp(data, m_lastData, valuesSize) == 0)
+        return false;
+
+    // Remember sent data.
+    if (valuesSize <= (int)sizeof(m_lastData))
+    {
+        memcpy(m_lastData, data, valuesSize);
+        m_lastSize = valuesSize;
+    }
+    m_lastTime = now;
+    size = encodedSize;
+
+    return true;
+}
+
+
+
+void cr::lens::LensSubscription::reset()
+{
+    m_lastSize = 0;
+}
+
+
+
+int cr::lens::LensSubscription::getAgesSize(const uint8_t* data)
+{
+    if ((data[9] & (uint8_t)0x20) == 0)
+        return 0;
+
+    // 2 bytes per masked param.
+    int size = 0;
+    for (int i = 0; i < 50; ++i)
+        if ((data[3 + i / 8] & (uint8_t)(128 >> (i % 8))) != 0)
+            size += 2;
+
+    return size;
+}
+
+
+
+bool cr::lens::LensSubscription::hasParams(const cr::lens::LensParamsMask& mask)
+{
+    // Param fields are placed before timestamps flag.
+    const uint8_t* ptr = (const uint8_t*)&mask;
+    for (size_t i = 0; i < offsetof(LensParamsMask, timestamps); ++i)
+        if (ptr[i] != 0)
+            return true;
+
+    return false;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/**
+ * @brief Lens params subscription. Keeps params mask and max update rate
+ * registered by remote client (by subscribe command) on lens controller side
+ * and encodes params only when masked values change. Not thread-safe, each
+ * client connection should have own subscription object.
+ */
+class LensSubscription
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    LensSubscription();
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensSubscription();
+
+    /**
+     * @brief Subscribe by command encoded by Lens::encodeSubscribeCommand(...).
+     * @param data Pointer to command data.
+     * @param size Size of data.
+     * @return TRUE if command decoded or FALSE if not.
+     */
+    bool subscribe(uint8_t* data, int size);
+
+    /**
+     * @brief Subscribe.
+     * @param mask Params mask. If all fields are false subscription cancelled.
+     * @param maxRateHz Max update rate, Hz. 0 - no limit.
+     * @param compact Use compact profile (LensParams::encodeCompact(...)).
+     */
+    void subscribe(LensParamsMask& mask, float maxRateHz,
+                   bool compact = false);
+
+    /**
+     * @brief Cancel subscription.
+     */
+    void unsubscribe();
+
+    /**
+     * @brief Get subscription status.
+     * @return TRUE if subscription active or FALSE.
+     */
+    bool isActive();
+
+    /**
+     * @brief Get subscription params mask.
+     * @return Params mask.
+     */
+    LensParamsMask getMask();
+
+    /**
+     * @brief Get max update rate.
+     * @return Max update rate, Hz. 0 - no limit.
+     */
+    float getMaxRate();
+
+    /**
+     * @brief Get compact profile flag.
+     * @return TRUE if params encoded in compact profile or FALSE.
+     */
+    bool isCompact();
+
+    /**
+     * @brief Encode params if masked values changed since last update and
+     * min update interval elapsed. Changes which come too early are not lost:
+     * they will be encoded by next update call after interval elapsed.
+     * @param params Current lens params.
+     * @param data Pointer to data buffer. Must have size >= 334.
+     * @param bufferSize Data buffer size.
+     * @param size Size of encoded data. 0 if nothing to send.
+     * @return TRUE if params encoded and have to be sent or FALSE.
+     */
+    bool update(LensParams& params, uint8_t* data, int bufferSize, int& size);
+
+    /**
+     * @brief Force next update to encode params even if values not changed
+     * (for example, after client reconnection).
+     */
+    void reset();
+
+    /**
+     * @brief Get size of params ages appended to encoded params. Ages change
+     * all the time, so they are not used to detect params changes.
+     * @param data Pointer to params encoded by LensParams::encode(...) or
+     * LensParams::encodeCompact(...) method.
+     * @return Size of ages at the end of data, bytes.
+     */
+    static int getAgesSize(const uint8_t* data);
+
+    /**
+     * @brief Check if mask has at least one param. Flags which don't select
+     * params (timestamps) are not checked.
+     * @param mask Params mask.
+     * @return TRUE if at least one param is masked or FALSE if not.
+     */
+    static bool hasParams(const LensParamsMask& mask);
+
+private:
+
+    /// Params mask.
+    LensParamsMask m_mask;
+    /// Max update rate, Hz.
+    float m_maxRateHz{0.0f};
+    /// Compact profile flag.
+    bool m_compact{false};
+    /// Subscription status.
+    bool m_isActive{false};
+    /// Last sent data without params ages.
+    uint8_t m_lastData[512];
+    /// Last sent data size.
+    int m_lastSize{0};
+    /// Last update time.
+    std::chrono::steady_clock::time_point m_lastTime;
+};
+}
+}
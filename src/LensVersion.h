@@ -1,7 +1,7 @@
 #pragma once
 
 #define LENS_MAJOR_VERSION 4
-#define LENS_MINOR_VERSION 4
-#define LENS_PATCH_VERSION 4
+#define LENS_MINOR_VERSION 5
+#define LENS_PATCH_VERSION 0
 
-#define LENS_VERSION "4.4.4"
+#define LENS_VERSION "4.5.0"
@@ -0,0 +1,162 @@
+#include <cmath>
+#include <algorithm>
+#include "LensZoomRate.h"
+
+
+
+/// Pi.
+#define LENS_ZOOM_RATE_PI 3.14159265358979323846
+
+
+
+cr::lens::LensZoomRate::LensZoomRate()
+{
+
+}
+
+
+
+cr::lens::LensZoomRate::~LensZoomRate()
+{
+
+}
+
+
+
+void cr::lens::LensZoomRate::setParams(const cr::lens::LensParams& params)
+{
+    // Sort points by hardware zoom position.
+    std::vector<FovPoint> sorted = params.fovPoints;
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const FovPoint& a, const FovPoint& b)
+                     { return a.hwZoomPos < b.hwZoomPos; });
+
+    // Average points with the same hardware zoom position.
+    std::vector<float> pos;
+    std::vector<float> fov;
+    size_t i = 0;
+    while (i < sorted.size())
+    {
+        size_t j = i;
+        double sum = 0.0;
+        while (j < sorted.size() && sorted[j].hwZoomPos == sorted[i].hwZoomPos)
+            sum += sorted[j++].xFovDeg;
+        pos.push_back((float)sorted[i].hwZoomPos);
+        fov.push_back((float)(sum / (double)(j - i)));
+        i = j;
+    }
+
+    // Derivatives of segments. FOV is linear inside segment (the same as in
+    // LensFovTable), so rate is exact for reported FOV.
+    std::vector<float> fovSlope;
+    std::vector<float> logTanSlope;
+    for (i = 0; i + 1 < pos.size(); ++i)
+    {
+        const double d = pos[i + 1] - pos[i];
+        const double logTan1 = std::log(std::tan(fov[i] *
+                                                 LENS_ZOOM_RATE_PI / 360.0));
+        const double logTan2 = std::log(std::tan(fov[i + 1] *
+                                                 LENS_ZOOM_RATE_PI / 360.0));
+        fovSlope.push_back((float)(std::fabs(fov[i + 1] - fov[i]) / d));
+        logTanSlope.push_back((float)(std::fabs(logTan2 - logTan1) / d));
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_hwZoomPos.swap(pos);
+    m_fovSlope.swap(fovSlope);
+    m_logTanSlope.swap(logTanSlope);
+    m_hwMaxSpeed = params.zoomHwMaxSpeed < 1 ? 1 : params.zoomHwMaxSpeed;
+    m_isActive = false;
+    m_segment = 0;
+}
+
+
+
+void cr::lens::LensZoomRate::setSpeedGain(float gain)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_gain = gain > 0.0f ? gain : 0.0f;
+}
+
+
+
+bool cr::lens::LensZoomRate::start(cr::lens::LensCommand id, float arg)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if ((id != LensCommand::ZOOM_AT_FOV_RATE &&
+         id != LensCommand::ZOOM_AT_MAGNIFICATION_RATE) ||
+        m_hwZoomPos.size() < 2 || m_gain <= 0.0f || arg == 0.0f)
+        return false;
+
+    m_command = id;
+    m_rate = std::fabs(arg);
+    m_direction = arg > 0.0f ? 1 : -1;
+    m_lastSpeed = -1;
+    m_isActive = true;
+
+    return true;
+}
+
+
+
+void cr::lens::LensZoomRate::stop()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isActive = false;
+}
+
+
+
+bool cr::lens::LensZoomRate::isActive()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_isActive;
+}
+
+
+
+int cr::lens::LensZoomRate::getDirection()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_isActive ? m_direction : 0;
+}
+
+
+
+bool cr::lens::LensZoomRate::update(float hwZoomPos, int& hwSpeed)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_isActive)
+        return false;
+
+    // Move segment from previous position.
+    const size_t last = m_hwZoomPos.size() - 2;
+    m_segment = m_segment > last ? last : m_segment;
+    while (m_segment > 0 && hwZoomPos < m_hwZoomPos[m_segment])
+        --m_segment;
+    while (m_segment < last && hwZoomPos > m_hwZoomPos[m_segment + 1])
+        ++m_segment;
+
+    // Derivative of segment.
+    const float slope = m_command == LensCommand::ZOOM_AT_FOV_RATE ?
+                        m_fovSlope[m_segment] : m_logTanSlope[m_segment];
+
+    // Hardware speed for rate.
+    int speed = m_hwMaxSpeed;
+    if (slope > 0.0f)
+    {
+        const float value = m_rate / slope / m_gain;
+        speed = value < (float)m_hwMaxSpeed ? (int)std::lround(value) :
+                                              m_hwMaxSpeed;
+        speed = speed < 1 ? 1 : speed;
+    }
+    hwSpeed = speed;
+    if (speed == m_lastSpeed)
+        return false;
+    m_lastSpeed = speed;
+
+    return true;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <mutex>
+#include <vector>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/**
+ * @brief Constant rate zoom controller. ZOOM_TELE and ZOOM_WIDE commands with
+ * fixed speed change field of view with varying rate because FOV is
+ * nonlinear in hardware zoom position. Controller calculates hardware zoom
+ * speed for current zoom position, so horizontal FOV changes with constant
+ * rate (ZOOM_AT_FOV_RATE command) or magnification changes with constant
+ * rate (ZOOM_AT_MAGNIFICATION_RATE command). Lens controller starts zoom to
+ * tele or wide (by sign of command argument) and on each control tick calls
+ * update(...) with current hardware zoom position and sends returned speed
+ * (ZOOM_HW_SPEED) if it changed. Derivatives of FOV by zoom position are
+ * calculated for each segment between FOV points once in setParams(...)
+ * (FOV is linear inside segment as in LensFovTable), table segment of zoom
+ * position is tracked from previous tick, so update takes O(1) for
+ * continuous motion. Class is thread-safe.
+ */
+class LensZoomRate
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    LensZoomRate();
+
+    /**
+     * @brief Class destructor.
+     */
+    ~LensZoomRate();
+
+    /**
+     * @brief Set lens params: FOV points and max hardware zoom speed. Stops
+     * constant rate zoom.
+     * @param params Lens params.
+     */
+    void setParams(const LensParams& params);
+
+    /**
+     * @brief Set zoom speed gain.
+     * @param gain Hardware zoom position units per second per hardware speed
+     * unit (ZOOM_HW_SPEED).
+     */
+    void setSpeedGain(float gain);
+
+    /**
+     * @brief Start constant rate zoom.
+     * @param id Command ID: ZOOM_AT_FOV_RATE or ZOOM_AT_MAGNIFICATION_RATE.
+     * @param arg Command argument: FOV change rate, degree/second, or
+     * magnification rate, 1/second. Positive - zoom to tele, negative - zoom
+     * to wide.
+     * @return TRUE if zoom started or FALSE if command is not constant rate
+     * zoom, there are no FOV points or speed gain is not set.
+     */
+    bool start(LensCommand id, float arg);
+
+    /**
+     * @brief Stop constant rate zoom (any other zoom command).
+     */
+    void stop();
+
+    /**
+     * @brief Check if constant rate zoom is active.
+     * @return TRUE if zoom is active or FALSE.
+     */
+    bool isActive();
+
+    /**
+     * @brief Get zoom direction of active zoom.
+     * @return 1 - tele, -1 - wide, 0 - zoom is not active.
+     */
+    int getDirection();
+
+    /**
+     * @brief Calculate hardware zoom speed for current position.
+     * @param hwZoomPos Current hardware zoom position.
+     * @param hwSpeed Output hardware zoom speed (1 - ZOOM_HW_MAX_SPEED).
+     * @return TRUE if speed changed since last update and must be sent to
+     * lens or FALSE if speed is the same or zoom is not active.
+     */
+    bool update(float hwZoomPos, int& hwSpeed);
+
+private:
+
+    /// Hardware zoom positions of points in ascending order.
+    std::vector<float> m_hwZoomPos;
+    /// Abs derivative of horizontal FOV by zoom position for segments,
+    /// degree/unit.
+    std::vector<float> m_fovSlope;
+    /// Abs derivative of log of tan(FOV / 2) by zoom position for segments,
+    /// 1/unit.
+    std::vector<float> m_logTanSlope;
+    /// Max hardware zoom speed.
+    int m_hwMaxSpeed{50};
+    /// Speed gain, units per second per speed unit. 0 - unknown.
+    float m_gain{0.0f};
+    /// Active command: ZOOM_AT_FOV_RATE or ZOOM_AT_MAGNIFICATION_RATE.
+    LensCommand m_command{LensCommand::ZOOM_STOP};
+    /// Zoom is active.
+    bool m_isActive{false};
+    /// Absolute rate.
+    float m_rate{0.0f};
+    /// Zoom direction: 1 - tele, -1 - wide.
+    int m_direction{0};
+    /// Table segment of last position.
+    size_t m_segment{0};
+    /// Last returned speed, -1 if not returned.
+    int m_lastSpeed{-1};
+    /// Mutex.
+    std::mutex m_mutex;
+};
+}
+}
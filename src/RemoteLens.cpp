@@ -0,0 +1,314 @@
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include "RemoteLens.h"
+#include "LensStreamDecoder.h"
+
+
+
+cr::lens::RemoteLens::RemoteLens()
+{
+
+}
+
+
+
+cr::lens::RemoteLens::~RemoteLens()
+{
+    closeLens();
+}
+
+
+
+bool cr::lens::RemoteLens::openLens(std::string initString)
+{
+    closeLens();
+
+    // Parse init string.
+    std::string type, address, extra;
+    int port = 0;
+    if (!LensSocket::parseInitString(initString, type, address, port, extra))
+        return false;
+    float maxRateHz = 0.0f;
+    m_timeoutMsec = 1000;
+    std::istringstream stream(extra);
+    std::string item;
+    try
+    {
+        if (std::getline(stream, item, ';') && !item.empty())
+            maxRateHz = std::stof(item);
+        if (std::getline(stream, item, ';') && !item.empty())
+            m_timeoutMsec = std::stoi(item);
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    // Open socket.
+    if (!m_socket.open(type, address, port, false))
+        return false;
+
+    // Subscribe command for all params with ages. Receive thread renews
+    // subscription with the same command.
+    LensParamsMask mask;
+    mask.timestamps = true;
+    encodeSubscribeCommand(m_subscribeCommand, m_subscribeCommandSize, &mask,
+                           maxRateHz, true);
+
+    // Start receive thread.
+    {
+        std::lock_guard<std::mutex> lock(m_paramsMutex);
+        m_params = LensParams();
+        m_params.initString = initString;
+    }
+    m_updatesCount.store(0);
+    m_stopFlag.store(false);
+    m_thread = std::thread(&RemoteLens::receive, this);
+
+    // Subscribe.
+    if (!m_socket.send(m_subscribeCommand, m_subscribeCommandSize))
+    {
+        closeLens();
+        return false;
+    }
+
+    return true;
+}
+
+
+
+bool cr::lens::RemoteLens::initLens(cr::lens::LensParams& params)
+{
+    return openLens(params.initString);
+}
+
+
+
+void cr::lens::RemoteLens::closeLens()
+{
+    if (!m_socket.isOpen())
+        return;
+
+    // Cancel subscription.
+    uint8_t data[15];
+    int size = 0;
+    encodeSubscribeCommand(data, size, nullptr, 0.0f);
+    m_socket.send(data, size);
+
+    // Stop receive thread.
+    m_stopFlag.store(true);
+    if (m_thread.joinable())
+        m_thread.join();
+    m_socket.close();
+}
+
+
+
+bool cr::lens::RemoteLens::isLensOpen()
+{
+    return m_socket.isOpen();
+}
+
+
+
+bool cr::lens::RemoteLens::isLensConnected()
+{
+    std::lock_guard<std::mutex> lock(m_paramsMutex);
+    return m_params.isConnected;
+}
+
+
+
+bool cr::lens::RemoteLens::setParam(cr::lens::LensParam id, float value)
+{
+    uint8_t data[11];
+    int size = 0;
+    encodeSetParamCommand(data, size, id, value);
+    return decodeAndExecuteCommand(data, size);
+}
+
+
+
+float cr::lens::RemoteLens::getParam(cr::lens::LensParam id)
+{
+    std::lock_guard<std::mutex> lock(m_paramsMutex);
+    return m_params.getParamValue(id);
+}
+
+
+
+void cr::lens::RemoteLens::getParams(cr::lens::LensParams& params)
+{
+    std::lock_guard<std::mutex> lock(m_paramsMutex);
+    params = m_params;
+}
+
+
+
+bool cr::lens::RemoteLens::executeCommand(cr::lens::LensCommand id, float arg)
+{
+    uint8_t data[11];
+    int size = 0;
+    encodeCommand(data, size, id, arg);
+    return decodeAndExecuteCommand(data, size);
+}
+
+
+
+void cr::lens::RemoteLens::addVideoFrame(cr::video::Frame& frame)
+{
+
+}
+
+
+
+bool cr::lens::RemoteLens::decodeAndExecuteCommand(uint8_t* data, int size)
+{
+    // Get command type and ID to match response.
+    LensCommand commandId = LensCommand::ZOOM_TELE;
+    LensParam paramId = LensParam::ZOOM_SPEED;
+    float value = 0.0f;
+    int type = decodeCommand(data, size, paramId, commandId, value);
+    if (type < 0 || !m_socket.isOpen())
+        return false;
+
+    // One request at a time.
+    std::lock_guard<std::mutex> requestLock(m_requestMutex);
+
+    // Request: sequence number and command in one datagram.
+    uint8_t request[18];
+    int sequenceSize = 0;
+    encodeSequence(request, sequenceSize, ++m_sequence);
+    memcpy(&request[sequenceSize], data, size);
+
+    std::unique_lock<std::mutex> lock(m_responseMutex);
+    m_responseType = type;
+    m_responseId = type == 0 ? (int)commandId : (int)paramId;
+    m_responseSequence = m_sequence;
+    m_hasResponse = false;
+    m_responseStatus = false;
+
+    // Send command and wait response.
+    if (!m_socket.send(request, sequenceSize + size))
+    {
+        m_responseType = -1;
+        return false;
+    }
+    bool result = m_responseCond.wait_for(
+                lock, std::chrono::milliseconds(m_timeoutMsec),
+                [this]{ return m_hasResponse; });
+    m_responseType = -1;
+
+    return result && m_responseStatus;
+}
+
+
+
+int64_t cr::lens::RemoteLens::getUpdatesCount()
+{
+    return m_updatesCount.load();
+}
+
+
+
+void cr::lens::RemoteLens::receive()
+{
+    LensStreamDecoder decoder;
+    LensStreamFrame frame;
+    uint8_t data[4096];
+    std::chrono::steady_clock::time_point renewTime =
+            std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(REMOTE_LENS_RENEW_PERIOD_MSEC);
+
+    while (!m_stopFlag.load())
+    {
+        // Renew subscription.
+        std::chrono::steady_clock::time_point now =
+                std::chrono::steady_clock::now();
+        if (now >= renewTime)
+        {
+            m_socket.send(m_subscribeCommand, m_subscribeCommandSize);
+            renewTime = now + std::chrono::milliseconds(
+                        REMOTE_LENS_RENEW_PERIOD_MSEC);
+        }
+
+        // Wait datagram. Timeout to check stop flag.
+        int size = m_socket.receive(data, (int)sizeof(data), 100);
+        if (size <= 0)
+        {
+            if (size < 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        // Process frames.
+        decoder.reset();
+        decoder.put(data, size);
+        bool hasSequence = false;
+        uint32_t sequence = 0;
+        while (decoder.next(frame))
+        {
+            switch (frame.type)
+            {
+            case LensFrameType::SEQUENCE:
+                hasSequence = decodeSequence(frame.data, frame.size, sequence);
+                break;
+            case LensFrameType::PARAMS:
+            case LensFrameType::COMPACT_PARAMS:
+            {
+                // Decoding clears initialization string, keep it for
+                // initLens(...) with params from getParams(...).
+                std::lock_guard<std::mutex> lock(m_paramsMutex);
+                std::string initString;
+                initString.swap(m_params.initString);
+                if (m_params.decode(frame.data, frame.size))
+                    ++m_updatesCount;
+                m_params.initString.swap(initString);
+                break;
+            }
+            case LensFrameType::RESPONSE:
+            {
+                // Decode response without params snapshot.
+                LensCommand commandId = LensCommand::ZOOM_TELE;
+                LensParam paramId = LensParam::ZOOM_SPEED;
+                bool status = false;
+                float value = 0.0f;
+                int type = decodeResponse(frame.data, frame.size, paramId,
+                                          commandId, status, value);
+                bool isCurrent = hasSequence;
+                hasSequence = false;
+                if (type < 0 || !isCurrent)
+                    break;
+
+                // Check that response matches waiting request. Late response
+                // to timed out request is dropped with its params snapshot.
+                int id = type == 0 ? (int)commandId : (int)paramId;
+                std::unique_lock<std::mutex> lock(m_responseMutex);
+                if (type != m_responseType || id != m_responseId ||
+                    sequence != m_responseSequence)
+                    break;
+
+                // Decode params snapshot.
+                {
+                    std::lock_guard<std::mutex> paramsLock(m_paramsMutex);
+                    std::string initString;
+                    initString.swap(m_params.initString);
+                    decodeResponse(frame.data, frame.size, paramId, commandId,
+                                   status, value, &m_params);
+                    m_params.initString.swap(initString);
+                }
+
+                // Wake up waiting request.
+                m_hasResponse = true;
+                m_responseStatus = status;
+                lock.unlock();
+                m_responseCond.notify_one();
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <condition_variable>
+#include "Lens.h"
+#include "LensSocket.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Subscription renewal period, msec. Must be several times shorter than
+/// subscription lease of LensServer.
+#define REMOTE_LENS_RENEW_PERIOD_MSEC 1000
+
+
+
+/**
+ * @brief Remote lens. Implements Lens interface over UDP or Unix domain
+ * datagram sockets connected to LensServer. Commands wait for server
+ * response. Params are read from local cache which is updated by params
+ * subscription and by params snapshot in command responses, so getParam(...)
+ * and getParams(...) methods don't make network requests. Requests carry
+ * sequence number, so late response to timed out request is not taken as
+ * response to next request. Subscription is
+ * renewed every REMOTE_LENS_RENEW_PERIOD_MSEC to keep server lease.
+ */
+class RemoteLens: public Lens
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    RemoteLens();
+
+    /**
+     * @brief Class destructor. Closes connection.
+     */
+    ~RemoteLens();
+
+    /**
+     * @brief Open connection to lens server.
+     * @param initString Init string. Format for UDP:
+     * "udp;[server IP];[port];[max params rate, Hz];[timeout, msec]" and for
+     * Unix domain sockets: "unix;[server socket file path];[max params rate,
+     * Hz];[timeout, msec]". Max params rate (default 0 - no limit) and
+     * command response timeout (default 1000 msec) are optional.
+     * @return TRUE if connection open or FALSE if not.
+     */
+    bool openLens(std::string initString);
+
+    /**
+     * @brief Open connection by init string from params.
+     * @param params Lens parameters. Only initString is used.
+     * @return TRUE if connection open or FALSE if not.
+     */
+    bool initLens(LensParams& params);
+
+    /**
+     * @brief Close connection.
+     */
+    void closeLens();
+
+    /**
+     * @brief Get connection open status.
+     * @return TRUE if connection open or FALSE.
+     */
+    bool isLensOpen();
+
+    /**
+     * @brief Get lens connection status reported by server.
+     * @return TRUE if the lens is connected or FALSE.
+     */
+    bool isLensConnected();
+
+    /**
+     * @brief Set the lens controller param. Waits server response.
+     * @param id Param ID.
+     * @param value Param value.
+     * @return TRUE if the property set or FALSE.
+     */
+    bool setParam(LensParam id, float value);
+
+    /**
+     * @brief Get the lens controller param from local cache.
+     * @param id Param ID.
+     * @return float Param value or -1 of the param not exists.
+     */
+    float getParam(LensParam id);
+
+    /**
+     * @brief Get the lens controller params from local cache.
+     * @param params Reference to LensParams object.
+     */
+    void getParams(LensParams& params);
+
+    /**
+     * @brief Execute command. Waits server response.
+     * @param id Command ID.
+     * @param arg Command argument.
+     * @return TRUE if the command executed or FALSE.
+     */
+    bool executeCommand(LensCommand id, float arg = 0);
+
+    /**
+     * @brief Add video frame for auto focus purposes. Not supported.
+     * @param frame Video frame object.
+     */
+    void addVideoFrame(cr::video::Frame& frame);
+
+    /**
+     * @brief Send command to server and wait response.
+     * @param data Pointer to command data.
+     * @param size Size of data.
+     * @return TRUE if command executed by server or FALSE if not.
+     */
+    bool decodeAndExecuteCommand(uint8_t* data, int size);
+
+    /**
+     * @brief Get number of params updates received from server. For
+     * diagnostics.
+     * @return Number of params updates.
+     */
+    int64_t getUpdatesCount();
+
+private:
+
+    /// Socket.
+    LensSocket m_socket;
+    /// Params cache.
+    LensParams m_params;
+    /// Params cache mutex.
+    std::mutex m_paramsMutex;
+    /// Receive thread.
+    std::thread m_thread;
+    /// Stop thread flag.
+    std::atomic<bool> m_stopFlag{false};
+    /// Number of params updates.
+    std::atomic<int64_t> m_updatesCount{0};
+    /// Command response timeout, msec.
+    int m_timeoutMsec{1000};
+    /// Mutex to send one request at a time.
+    std::mutex m_requestMutex;
+    /// Response mutex.
+    std::mutex m_responseMutex;
+    /// Response condition variable.
+    std::condition_variable m_responseCond;
+    /// Expected response type: 0 - command, 1 - set param command.
+    int m_responseType{-1};
+    /// Expected response ID.
+    int m_responseId{0};
+    /// Expected response sequence number.
+    uint32_t m_responseSequence{0};
+    /// Last request sequence number.
+    uint32_t m_sequence{0};
+    /// Response received flag.
+    bool m_hasResponse{false};
+    /// Response status.
+    bool m_responseStatus{false};
+    /// Subscribe command to renew subscription.
+    uint8_t m_subscribeCommand[15];
+    /// Size of subscribe command.
+    int m_subscribeCommandSize{0};
+
+    /**
+     * @brief Receive thread function.
+     */
+    void receive();
+};
+}
+}
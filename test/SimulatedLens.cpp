@@ -0,0 +1,435 @@
+#include <cmath>
+#include <chrono>
+#include "SimulatedLens.h"
+
+
+
+cr::lens::SimulatedLens::SimulatedLens()
+{
+    m_params.isOpen = false;
+    m_params.isConnected = false;
+}
+
+
+
+cr::lens::SimulatedLens::~SimulatedLens()
+{
+    setCommandTime(0);
+}
+
+
+
+bool cr::lens::SimulatedLens::openLens(std::string initString)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_params.initString = initString;
+    m_params.isOpen = true;
+    m_params.isConnected = true;
+    return true;
+}
+
+
+
+bool cr::lens::SimulatedLens::initLens(cr::lens::LensParams& params)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_params = params;
+    m_fovTable.set(m_params.fovPoints);
+    m_hwZoomPos = (float)m_params.zoomHwPos;
+    m_targetHwZoomPos = m_hwZoomPos;
+    m_zoomMapper.setLinear(m_params.zoomHwWideLimit, m_params.zoomHwTeleLimit);
+    m_focusMapper.setLinear(m_params.focusHwNearLimit,
+                            m_params.focusHwFarLimit);
+    m_irisMapper.setLinear(m_params.irisHwCloseLimit, m_params.irisHwOpenLimit);
+    m_focusTracker.setParams(m_params);
+    m_zoomRate.setParams(m_params);
+    if (m_params.zoomHwMaxSpeed > 0)
+        m_zoomRate.setSpeedGain(m_maxHwRate / (float)m_params.zoomHwMaxSpeed);
+    m_params.isOpen = true;
+    m_params.isConnected = true;
+    return true;
+}
+
+
+
+void cr::lens::SimulatedLens::closeLens()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_params.isOpen = false;
+    m_params.isConnected = false;
+}
+
+
+
+bool cr::lens::SimulatedLens::isLensOpen()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_params.isOpen;
+}
+
+
+
+bool cr::lens::SimulatedLens::isLensConnected()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_params.isConnected;
+}
+
+
+
+bool cr::lens::SimulatedLens::setParam(cr::lens::LensParam id, float value)
+{
+    if (m_commandTime.load() > 0)
+        return m_commandQueue.push(id, value);
+
+    return applyParam(id, value);
+}
+
+
+
+bool cr::lens::SimulatedLens::applyParam(cr::lens::LensParam id, float value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    switch (id)
+    {
+    case LensParam::ZOOM_POS:
+    {
+        const int userPos = LensPositionMapper::clampPos(value);
+        const int hwPos = m_zoomMapper.toHw(userPos);
+        m_targetHwZoomPos = (float)hwPos;
+        if (m_maxHwRate > 0.0f)
+            return true;
+        m_hwZoomPos = m_targetHwZoomPos;
+        m_params.zoomPos = userPos;
+        m_params.zoomHwPos = hwPos;
+        m_fovTable.getFov((float)m_params.zoomHwPos, m_params.xFovDeg,
+                          m_params.yFovDeg);
+        m_params.setTimestamp(LensParam::ZOOM_POS);
+        m_params.setTimestamp(LensParam::ZOOM_HW_POS);
+        trackFocus();
+        return true;
+    }
+    case LensParam::FOCUS_POS:
+        m_params.focusPos = LensPositionMapper::clampPos(value);
+        m_params.focusHwPos = m_focusMapper.toHw(m_params.focusPos);
+        m_params.setTimestamp(LensParam::FOCUS_POS);
+        m_params.setTimestamp(LensParam::FOCUS_HW_POS);
+        // Focus set by user: track this object during zoom.
+        m_focusTracker.lock(m_hwZoomPos, (float)m_params.focusHwPos);
+        return true;
+    case LensParam::IRIS_POS:
+        m_params.irisPos = LensPositionMapper::clampPos(value);
+        m_params.irisHwPos = m_irisMapper.toHw(m_params.irisPos);
+        m_params.setTimestamp(LensParam::IRIS_POS);
+        m_params.setTimestamp(LensParam::IRIS_HW_POS);
+        return true;
+    case LensParam::ZOOM_SPEED:
+        m_params.zoomSpeed = value < 0.0f ? 0 :
+                             (value > 100.0f ? 100 : (int)value);
+        m_params.zoomHwSpeed =
+                m_params.zoomSpeed * m_params.zoomHwMaxSpeed / 100;
+        return true;
+    case LensParam::ZOOM_HW_SPEED:
+        m_params.zoomHwSpeed = (int)value;
+        return true;
+    case LensParam::FOCUS_HW_SPEED:
+        m_params.focusHwSpeed = (int)value;
+        return true;
+    case LensParam::ZOOM_HW_TELE_LIMIT:
+        m_params.zoomHwTeleLimit = (int)value;
+        m_zoomMapper.setLinear(m_params.zoomHwWideLimit,
+                               m_params.zoomHwTeleLimit);
+        return true;
+    case LensParam::ZOOM_HW_WIDE_LIMIT:
+        m_params.zoomHwWideLimit = (int)value;
+        m_zoomMapper.setLinear(m_params.zoomHwWideLimit,
+                               m_params.zoomHwTeleLimit);
+        return true;
+    case LensParam::FOCUS_MODE:
+        m_params.focusMode = (int)value;
+        return true;
+    case LensParam::CUSTOM_1:
+        m_params.custom1 = value;
+        return true;
+    case LensParam::CUSTOM_2:
+        m_params.custom2 = value;
+        return true;
+    case LensParam::CUSTOM_3:
+        m_params.custom3 = value;
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+
+float cr::lens::SimulatedLens::getParam(cr::lens::LensParam id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    switch (id)
+    {
+    case LensParam::ZOOM_POS: return (float)m_params.zoomPos;
+    case LensParam::ZOOM_HW_POS: return (float)m_params.zoomHwPos;
+    case LensParam::FOCUS_POS: return (float)m_params.focusPos;
+    case LensParam::FOCUS_HW_POS: return (float)m_params.focusHwPos;
+    case LensParam::IRIS_POS: return (float)m_params.irisPos;
+    case LensParam::IRIS_HW_POS: return (float)m_params.irisHwPos;
+    case LensParam::ZOOM_SPEED: return (float)m_params.zoomSpeed;
+    case LensParam::ZOOM_HW_SPEED: return (float)m_params.zoomHwSpeed;
+    case LensParam::FOCUS_HW_SPEED: return (float)m_params.focusHwSpeed;
+    case LensParam::ZOOM_HW_TELE_LIMIT: return (float)m_params.zoomHwTeleLimit;
+    case LensParam::ZOOM_HW_WIDE_LIMIT: return (float)m_params.zoomHwWideLimit;
+    case LensParam::FOCUS_MODE: return (float)m_params.focusMode;
+    case LensParam::IS_CONNECTED: return m_params.isConnected ? 1.0f : 0.0f;
+    case LensParam::IS_OPEN: return m_params.isOpen ? 1.0f : 0.0f;
+    case LensParam::X_FOV_DEG: return m_params.xFovDeg;
+    case LensParam::Y_FOV_DEG: return m_params.yFovDeg;
+    case LensParam::CUSTOM_1: return m_params.custom1;
+    case LensParam::CUSTOM_2: return m_params.custom2;
+    case LensParam::CUSTOM_3: return m_params.custom3;
+    default: return -1.0f;
+    }
+}
+
+
+
+void cr::lens::SimulatedLens::getParams(cr::lens::LensParams& params)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    params = m_params;
+}
+
+
+
+bool cr::lens::SimulatedLens::executeCommand(cr::lens::LensCommand id,
+                                             float arg)
+{
+    if (m_commandTime.load() > 0)
+        return m_commandQueue.push(id, arg);
+
+    return applyCommand(id, arg);
+}
+
+
+
+bool cr::lens::SimulatedLens::applyCommand(cr::lens::LensCommand id,
+                                           float arg)
+{
+    switch (id)
+    {
+    case LensCommand::ZOOM_TO_POS:
+        m_zoomRate.stop();
+        return applyParam(LensParam::ZOOM_POS, arg);
+    case LensCommand::FOCUS_TO_POS:
+        return applyParam(LensParam::FOCUS_POS, arg);
+    case LensCommand::IRIS_TO_POS:
+        return applyParam(LensParam::IRIS_POS, arg);
+    case LensCommand::ZOOM_TELE:
+        m_zoomRate.stop();
+        return applyParam(LensParam::ZOOM_POS, 65535.0f);
+    case LensCommand::ZOOM_WIDE:
+        m_zoomRate.stop();
+        return applyParam(LensParam::ZOOM_POS, 0.0f);
+    case LensCommand::ZOOM_AT_FOV_RATE:
+    case LensCommand::ZOOM_AT_MAGNIFICATION_RATE:
+        if (!m_zoomRate.start(id, arg))
+            return false;
+        return applyParam(LensParam::ZOOM_POS, arg > 0.0f ? 65535.0f : 0.0f);
+    case LensCommand::ZOOM_STOP:
+    {
+        m_zoomRate.stop();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_targetHwZoomPos = m_hwZoomPos;
+        return true;
+    }
+    case LensCommand::ZOOM_TO_FOV:
+    {
+        m_zoomRate.stop();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        float hwZoomPos = 0.0f;
+        if (!m_fovTable.getHwZoomPos(arg, hwZoomPos))
+            return false;
+        m_targetHwZoomPos = (float)(int)(hwZoomPos + 0.5f);
+        if (m_maxHwRate <= 0.0f)
+            setHwZoomPos(m_targetHwZoomPos);
+        return true;
+    }
+    case LensCommand::AF_START:
+    case LensCommand::FOCUS_FAR:
+    case LensCommand::FOCUS_NEAR:
+        m_focusTracker.unlock();
+        return true;
+    case LensCommand::AF_STOP:
+    {
+        // Autofocus ended: focus is found.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_focusTracker.lock(m_hwZoomPos, (float)m_params.focusHwPos);
+        return true;
+    }
+    case LensCommand::RESTART:
+        return false;
+    default:
+        return true;
+    }
+}
+
+
+
+void cr::lens::SimulatedLens::addVideoFrame(cr::video::Frame& frame)
+{
+
+}
+
+
+
+bool cr::lens::SimulatedLens::decodeAndExecuteCommand(uint8_t* data, int size)
+{
+    // Decode command.
+    LensCommand commandId = LensCommand::ZOOM_TELE;
+    LensParam paramId = LensParam::ZOOM_SPEED;
+    float value = 0.0f;
+    switch (Lens::decodeCommand(data, size, paramId, commandId, value))
+    {
+    case 0:
+        return executeCommand(commandId, value);
+    case 1:
+        return setParam(paramId, value);
+    default:
+        return false;
+    }
+}
+
+
+
+void cr::lens::SimulatedLens::setZoomRate(float maxHwRate)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxHwRate = maxHwRate < 0.0f ? 0.0f : maxHwRate;
+    if (m_params.zoomHwMaxSpeed > 0)
+        m_zoomRate.setSpeedGain(m_maxHwRate / (float)m_params.zoomHwMaxSpeed);
+}
+
+
+
+void cr::lens::SimulatedLens::setZoomMapper(
+        const cr::lens::LensPositionMapper& mapper)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_zoomMapper = mapper;
+}
+
+
+
+void cr::lens::SimulatedLens::advance(float sec)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_maxHwRate <= 0.0f || m_hwZoomPos == m_targetHwZoomPos ||
+        m_params.zoomHwMaxSpeed <= 0)
+        return;
+
+    // Speed of constant rate zoom.
+    int hwSpeed = 0;
+    if (m_zoomRate.update(m_hwZoomPos, hwSpeed))
+    {
+        m_params.zoomHwSpeed = hwSpeed;
+        m_params.zoomSpeed = hwSpeed * 100 / m_params.zoomHwMaxSpeed;
+    }
+
+    const float step = m_maxHwRate * (float)m_params.zoomHwSpeed /
+                       (float)m_params.zoomHwMaxSpeed * sec;
+    if (std::fabs(m_targetHwZoomPos - m_hwZoomPos) <= step)
+        setHwZoomPos(m_targetHwZoomPos);
+    else
+        setHwZoomPos(m_hwZoomPos + (m_targetHwZoomPos > m_hwZoomPos ?
+                                    step : -step));
+}
+
+
+
+void cr::lens::SimulatedLens::setHwZoomPos(float hwZoomPos)
+{
+    m_hwZoomPos = hwZoomPos;
+    m_params.zoomHwPos = (int)std::lround(hwZoomPos);
+    m_params.zoomPos = m_zoomMapper.toUser(m_params.zoomHwPos);
+    m_fovTable.getFov(hwZoomPos, m_params.xFovDeg, m_params.yFovDeg);
+    m_params.setTimestamp(LensParam::ZOOM_POS);
+    m_params.setTimestamp(LensParam::ZOOM_HW_POS);
+    trackFocus();
+}
+
+
+
+void cr::lens::SimulatedLens::trackFocus()
+{
+    // FOCUS_TO_POS by tracker. Doesn't relock tracker.
+    float focusPos = 0.0f;
+    if (!m_focusTracker.update(m_hwZoomPos, focusPos))
+        return;
+    m_params.focusPos = LensPositionMapper::clampPos(focusPos);
+    m_params.focusHwPos = m_focusMapper.toHw(m_params.focusPos);
+    m_params.setTimestamp(LensParam::FOCUS_POS);
+    m_params.setTimestamp(LensParam::FOCUS_HW_POS);
+}
+
+
+
+void cr::lens::SimulatedLens::setCommandTime(int msec)
+{
+    // Restart command thread.
+    m_stopCommandThread.store(true);
+    if (m_commandThread.joinable())
+        m_commandThread.join();
+    m_commandTime.store(msec < 0 ? 0 : msec);
+    clearCommands();
+    if (m_commandTime.load() == 0)
+        return;
+    m_stopCommandThread.store(false);
+    m_commandThread = std::thread(&SimulatedLens::processCommands, this);
+}
+
+
+
+int cr::lens::SimulatedLens::getCommandLatencyUs(cr::lens::LensCommand id)
+{
+    std::lock_guard<std::mutex> lock(m_latencyMutex);
+    auto latency = m_commandLatency.find(id);
+    return latency == m_commandLatency.end() ? -1 : latency->second;
+}
+
+
+
+void cr::lens::SimulatedLens::clearCommands()
+{
+    m_commandQueue.clear();
+    std::lock_guard<std::mutex> lock(m_latencyMutex);
+    m_commandLatency.clear();
+}
+
+
+
+void cr::lens::SimulatedLens::processCommands()
+{
+    LensQueuedCommand command;
+    while (!m_stopCommandThread.load())
+    {
+        if (!m_commandQueue.pop(command, 10))
+            continue;
+
+        // Latency is time in queue. Command takes effect after exchange.
+        if (command.type == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_latencyMutex);
+            m_commandLatency[command.commandId] =
+                    (int)std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() -
+                        command.pushTime).count();
+        }
+        std::this_thread::sleep_for(
+                    std::chrono::milliseconds(m_commandTime.load()));
+        if (command.type == 0)
+            applyCommand(command.commandId, command.value);
+        else
+            applyParam(command.paramId, command.value);
+    }
+}
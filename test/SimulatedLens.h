@@ -0,0 +1,239 @@
+#pragma once
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include "Lens.h"
+#include "LensFovTable.h"
+#include "LensCommandQueue.h"
+#include "LensFocusTracker.h"
+#include "LensZoomRate.h"
+#include "LensPositionMapper.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+/**
+ * @brief Simulated lens controller for tests. Lens moves to requested
+ * positions immediately. Positions are clamped to 0-65535 user space range
+ * and scaled to hardware range according to hardware limits. Zoom can be
+ * simulated with finite speed (see setZoomRate(...)): zoom commands set
+ * target position and zoom moves to it by advance(...) calls with speed
+ * ZOOM_HW_SPEED. Constant rate zoom commands (ZOOM_AT_FOV_RATE and
+ * ZOOM_AT_MAGNIFICATION_RATE) update speed on each advance(...) call.
+ * Focus follows zoom motion along tracking curves (LensParams::trackingCurves)
+ * by LensFocusTracker: tracker is locked by FOCUS_TO_POS command, FOCUS_POS
+ * param or AF_STOP command (end of autofocus) and unlocked by AF_START,
+ * FOCUS_FAR and FOCUS_NEAR commands. Each zoom position change makes
+ * FOCUS_TO_POS of tracker.
+ * Controller with slow hardware exchange can be simulated (see
+ * setCommandTime(...)): commands and set param commands go through
+ * LensCommandQueue and are executed by lens thread one by one.
+ */
+class SimulatedLens: public Lens
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     */
+    SimulatedLens();
+
+    /**
+     * @brief Class destructor.
+     */
+    ~SimulatedLens();
+
+    /**
+     * @brief Open lens controller.
+     * @param initString Init string. Not used.
+     * @return Always TRUE.
+     */
+    bool openLens(std::string initString);
+
+    /**
+     * @brief Init lens controller by set of parameters.
+     * @param params Lens parameters.
+     * @return Always TRUE.
+     */
+    bool initLens(LensParams& params);
+
+    /**
+     * @brief Close connection.
+     */
+    void closeLens();
+
+    /**
+     * @brief Get lens open status.
+     * @return TRUE if the lens is open or FALSE.
+     */
+    bool isLensOpen();
+
+    /**
+     * @brief Get lens connection status.
+     * @return TRUE if the lens is connected or FALSE.
+     */
+    bool isLensConnected();
+
+    /**
+     * @brief Set the lens controller param.
+     * @param id Param ID.
+     * @param value Param value.
+     * @return TRUE if the property set or FALSE.
+     */
+    bool setParam(LensParam id, float value);
+
+    /**
+     * @brief Get the lens controller param.
+     * @param id Param ID.
+     * @return float Param value or -1 of the param not exists.
+     */
+    float getParam(LensParam id);
+
+    /**
+     * @brief Get the lens controller params.
+     * @param params Reference to LensParams object.
+     */
+    void getParams(LensParams& params);
+
+    /**
+     * @brief Execute command.
+     * @param id Command ID.
+     * @param arg Command argument.
+     * @return TRUE if the command executed or FALSE.
+     */
+    bool executeCommand(LensCommand id, float arg = 0);
+
+    /**
+     * @brief Add video frame for auto focus purposes. Not supported.
+     * @param frame Video frame object.
+     */
+    void addVideoFrame(cr::video::Frame& frame);
+
+    /**
+     * @brief Decode and execute command.
+     * @param data Pointer to command data.
+     * @param size Size of data.
+     * @return TRUE if command decoded and executed or FALSE if not.
+     */
+    bool decodeAndExecuteCommand(uint8_t* data, int size);
+
+    /**
+     * @brief Set simulated zoom rate.
+     * @param maxHwRate Hardware zoom position change per second at max
+     * hardware zoom speed. 0 - zoom moves immediately (default).
+     */
+    void setZoomRate(float maxHwRate);
+
+    /**
+     * @brief Set zoom position mapping (reset to linear by initLens(...) and
+     * zoom limit params).
+     * @param mapper Zoom position mapper.
+     */
+    void setZoomMapper(const LensPositionMapper& mapper);
+
+    /**
+     * @brief Move zoom to target position with current zoom speed.
+     * @param sec Simulated time, seconds.
+     */
+    void advance(float sec);
+
+    /**
+     * @brief Set simulated hardware exchange time of one command.
+     * @param msec Time, msec. 0 - commands and set param commands executed
+     * immediately (default). Positive value - commands and set param commands
+     * are put to LensCommandQueue and executed by lens thread, each one
+     * takes given time.
+     */
+    void setCommandTime(int msec);
+
+    /**
+     * @brief Get time from push to execution of last executed command with
+     * given ID (queued execution, see setCommandTime(...)).
+     * @param id Command ID.
+     * @return Latency, microseconds, or -1 if command was not executed since
+     * last clearCommands() call.
+     */
+    int getCommandLatencyUs(LensCommand id);
+
+    /**
+     * @brief Remove pending commands and reset command latencies.
+     */
+    void clearCommands();
+
+private:
+
+    /// Lens parameters.
+    LensParams m_params;
+    /// FOV table.
+    LensFovTable m_fovTable;
+    /// Mutex to protect params.
+    std::mutex m_mutex;
+    /// Zoom rate at max speed, hardware units per second.
+    float m_maxHwRate{0.0f};
+    /// Precise hardware zoom position.
+    float m_hwZoomPos{0.0f};
+    /// Target hardware zoom position.
+    float m_targetHwZoomPos{0.0f};
+    /// Constant rate zoom controller.
+    LensZoomRate m_zoomRate;
+    /// Zoom position mapper.
+    LensPositionMapper m_zoomMapper;
+    /// Focus position mapper.
+    LensPositionMapper m_focusMapper;
+    /// Iris position mapper.
+    LensPositionMapper m_irisMapper;
+    /// Zoom-focus tracker.
+    LensFocusTracker m_focusTracker;
+    /// Command queue.
+    LensCommandQueue m_commandQueue;
+    /// Command thread.
+    std::thread m_commandThread;
+    /// Stop command thread flag.
+    std::atomic<bool> m_stopCommandThread{false};
+    /// Command execution time, msec. 0 - commands are not queued.
+    std::atomic<int> m_commandTime{0};
+    /// Latency of last executed commands by command ID, microseconds.
+    std::map<LensCommand, int> m_commandLatency;
+    /// Mutex to protect command latencies.
+    std::mutex m_latencyMutex;
+
+    /**
+     * @brief Set param without queue.
+     * @param id Param ID.
+     * @param value Param value.
+     * @return TRUE if the property set or FALSE.
+     */
+    bool applyParam(LensParam id, float value);
+
+    /**
+     * @brief Execute command without queue.
+     * @param id Command ID.
+     * @param arg Command argument.
+     * @return TRUE if the command executed or FALSE.
+     */
+    bool applyCommand(LensCommand id, float arg);
+
+    /**
+     * @brief Command thread function.
+     */
+    void processCommands();
+
+    /**
+     * @brief Move focus by focus tracker after zoom position change. Must be
+     * called under lock.
+     */
+    void trackFocus();
+
+    /**
+     * @brief Set hardware zoom position and update user space position and
+     * FOV.
+     * @param hwZoomPos Hardware zoom position.
+     */
+    void setHwZoomPos(float hwZoomPos);
+};
+}
+}
@@ -1,5 +1,35 @@
 #include <iostream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 #include "Lens.h"
+#include "LensCommandQueue.h"
+#include "LensStreamDecoder.h"
+#include "SimulatedLens.h"
+#include "LensSubscription.h"
+#include "LensParamsPublisher.h"
+#include "LensServer.h"
+#include "RemoteLens.h"
+#include "LensParamsShm.h"
+#include "LensParamReader.h"
+#include "LensPollScheduler.h"
+#include "LensPredictor.h"
+#include "LensStateHistory.h"
+#include "LensKlvEncoder.h"
+#include "LensFocusTracker.h"
+#include "LensFovTable.h"
+#include "LensAngleConverter.h"
+#include "LensDistortion.h"
+#include "LensFovLoader.h"
+#include "LensGroup.h"
+#include "LensZoomRate.h"
+#include "LensPositionMapper.h"
 
 
 
@@ -9,6 +39,11 @@ using namespace std;
 
 
 
+/// Pi.
+#define TEST_PI 3.14159265358979323846
+
+
+
 /// Copy test.
 bool copyTest();
 
@@ -25,6 +60,81 @@ bool encodeDecodeCommandsTest();
 /// JSON read/write test.
 bool jsonReadWriteTest();
 
+/// Stop commands priority test.
+bool stopCommandsPriorityTest();
+
+/// Stream decoder test.
+bool streamDecoderTest();
+
+/// Encode/decode params in compact profile test.
+bool encodeDecodeCompactParamsTest();
+
+/// Serialize/deserialize all params test.
+bool serializeDeserializeParamsTest();
+
+/// Command response test.
+bool commandResponseTest();
+
+/// Params subscription test.
+bool paramsSubscriptionTest();
+
+/// Params publisher test.
+bool paramsPublisherTest();
+
+/// Remote lens test.
+bool remoteLensTest();
+
+/// Params shared memory test.
+bool paramsShmTest();
+
+/// Single-flight reader test.
+bool singleFlightReaderTest();
+
+/// Params timestamps test.
+bool paramsTimestampsTest();
+
+/// Poll scheduler test.
+bool pollSchedulerTest();
+
+/// Position predictor test.
+bool positionPredictorTest();
+
+/// State history test.
+bool stateHistoryTest();
+
+/// KLV encoder test.
+bool klvEncoderTest();
+
+/// Focus tracker test.
+bool focusTrackerTest();
+
+/// Focus tracking by lens controller test.
+bool lensFocusTrackingTest();
+
+/// Zoom to FOV test.
+bool zoomToFovTest();
+
+/// Angle converter test.
+bool angleConverterTest();
+
+/// Distortion model test.
+bool distortionTest();
+
+/// Calibration table test.
+bool calibrationTableTest();
+
+/// FOV points loader test.
+bool fovLoaderTest();
+
+/// Lens group test.
+bool lensGroupTest();
+
+/// Constant rate zoom test.
+bool zoomRateTest();
+
+/// Position mapper test.
+bool positionMapperTest();
+
 /// Compare params.
 bool compareParams(LensParams& in, LensParams& out, LensParamsMask& mask);
 
@@ -75,6 +185,181 @@ int main(void)
         cout << "ERROR" << endl;
     cout << endl;
 
+    cout << "Stop commands priority test:" << endl;
+    if (stopCommandsPriorityTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Stream decoder test:" << endl;
+    if (streamDecoderTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Encode/Decode params in compact profile test:" << endl;
+    if (encodeDecodeCompactParamsTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Serialize/Deserialize all params test:" << endl;
+    if (serializeDeserializeParamsTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Command response test:" << endl;
+    if (commandResponseTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Params subscription test:" << endl;
+    if (paramsSubscriptionTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Params publisher test:" << endl;
+    if (paramsPublisherTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Remote lens test:" << endl;
+    if (remoteLensTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Params shared memory test:" << endl;
+    if (paramsShmTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Single-flight reader test:" << endl;
+    if (singleFlightReaderTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Params timestamps test:" << endl;
+    if (paramsTimestampsTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Poll scheduler test:" << endl;
+    if (pollSchedulerTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Position predictor test:" << endl;
+    if (positionPredictorTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "State history test:" << endl;
+    if (stateHistoryTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "KLV encoder test:" << endl;
+    if (klvEncoderTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Focus tracker test:" << endl;
+    if (focusTrackerTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Focus tracking by lens controller test:" << endl;
+    if (lensFocusTrackingTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Zoom to FOV test:" << endl;
+    if (zoomToFovTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Angle converter test:" << endl;
+    if (angleConverterTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Distortion model test:" << endl;
+    if (distortionTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Calibration table test:" << endl;
+    if (calibrationTableTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "FOV points loader test:" << endl;
+    if (fovLoaderTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Lens group test:" << endl;
+    if (lensGroupTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Constant rate zoom test:" << endl;
+    if (zoomRateTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
+    cout << "Position mapper test:" << endl;
+    if (positionMapperTest())
+        cout << "OK" << endl;
+    else
+        cout << "ERROR" << endl;
+    cout << endl;
+
     return 1;
 }
 
@@ -558,6 +843,3179 @@ bool encodeDecodeParamsWithMaskTest()
 
 
 
+/// Stop commands priority test.
+bool stopCommandsPriorityTest()
+{
+    // Simulated lens: each command takes 2 msec (serial port exchange).
+    SimulatedLens lens;
+    LensParams params;
+    params.zoomHwTeleLimit = 65535;
+    lens.initLens(params);
+    lens.setCommandTime(2);
+
+    // Load queue and send stop several times.
+    int maxLatencyUs = 0;
+    bool result = true;
+    for (int n = 0; n < 10 && result; ++n)
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            lens.executeCommand(LensCommand::ZOOM_TO_POS, (float)(i * 100));
+            lens.setParam(LensParam::ZOOM_POS, (float)(i * 100 + 50));
+            lens.executeCommand(LensCommand::FOCUS_FAR);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        lens.executeCommand(LensCommand::ZOOM_STOP);
+
+        // Wait stop execution.
+        std::chrono::time_point<std::chrono::steady_clock> startTime =
+                std::chrono::steady_clock::now();
+        while (lens.getCommandLatencyUs(LensCommand::ZOOM_STOP) < 0 &&
+               std::chrono::steady_clock::now() - startTime <
+               std::chrono::milliseconds(1000))
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        const int latencyUs = lens.getCommandLatencyUs(LensCommand::ZOOM_STOP);
+        if (latencyUs < 0)
+        {
+            cout << "ZOOM_STOP not executed" << endl;
+            result = false;
+            break;
+        }
+
+        // Pending zoom moves must be dropped: position doesn't change while
+        // focus commands are still executed.
+        const float zoomPos = lens.getParam(LensParam::ZOOM_POS);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (lens.getParam(LensParam::ZOOM_POS) != zoomPos)
+        {
+            cout << "Zoom move executed after ZOOM_STOP" << endl;
+            result = false;
+        }
+        maxLatencyUs = std::max(maxLatencyUs, latencyUs);
+        lens.clearCommands();
+    }
+    lens.setCommandTime(0);
+
+    cout << "Max stop latency: " << maxLatencyUs << " us (FIFO: ~" <<
+            600 * 2 << " ms)" << endl;
+
+    // Stop latency must be bounded by one command execution time.
+    if (maxLatencyUs > 20000)
+    {
+        cout << "Stop latency too big" << endl;
+        result = false;
+    }
+
+    return result;
+}
+
+
+
+/// Stream decoder test.
+bool streamDecoderTest()
+{
+    // Prepare stream: garbage, commands, set param commands and params.
+    const int numFrames = 1000;
+    uint8_t* stream = new uint8_t[numFrames * 256];
+    int streamSize = 0;
+    int frameTypes[numFrames];
+    float values[numFrames];
+    for (int i = 0; i < numFrames; ++i)
+    {
+        // Add garbage.
+        if (rand() % 10 == 0)
+        {
+            stream[streamSize++] = 0xFF;
+            stream[streamSize++] = 0x00;
+            stream[streamSize++] = 0x07;
+        }
+
+        int size = 0;
+        frameTypes[i] = rand() % 3;
+        values[i] = (float)(rand() % 65535);
+        if (frameTypes[i] == 0)
+        {
+            Lens::encodeCommand(&stream[streamSize], size,
+                                LensCommand::ZOOM_TO_POS, values[i]);
+        }
+        else if (frameTypes[i] == 1)
+        {
+            Lens::encodeSetParamCommand(&stream[streamSize], size,
+                                        LensParam::FOCUS_POS, values[i]);
+        }
+        else
+        {
+            LensParams params;
+            params.zoomPos = (int)values[i];
+            LensParamsMask mask;
+            mask.focusPos = rand() % 2 == 0;
+            mask.isConnected = rand() % 2 == 0;
+            mask.custom3 = rand() % 2 == 0;
+            params.encode(&stream[streamSize], 256, size, &mask);
+        }
+        streamSize += size;
+    }
+
+    // Decode stream by random chunks.
+    LensStreamDecoder decoder(1024);
+    LensStreamFrame frame;
+    int pos = 0;
+    int frameIndex = 0;
+    bool result = true;
+    std::chrono::time_point<std::chrono::high_resolution_clock> startTime =
+            std::chrono::high_resolution_clock::now();
+    while (pos < streamSize)
+    {
+        int chunkSize = 1 + rand() % 300;
+        if (pos + chunkSize > streamSize)
+            chunkSize = streamSize - pos;
+        int putSize = decoder.put(&stream[pos], chunkSize);
+        pos += putSize;
+
+        while (decoder.next(frame))
+        {
+            if (frameIndex >= numFrames ||
+                (int)frame.type != frameTypes[frameIndex])
+            {
+                cout << "Wrong frame type" << endl;
+                result = false;
+                break;
+            }
+
+            LensCommand commandId;
+            LensParam paramId;
+            float value = 0.0f;
+            if (frame.type == LensFrameType::PARAMS)
+            {
+                LensParams params;
+                if (!params.decode(frame.data, frame.size) ||
+                    params.zoomPos != (int)values[frameIndex])
+                {
+                    cout << "Wrong params frame" << endl;
+                    result = false;
+                }
+            }
+            else if (Lens::decodeCommand(frame.data, frame.size, paramId,
+                                         commandId, value) < 0 ||
+                                         value != values[frameIndex])
+            {
+                cout << "Wrong command frame" << endl;
+                result = false;
+            }
+            ++frameIndex;
+        }
+    }
+    int timeUs = (int)std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::high_resolution_clock::now() - startTime).count();
+    delete[] stream;
+
+    cout << "Decoded frames: " << frameIndex << ", skipped bytes: " <<
+            decoder.getSkippedBytes() << ", time: " << timeUs << " us" << endl;
+
+    if (frameIndex != numFrames)
+    {
+        cout << "Not all frames decoded" << endl;
+        return false;
+    }
+
+    // Corrupted full params header with big size doesn't drop next frames.
+    uint8_t data[64];
+    memset(data, 0, sizeof(data));
+    int size = 0;
+    Lens::encodeCommand(&data[7], size, LensCommand::ZOOM_STOP);
+    data[0] = 0x04;
+    data[1] = data[8];
+    data[2] = data[9];
+    uint32_t bigSize = 1000000;
+    memcpy(&data[3], &bigSize, 4);
+    LensStreamDecoder copy(decoder);
+    copy.reset();
+    copy.put(data, 7 + size);
+    if (!copy.next(frame) || frame.type != LensFrameType::COMMAND)
+    {
+        cout << "Command after corrupted header not decoded" << endl;
+        return false;
+    }
+
+    return result;
+}
+
+
+
+/// Encode/decode params in compact profile test.
+bool encodeDecodeCompactParamsTest()
+{
+    // Prepare random params.
+    LensParams in;
+    in.zoomPos = rand() % 65536;
+    in.zoomHwPos = rand() % 65536;
+    in.focusPos = rand() % 65536;
+    in.focusHwPos = rand() % 65536;
+    in.irisPos = rand() % 65536;
+    in.irisHwPos = rand() % 65536;
+    in.focusMode = rand() % 2;
+    in.filterMode = rand() % 2;
+    in.afRoiX0 = rand() % 1920;
+    in.afRoiY0 = rand() % 1080;
+    in.afRoiX1 = rand() % 1920;
+    in.afRoiY1 = rand() % 1080;
+    in.zoomSpeed = rand() % 101;
+    in.zoomHwSpeed = rand() % 255;
+    in.zoomHwMaxSpeed = rand() % 255;
+    in.focusSpeed = rand() % 101;
+    in.focusHwSpeed = rand() % 255;
+    in.focusHwMaxSpeed = rand() % 255;
+    in.irisSpeed = rand() % 101;
+    in.irisHwSpeed = rand() % 255;
+    in.irisHwMaxSpeed = rand() % 255;
+    in.zoomHwTeleLimit = rand() % 65536;
+    in.zoomHwWideLimit = rand() % 65536;
+    in.focusHwFarLimit = rand() % 65536;
+    in.focusHwNearLimit = rand() % 65536;
+    in.irisHwOpenLimit = rand() % 65536;
+    in.irisHwCloseLimit = rand() % 65536;
+    in.focusFactor = (float)(rand() % 10000) / 7.0f;
+    in.isConnected = true;
+    in.afHwSpeed = rand() % 255;
+    in.focusFactorThreshold = rand() % 101;
+    in.refocusTimeoutSec = rand() % 100000;
+    in.afIsActive = false;
+    in.irisMode = rand() % 2;
+    in.autoAfRoiWidth = rand() % 1920;
+    in.autoAfRoiHeight = rand() % 1080;
+    in.autoAfRoiBorder = rand() % 540;
+    in.afRoiMode = rand() % 2;
+    in.extenderMode = rand() % 2;
+    in.stabiliserMode = rand() % 2;
+    in.afRange = -(rand() % 255);
+    in.xFovDeg = (float)(rand() % 9000) / 100.0f;
+    in.yFovDeg = (float)(rand() % 9000) / 100.0f;
+    in.logMode = rand() % 4;
+    in.temperature = (float)(rand() % 100) - 40.0f;
+    in.isOpen = true;
+    in.type = rand() % 255;
+    in.custom1 = (float)(rand() % 255) / 3.0f;
+    in.custom2 = (float)(rand() % 255) / 3.0f;
+    in.custom3 = (float)(rand() % 255) / 3.0f;
+
+    // Encode data.
+    uint8_t data[1024];
+    int size = 0;
+    int compactSize = 0;
+    in.encode(data, 1024, size);
+    if (!in.encodeCompact(data, 1024, compactSize))
+    {
+        cout << "Can't encode data" << endl;
+        return false;
+    }
+
+    cout << "Encoded data size: " << size << " bytes, compact: " <<
+            compactSize << " bytes" << endl;
+
+    // Check frame size detection by stream decoder.
+    if (LensStreamDecoder::getFrameSize(data, compactSize) != compactSize)
+    {
+        cout << "Wrong frame size detected" << endl;
+        return false;
+    }
+
+    // Decode data.
+    LensParams out;
+    if (!out.decode(data, compactSize))
+    {
+        cout << "Can't decode data" << endl;
+        return false;
+    }
+
+    // Compare params.
+    LensParamsMask mask;
+    if (!compareParams(in, out, mask))
+        return false;
+
+    // Encode with mask.
+    mask.zoomPos = false;
+    mask.isConnected = false;
+    mask.temperature = false;
+    mask.custom3 = false;
+    in.encodeCompact(data, 1024, compactSize, &mask);
+    out = LensParams();
+    if (!out.decode(data, compactSize))
+    {
+        cout << "Can't decode data with mask" << endl;
+        return false;
+    }
+    if (out.zoomPos != 0 || out.isConnected || out.temperature != 0.0f)
+    {
+        cout << "Masked params decoded" << endl;
+        return false;
+    }
+
+    // Check incomplete data.
+    if (out.decode(data, compactSize - 1))
+    {
+        cout << "Incomplete data decoded" << endl;
+        return false;
+    }
+
+    return compareParams(in, out, mask);
+}
+
+
+
+/// Serialize/deserialize all params test.
+bool serializeDeserializeParamsTest()
+{
+    // Prepare random params.
+    LensParams in;
+    in.initString = "/dev/ttyUSB0;9600;20;extra";
+    in.zoomPos = rand() % 65536;
+    in.focusHwPos = rand() % 65536;
+    in.afRoiX0 = rand() % 1920;
+    in.isConnected = true;
+    in.xFovDeg = (float)(rand() % 9000) / 100.0f;
+    in.custom3 = (float)(rand() % 255) / 3.0f;
+    for (int i = 0; i < 5000; ++i)
+    {
+        FovPoint pt;
+        pt.hwZoomPos = i * 13;
+        pt.xFovDeg = (float)(rand() % 9000) / 100.0f;
+        pt.yFovDeg = (float)(rand() % 9000) / 100.0f;
+        in.fovPoints.push_back(pt);
+    }
+
+    // Serialize.
+    int bufferSize = in.getSerializedSize();
+    uint8_t* data = new uint8_t[bufferSize];
+    int size = 0;
+    std::chrono::time_point<std::chrono::high_resolution_clock> startTime =
+            std::chrono::high_resolution_clock::now();
+    if (!in.serialize(data, bufferSize, size))
+    {
+        cout << "Can't serialize params" << endl;
+        delete[] data;
+        return false;
+    }
+    int serializeTimeUs = (int)std::chrono::duration_cast<
+            std::chrono::microseconds>(std::chrono::high_resolution_clock::now()
+                                       - startTime).count();
+
+    // Deserialize.
+    LensParams out;
+    startTime = std::chrono::high_resolution_clock::now();
+    if (!out.deserialize(data, size))
+    {
+        cout << "Can't deserialize params" << endl;
+        delete[] data;
+        return false;
+    }
+    int deserializeTimeUs = (int)std::chrono::duration_cast<
+            std::chrono::microseconds>(std::chrono::high_resolution_clock::now()
+                                       - startTime).count();
+
+    cout << "Serialized data size: " << size << " bytes, serialize time: " <<
+            serializeTimeUs << " us, deserialize time: " << deserializeTimeUs <<
+            " us" << endl;
+
+    // Check incomplete data.
+    LensParams tmp;
+    if (tmp.deserialize(data, size - 1))
+    {
+        cout << "Incomplete data deserialized" << endl;
+        delete[] data;
+        return false;
+    }
+
+    // Check forged frame size. Frame size smaller than minimum must be
+    // rejected before reading initialization string.
+    uint32_t forgedSize = 3 + 4 + 201;
+    memcpy(&data[3], &forgedSize, 4);
+    if (tmp.deserialize(data, size))
+    {
+        cout << "Data with forged size deserialized" << endl;
+        delete[] data;
+        return false;
+    }
+    forgedSize = (uint32_t)size - 1;
+    memcpy(&data[3], &forgedSize, 4);
+    if (tmp.deserialize(data, size))
+    {
+        cout << "Data with truncated size deserialized" << endl;
+        delete[] data;
+        return false;
+    }
+    forgedSize = (uint32_t)size;
+    memcpy(&data[3], &forgedSize, 4);
+
+    // Stream decoder must skip frame which doesn't fit into buffer.
+    LensStreamDecoder decoder(1024);
+    LensStreamFrame frame;
+    int pos = 0;
+    while (pos < size)
+    {
+        pos += decoder.put(&data[pos], size - pos);
+        if (decoder.next(frame))
+        {
+            cout << "Frame bigger than buffer decoded" << endl;
+            delete[] data;
+            return false;
+        }
+    }
+    delete[] data;
+    uint8_t command[11];
+    int commandSize = 0;
+    Lens::encodeCommand(command, commandSize, LensCommand::ZOOM_STOP);
+    decoder.put(command, commandSize);
+    if (!decoder.next(frame) || frame.type != LensFrameType::COMMAND)
+    {
+        cout << "Command after big frame not decoded" << endl;
+        return false;
+    }
+
+    // Compare params.
+    if (in.initString != out.initString)
+    {
+        cout << "in.initString" << endl;
+        return false;
+    }
+    if (in.fovPoints.size() != out.fovPoints.size())
+    {
+        cout << "in.fovPoints.size()" << endl;
+        return false;
+    }
+    LensParamsMask mask;
+    return compareParams(in, out, mask);
+}
+
+
+
+// Command response test.
+bool commandResponseTest()
+{
+    // Prepare lens.
+    SimulatedLens lens;
+    LensParams initParams;
+    initParams.zoomHwWideLimit = 1000;
+    initParams.zoomHwTeleLimit = 31000;
+    lens.initLens(initParams);
+
+    // Encode set param command with out of range value.
+    uint8_t command[11];
+    int commandSize = 0;
+    Lens::encodeSetParamCommand(command, commandSize, LensParam::ZOOM_POS,
+                                70000.0f);
+
+    // Process command with params snapshot.
+    LensParamsMask mask;
+    memset((void*)&mask, 0, sizeof(LensParamsMask));
+    mask.zoomPos = true;
+    mask.zoomHwPos = true;
+    mask.isConnected = true;
+    uint8_t response[256];
+    int responseSize = 0;
+    if (!lens.processCommand(command, commandSize, response,
+                             (int)sizeof(response), responseSize, &mask))
+    {
+        cout << "Can't process command" << endl;
+        return false;
+    }
+
+    // Check stream decoder.
+    LensStreamDecoder decoder;
+    decoder.put(response, responseSize);
+    LensStreamFrame frame;
+    if (!decoder.next(frame) || frame.type != LensFrameType::RESPONSE ||
+        frame.size != responseSize)
+    {
+        cout << "Stream decoder doesn't recognize response" << endl;
+        return false;
+    }
+
+    // Decode response.
+    LensParam paramId = LensParam::CUSTOM_1;
+    LensCommand commandId = LensCommand::ZOOM_TELE;
+    bool status = false;
+    float value = 0.0f;
+    LensParams params;
+    if (Lens::decodeResponse(frame.data, frame.size, paramId, commandId,
+                             status, value, &params) != 1)
+    {
+        cout << "Can't decode response" << endl;
+        return false;
+    }
+    if (paramId != LensParam::ZOOM_POS || !status || value != 65535.0f)
+    {
+        cout << "Wrong effective value: " << value << endl;
+        return false;
+    }
+    if (params.zoomPos != 65535 || params.zoomHwPos != 31000 ||
+        !params.isConnected)
+    {
+        cout << "Wrong params snapshot" << endl;
+        return false;
+    }
+
+    cout << "Response with snapshot size: " << responseSize << " bytes" <<
+            endl;
+
+    // Process command without snapshot.
+    Lens::encodeCommand(command, commandSize, LensCommand::FOCUS_TO_POS,
+                        -100.0f);
+    lens.processCommand(command, commandSize, response,
+                        (int)sizeof(response), responseSize);
+    if (responseSize != 14)
+    {
+        cout << "Wrong response size: " << responseSize << endl;
+        return false;
+    }
+    if (Lens::decodeResponse(response, responseSize, paramId, commandId,
+                             status, value) != 0 ||
+        commandId != LensCommand::FOCUS_TO_POS || !status || value != 0.0f)
+    {
+        cout << "Wrong command response" << endl;
+        return false;
+    }
+
+    // Check response buffer size.
+    lens.processCommand(command, commandSize, response, 10, responseSize);
+    if (responseSize != 0)
+    {
+        cout << "Response encoded to small buffer" << endl;
+        return false;
+    }
+
+    // Snapshot doesn't fit buffer: response must be sent without snapshot.
+    Lens::encodeSetParamCommand(command, commandSize, LensParam::ZOOM_POS,
+                                -5.0f);
+    if (!lens.processCommand(command, commandSize, response, 20,
+                             responseSize, &mask) || responseSize != 14 ||
+        response[13] != 0x00)
+    {
+        cout << "Wrong response without snapshot: " << responseSize << endl;
+        return false;
+    }
+    params.zoomPos = 1234;
+    if (Lens::decodeResponse(response, responseSize, paramId, commandId,
+                             status, value, &params) != 1 ||
+        paramId != LensParam::ZOOM_POS || !status || value != 0.0f ||
+        params.zoomPos != 1234)
+    {
+        cout << "Wrong response status without snapshot" << endl;
+        return false;
+    }
+    if (Lens::encodeResponse(response, 20, responseSize, 1,
+                             (int)LensParam::ZOOM_POS, true, 0.0f,
+                             &params, &mask) || responseSize != 0)
+    {
+        cout << "Response with snapshot encoded to small buffer" << endl;
+        return false;
+    }
+
+    // Check wrong snapshot flag.
+    Lens::encodeResponse(response, (int)sizeof(response), responseSize, 1,
+                         (int)LensParam::ZOOM_POS, true, 0.0f);
+    response[13] = 0x02;
+    if (Lens::decodeResponse(response, responseSize, paramId, commandId,
+                             status, value) != -1)
+    {
+        cout << "Wrong snapshot flag accepted" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Params subscription test.
+bool paramsSubscriptionTest()
+{
+    // Encode subscribe command.
+    LensParamsMask mask;
+    memset((void*)&mask, 0, sizeof(LensParamsMask));
+    mask.zoomPos = true;
+    mask.focusPos = true;
+    mask.isConnected = true;
+    uint8_t command[15];
+    int commandSize = 0;
+    Lens::encodeSubscribeCommand(command, commandSize, &mask, 0.0f, true);
+
+    // Check stream decoder.
+    LensStreamDecoder decoder;
+    decoder.put(command, commandSize);
+    LensStreamFrame frame;
+    if (!decoder.next(frame) || frame.type != LensFrameType::SUBSCRIBE)
+    {
+        cout << "Stream decoder doesn't recognize subscribe command" << endl;
+        return false;
+    }
+
+    // Subscribe.
+    LensSubscription subscription;
+    if (!subscription.subscribe(frame.data, frame.size) ||
+        !subscription.isActive() || !subscription.isCompact())
+    {
+        cout << "Can't subscribe" << endl;
+        return false;
+    }
+
+    // First update always sent.
+    LensParams params;
+    params.zoomPos = 1000;
+    params.focusPos = 2000;
+    uint8_t data[256];
+    int size = 0;
+    if (!subscription.update(params, data, (int)sizeof(data), size))
+    {
+        cout << "First update not sent" << endl;
+        return false;
+    }
+
+    // Nothing changed.
+    if (subscription.update(params, data, (int)sizeof(data), size))
+    {
+        cout << "Update sent without changes" << endl;
+        return false;
+    }
+
+    // Not masked field changed.
+    params.irisPos = 300;
+    if (subscription.update(params, data, (int)sizeof(data), size))
+    {
+        cout << "Update sent after not masked field changed" << endl;
+        return false;
+    }
+
+    // Masked field changed.
+    params.zoomPos = 1001;
+    if (!subscription.update(params, data, (int)sizeof(data), size))
+    {
+        cout << "Update not sent after masked field changed" << endl;
+        return false;
+    }
+    LensParams out;
+    if (!out.decode(data, size) || out.zoomPos != 1001)
+    {
+        cout << "Can't decode update" << endl;
+        return false;
+    }
+
+    // Compare traffic with polling: 1000 cycles, zoom moves 5% of cycles.
+    int pollBytes = 0;
+    int pushBytes = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (i % 20 == 0)
+            params.zoomPos += 10;
+        params.encode(data, (int)sizeof(data), size);
+        pollBytes += size + 11;
+        if (subscription.update(params, data, (int)sizeof(data), size))
+            pushBytes += size;
+    }
+    cout << "Polling traffic: " << pollBytes << " bytes, push traffic: " <<
+            pushBytes << " bytes" << endl;
+    if (pushBytes >= pollBytes)
+        return false;
+
+    // Check rate limit.
+    subscription.subscribe(mask, 10.0f);
+    subscription.update(params, data, (int)sizeof(data), size);
+    params.zoomPos += 1;
+    if (subscription.update(params, data, (int)sizeof(data), size))
+    {
+        cout << "Rate limit not applied" << endl;
+        return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(110));
+    if (!subscription.update(params, data, (int)sizeof(data), size))
+    {
+        cout << "Pending change lost" << endl;
+        return false;
+    }
+
+    // Unsubscribe by empty mask.
+    LensParamsMask emptyMask;
+    memset((void*)&emptyMask, 0, sizeof(LensParamsMask));
+    Lens::encodeSubscribeCommand(command, commandSize, &emptyMask, 0.0f);
+    subscription.subscribe(command, commandSize);
+    if (subscription.isActive())
+    {
+        cout << "Subscription not cancelled" << endl;
+        return false;
+    }
+
+    // Mask with timestamps flag only has no params.
+    emptyMask.timestamps = true;
+    Lens::encodeSubscribeCommand(command, commandSize, &emptyMask, 0.0f);
+    subscription.subscribe(command, commandSize);
+    LensParamsPublisher publisher;
+    if (subscription.isActive() ||
+        publisher.addSubscriber(command, commandSize,
+                                [](const LensParamsBuffer&) {}) >= 0)
+    {
+        cout << "Timestamps only subscription is active" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Params publisher test.
+bool paramsPublisherTest()
+{
+    // Two distinct masks for 20 subscribers.
+    LensParamsMask positionMask;
+    memset((void*)&positionMask, 0, sizeof(LensParamsMask));
+    positionMask.zoomPos = true;
+    positionMask.focusPos = true;
+    positionMask.irisPos = true;
+    LensParamsMask allMask;
+
+    LensParamsPublisher publisher;
+    std::atomic<int> receivedCount(0);
+    std::vector<LensParamsBuffer> lastBuffers(20);
+    std::vector<LensParamsSink> sinks;
+    for (int i = 0; i < 20; ++i)
+    {
+        sinks.push_back([&receivedCount, &lastBuffers, i]
+                        (const LensParamsBuffer& buffer)
+        {
+            lastBuffers[i] = buffer;
+            ++receivedCount;
+        });
+        if (i % 2 == 0)
+            publisher.addSubscriber(positionMask, sinks.back());
+        else
+            publisher.addSubscriber(allMask, sinks.back(), 0.0f, true);
+    }
+
+    // Publish params changes.
+    LensParams params;
+    const int changesCount = 1000;
+    std::chrono::time_point<std::chrono::high_resolution_clock> startTime =
+            std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < changesCount; ++i)
+    {
+        params.zoomPos = i;
+        publisher.publish(params);
+    }
+    int publishTimeUs = (int)std::chrono::duration_cast<
+            std::chrono::microseconds>(std::chrono::high_resolution_clock::now()
+                                       - startTime).count();
+
+    // Check encode count and deliveries.
+    if (publisher.getEncodeCount() != 2 * changesCount)
+    {
+        cout << "Wrong encode count: " << publisher.getEncodeCount() << endl;
+        return false;
+    }
+    if (receivedCount != 20 * changesCount)
+    {
+        cout << "Wrong received count: " << receivedCount << endl;
+        return false;
+    }
+
+    // Subscribers with the same mask share the same buffer.
+    if (lastBuffers[0] != lastBuffers[2] || lastBuffers[1] != lastBuffers[3] ||
+        lastBuffers[0] == lastBuffers[1])
+    {
+        cout << "Buffers not shared" << endl;
+        return false;
+    }
+    LensParams out;
+    if (!out.decode((uint8_t*)lastBuffers[1]->data(),
+                    (int)lastBuffers[1]->size()) ||
+        out.zoomPos != changesCount - 1)
+    {
+        cout << "Can't decode buffer" << endl;
+        return false;
+    }
+
+    // Encode for each subscriber separately for comparison.
+    uint8_t data[256];
+    int size = 0;
+    startTime = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < changesCount; ++i)
+    {
+        params.zoomPos = i;
+        for (int j = 0; j < 20; ++j)
+        {
+            if (j % 2 == 0)
+                params.encode(data, 256, size, &positionMask);
+            else
+                params.encodeCompact(data, 256, size, &allMask);
+            sinks[j](std::make_shared<const std::vector<uint8_t>>(
+                         data, data + size));
+        }
+    }
+    int encodeTimeUs = (int)std::chrono::duration_cast<
+            std::chrono::microseconds>(std::chrono::high_resolution_clock::now()
+                                       - startTime).count();
+
+    cout << "Publish time: " << publishTimeUs << " us, encode per subscriber"
+            " time: " << encodeTimeUs << " us" << endl;
+
+    // Nothing changed.
+    if (publisher.publish(params) != 0)
+    {
+        cout << "Update published without changes" << endl;
+        return false;
+    }
+
+    // Ages are current at send time: subscriber added later gets the same
+    // values with ages which include time since encoding.
+    LensParamsPublisher agesPublisher;
+    LensParamsMask agesMask;
+    memset((void*)&agesMask, 0, sizeof(LensParamsMask));
+    agesMask.zoomPos = true;
+    agesMask.timestamps = true;
+    LensParamsBuffer agesBuffer;
+    LensParamsSink agesSink = [&agesBuffer](const LensParamsBuffer& buffer)
+    {
+        agesBuffer = buffer;
+    };
+    params.timestamps[(int)LensParam::ZOOM_POS - 1] =
+            LensParams::getTimeMsec() - 500;
+    agesPublisher.addSubscriber(agesMask, agesSink);
+    agesPublisher.publish(params);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    agesPublisher.addSubscriber(agesMask, agesSink);
+    if (agesPublisher.publish(params) != 1 ||
+        !out.decode((uint8_t*)agesBuffer->data(), (int)agesBuffer->size()) ||
+        out.getAgeMsec(LensParam::ZOOM_POS) < 700)
+    {
+        cout << "Frozen ages sent to new subscriber: " <<
+                out.getAgeMsec(LensParam::ZOOM_POS) << " msec" << endl;
+        return false;
+    }
+
+    // New timestamp of the same value is sent to all subscribers.
+    params.setTimestamp(LensParam::ZOOM_POS);
+    if (agesPublisher.publish(params) != 2 ||
+        !out.decode((uint8_t*)agesBuffer->data(), (int)agesBuffer->size()) ||
+        out.getAgeMsec(LensParam::ZOOM_POS) > 100)
+    {
+        cout << "New timestamp not published" << endl;
+        return false;
+    }
+
+    // Remove subscriber.
+    if (!publisher.removeSubscriber(0) || publisher.removeSubscriber(0) ||
+        publisher.getSubscribersCount() != 19)
+    {
+        cout << "Can't remove subscriber" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Remote lens test.
+bool remoteLensTest()
+{
+    // Prepare lens.
+    SimulatedLens lens;
+    LensParams initParams;
+    initParams.zoomHwWideLimit = 0;
+    initParams.zoomHwTeleLimit = 65535;
+    lens.initLens(initParams);
+
+    // Check UDP and Unix sockets. Subscription lease 2500 msec.
+    const char* servers[2] = {"udp;127.0.0.1;7031;1;2500",
+                              "unix;/tmp/lens_test.sock;1;2500"};
+    const char* clients[2] = {"udp;127.0.0.1;7031", "unix;/tmp/lens_test.sock"};
+    for (int i = 0; i < 2; ++i)
+    {
+        // Start server and connect client.
+        LensServer server;
+        if (!server.start(&lens, servers[i]))
+        {
+            cout << "Can't start server: " << servers[i] << endl;
+            return false;
+        }
+        RemoteLens remoteLens;
+        if (!remoteLens.openLens(clients[i]))
+        {
+            cout << "Can't open remote lens: " << clients[i] << endl;
+            return false;
+        }
+
+        // Client which subscribes and disappears without renewal.
+        LensSocket deadClient;
+        std::chrono::time_point<std::chrono::steady_clock> subscribeTime =
+                std::chrono::steady_clock::now();
+        if (i == 0)
+        {
+            LensParamsMask mask;
+            uint8_t data[15];
+            int size = 0;
+            Lens::encodeSubscribeCommand(data, size, &mask, 0.0f);
+            if (!deadClient.open("udp", "127.0.0.1", 7031, false) ||
+                !deadClient.send(data, size))
+            {
+                cout << "Can't subscribe client" << endl;
+                return false;
+            }
+        }
+
+        // Set param with out of range value. Cache gets clamped value.
+        if (!remoteLens.setParam(LensParam::ZOOM_POS, 70000.0f) ||
+            remoteLens.getParam(LensParam::ZOOM_POS) != 65535.0f ||
+            !remoteLens.isLensConnected())
+        {
+            cout << "Set param error" << endl;
+            return false;
+        }
+        if (remoteLens.executeCommand(LensCommand::RESTART))
+        {
+            cout << "Command status error" << endl;
+            return false;
+        }
+
+        // Command round trip latency.
+        const int commandsCount = 1000;
+        std::chrono::time_point<std::chrono::high_resolution_clock> startTime =
+                std::chrono::high_resolution_clock::now();
+        for (int j = 0; j < commandsCount; ++j)
+        {
+            if (!remoteLens.executeCommand(LensCommand::FOCUS_TO_POS,
+                                           (float)j))
+            {
+                cout << "Command error" << endl;
+                return false;
+            }
+        }
+        int latencyUs = (int)(std::chrono::duration_cast<
+                std::chrono::microseconds>(
+                    std::chrono::high_resolution_clock::now() -
+                    startTime).count() / commandsCount);
+        if (remoteLens.getParam(LensParam::FOCUS_POS) != commandsCount - 1)
+        {
+            cout << "Wrong focus position in cache" << endl;
+            return false;
+        }
+
+        // Telemetry throughput: params change on lens side for 500 msec.
+        int64_t updatesCount = remoteLens.getUpdatesCount();
+        startTime = std::chrono::high_resolution_clock::now();
+        int irisPos = 0;
+        while (std::chrono::high_resolution_clock::now() - startTime <
+               std::chrono::milliseconds(500))
+        {
+            lens.setParam(LensParam::IRIS_POS, (float)(irisPos++ % 65536));
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        int updatesPerSec = (int)((remoteLens.getUpdatesCount() -
+                                   updatesCount) * 2);
+        if (updatesPerSec <= 0 ||
+            remoteLens.getParam(LensParam::IRIS_POS) != lens.getParam(
+                LensParam::IRIS_POS))
+        {
+            cout << "Telemetry error" << endl;
+            return false;
+        }
+
+        // Telemetry doesn't clear initialization string.
+        LensParams remoteParams;
+        remoteLens.getParams(remoteParams);
+        if (remoteParams.initString != clients[i])
+        {
+            cout << "Initialization string cleared" << endl;
+            return false;
+        }
+
+        cout << clients[i] << ": command latency " << latencyUs <<
+                " us, telemetry " << updatesPerSec << " updates/sec" << endl;
+
+        // Subscription without renewal expires, remote lens renews own one.
+        if (i == 0)
+        {
+            if (server.getClientsCount() != 2)
+            {
+                cout << "Wrong number of clients: " <<
+                        server.getClientsCount() << endl;
+                return false;
+            }
+            std::this_thread::sleep_until(subscribeTime +
+                                          std::chrono::milliseconds(3000));
+            if (server.getClientsCount() != 1)
+            {
+                cout << "Subscription not expired" << endl;
+                return false;
+            }
+            deadClient.close();
+        }
+
+        // Unsubscribe on close.
+        remoteLens.closeLens();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (server.getClientsCount() != 0)
+        {
+            cout << "Client not unsubscribed" << endl;
+            return false;
+        }
+    }
+
+    // Late response to timed out request must not be taken as response to
+    // next request with the same ID. Server side answers first request only
+    // after second request is received.
+    LensSocket fakeServer;
+    if (!fakeServer.open("udp", "127.0.0.1", 7032, true))
+    {
+        cout << "Can't open fake server" << endl;
+        return false;
+    }
+    RemoteLens remoteLens;
+    if (!remoteLens.openLens("udp;127.0.0.1;7032;0;100"))
+    {
+        cout << "Can't open remote lens" << endl;
+        return false;
+    }
+    std::atomic<bool> firstResult(true);
+    std::atomic<bool> secondResult(true);
+    std::thread requestThread([&remoteLens, &firstResult, &secondResult]
+    {
+        firstResult.store(remoteLens.executeCommand(LensCommand::ZOOM_STOP));
+        secondResult.store(remoteLens.executeCommand(LensCommand::ZOOM_STOP));
+    });
+    uint32_t sequences[2] = {0, 0};
+    LensSocketAddress address;
+    uint8_t data[256];
+    int requestsCount = 0;
+    std::chrono::time_point<std::chrono::steady_clock> startTime =
+            std::chrono::steady_clock::now();
+    while (requestsCount < 2 && std::chrono::steady_clock::now() - startTime <
+           std::chrono::milliseconds(2000))
+    {
+        int size = fakeServer.receive(data, (int)sizeof(data), 100, &address);
+        LensStreamDecoder decoder;
+        LensStreamFrame frame;
+        decoder.put(data, size);
+        while (decoder.next(frame))
+            if (frame.type == LensFrameType::SEQUENCE && requestsCount < 2)
+                Lens::decodeSequence(frame.data, frame.size,
+                                     sequences[requestsCount++]);
+    }
+
+    // Late response with TRUE status, then actual response with FALSE status.
+    for (int i = 0; i < requestsCount; ++i)
+    {
+        int size = 0;
+        Lens::encodeSequence(data, size, sequences[i]);
+        int responseSize = 0;
+        Lens::encodeResponse(&data[size], (int)sizeof(data) - size,
+                             responseSize, 0, (int)LensCommand::ZOOM_STOP,
+                             i == 0, 0.0f);
+        fakeServer.sendTo(data, size + responseSize, address);
+    }
+    requestThread.join();
+    if (requestsCount != 2 || sequences[0] == sequences[1] ||
+        firstResult.load() || secondResult.load())
+    {
+        cout << "Late response taken for next request" << endl;
+        return false;
+    }
+
+    // Retry after timeout gets own response.
+    std::thread retryThread([&fakeServer, &data, &address]
+    {
+        // Skip subscription renewals.
+        uint32_t sequence = 0;
+        for (int i = 0; i < 10; ++i)
+        {
+            int size = fakeServer.receive(data, (int)sizeof(data), 100,
+                                          &address);
+            if (size >= 7 && Lens::decodeSequence(data, 7, sequence))
+                break;
+            if (i == 9)
+                return;
+        }
+        int responseSize = 0;
+        Lens::encodeResponse(&data[7], (int)sizeof(data) - 7, responseSize, 0,
+                             (int)LensCommand::ZOOM_STOP, true, 0.0f);
+        fakeServer.sendTo(data, 7 + responseSize, address);
+    });
+    bool retryResult = remoteLens.executeCommand(LensCommand::ZOOM_STOP);
+    retryThread.join();
+    if (!retryResult)
+    {
+        cout << "Retry after timeout failed" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+
+// Params shared memory test.
+bool paramsShmTest()
+{
+    // Create segment.
+    LensParamsShm writer;
+    if (!writer.create("/lens_params_test"))
+    {
+        cout << "Can't create segment" << endl;
+        return false;
+    }
+    LensParamsShm reader;
+    if (!reader.open("/lens_params_test"))
+    {
+        cout << "Can't open segment" << endl;
+        return false;
+    }
+
+    // No data yet.
+    LensParams out;
+    if (reader.read(out) || reader.getSequence() != 0)
+    {
+        cout << "Data read from empty segment" << endl;
+        return false;
+    }
+
+    // Write params. Reader can't write.
+    LensParams in;
+    in.zoomPos = 1234;
+    in.focusPos = 1234;
+    in.xFovDeg = 12.5f;
+    in.isConnected = true;
+    if (!writer.write(in) || reader.write(in))
+    {
+        cout << "Write error" << endl;
+        return false;
+    }
+    if (!reader.read(out) || out.zoomPos != 1234 || out.xFovDeg != 12.5f ||
+        !out.isConnected || reader.getSequence() == 0)
+    {
+        cout << "Read error" << endl;
+        return false;
+    }
+
+    // Read keeps initialization string and calibration tables.
+    FovPoint point;
+    point.hwZoomPos = 100;
+    point.xFovDeg = 30.0f;
+    point.yFovDeg = 20.0f;
+    out.initString = "lens0";
+    out.fovPoints.push_back(point);
+    if (!reader.read(out) || out.initString != "lens0" ||
+        out.fovPoints.size() != 1 || out.fovPoints[0].xFovDeg != 30.0f)
+    {
+        cout << "Calibration tables cleared by read" << endl;
+        return false;
+    }
+
+    // Param age includes time between write and read.
+    in.timestamps[(int)LensParam::ZOOM_POS - 1] =
+            LensParams::getTimeMsec() - 500;
+    writer.write(in);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    if (!reader.read(out) || out.getAgeMsec(LensParam::ZOOM_POS) < 700 ||
+        out.getAgeMsec(LensParam::ZOOM_POS) > 1000 ||
+        out.getAgeMsec(LensParam::FOCUS_POS) != -1)
+    {
+        cout << "Wrong param age after delayed read: " <<
+                out.getAgeMsec(LensParam::ZOOM_POS) << " msec" << endl;
+        return false;
+    }
+
+    // Concurrent write and read: zoom and focus positions always equal.
+    std::atomic<bool> stopFlag(false);
+    std::thread writerThread([&writer, &stopFlag]
+    {
+        LensParams params;
+        int i = 0;
+        while (!stopFlag.load())
+        {
+            params.zoomPos = i;
+            params.focusPos = i;
+            writer.write(params);
+            ++i;
+        }
+    });
+    const int readsCount = 100000;
+    int errorsCount = 0;
+    int failedReadsCount = 0;
+    std::chrono::time_point<std::chrono::high_resolution_clock> startTime =
+            std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < readsCount; ++i)
+    {
+        if (!reader.read(out))
+        {
+            ++failedReadsCount;
+            continue;
+        }
+        if (out.zoomPos != out.focusPos)
+            ++errorsCount;
+    }
+    int readTimeNs = (int)(std::chrono::duration_cast<
+            std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now()
+                                      - startTime).count() / readsCount);
+    stopFlag.store(true);
+    writerThread.join();
+
+    cout << "Read time with concurrent writer: " << readTimeNs << " ns, "
+            "failed reads: " << failedReadsCount << endl;
+    if (errorsCount > 0)
+    {
+        cout << "Inconsistent reads: " << errorsCount << endl;
+        return false;
+    }
+
+    // Segment removed when writer closed.
+    reader.close();
+    writer.close();
+    if (reader.open("/lens_params_test"))
+    {
+        cout << "Segment not removed" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Single-flight reader test.
+bool singleFlightReaderTest()
+{
+    // Hardware query takes 5 msec.
+    std::atomic<int> focusFactor(0);
+    LensParamReader reader([&focusFactor](LensParam id)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return id == LensParam::FOCUS_FACTOR ? (float)++focusFactor : 0.0f;
+    });
+
+    // Concurrent reads share one query.
+    const int threadsCount = 8;
+    std::vector<std::thread> threads;
+    std::vector<float> values(threadsCount);
+    for (int i = 0; i < threadsCount; ++i)
+        threads.emplace_back([&reader, &values, i]
+        {
+            values[i] = reader.read(LensParam::FOCUS_FACTOR);
+        });
+    for (auto& thread : threads)
+        thread.join();
+    cout << "Concurrent reads: " << threadsCount << ", hardware queries: " <<
+            reader.getQueriesCount() << endl;
+    if (reader.getQueriesCount() >= threadsCount)
+        return false;
+    for (int i = 0; i < threadsCount; ++i)
+    {
+        if (values[i] < 1.0f || values[i] > (float)reader.getQueriesCount())
+        {
+            cout << "Wrong value: " << values[i] << endl;
+            return false;
+        }
+    }
+
+    // Fresh value from cache.
+    reader.setFreshness(LensParam::FOCUS_FACTOR, 100);
+    float value = reader.read(LensParam::FOCUS_FACTOR);
+    int64_t queriesCount = reader.getQueriesCount();
+    for (int i = 0; i < 10; ++i)
+    {
+        if (reader.read(LensParam::FOCUS_FACTOR) != value)
+        {
+            cout << "Value not cached" << endl;
+            return false;
+        }
+    }
+    if (reader.getQueriesCount() != queriesCount)
+    {
+        cout << "Hardware query for fresh value" << endl;
+        return false;
+    }
+
+    // Invalidated and expired values are read from hardware.
+    reader.invalidate(LensParam::FOCUS_FACTOR);
+    if (reader.read(LensParam::FOCUS_FACTOR) == value ||
+        reader.getQueriesCount() != queriesCount + 1)
+    {
+        cout << "Value not invalidated" << endl;
+        return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(110));
+    reader.read(LensParam::FOCUS_FACTOR);
+    if (reader.getQueriesCount() != queriesCount + 2)
+    {
+        cout << "Value not expired" << endl;
+        return false;
+    }
+
+    // Invalid param ID.
+    if (reader.read((LensParam)0) != -1.0f)
+        return false;
+
+    // Failed hardware query doesn't block next reads.
+    std::atomic<int> irisQueries(0);
+    LensParamReader failReader([&irisQueries](LensParam)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        if (irisQueries++ == 0)
+            throw std::runtime_error("Hardware error");
+        return 10.0f;
+    });
+    threads.clear();
+    std::atomic<int> errorsCount(0);
+    for (int i = 0; i < threadsCount; ++i)
+        threads.emplace_back([&failReader, &errorsCount]
+        {
+            try
+            {
+                failReader.read(LensParam::IRIS_POS);
+            }
+            catch (...)
+            {
+                ++errorsCount;
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+    if (errorsCount.load() != 1 ||
+        failReader.read(LensParam::IRIS_POS) != 10.0f)
+    {
+        cout << "Read after failed query error" << endl;
+        return false;
+    }
+
+    // Read after invalidation doesn't join query started before it. Query
+    // reads hardware value at start and takes 50 msec.
+    std::atomic<int> hwZoomPos(1);
+    LensParamReader slowReader([&hwZoomPos](LensParam)
+    {
+        float result = (float)hwZoomPos.load();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return result;
+    });
+    float oldValue = 0.0f;
+    std::thread slowThread([&slowReader, &oldValue]
+    {
+        oldValue = slowReader.read(LensParam::ZOOM_POS);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    hwZoomPos.store(2);
+    slowReader.invalidate(LensParam::ZOOM_POS);
+    float newValue = slowReader.read(LensParam::ZOOM_POS);
+    slowThread.join();
+    if (oldValue != 1.0f || newValue != 2.0f ||
+        slowReader.getQueriesCount() != 2)
+    {
+        cout << "Stale value after invalidation: " << newValue << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Params timestamps test.
+bool paramsTimestampsTest()
+{
+    // Set timestamps.
+    LensParams in;
+    in.zoomPos = 100;
+    in.custom3 = 3.5f;
+    in.setTimestamp(LensParam::ZOOM_POS);
+    in.setTimestamp(LensParam::CUSTOM_3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    in.setTimestamp(LensParam::FOCUS_POS);
+
+    // Copy keeps timestamps.
+    LensParams copy;
+    copy = in;
+    if (copy.getTimestamp(LensParam::ZOOM_POS) !=
+        in.getTimestamp(LensParam::ZOOM_POS))
+    {
+        cout << "Timestamps not copied" << endl;
+        return false;
+    }
+
+    // Encode and decode in both profiles.
+    LensParamsMask mask;
+    mask.timestamps = true;
+    uint8_t data[512];
+    for (int profile = 0; profile < 2; ++profile)
+    {
+        int size = 0;
+        bool result = profile == 0 ?
+                    in.encode(data, (int)sizeof(data), size, &mask) :
+                    in.encodeCompact(data, (int)sizeof(data), size, &mask);
+        if (!result)
+        {
+            cout << "Can't encode params with timestamps" << endl;
+            return false;
+        }
+        if (LensStreamDecoder::getFrameSize(data, size) != size)
+        {
+            cout << "Wrong frame size: " <<
+                    LensStreamDecoder::getFrameSize(data, size) << " expected "
+                 << size << endl;
+            return false;
+        }
+        LensParams out;
+        if (!out.decode(data, size) || out.custom3 != 3.5f)
+        {
+            cout << "Can't decode params with timestamps" << endl;
+            return false;
+        }
+        int zoomAge = out.getAgeMsec(LensParam::ZOOM_POS);
+        int focusAge = out.getAgeMsec(LensParam::FOCUS_POS);
+        if (zoomAge < 30 || zoomAge > 1000 || focusAge < 0 ||
+            focusAge >= zoomAge || out.getAgeMsec(LensParam::CUSTOM_3) < 30 ||
+            out.getAgeMsec(LensParam::IRIS_POS) != -1)
+        {
+            cout << "Wrong ages: zoom " << zoomAge << " focus " << focusAge <<
+                    endl;
+            return false;
+        }
+        cout << (profile == 0 ? "Full" : "Compact") << " profile size with "
+                "ages: " << size << " bytes" << endl;
+
+        // Data without ages resets timestamps.
+        in.encode(data, (int)sizeof(data), size);
+        if (!out.decode(data, size) ||
+            out.getTimestamp(LensParam::ZOOM_POS) != 0)
+        {
+            cout << "Timestamps not reset" << endl;
+            return false;
+        }
+    }
+
+    // Ages don't trigger subscription updates.
+    LensSubscription subscription;
+    subscription.subscribe(mask, 0.0f);
+    int size = 0;
+    subscription.update(in, data, (int)sizeof(data), size);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    if (subscription.update(in, data, (int)sizeof(data), size))
+    {
+        cout << "Update sent because of ages" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Poll scheduler test.
+bool pollSchedulerTest()
+{
+    // Simulated time. Each poll takes 2 msec of bus time.
+    uint32_t now = 1;
+    LensPollScheduler scheduler([&now]() { return now; });
+
+    // 10 sec of polling. Zoom moves from 2 sec to 4 sec.
+    bool isMoving = false;
+    bool isStarted = false;
+    bool isStopped = false;
+    int boostedPeriod = 0;
+    while (now < 10001)
+    {
+        if (!isStarted && now >= 2001)
+        {
+            scheduler.onCommand(LensCommand::ZOOM_TELE);
+            boostedPeriod = scheduler.getPeriod(LensParam::ZOOM_POS);
+            isStarted = true;
+            isMoving = true;
+        }
+        if (!isStopped && now >= 4001)
+        {
+            scheduler.onCommand(LensCommand::ZOOM_STOP);
+            isStopped = true;
+            isMoving = false;
+        }
+
+        LensParam id;
+        int waitMsec = 0;
+        if (!scheduler.next(id, waitMsec))
+        {
+            now += waitMsec > 0 ? waitMsec : 1;
+            continue;
+        }
+        now += 2;
+
+        // Zoom position and FOV change during motion.
+        float value = 1.0f;
+        if (isMoving && (id == LensParam::ZOOM_POS ||
+                         id == LensParam::ZOOM_HW_POS ||
+                         id == LensParam::X_FOV_DEG ||
+                         id == LensParam::Y_FOV_DEG))
+            value = (float)now;
+        scheduler.onResult(id, value, 2000);
+    }
+
+    LensPollMetrics metrics = scheduler.getMetrics();
+
+    // Fixed rate polling of 50 params every 100 msec takes 100 % of bus
+    // and samples positions every 100 msec.
+    cout << "Polls: " << metrics.pollsCount << ", bus utilization: " <<
+            metrics.busUtilization * 100.0f << " % (fixed rate 100 %)" << endl;
+    cout << "Position sample interval during motion: " <<
+            metrics.positionSampleIntervalMsec << " msec avg, " <<
+            metrics.maxPositionSampleIntervalMsec <<
+            " msec max (fixed rate 100 msec)" << endl;
+
+    if (boostedPeriod != 10)
+    {
+        cout << "Zoom position is not boosted: " << boostedPeriod << endl;
+        return false;
+    }
+    if (metrics.positionSampleIntervalMsec > 12.0f ||
+        metrics.maxPositionSampleIntervalMsec > 30.0f)
+    {
+        cout << "Position sample interval too big" << endl;
+        return false;
+    }
+    if (metrics.busUtilization > 0.5f)
+    {
+        cout << "Bus utilization too high" << endl;
+        return false;
+    }
+
+    // Idle params back off.
+    if (scheduler.getPeriod(LensParam::IS_CONNECTED) <= 1000 ||
+        scheduler.getPeriod(LensParam::ZOOM_POS) <= 100)
+    {
+        cout << "Idle params don't back off" << endl;
+        return false;
+    }
+
+    // Disabled params are not polled.
+    scheduler.setPeriod(LensParam::TEMPERATURE, 0);
+    if (scheduler.getPeriod(LensParam::TEMPERATURE) != 0)
+    {
+        cout << "Param not disabled" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Position predictor test.
+bool positionPredictorTest()
+{
+    // Zoom moves 10000 hardware units per second at hardware speed 50.
+    LensParams params;
+    params.zoomHwWideLimit = 0;
+    params.zoomHwTeleLimit = 30000;
+    params.zoomHwSpeed = 50;
+    FovPoint point;
+    point.hwZoomPos = 30000;
+    point.xFovDeg = 6.0f;
+    point.yFovDeg = 4.5f;
+    params.fovPoints.push_back(point);
+    point.hwZoomPos = 0;
+    point.xFovDeg = 60.0f;
+    point.yFovDeg = 45.0f;
+    params.fovPoints.push_back(point);
+    LensPredictor predictor;
+    predictor.setParams(params);
+
+    // Real zoom position: tele from 1000 to 2500 msec, wide from 4000 msec
+    // to wide limit (5500 msec).
+    auto realPos = [](uint32_t t)
+    {
+        if (t < 1000)
+            return 0.0f;
+        if (t < 2500)
+            return (float)(t - 1000) * 10.0f;
+        if (t < 4000)
+            return 15000.0f;
+        if (t < 5500)
+            return 15000.0f - (float)(t - 4000) * 10.0f;
+        return 0.0f;
+    };
+
+    // Zoom position is polled every 100 msec, video frames every 10 msec.
+    float staleError[2] = {0.0f, 0.0f};
+    float predictedError[2] = {0.0f, 0.0f};
+    float stalePos = 0.0f;
+    for (uint32_t t = 10; t <= 6000; t += 10)
+    {
+        if (t == 1000)
+            predictor.onCommand(LensCommand::ZOOM_TELE, 0.0f, t);
+        if (t == 2500)
+            predictor.onCommand(LensCommand::ZOOM_STOP, 0.0f, t);
+        if (t == 4000)
+            predictor.onCommand(LensCommand::ZOOM_WIDE, 0.0f, t);
+        if (t % 100 == 50)
+        {
+            stalePos = realPos(t);
+            predictor.addSample(LensParam::ZOOM_HW_POS, stalePos, t);
+        }
+
+        float pos = 0.0f;
+        if (!predictor.predict(LensParam::ZOOM_HW_POS, t, pos))
+            continue;
+
+        // First motion: error after two samples (speed gain unknown).
+        // Second motion: whole motion (speed gain learned).
+        int motion = -1;
+        if (t >= 1160 && t < 2700)
+            motion = 0;
+        else if (t >= 4000 && t < 5700)
+            motion = 1;
+        if (motion < 0)
+            continue;
+        float error = std::fabs(pos - realPos(t));
+        if (error > predictedError[motion])
+            predictedError[motion] = error;
+        error = std::fabs(stalePos - realPos(t));
+        if (error > staleError[motion])
+            staleError[motion] = error;
+    }
+
+    cout << "Speed gain learned: " <<
+            predictor.getSpeedGain(LensAxis::ZOOM) << " (real 200)" << endl;
+    cout << "Max error during first motion: predicted " <<
+            predictedError[0] << ", stale " << staleError[0] << endl;
+    cout << "Max error during second motion: predicted " <<
+            predictedError[1] << ", stale " << staleError[1] << endl;
+
+    if (predictedError[0] > 1.0f || predictedError[1] > 1.0f)
+    {
+        cout << "Prediction error too big" << endl;
+        return false;
+    }
+
+    // FOV in the middle of motion which is not sampled yet.
+    predictor.onCommand(LensCommand::ZOOM_TELE, 0.0f, 7000);
+    float xFovDeg = 0.0f;
+    float zoomPos = 0.0f;
+    if (!predictor.predict(LensParam::X_FOV_DEG, 8500, xFovDeg) ||
+        !predictor.predict(LensParam::ZOOM_POS, 8500, zoomPos))
+    {
+        cout << "predict() error" << endl;
+        return false;
+    }
+    if (std::fabs(xFovDeg - 33.0f) > 0.01f ||
+        std::fabs(zoomPos - 32767.5f) > 1.0f)
+    {
+        cout << "Wrong predicted FOV: " << xFovDeg << ", zoom pos: " <<
+                zoomPos << endl;
+        return false;
+    }
+
+    // Position in the past is interpolated between samples.
+    float pos = 0.0f;
+    if (!predictor.predict(LensParam::ZOOM_HW_POS, 5420, pos) ||
+        std::fabs(pos - realPos(5420)) > 1.0f)
+    {
+        cout << "Wrong interpolated position: " << pos << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// State history test.
+bool stateHistoryTest()
+{
+    LensStateHistory history(256);
+
+    // Readers get state between snapshots up to 400 msec in the past.
+    std::atomic<bool> isRunning(true);
+    std::atomic<int64_t> lookups(0);
+    std::atomic<int64_t> errors(0);
+    auto reader = [&]()
+    {
+        uint32_t seed = 1;
+        LensState last, state;
+        while (isRunning.load())
+        {
+            if (!history.getLast(last))
+                continue;
+            seed = seed * 1103515245 + 12345;
+            uint32_t t = last.timeMsec - 1 - 2 * ((seed >> 16) % 200);
+            if (!history.get(t, state) || state.timeMsec != t)
+                continue;
+            ++lookups;
+            if (state.get(LensParam::ZOOM_POS) != (float)t ||
+                state.get(LensParam::FOCUS_POS) != (float)(2 * t) ||
+                state.get(LensParam::FOCUS_MODE) != (float)(t - 1))
+                ++errors;
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    std::thread reader1(reader);
+    std::thread reader2(reader);
+
+    // Writer pushes snapshot every 2 msec of simulated time.
+    std::thread writer([&]()
+    {
+        LensState state;
+        for (uint32_t t = 1000; t < 201000; t += 2)
+        {
+            state.timeMsec = t;
+            state.set(LensParam::ZOOM_POS, (float)t);
+            state.set(LensParam::FOCUS_POS, (float)(2 * t));
+            state.set(LensParam::FOCUS_MODE, (float)t);
+            history.push(state);
+
+            // Let readers run on single core machines.
+            if ((t & 127) == 0)
+                std::this_thread::yield();
+        }
+        isRunning.store(false);
+    });
+    writer.join();
+    reader1.join();
+    reader2.join();
+    double sec = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
+    cout << "Lookups: " << lookups.load() << " (" <<
+            (int64_t)((double)lookups.load() / sec) << " per sec), errors: " <<
+            errors.load() << endl;
+    if (errors.load() != 0 || lookups.load() == 0)
+        return false;
+
+    // Time before oldest snapshot and after last snapshot.
+    LensState state;
+    if (history.get(1000, state))
+    {
+        cout << "Overwritten snapshot returned" << endl;
+        return false;
+    }
+    if (!history.get(500000, state) ||
+        state.get(LensParam::ZOOM_POS) != 200998.0f)
+    {
+        cout << "Last snapshot not returned" << endl;
+        return false;
+    }
+
+    // Snapshot from LensParams.
+    LensParams params;
+    params.xFovDeg = 10.0f;
+    history.push(params, 200998);
+    params.xFovDeg = 20.0f;
+    history.push(params, 201008);
+    if (!history.get(201000, state) ||
+        std::fabs(state.get(LensParam::X_FOV_DEG) - 12.0f) > 0.001f ||
+        history.push(params, 201006))
+    {
+        cout << "Wrong interpolated FOV" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// KLV encoder test.
+bool klvEncoderTest()
+{
+    LensParams params;
+    params.xFovDeg = 90.0f;
+    params.yFovDeg = 45.0f;
+    params.zoomPos = 1234;
+    params.focusPos = 4321;
+
+    // Packet without zoom and focus.
+    LensKlvEncoder encoder;
+    uint8_t data[64];
+    int size = 0;
+    if (!encoder.encode(params, 0x0102030405060708, data, 64, size) ||
+        size != encoder.getPacketSize() || size != 42 ||
+        !LensKlvEncoder::check(data, size))
+    {
+        cout << "encode() error" << endl;
+        return false;
+    }
+
+    // Check items: time stamp, horizontal and vertical FOV, version.
+    const uint8_t items[] = {0x02, 0x08, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+                             0x07, 0x08, 0x10, 0x02, 0x80, 0x00, 0x11, 0x02,
+                             0x40, 0x00, 0x41, 0x01, 19, 0x01, 0x02};
+    if (data[16] != 25 || memcmp(&data[17], items, sizeof(items)) != 0)
+    {
+        cout << "Wrong packet items" << endl;
+        return false;
+    }
+
+    // Corrupted packet.
+    data[20] ^= 0x01;
+    if (LensKlvEncoder::check(data, size))
+    {
+        cout << "Corrupted packet not detected" << endl;
+        return false;
+    }
+
+    // Packet with zoom and focus from lens state.
+    LensKlvEncoder encoder2(100, 101);
+    LensState state;
+    state.set(LensParam::X_FOV_DEG, 90.0f);
+    state.set(LensParam::Y_FOV_DEG, 45.0f);
+    state.set(LensParam::ZOOM_POS, 1234.0f);
+    state.set(LensParam::FOCUS_POS, 4321.0f);
+    if (!encoder2.encode(state, 1, data, 64, size) || size != 50 ||
+        !LensKlvEncoder::check(data, size) ||
+        data[35] != 100 || data[37] != (1234 >> 8) ||
+        data[38] != (1234 & 0xFF) || data[39] != 101 ||
+        data[41] != (4321 >> 8) || data[42] != (4321 & 0xFF))
+    {
+        cout << "Wrong packet with zoom and focus" << endl;
+        return false;
+    }
+
+    // Too small buffer.
+    if (encoder2.encode(state, 1, data, 49, size))
+    {
+        cout << "Too small buffer not detected" << endl;
+        return false;
+    }
+
+    // Tags of items written by encoder and duplicated tag are rejected.
+    const int reservedTags[5] = {1, 2, 16, 17, 65};
+    for (int tag : reservedTags)
+    {
+        LensKlvEncoder encoder3(tag, tag);
+        if (encoder3.getPacketSize() != 42)
+        {
+            cout << "Reserved tag " << tag << " accepted" << endl;
+            return false;
+        }
+    }
+    LensKlvEncoder encoder4(100, 100);
+    if (encoder4.getPacketSize() != 46)
+    {
+        cout << "Duplicated tag accepted" << endl;
+        return false;
+    }
+
+    // NaN values are written as 0.
+    state.set(LensParam::X_FOV_DEG, NAN);
+    state.set(LensParam::ZOOM_POS, NAN);
+    if (!encoder2.encode(state, 1, data, 64, size) ||
+        !LensKlvEncoder::check(data, size) || data[29] != 0 ||
+        data[30] != 0 || data[37] != 0 || data[38] != 0)
+    {
+        cout << "Wrong NaN values" << endl;
+        return false;
+    }
+
+    // Encoding time.
+    const int count = 1000000;
+    uint32_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+        params.zoomPos = i & 0xFFFF;
+        encoder2.encode(params, (uint64_t)i, data, 64, size);
+        sum += data[size - 1];
+    }
+    double usec = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+    cout << "Encoding time: " << usec * 1000.0 / count << " nsec per packet ("
+         << (int64_t)(count / usec * 1000000.0 / 60.0) <<
+         " streams at 60 fps per core), checksum " << sum << endl;
+
+    return true;
+}
+
+
+
+// Focus tracker test.
+bool focusTrackerTest()
+{
+    // Focus model: linear in zoom and in inverse object distance.
+    auto realFocus = [](float zoom, float inverseDistance)
+    {
+        return 10000.0f + 0.3f * zoom +
+               20000.0f * inverseDistance * (1.0f + zoom / 30000.0f);
+    };
+
+    // Tracking curves for infinity, 10 m and 2 m.
+    LensParams params;
+    params.focusHwNearLimit = 0;
+    params.focusHwFarLimit = 65535;
+    const float distances[] = {10.0f, 0.0f, 2.0f};
+    for (float distance : distances)
+    {
+        TrackingCurve curve;
+        curve.distanceM = distance;
+        for (int zoom = 30000; zoom >= 0; zoom -= 1000)
+        {
+            TrackingPoint point;
+            point.hwZoomPos = zoom;
+            point.hwFocusPos = (int)realFocus(
+                        (float)zoom, distance > 0.0f ? 1.0f / distance : 0.0f);
+            curve.points.push_back(point);
+        }
+        params.trackingCurves.push_back(curve);
+    }
+
+    // Curves must survive serialization, JSON and copy.
+    int size = 0;
+    std::vector<uint8_t> data(params.getSerializedSize());
+    LensParams out;
+    if (!params.serialize(data.data(), (int)data.size(), size) ||
+        !out.deserialize(data.data(), size) ||
+        out.trackingCurves.size() != 3 ||
+        out.trackingCurves[2].distanceM != 2.0f ||
+        out.trackingCurves[2].points.size() != 31 ||
+        out.trackingCurves[2].points[30].hwFocusPos !=
+        params.trackingCurves[2].points[30].hwFocusPos)
+    {
+        cout << "Tracking curves not serialized" << endl;
+        return false;
+    }
+
+    // Tracking curves section is required: data cut before it is rejected.
+    std::vector<uint8_t> cutData(data.begin(), data.begin() + size -
+                                 (4 + 3 * (8 + 31 * 8) + 4));
+    uint32_t cutSize = (uint32_t)cutData.size();
+    memcpy(&cutData[3], &cutSize, 4);
+    if (out.deserialize(cutData.data(), (int)cutData.size()))
+    {
+        cout << "Data without tracking curves deserialized" << endl;
+        return false;
+    }
+    cr::utils::ConfigReader inConfig;
+    inConfig.set(params, "lensParams");
+    inConfig.writeToFile("TestLensParams.json");
+    cr::utils::ConfigReader outConfig;
+    LensParams jsonParams;
+    if (!outConfig.readFromFile("TestLensParams.json") ||
+        !outConfig.get(jsonParams, "lensParams") ||
+        jsonParams.trackingCurves.size() != 3 ||
+        jsonParams.trackingCurves[1].points[5].hwZoomPos !=
+        params.trackingCurves[1].points[5].hwZoomPos)
+    {
+        cout << "Tracking curves not read from JSON" << endl;
+        return false;
+    }
+    LensParams copy;
+    copy = params;
+    if (copy.trackingCurves.size() != 3 ||
+        copy.trackingCurves[0].points.size() != 31)
+    {
+        cout << "Tracking curves not copied" << endl;
+        return false;
+    }
+
+    // Lock tracker to object at 4 m at wide position.
+    LensFocusTracker tracker;
+    tracker.setParams(params);
+    float distance = 0.0f;
+    if (!tracker.lock(0.0f, realFocus(0.0f, 0.25f)) ||
+        !tracker.getDistance(0.0f, realFocus(0.0f, 0.25f), distance) ||
+        std::fabs(distance - 4.0f) > 0.01f)
+    {
+        cout << "Wrong object distance: " << distance << endl;
+        return false;
+    }
+
+    // Zoom to tele. Focus must follow curve within deadband (64).
+    int commandsCount = 0;
+    float focusPos = 0.0f;
+    float maxError = 0.0f;
+    for (int zoom = 0; zoom <= 30000; zoom += 50)
+    {
+        float pos = 0.0f;
+        if (tracker.update((float)zoom, pos, 64.0f))
+        {
+            focusPos = pos;
+            ++commandsCount;
+        }
+        float error = std::fabs(focusPos - realFocus((float)zoom, 0.25f));
+        if (error > maxError)
+            maxError = error;
+    }
+
+    cout << "FOCUS_TO_POS commands: " << commandsCount <<
+            " for 601 zoom steps, max focus error: " << maxError << endl;
+    if (maxError > 65.0f || commandsCount < 2 || commandsCount >= 601)
+    {
+        cout << "Focus doesn't follow zoom" << endl;
+        return false;
+    }
+
+    // Unlocked tracker doesn't send commands.
+    tracker.unlock();
+    if (tracker.update(0.0f, focusPos))
+    {
+        cout << "Unlocked tracker sent command" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Focus tracking by lens controller test.
+bool lensFocusTrackingTest()
+{
+    // Focus model: linear in zoom and in inverse object distance.
+    auto realFocus = [](float zoom, float inverseDistance)
+    {
+        return 10000.0f + 0.3f * zoom +
+               20000.0f * inverseDistance * (1.0f + zoom / 30000.0f);
+    };
+
+    // Lens with tracking curves for infinity, 10 m and 2 m.
+    LensParams params;
+    params.zoomHwWideLimit = 0;
+    params.zoomHwTeleLimit = 30000;
+    params.zoomHwMaxSpeed = 100;
+    params.zoomHwSpeed = 100;
+    params.focusHwNearLimit = 0;
+    params.focusHwFarLimit = 65535;
+    const float distances[] = {10.0f, 0.0f, 2.0f};
+    for (float distance : distances)
+    {
+        TrackingCurve curve;
+        curve.distanceM = distance;
+        for (int zoom = 30000; zoom >= 0; zoom -= 1000)
+        {
+            TrackingPoint point;
+            point.hwZoomPos = zoom;
+            point.hwFocusPos = (int)realFocus(
+                        (float)zoom, distance > 0.0f ? 1.0f / distance : 0.0f);
+            curve.points.push_back(point);
+        }
+        params.trackingCurves.push_back(curve);
+    }
+    SimulatedLens lens;
+    lens.initLens(params);
+    lens.setZoomRate(10000.0f);
+
+    // Focus on object at 4 m at wide position locks tracker.
+    lens.executeCommand(LensCommand::FOCUS_TO_POS, realFocus(0.0f, 0.25f));
+
+    // Zoom to tele: focus follows zoom motion.
+    lens.executeCommand(LensCommand::ZOOM_TO_POS, 65535.0f);
+    float maxError = 0.0f;
+    for (int i = 0; i < 400; ++i)
+    {
+        lens.advance(0.01f);
+        float zoom = lens.getParam(LensParam::ZOOM_HW_POS);
+        float focus = lens.getParam(LensParam::FOCUS_HW_POS);
+        maxError = std::max(maxError,
+                            std::fabs(focus - realFocus(zoom, 0.25f)));
+    }
+    cout << "Max focus error during zoom: " << maxError << " (focus change " <<
+            realFocus(30000.0f, 0.25f) - realFocus(0.0f, 0.25f) << ")" << endl;
+    if (lens.getParam(LensParam::ZOOM_HW_POS) != 30000.0f || maxError > 100.0f)
+    {
+        cout << "Focus doesn't follow zoom" << endl;
+        return false;
+    }
+
+    // Manual focus unlocks tracker: focus stays while zooming.
+    lens.executeCommand(LensCommand::FOCUS_FAR);
+    const float focus = lens.getParam(LensParam::FOCUS_HW_POS);
+    lens.executeCommand(LensCommand::ZOOM_TO_POS, 0.0f);
+    lens.advance(4.0f);
+    if (lens.getParam(LensParam::ZOOM_HW_POS) != 0.0f ||
+        lens.getParam(LensParam::FOCUS_HW_POS) != focus)
+    {
+        cout << "Focus moved by unlocked tracker" << endl;
+        return false;
+    }
+
+    // End of autofocus locks tracker again.
+    lens.executeCommand(LensCommand::AF_START);
+    lens.executeCommand(LensCommand::FOCUS_TO_POS, realFocus(0.0f, 0.1f));
+    lens.executeCommand(LensCommand::AF_STOP);
+    lens.executeCommand(LensCommand::ZOOM_TO_POS, 65535.0f);
+    lens.advance(4.0f);
+    if (std::fabs(lens.getParam(LensParam::FOCUS_HW_POS) -
+                  realFocus(30000.0f, 0.1f)) > 100.0f)
+    {
+        cout << "Focus doesn't follow zoom after autofocus" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Zoom to FOV test.
+bool zoomToFovTest()
+{
+    // FOV table: 60 degree at wide, 2 degree at tele.
+    LensParams params;
+    params.zoomHwWideLimit = 0;
+    params.zoomHwTeleLimit = 50000;
+    const float fov[] = {60.0f, 30.0f, 12.0f, 5.0f, 2.0f};
+    for (int i = 4; i >= 0; --i)
+    {
+        FovPoint point;
+        point.hwZoomPos = i * 12500;
+        point.xFovDeg = fov[i];
+        point.yFovDeg = fov[i] * 0.75f;
+        params.fovPoints.push_back(point);
+    }
+
+    // Inverse lookup must return position with requested FOV.
+    LensFovTable table(params.fovPoints);
+    for (float xFovDeg = 2.0f; xFovDeg <= 60.0f; xFovDeg += 0.5f)
+    {
+        float hwZoomPos = 0.0f, x = 0.0f, y = 0.0f;
+        if (!table.getHwZoomPos(xFovDeg, hwZoomPos) ||
+            !table.getFov(hwZoomPos, x, y) || std::fabs(x - xFovDeg) > 0.001f)
+        {
+            cout << "Wrong inverse lookup for " << xFovDeg << endl;
+            return false;
+        }
+    }
+    float hwZoomPos = 0.0f;
+    if (!table.getHwZoomPos(90.0f, hwZoomPos) || hwZoomPos != 0.0f ||
+        !table.getHwZoomPos(1.0f, hwZoomPos) || hwZoomPos != 50000.0f)
+    {
+        cout << "Wrong inverse lookup out of range" << endl;
+        return false;
+    }
+
+    // Not monotonic table: first position with requested FOV.
+    std::vector<FovPoint> points(3);
+    points[0].hwZoomPos = 0;
+    points[0].xFovDeg = 10.0f;
+    points[1].hwZoomPos = 100;
+    points[1].xFovDeg = 20.0f;
+    points[2].hwZoomPos = 200;
+    points[2].xFovDeg = 0.0f;
+    LensFovTable bumpTable(points);
+    if (!bumpTable.getHwZoomPos(15.0f, hwZoomPos) || hwZoomPos != 50.0f)
+    {
+        cout << "Wrong inverse lookup in not monotonic table: " <<
+                hwZoomPos << endl;
+        return false;
+    }
+
+    // Dense table lookup time.
+    std::vector<FovPoint> densePoints(10000);
+    for (int i = 0; i < 10000; ++i)
+    {
+        densePoints[i].hwZoomPos = i * 5;
+        densePoints[i].xFovDeg = 60.0f / (1.0f + (float)i / 200.0f);
+    }
+    LensFovTable denseTable(densePoints);
+    const int count = 1000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+        denseTable.getHwZoomPos(1.2f + (float)(i % 5800) / 100.0f, hwZoomPos);
+    double nsec = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / count;
+    cout << "Inverse lookup time (10000 points): " << nsec << " nsec" << endl;
+
+    // One command moves lens to requested FOV.
+    SimulatedLens lens;
+    lens.initLens(params);
+    uint8_t command[11];
+    int commandSize = 0;
+    Lens::encodeCommand(command, commandSize, LensCommand::ZOOM_TO_FOV, 20.0f);
+    LensStreamDecoder decoder;
+    LensStreamFrame frame;
+    decoder.put(command, commandSize);
+    if (!decoder.next(frame) || frame.type != LensFrameType::COMMAND ||
+        !lens.decodeAndExecuteCommand(frame.data, frame.size))
+    {
+        cout << "ZOOM_TO_FOV command not executed" << endl;
+        return false;
+    }
+    float xFovDeg = lens.getParam(LensParam::X_FOV_DEG);
+    cout << "FOV after ZOOM_TO_FOV(20): " << xFovDeg << " degree, zoom pos " <<
+            lens.getParam(LensParam::ZOOM_POS) << endl;
+    if (std::fabs(xFovDeg - 20.0f) > 0.01f)
+        return false;
+
+    return true;
+}
+
+
+
+// Angle converter test.
+bool angleConverterTest()
+{
+    LensAngleConverter converter;
+    if (converter.set(0.0f, 10.0f, 1920, 1080) ||
+        converter.set(10.0f, 10.0f, 0, 1080))
+    {
+        cout << "Invalid params accepted" << endl;
+        return false;
+    }
+
+    // FOV from lens state.
+    const int width = 1920;
+    const int height = 1080;
+    const float xFov = 60.0f;
+    const float yFov = 2.0f * (float)(std::atan(std::tan(30.0 * TEST_PI / 180.0)
+                       * height / width) * 180.0 / TEST_PI);
+    LensState state;
+    state.set(LensParam::X_FOV_DEG, xFov);
+    state.set(LensParam::Y_FOV_DEG, yFov);
+    if (!converter.set(state, width, height))
+    {
+        cout << "set() error" << endl;
+        return false;
+    }
+
+    // Points over whole frame.
+    const int count = 10000;
+    std::vector<float> x(count), y(count), az(count), el(count);
+    std::vector<float> x2(count), y2(count);
+    for (int i = 0; i < count; ++i)
+    {
+        x[i] = (float)((i * 7919) % width) + 0.5f;
+        y[i] = (float)((i * 104729) % height) + 0.5f;
+    }
+    converter.toAngles(x.data(), y.data(), az.data(), el.data(), count);
+    converter.toPixels(az.data(), el.data(), x2.data(), y2.data(), count);
+
+    // Compare with standard functions.
+    double fx = width / 2.0 / std::tan(xFov / 2.0 * TEST_PI / 180.0);
+    double fy = height / 2.0 / std::tan(yFov / 2.0 * TEST_PI / 180.0);
+    double maxAngleError = 0.0;
+    double maxPixelError = 0.0;
+    for (int i = 0; i < count; ++i)
+    {
+        double a = std::atan((x[i] - width / 2.0) / fx) * 180.0 / TEST_PI;
+        double e = std::atan((height / 2.0 - y[i]) / fy) * 180.0 / TEST_PI;
+        maxAngleError = std::max(maxAngleError, std::fabs(a - az[i]));
+        maxAngleError = std::max(maxAngleError, std::fabs(e - el[i]));
+        maxPixelError = std::max(maxPixelError,
+                                 (double)std::fabs(x[i] - x2[i]));
+        maxPixelError = std::max(maxPixelError,
+                                 (double)std::fabs(y[i] - y2[i]));
+    }
+    cout << "Max angle error: " << maxAngleError <<
+            " deg, max round trip error: " << maxPixelError << " pix" << endl;
+    if (maxAngleError > 0.0001 || maxPixelError > 0.01 ||
+        std::fabs(az[0] + xFov / 2.0f) > 0.1f)
+    {
+        cout << "Wrong conversion" << endl;
+        return false;
+    }
+
+    // Conversion time compared to standard functions.
+    const int n = 1000;
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < n; ++k)
+    {
+        x[k] += 0.001f;
+        converter.toAngles(x.data(), y.data(), az.data(), el.data(), count);
+    }
+    double usec = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int k = 0; k < n; ++k)
+    {
+        x[k] += 0.001f;
+        for (int i = 0; i < count; ++i)
+        {
+            az[i] = (float)(std::atan((x[i] - width / 2.0f) / fx) *
+                    180.0 / TEST_PI);
+            el[i] = (float)(std::atan((height / 2.0f - y[i]) / fy) *
+                    180.0 / TEST_PI);
+        }
+    }
+    double stdUsec = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+    cout << "toAngles() time for " << count << " points: " << usec / n <<
+            " usec (std::atan " << stdUsec / n << " usec)" << endl;
+
+    return true;
+}
+
+
+
+// Distortion model test.
+bool distortionTest()
+{
+    // Strong barrel distortion at wide angle.
+    LensParams params;
+    for (int i = 0; i <= 10; ++i)
+    {
+        FovPoint fovPoint;
+        fovPoint.hwZoomPos = i * 6000;
+        fovPoint.xFovDeg = 60.0f - 5.0f * i;
+        fovPoint.yFovDeg = fovPoint.xFovDeg * 9.0f / 16.0f;
+        params.fovPoints.push_back(fovPoint);
+    }
+    DistortionPoint point;
+    point.hwZoomPos = 60000;
+    params.distortionPoints.push_back(point);
+    point.hwZoomPos = 0;
+    point.k1 = -0.3f;
+    point.k2 = 0.1f;
+    point.p1 = 0.001f;
+    params.distortionPoints.push_back(point);
+
+    // Serialize and deserialize.
+    std::vector<uint8_t> data(params.getSerializedSize());
+    int size = 0;
+    LensParams out;
+    if (!params.serialize(data.data(), (int)data.size(), size) ||
+        !out.deserialize(data.data(), size) ||
+        out.distortionPoints.size() != 2 ||
+        out.distortionPoints[1].k2 != 0.1f ||
+        out.distortionPoints[1].p1 != 0.001f)
+    {
+        cout << "Distortion points not serialized" << endl;
+        return false;
+    }
+
+    // Interpolated coefficients.
+    LensDistortion distortion(2, 64);
+    distortion.setParams(params);
+    DistortionPoint k;
+    if (!distortion.getCoefficients(15000.0f, k) ||
+        std::fabs(k.k1 + 0.225f) > 0.0001f ||
+        std::fabs(k.k2 - 0.075f) > 0.0001f || k.hwZoomPos != 15000)
+    {
+        cout << "Wrong coefficients" << endl;
+        return false;
+    }
+
+    // Remap table requires frame size.
+    if (distortion.getRemapTable(0.0f) != nullptr ||
+        !distortion.setFrameSize(640, 360))
+    {
+        cout << "Remap table without frame size" << endl;
+        return false;
+    }
+
+    // Center is not moved, corners are taken closer to center (barrel).
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<const LensRemapTable> table =
+            distortion.getRemapTable(10.0f);
+    double calcUsec = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+    if (table == nullptr || table->width != 640 ||
+        table->hwZoomPos != 0.0f)
+    {
+        cout << "getRemapTable() error" << endl;
+        return false;
+    }
+    int center = 180 * 640 + 320;
+    if (std::fabs(table->mapX[center] - 320.0f) > 0.6f ||
+        std::fabs(table->mapY[center] - 180.0f) > 0.6f ||
+        table->mapX[0] <= 0.0f || table->mapY[0] <= 0.0f)
+    {
+        cout << "Wrong remap table" << endl;
+        return false;
+    }
+
+    // Tables for close positions are taken from cache.
+    start = std::chrono::steady_clock::now();
+    std::shared_ptr<const LensRemapTable> table2 =
+            distortion.getRemapTable(20.0f);
+    double cacheUsec = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+    if (table2 != table || distortion.getCalculatedCount() != 1)
+    {
+        cout << "Table not cached" << endl;
+        return false;
+    }
+    cout << "Table calculation: " << calcUsec << " usec, cache lookup: " <<
+            cacheUsec << " usec" << endl;
+
+    // Least recently used table is dropped, but still valid for user.
+    distortion.getRemapTable(30000.0f);
+    distortion.getRemapTable(0.0f);
+    distortion.getRemapTable(60000.0f);
+    distortion.getRemapTable(0.0f);
+    if (distortion.getCalculatedCount() != 3 || table->mapX.size() != 640 * 360)
+    {
+        cout << "Wrong cache eviction" << endl;
+        return false;
+    }
+
+    // No distortion at tele: image is not changed.
+    table = distortion.getRemapTable(60000.0f);
+    std::vector<uint8_t> src(640 * 360 * 3);
+    std::vector<uint8_t> dst(src.size());
+    for (size_t i = 0; i < src.size(); ++i)
+        src[i] = (uint8_t)(i * 7);
+    table->remap(src.data(), dst.data(), 3);
+    if (dst != src)
+    {
+        cout << "Wrong remap" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Calibration table test.
+bool calibrationTableTest()
+{
+    // Dense FOV table.
+    LensParams params;
+    std::vector<FovPoint> points(10000);
+    for (int i = 0; i < 10000; ++i)
+    {
+        points[i].hwZoomPos = i * 5;
+        points[i].xFovDeg = 60.0f - (float)i * 0.005f;
+        points[i].yFovDeg = 40.0f - (float)i * 0.003f;
+    }
+    params.fovPoints = points;
+
+    // Copy shares points.
+    LensParams copy;
+    copy = params;
+    if (!copy.fovPoints.isSharedWith(params.fovPoints) ||
+        copy.fovPoints.size() != 10000)
+    {
+        cout << "Points not shared" << endl;
+        return false;
+    }
+
+    // Reading by const reference doesn't copy points.
+    const LensParams& constCopy = copy;
+    float fovSum = 0.0f;
+    for (auto& point : constCopy.fovPoints)
+        fovSum += point.xFovDeg;
+    fovSum += constCopy.fovPoints[5].xFovDeg +
+              constCopy.fovPoints.front().yFovDeg;
+    if (!copy.fovPoints.isSharedWith(params.fovPoints) || fovSum <= 0.0f)
+    {
+        cout << "Points copied on read" << endl;
+        return false;
+    }
+
+    // Change of copy by std::vector interface doesn't change source.
+    copy.fovPoints[5].xFovDeg = 1.0f;
+    if (copy.fovPoints.isSharedWith(params.fovPoints) ||
+        constCopy.fovPoints[5].xFovDeg != 1.0f ||
+        params.fovPoints.get()[5].xFovDeg == 1.0f ||
+        copy.fovPoints == params.fovPoints)
+    {
+        cout << "Copy on write error" << endl;
+        return false;
+    }
+    LensParams sorted;
+    sorted = params;
+    std::sort(sorted.fovPoints.begin(), sorted.fovPoints.end(),
+              [](const FovPoint& a, const FovPoint& b)
+    {
+        return a.hwZoomPos > b.hwZoomPos;
+    });
+    if (sorted.fovPoints.isSharedWith(params.fovPoints) ||
+        sorted.fovPoints.get().front().hwZoomPos != 49995 ||
+        params.fovPoints.get().front().hwZoomPos != 0)
+    {
+        cout << "Sort of copy error" << endl;
+        return false;
+    }
+
+    // Identical tables of different lenses are interned to one table.
+    std::vector<uint8_t> data(params.getSerializedSize());
+    int size = 0;
+    params.serialize(data.data(), (int)data.size(), size);
+    std::vector<LensParams> lenses(200);
+    for (LensParams& lens : lenses)
+    {
+        if (!lens.deserialize(data.data(), size) ||
+            !lens.fovPoints.isSharedWith(lenses[0].fovPoints) ||
+            lens.fovPoints != params.fovPoints)
+        {
+            cout << "Tables not interned" << endl;
+            return false;
+        }
+    }
+    if (CalibrationTable<FovPoint>::getInternedCount() != 1)
+    {
+        cout << "Wrong number of interned tables: " <<
+                CalibrationTable<FovPoint>::getInternedCount() << endl;
+        return false;
+    }
+
+    // Interned table is not changed.
+    lenses[1].fovPoints.push_back(points[0]);
+    if (lenses[0].fovPoints.size() != 10000 ||
+        lenses[1].fovPoints.size() != 10001)
+    {
+        cout << "Interned table changed" << endl;
+        return false;
+    }
+
+    // Tables read from JSON are interned too.
+    cr::utils::ConfigReader config;
+    config.set(lenses[0], "lensParams");
+    LensParams json1;
+    LensParams json2;
+    if (!config.get(json1, "lensParams") ||
+        !config.get(json2, "lensParams") ||
+        !json1.fovPoints.isSharedWith(json2.fovPoints) ||
+        !json1.fovPoints.isSharedWith(lenses[0].fovPoints))
+    {
+        cout << "Tables from JSON not interned" << endl;
+        return false;
+    }
+
+    // Copy time compared to std::vector.
+    const int count = 10000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+        copy = lenses[i % 200];
+        copy.zoomPos = i;
+    }
+    double usec = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+    std::vector<FovPoint> vectorCopy;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+        vectorCopy = points;
+        vectorCopy[0].hwZoomPos = i;
+    }
+    double vectorUsec = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+    cout << "LensParams copy: " << usec / count << " usec (copy of "
+         "std::vector with 10000 points: " << vectorUsec / count << " usec)"
+         << endl;
+
+    return true;
+}
+
+
+
+// FOV points loader test.
+bool fovLoaderTest()
+{
+    // Dense FOV table.
+    std::vector<FovPoint> points(10000);
+    for (int i = 0; i < 10000; ++i)
+    {
+        points[i].hwZoomPos = i * 5 - 1000;
+        points[i].xFovDeg = 60.0f / (1.0f + (float)i * 0.003f);
+        points[i].yFovDeg = 1.0e-3f + (float)i * 3.1e-7f;
+    }
+    if (!LensFovLoader::writeCsv("TestFovPoints.csv", points) ||
+        !LensFovLoader::writeBinary("TestFovPoints.bin", points))
+    {
+        cout << "Can't write files" << endl;
+        return false;
+    }
+
+    // Binary file must be little-endian on any host.
+    uint8_t header[16] = {0};
+    FILE* file = fopen("TestFovPoints.bin", "rb");
+    size_t headerSize = file ? fread(header, 1, 16, file) : 0;
+    if (file)
+        fclose(file);
+    const uint8_t expected[16] = {'L', 'F', 'O', 'V', 1, 0, 0, 0,
+                                  0x10, 0x27, 0, 0, 0x18, 0xFC, 0xFF, 0xFF};
+    if (headerSize != 16 || memcmp(header, expected, 16) != 0)
+    {
+        cout << "Binary file is not little-endian" << endl;
+        return false;
+    }
+    LensParams jsonParams;
+    jsonParams.fovPoints = points;
+    cr::utils::ConfigReader config;
+    config.set(jsonParams, "lensParams");
+    config.writeToFile("TestFovPoints.json");
+
+    // Read files and measure time.
+    CalibrationTable<FovPoint> csv;
+    CalibrationTable<FovPoint> binary;
+    CalibrationTable<FovPoint> mapped;
+    auto start = std::chrono::steady_clock::now();
+    bool result = LensFovLoader::readCsv("TestFovPoints.csv", csv);
+    auto csvTime = std::chrono::steady_clock::now();
+    result = LensFovLoader::readBinary("TestFovPoints.bin", binary, false) &&
+             result;
+    auto binaryTime = std::chrono::steady_clock::now();
+    result = LensFovLoader::readBinary("TestFovPoints.bin", mapped, true) &&
+             result;
+    auto mappedTime = std::chrono::steady_clock::now();
+    cr::utils::ConfigReader jsonConfig;
+    result = jsonConfig.readFromFile("TestFovPoints.json") &&
+             jsonConfig.get(jsonParams, "lensParams") && result;
+    auto jsonTime = std::chrono::steady_clock::now();
+    if (!result)
+    {
+        cout << "Can't read files" << endl;
+        return false;
+    }
+    auto msec = [](std::chrono::steady_clock::time_point t1,
+                   std::chrono::steady_clock::time_point t2)
+    {
+        return std::chrono::duration<double, std::milli>(t2 - t1).count();
+    };
+    cout << "10000 points: CSV " << msec(start, csvTime) << " msec, binary " <<
+            msec(csvTime, binaryTime) << " msec, mmap " <<
+            msec(binaryTime, mappedTime) << " msec, JSON " <<
+            msec(mappedTime, jsonTime) << " msec" << endl;
+
+    // Values are restored exactly and tables are shared.
+    if (csv.get() != points || binary.get() != points ||
+        mapped.get() != points)
+    {
+        cout << "Wrong points" << endl;
+        return false;
+    }
+    if (!csv.isSharedWith(binary) || !csv.isSharedWith(mapped) ||
+        !csv.isSharedWith(jsonParams.fovPoints))
+    {
+        cout << "Tables not shared" << endl;
+        return false;
+    }
+
+    // CSV with header, comments, different separators and without line feed
+    // at the end.
+    FILE* f = fopen("TestFovPoints.csv", "wb");
+    fprintf(f, "# Test table\r\nzoom;xFov;yFov\r\n\r\n  0; 60.5; 40\r\n"
+               "# Point 2\n1000\t3.25e1\t-1.5E-1\n2000 , +.5 , 7.");
+    fclose(f);
+    if (!LensFovLoader::readCsv("TestFovPoints.csv", csv) || csv.size() != 3 ||
+        csv[0].hwZoomPos != 0 || csv[0].xFovDeg != 60.5f ||
+        csv[0].yFovDeg != 40.0f || csv[1].hwZoomPos != 1000 ||
+        csv[1].xFovDeg != 32.5f || csv[1].yFovDeg != -0.15f ||
+        csv[2].hwZoomPos != 2000 || csv[2].xFovDeg != 0.5f ||
+        csv[2].yFovDeg != 7.0f)
+    {
+        cout << "Wrong CSV parsing" << endl;
+        return false;
+    }
+
+    // Wrong files.
+    f = fopen("TestFovPoints.csv", "wb");
+    fprintf(f, "0,60,40\n1000,30\n");
+    fclose(f);
+    f = fopen("TestFovPoints.bin", "r+b");
+    fseek(f, 8, SEEK_SET);
+    uint32_t count = 10001;
+    fwrite(&count, 4, 1, f);
+    fclose(f);
+    if (LensFovLoader::readCsv("TestFovPoints.csv", csv) ||
+        LensFovLoader::readBinary("TestFovPoints.bin", binary, false) ||
+        LensFovLoader::readBinary("TestFovPoints.bin", mapped, true) ||
+        LensFovLoader::readCsv("NotExistingFile.csv", csv) ||
+        csv.size() != 3 || binary.size() != 10000)
+    {
+        cout << "Wrong files accepted" << endl;
+        return false;
+    }
+
+    // Huge number of points in header is rejected without allocation.
+    f = fopen("TestFovPoints.bin", "r+b");
+    fseek(f, 8, SEEK_SET);
+    count = 0xFFFFFFFF;
+    fwrite(&count, 4, 1, f);
+    fclose(f);
+    if (LensFovLoader::readBinary("TestFovPoints.bin", binary, false) ||
+        LensFovLoader::readBinary("TestFovPoints.bin", mapped, true))
+    {
+        cout << "Huge number of points accepted" << endl;
+        return false;
+    }
+    remove("TestFovPoints.csv");
+    remove("TestFovPoints.bin");
+    remove("TestFovPoints.json");
+
+    return true;
+}
+
+
+
+// Lens group test.
+bool lensGroupTest()
+{
+    // Day lens: 30x, 60-2 degree. Thermal lens: 4x, 40-10 degree with
+    // nonlinear FOV curve.
+    LensParams dayParams;
+    dayParams.zoomHwWideLimit = 1000;
+    dayParams.zoomHwTeleLimit = 51000;
+    LensParams thermalParams;
+    thermalParams.zoomHwWideLimit = 0;
+    thermalParams.zoomHwTeleLimit = 10000;
+    std::vector<FovPoint> dayPoints;
+    std::vector<FovPoint> thermalPoints;
+    for (int i = 0; i <= 20; ++i)
+    {
+        FovPoint point;
+        point.hwZoomPos = 1000 + i * 2500;
+        double tanX = std::tan(30.0 * TEST_PI / 180.0) /
+                      std::pow(30.0, i / 20.0);
+        point.xFovDeg = (float)(std::atan(tanX) * 360.0 / TEST_PI);
+        point.yFovDeg = point.xFovDeg * 0.75f;
+        dayPoints.push_back(point);
+        point.hwZoomPos = i * 500;
+        tanX = std::tan(20.0 * TEST_PI / 180.0) /
+               std::pow(4.0, std::pow(i / 20.0, 0.7));
+        point.xFovDeg = (float)(std::atan(tanX) * 360.0 / TEST_PI);
+        point.yFovDeg = point.xFovDeg * 0.75f;
+        thermalPoints.push_back(point);
+    }
+    dayParams.fovPoints = dayPoints;
+    thermalParams.fovPoints = thermalPoints;
+    SimulatedLens day;
+    SimulatedLens thermal;
+    day.openLens("");
+    day.initLens(dayParams);
+    thermal.openLens("");
+    thermal.initLens(thermalParams);
+    day.executeCommand(LensCommand::ZOOM_TO_FOV, 38.0f);
+    thermal.executeCommand(LensCommand::ZOOM_TO_FOV, 38.0f);
+    day.setZoomRate(25000.0f);
+    thermal.setZoomRate(4000.0f);
+
+    LensGroup group;
+    float minXFov = 0.0f;
+    float maxXFov = 0.0f;
+    if (!group.addLens(day, 25000.0f) || !group.addLens(thermal, 4000.0f) ||
+        !group.getFovRange(minXFov, maxXFov) ||
+        minXFov != thermalPoints.back().xFovDeg ||
+        maxXFov != thermalPoints.front().xFovDeg)
+    {
+        cout << "Wrong FOV range: " << minXFov << " - " << maxXFov << endl;
+        return false;
+    }
+
+    // Synchronized moves.
+    const float targets[3] = {12.0f, 35.0f, 1.0f};
+    for (float target : targets)
+    {
+        if (!group.zoomToFov(target))
+        {
+            cout << "Can't start move" << endl;
+            return false;
+        }
+        float maxMismatch = 0.0f;
+        int ticks = 0;
+        while (group.update(0.02f) && ticks < 5000)
+        {
+            maxMismatch = std::max(maxMismatch, group.getMismatch());
+            day.advance(0.02f);
+            thermal.advance(0.02f);
+            ++ticks;
+        }
+        target = std::max(target, minXFov);
+        float dayFov = day.getParam(LensParam::X_FOV_DEG);
+        float thermalFov = thermal.getParam(LensParam::X_FOV_DEG);
+        cout << "Zoom to " << target << " deg: " << ticks * 0.02f <<
+                " sec, max mismatch " << maxMismatch << " %, FOV " <<
+                dayFov << " / " << thermalFov << endl;
+        if (ticks >= 5000 || maxMismatch > 2.0f ||
+            std::fabs(dayFov - target) / target > 0.01f ||
+            std::fabs(thermalFov - target) / target > 0.01f ||
+            group.isFailed())
+        {
+            cout << "Move error" << endl;
+            return false;
+        }
+    }
+
+    // Desynchronized start: thermal lens at wide end, day lens at tele end.
+    // Catch-up of thermal lens (~2.5 sec) is sync phase, not stall.
+    thermal.setParam(LensParam::ZOOM_SPEED, 100.0f);
+    thermal.executeCommand(LensCommand::ZOOM_TO_FOV, 40.0f);
+    thermal.advance(5.0f);
+    if (!group.setStallTimeout(0.5f) || !group.zoomToFov(20.0f))
+    {
+        cout << "Can't start desynchronized move" << endl;
+        return false;
+    }
+    float maxMismatch = 0.0f;
+    int ticks = 0;
+    int syncTicks = 0;
+    while (group.update(0.02f) && ticks < 5000)
+    {
+        if (group.isSyncing())
+            ++syncTicks;
+        else
+            maxMismatch = std::max(maxMismatch, group.getMismatch());
+        day.advance(0.02f);
+        thermal.advance(0.02f);
+        ++ticks;
+    }
+    float dayFov = day.getParam(LensParam::X_FOV_DEG);
+    float thermalFov = thermal.getParam(LensParam::X_FOV_DEG);
+    cout << "Desynchronized zoom to 20 deg: sync " << syncTicks * 0.02f <<
+            " sec, total " << ticks * 0.02f << " sec, max mismatch " <<
+            maxMismatch << " %, FOV " << dayFov << " / " << thermalFov << endl;
+    if (ticks >= 5000 || group.isFailed() || syncTicks * 0.02f < 0.5f ||
+        maxMismatch > 2.0f || std::fabs(dayFov - 20.0f) / 20.0f > 0.01f ||
+        std::fabs(thermalFov - 20.0f) / 20.0f > 0.01f)
+    {
+        cout << "Desynchronized move error" << endl;
+        return false;
+    }
+
+    // Zero tolerance would pause trajectory forever.
+    if (group.setTolerance(0.0f) || group.setTolerance(-1.0f) ||
+        group.setStallTimeout(0.0f) || !group.setStallTimeout(1.0f))
+    {
+        cout << "Wrong tolerance or stall timeout accepted" << endl;
+        return false;
+    }
+
+    // Thermal lens doesn't move: group stops by stall timeout.
+    if (!group.zoomToFov(12.0f))
+    {
+        cout << "Can't start move" << endl;
+        return false;
+    }
+    ticks = 0;
+    while (group.update(0.02f) && ticks < 5000)
+    {
+        day.advance(0.02f);
+        ++ticks;
+    }
+    if (ticks >= 5000 || group.isMoving() || !group.isFailed())
+    {
+        cout << "Stalled move not stopped" << endl;
+        return false;
+    }
+    cout << "Stalled move stopped after " << ticks * 0.02f << " sec" << endl;
+    thermal.advance(1.0f);
+
+    // Mismatch of independent ZOOM_TO_FOV commands for comparison. Both
+    // lenses start at tele end of common range.
+    day.setParam(LensParam::ZOOM_SPEED, 100.0f);
+    thermal.setParam(LensParam::ZOOM_SPEED, 100.0f);
+    day.executeCommand(LensCommand::ZOOM_TO_FOV, minXFov);
+    thermal.executeCommand(LensCommand::ZOOM_TO_FOV, minXFov);
+    day.advance(10.0f);
+    thermal.advance(10.0f);
+    day.executeCommand(LensCommand::ZOOM_TO_FOV, 38.0f);
+    thermal.executeCommand(LensCommand::ZOOM_TO_FOV, 38.0f);
+    maxMismatch = 0.0f;
+    for (int i = 0; i < 500; ++i)
+    {
+        day.advance(0.02f);
+        thermal.advance(0.02f);
+        float dayFov = day.getParam(LensParam::X_FOV_DEG);
+        float thermalFov = thermal.getParam(LensParam::X_FOV_DEG);
+        maxMismatch = std::max(maxMismatch, std::fabs(dayFov - thermalFov) /
+                                            std::min(dayFov, thermalFov) *
+                                            100.0f);
+    }
+    cout << "Max mismatch of independent moves: " << maxMismatch << " %" <<
+            endl;
+
+    return true;
+}
+
+
+
+// Constant rate zoom test.
+bool zoomRateTest()
+{
+    // 30x lens, 60-2 degree.
+    LensParams params;
+    params.zoomHwWideLimit = 1000;
+    params.zoomHwTeleLimit = 51000;
+    params.zoomHwMaxSpeed = 1000;
+    std::vector<FovPoint> points;
+    for (int i = 0; i <= 20; ++i)
+    {
+        FovPoint point;
+        point.hwZoomPos = 1000 + i * 2500;
+        double tanX = std::tan(30.0 * TEST_PI / 180.0) /
+                      std::pow(30.0, i / 20.0);
+        point.xFovDeg = (float)(std::atan(tanX) * 360.0 / TEST_PI);
+        point.yFovDeg = point.xFovDeg * 0.75f;
+        points.push_back(point);
+    }
+    params.fovPoints = points;
+    SimulatedLens lens;
+    lens.openLens("");
+    lens.initLens(params);
+    lens.setZoomRate(25000.0f);
+
+    // Measure min and max rate of FOV (or log of tan(FOV / 2)) change by
+    // 0.1 sec intervals while FOV is between 50 and 10 degree.
+    auto measure = [&lens](bool isMagnification, float& minRate,
+                           float& maxRate)
+    {
+        auto value = [isMagnification](float xFov)
+        {
+            return isMagnification ?
+                        (float)std::log(std::tan(xFov * TEST_PI / 360.0)) :
+                        xFov;
+        };
+        minRate = 1e9f;
+        maxRate = 0.0f;
+        float prev = value(lens.getParam(LensParam::X_FOV_DEG));
+        for (int i = 0; i < 1000; ++i)
+        {
+            for (int j = 0; j < 10; ++j)
+                lens.advance(0.01f);
+            float xFov = lens.getParam(LensParam::X_FOV_DEG);
+            float rate = std::fabs(value(xFov) - prev) / 0.1f;
+            prev = value(xFov);
+            if (xFov < 10.0f)
+                break;
+            if (xFov > 50.0f)
+                continue;
+            minRate = std::min(minRate, rate);
+            maxRate = std::max(maxRate, rate);
+        }
+    };
+
+    // Fixed speed zoom.
+    float minRate = 0.0f;
+    float maxRate = 0.0f;
+    lens.setParam(LensParam::ZOOM_HW_SPEED, 250.0f);
+    lens.executeCommand(LensCommand::ZOOM_TELE);
+    measure(false, minRate, maxRate);
+    cout << "Fixed speed: FOV rate " << minRate << " - " << maxRate <<
+            " deg/sec" << endl;
+
+    // Constant FOV rate from wide end. Command is encoded as for remote lens.
+    lens.executeCommand(LensCommand::ZOOM_WIDE);
+    for (int i = 0; i < 100; ++i)
+        lens.advance(0.1f);
+    uint8_t command[11];
+    int commandSize = 0;
+    Lens::encodeCommand(command, commandSize, LensCommand::ZOOM_AT_FOV_RATE,
+                        4.0f);
+    if (!lens.decodeAndExecuteCommand(command, commandSize))
+    {
+        cout << "ZOOM_AT_FOV_RATE command not executed" << endl;
+        return false;
+    }
+    measure(false, minRate, maxRate);
+    cout << "ZOOM_AT_FOV_RATE(4): FOV rate " << minRate << " - " << maxRate <<
+            " deg/sec" << endl;
+    if (minRate < 3.9f || maxRate > 4.1f)
+    {
+        cout << "FOV rate is not constant" << endl;
+        return false;
+    }
+
+    // Constant magnification rate to wide from tele end.
+    lens.executeCommand(LensCommand::ZOOM_TELE);
+    for (int i = 0; i < 100; ++i)
+        lens.advance(0.1f);
+    if (!lens.executeCommand(LensCommand::ZOOM_AT_MAGNIFICATION_RATE, -0.5f))
+    {
+        cout << "ZOOM_AT_MAGNIFICATION_RATE command not executed" << endl;
+        return false;
+    }
+    float xFov = 0.0f;
+    for (int i = 0; i < 1000 && xFov < 10.0f; ++i)
+    {
+        lens.advance(0.01f);
+        xFov = lens.getParam(LensParam::X_FOV_DEG);
+    }
+    float startXFov = xFov;
+    for (int i = 0; i < 100; ++i)
+        lens.advance(0.01f);
+    xFov = lens.getParam(LensParam::X_FOV_DEG);
+    float rate = (float)(std::log(std::tan(xFov * TEST_PI / 360.0)) -
+                         std::log(std::tan(startXFov * TEST_PI / 360.0)));
+    cout << "ZOOM_AT_MAGNIFICATION_RATE(-0.5): rate " << rate <<
+            " 1/sec (FOV " << startXFov << " -> " << xFov << " in 1 sec)" <<
+            endl;
+    if (std::fabs(rate - 0.5f) > 0.02f)
+    {
+        cout << "Magnification rate is not constant" << endl;
+        return false;
+    }
+
+    // Stop.
+    lens.executeCommand(LensCommand::ZOOM_STOP);
+    float hwZoomPos = lens.getParam(LensParam::ZOOM_HW_POS);
+    lens.advance(0.1f);
+    if (lens.getParam(LensParam::ZOOM_HW_POS) != hwZoomPos)
+    {
+        cout << "Zoom not stopped" << endl;
+        return false;
+    }
+
+    // Update time.
+    LensZoomRate zoomRate;
+    zoomRate.setParams(params);
+    zoomRate.setSpeedGain(25.0f);
+    zoomRate.start(LensCommand::ZOOM_AT_FOV_RATE, 4.0f);
+    const int count = 1000000;
+    int hwSpeed = 0;
+    int changes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+        changes += zoomRate.update(1000.0f + (float)i * 0.05f, hwSpeed) ? 1 : 0;
+    double usec = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+    cout << "Update time: " << usec / count << " usec, speed changes: " <<
+            changes << endl;
+
+    return true;
+}
+
+
+
+bool positionMapperTest()
+{
+    // Linear mapping compared with float math for direct and reversed
+    // hardware ranges.
+    const int ranges[3][2] = {{1000, 51000}, {51000, 1000}, {-200000, 800000}};
+    for (const auto& range : ranges)
+    {
+        LensPositionMapper mapper(range[0], range[1]);
+        const double scale = (double)(range[1] - range[0]) / 65535.0;
+        for (int pos = 0; pos <= 65535; ++pos)
+        {
+            const int hwPos = mapper.toHw(pos);
+            if (std::abs(hwPos - (int)std::lround(range[0] + pos * scale)) > 1)
+            {
+                cout << "Wrong hardware position " << hwPos << " for " <<
+                        pos << endl;
+                return false;
+            }
+        }
+        const int step = std::abs(range[1] - range[0]) / 100000 + 1;
+        const int low = std::min(range[0], range[1]);
+        const int high = std::max(range[0], range[1]);
+        for (int hwPos = low; hwPos <= high; hwPos += step)
+        {
+            const int pos = mapper.toUser(hwPos);
+            const int expected = (int)std::lround((hwPos - range[0]) / scale);
+            if (std::abs(pos - expected) > 1)
+            {
+                cout << "Wrong user position " << pos << " for " << hwPos <<
+                        endl;
+                return false;
+            }
+        }
+        if (mapper.toHw(-10) != range[0] || mapper.toHw(70000) != range[1] ||
+            mapper.toUser(low - 10) != (range[0] < range[1] ? 0 : 65535) ||
+            mapper.toUser(high + 10) != (range[0] < range[1] ? 65535 : 0))
+        {
+            cout << "Positions are not clamped" << endl;
+            return false;
+        }
+    }
+
+    // Tables validation.
+    LensPositionMapper mapper;
+    if (mapper.setTable({100}) || mapper.setTable({0, 10, 5, 20}) ||
+        !mapper.setTable({20, 5, 5, 0}) || mapper.isLinear())
+    {
+        cout << "Wrong table validation" << endl;
+        return false;
+    }
+
+    // 30x lens, 60-2 degree, FOV is not linear in hardware position.
+    LensParams params;
+    params.zoomHwWideLimit = 1000;
+    params.zoomHwTeleLimit = 51000;
+    for (int i = 0; i <= 20; ++i)
+    {
+        FovPoint point;
+        point.hwZoomPos = 1000 + i * 2500;
+        double tanX = std::tan(30.0 * TEST_PI / 180.0) /
+                      std::pow(30.0, i / 20.0);
+        point.xFovDeg = (float)(std::atan(std::sqrt(tanX * tanX * tanX / 0.5)) *
+                                360.0 / TEST_PI);
+        point.yFovDeg = point.xFovDeg * 0.75f;
+        params.fovPoints.push_back(point);
+    }
+    if (!mapper.setMagnificationTable(params))
+    {
+        cout << "Magnification table not set" << endl;
+        return false;
+    }
+
+    // Magnification must change by equal factor for equal user steps.
+    SimulatedLens lens;
+    lens.openLens("");
+    lens.initLens(params);
+    lens.setZoomMapper(mapper);
+    double minFactor = 1e9;
+    double maxFactor = 0.0;
+    lens.setParam(LensParam::ZOOM_POS, 0.0f);
+    double prevTan = std::tan(lens.getParam(LensParam::X_FOV_DEG) *
+                              TEST_PI / 360.0);
+    for (int i = 1; i <= 16; ++i)
+    {
+        lens.setParam(LensParam::ZOOM_POS, (float)(i * 65535 / 16));
+        double tan = std::tan(lens.getParam(LensParam::X_FOV_DEG) *
+                              TEST_PI / 360.0);
+        minFactor = std::min(minFactor, prevTan / tan);
+        maxFactor = std::max(maxFactor, prevTan / tan);
+        prevTan = tan;
+    }
+    cout << "Magnification step factor: " << minFactor << " - " <<
+            maxFactor << endl;
+    if (maxFactor / minFactor > 1.02)
+    {
+        cout << "Magnification is not linear in user position" << endl;
+        return false;
+    }
+
+    // Round trip by table.
+    for (int hwPos = 1000; hwPos <= 51000; ++hwPos)
+    {
+        const int pos = mapper.toUser(hwPos);
+        if (mapper.toUser(mapper.toHw(pos)) != pos ||
+            (hwPos > 1000 && pos < mapper.toUser(hwPos - 1)))
+        {
+            cout << "Wrong table round trip for " << hwPos << endl;
+            return false;
+        }
+    }
+
+    // Out of range and NaN command arguments.
+    if (LensPositionMapper::clampPos(std::nanf("")) != 0 ||
+        LensPositionMapper::clampPos(-1.0e10f) != 0 ||
+        LensPositionMapper::clampPos(1.0e10f) != 65535 ||
+        LensPositionMapper::clampPos(1234.7f) != 1234)
+    {
+        cout << "Wrong position clamping" << endl;
+        return false;
+    }
+
+    // Conversion time compared with float math.
+    const int count = 10000000;
+    volatile int sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+        sink = sink + mapper.toUser(mapper.toHw(i & 0xFFFF));
+    double tableNsec = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / count;
+    LensPositionMapper linear(1000, 51000);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+        sink = sink + linear.toUser(linear.toHw(i & 0xFFFF));
+    double linearNsec = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / count;
+    float hwMin = 1000.0f;
+    float hwMax = 51000.0f;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+        float hwPos = hwMin + (hwMax - hwMin) * (float)(i & 0xFFFF) / 65535.0f;
+        float pos = (hwPos - hwMin) / (hwMax - hwMin) * 65535.0f;
+        pos = pos < 0.0f ? 0.0f : (pos > 65535.0f ? 65535.0f : pos);
+        sink = sink + (int)pos;
+    }
+    double floatNsec = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / count;
+    cout << "Round trip time: table " << tableNsec << " nsec, linear " <<
+            linearNsec << " nsec, float math " << floatNsec << " nsec" << endl;
+
+    return true;
+}
+
+
+
 bool compareParams(LensParams& in, LensParams& out, LensParamsMask& mask)
 {
     bool result = true;
@@ -0,0 +1,330 @@
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include "FovCalibrator.h"
+
+
+
+/// Pi.
+#define FOV_CALIBRATOR_PI 3.14159265358979323846
+/// Max scale between key frame and current frame. Key frame is changed when
+/// scale exceeds this value.
+#define FOV_CALIBRATOR_MAX_KEY_SCALE 1.3f
+/// Min phase correlation peak value to accept scale.
+#define FOV_CALIBRATOR_MIN_CONFIDENCE 0.02f
+
+
+
+cr::lens::FovCalibrator::FovCalibrator(int size)
+{
+    // Size must be power of 2.
+    m_size = 32;
+    while (m_size < size && m_size < 4096)
+        m_size *= 2;
+
+    // Hann window.
+    const int n = m_size;
+    m_window.resize(n);
+    for (int i = 0; i < n; ++i)
+        m_window[i] = (float)(0.5 - 0.5 * std::cos(2.0 * FOV_CALIBRATOR_PI *
+                                                   (i + 0.5) / n));
+
+    // High-pass filter for centered spectrum (suppresses low frequencies
+    // which dominate magnitude spectrum but don't carry scale information).
+    m_highPass.resize(n * n);
+    for (int y = 0; y < n; ++y)
+    {
+        for (int x = 0; x < n; ++x)
+        {
+            double v = std::cos(FOV_CALIBRATOR_PI * (x - n / 2) / n) *
+                       std::cos(FOV_CALIBRATOR_PI * (y - n / 2) / n);
+            m_highPass[y * n + x] = (float)((1.0 - v) * (2.0 - v));
+        }
+    }
+
+    m_buffer.resize(n * n);
+    m_logPolar1.resize(n * n);
+    m_logPolar2.resize(n * n);
+}
+
+
+
+cr::lens::FovCalibrator::~FovCalibrator()
+{
+
+}
+
+
+
+void cr::lens::FovCalibrator::setSettleTime(int settleTimeMsec,
+                                            int pollPeriodMsec)
+{
+    m_settleTimeMsec = settleTimeMsec < 0 ? 0 : settleTimeMsec;
+    m_pollPeriodMsec = pollPeriodMsec < 1 ? 1 : pollPeriodMsec;
+}
+
+
+
+bool cr::lens::FovCalibrator::estimateScale(const uint8_t* gray1,
+                                            const uint8_t* gray2,
+                                            int width, int height,
+                                            float& scale, float& confidence)
+{
+    if (gray1 == nullptr || gray2 == nullptr ||
+        width < 32 || height < 32)
+        return false;
+
+    getLogPolarSpectrum(gray1, width, height, m_logPolar1);
+    getLogPolarSpectrum(gray2, width, height, m_logPolar2);
+
+    // Normalized cross power spectrum.
+    const int n = m_size;
+    for (int i = 0; i < n * n; ++i)
+    {
+        std::complex<float> c = m_logPolar2[i] * std::conj(m_logPolar1[i]);
+        float a = std::abs(c);
+        m_buffer[i] = a > 1e-20f ? c / a : std::complex<float>(0.0f, 0.0f);
+    }
+    fft2d(m_buffer, n, true);
+
+    // Find correlation peak. Rows - angle, columns - log radius.
+    int peak = 0;
+    for (int i = 1; i < n * n; ++i)
+        if (m_buffer[i].real() > m_buffer[peak].real())
+            peak = i;
+    const int row = peak / n;
+    const int col = peak % n;
+    confidence = m_buffer[peak].real() / (float)(n * n);
+
+    // Subpixel peak position by log radius.
+    float left = m_buffer[row * n + (col + n - 1) % n].real();
+    float center = m_buffer[peak].real();
+    float right = m_buffer[row * n + (col + 1) % n].real();
+    float d = left - 2.0f * center + right;
+    float shift = (float)(col > n / 2 ? col - n : col);
+    if (std::fabs(d) > 1e-20f)
+        shift += 0.5f * (left - right) / d;
+
+    // Magnified image has compressed spectrum: shift by log radius is
+    // negative log of scale.
+    const double base = std::log(n / 2.0 - 1.0) / n;
+    scale = (float)std::exp(-shift * base);
+
+    return true;
+}
+
+
+
+bool cr::lens::FovCalibrator::calibrate(cr::lens::Lens& lens,
+                                        cr::lens::FovCalibratorGrabber grabber,
+                                        int stepsCount, float wideXFovDeg,
+                                        std::vector<cr::lens::FovPoint>& points)
+{
+    points.clear();
+    if (!grabber || stepsCount < 1 ||
+        wideXFovDeg <= 0.0f || wideXFovDeg >= 180.0f)
+        return false;
+
+    std::vector<uint8_t> key;
+    std::vector<uint8_t> frame;
+    int keyWidth = 0;
+    int keyHeight = 0;
+    float keyTan = (float)std::tan(wideXFovDeg * FOV_CALIBRATOR_PI / 360.0);
+    for (int step = 0; step <= stepsCount; ++step)
+    {
+        // Move zoom and wait for frame.
+        float pos = (float)((int64_t)65535 * step / stepsCount);
+        if (!lens.executeCommand(LensCommand::ZOOM_TO_POS, pos))
+            return false;
+        int hwZoomPos = waitZoom(lens);
+        int width = 0;
+        int height = 0;
+        if (!grabber(frame, width, height) || width <= 0 || height <= 0 ||
+            frame.size() < (size_t)width * height)
+            return false;
+
+        // Estimate FOV by scale relative to key frame.
+        float xTan = keyTan;
+        if (step == 0)
+        {
+            key = frame;
+            keyWidth = width;
+            keyHeight = height;
+        }
+        else
+        {
+            float scale = 1.0f;
+            float confidence = 0.0f;
+            if (width != keyWidth || height != keyHeight ||
+                !estimateScale(key.data(), frame.data(), width, height,
+                               scale, confidence) ||
+                confidence < FOV_CALIBRATOR_MIN_CONFIDENCE)
+                return false;
+            xTan = keyTan / scale;
+
+            // Change key frame.
+            if (scale > FOV_CALIBRATOR_MAX_KEY_SCALE ||
+                scale < 1.0f / FOV_CALIBRATOR_MAX_KEY_SCALE)
+            {
+                key.swap(frame);
+                keyTan = xTan;
+            }
+        }
+
+        FovPoint point;
+        point.hwZoomPos = hwZoomPos;
+        point.xFovDeg = (float)(std::atan(xTan) * 360.0 / FOV_CALIBRATOR_PI);
+        point.yFovDeg = (float)(std::atan(xTan * height / width) * 360.0 /
+                                FOV_CALIBRATOR_PI);
+        points.push_back(point);
+    }
+
+    return true;
+}
+
+
+
+void cr::lens::FovCalibrator::getLogPolarSpectrum(
+        const uint8_t* gray, int width, int height,
+        std::vector<std::complex<float>>& logPolar)
+{
+    // Resample central square region to n x n.
+    const int n = m_size;
+    const int side = width < height ? width : height;
+    const float x0 = (float)(width - side) / 2.0f;
+    const float y0 = (float)(height - side) / 2.0f;
+    const float k = (float)side / (float)n;
+    double sum = 0.0;
+    for (int y = 0; y < n; ++y)
+    {
+        float sy = y0 + ((float)y + 0.5f) * k - 0.5f;
+        sy = sy < 0.0f ? 0.0f : (sy > height - 1.001f ? height - 1.001f : sy);
+        int iy = (int)sy;
+        float wy = sy - (float)iy;
+        for (int x = 0; x < n; ++x)
+        {
+            float sx = x0 + ((float)x + 0.5f) * k - 0.5f;
+            sx = sx < 0.0f ? 0.0f : (sx > width - 1.001f ? width - 1.001f : sx);
+            int ix = (int)sx;
+            float wx = sx - (float)ix;
+            const uint8_t* p = &gray[iy * width + ix];
+            float top = p[0] + wx * (float)(p[1] - p[0]);
+            float bottom = p[width] + wx * (float)(p[width + 1] - p[width]);
+            float v = top + wy * (bottom - top);
+            m_buffer[y * n + x] = v;
+            sum += v;
+        }
+    }
+
+    // Remove mean and apply window.
+    const float mean = (float)(sum / (n * n));
+    for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x)
+            m_buffer[y * n + x] = (m_buffer[y * n + x].real() - mean) *
+                                  m_window[y] * m_window[x];
+    fft2d(m_buffer, n, false);
+
+    // Centered high-pass filtered magnitude spectrum.
+    std::vector<float> magnitude(n * n);
+    for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x)
+            magnitude[((y + n / 2) % n) * n + (x + n / 2) % n] =
+                    std::abs(m_buffer[y * n + x]);
+    for (int i = 0; i < n * n; ++i)
+        magnitude[i] *= m_highPass[i];
+
+    // Log-polar resampling. Magnitude spectrum is symmetric, so half circle
+    // is used. Rows - angle, columns - log radius.
+    const double base = std::log(n / 2.0 - 1.0) / n;
+    for (int a = 0; a < n; ++a)
+    {
+        double angle = FOV_CALIBRATOR_PI * a / n;
+        double c = std::cos(angle);
+        double s = std::sin(angle);
+        for (int r = 0; r < n; ++r)
+        {
+            double radius = std::exp(r * base);
+            double fx = n / 2.0 + radius * c;
+            double fy = n / 2.0 + radius * s;
+            int ix = (int)fx;
+            int iy = (int)fy;
+            float wx = (float)(fx - ix);
+            float wy = (float)(fy - iy);
+            const float* p = &magnitude[iy * n + ix];
+            float top = p[0] + wx * (p[1] - p[0]);
+            float bottom = p[n] + wx * (p[n + 1] - p[n]);
+            // Window by log radius which is not periodic.
+            logPolar[a * n + r] = (top + wy * (bottom - top)) * m_window[r];
+        }
+    }
+    fft2d(logPolar, n, false);
+}
+
+
+
+int cr::lens::FovCalibrator::waitZoom(cr::lens::Lens& lens)
+{
+    int pos = (int)lens.getParam(LensParam::ZOOM_HW_POS);
+    if (m_settleTimeMsec == 0)
+        return pos;
+
+    // Wait until position is not changed for two polls.
+    int stableCount = 0;
+    for (int t = 0; t < m_settleTimeMsec && stableCount < 2;
+         t += m_pollPeriodMsec)
+    {
+        std::this_thread::sleep_for(
+                    std::chrono::milliseconds(m_pollPeriodMsec));
+        int newPos = (int)lens.getParam(LensParam::ZOOM_HW_POS);
+        stableCount = newPos == pos ? stableCount + 1 : 0;
+        pos = newPos;
+    }
+
+    return pos;
+}
+
+
+
+void cr::lens::FovCalibrator::fft(std::complex<float>* data, int n, int step,
+                                  bool inverse)
+{
+    // Bit reversal permutation.
+    for (int i = 1, j = 0; i < n; ++i)
+    {
+        int bit = n >> 1;
+        for (; (j & bit) != 0; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(data[i * step], data[j * step]);
+    }
+
+    // Butterflies.
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        double angle = (inverse ? 2.0 : -2.0) * FOV_CALIBRATOR_PI / len;
+        for (int k = 0; k < len / 2; ++k)
+        {
+            std::complex<float> w((float)std::cos(angle * k),
+                                  (float)std::sin(angle * k));
+            for (int i = k; i < n; i += len)
+            {
+                std::complex<float> u = data[i * step];
+                std::complex<float> v = data[(i + len / 2) * step] * w;
+                data[i * step] = u + v;
+                data[(i + len / 2) * step] = u - v;
+            }
+        }
+    }
+}
+
+
+
+void cr::lens::FovCalibrator::fft2d(std::vector<std::complex<float>>& data,
+                                    int n, bool inverse)
+{
+    for (int y = 0; y < n; ++y)
+        fft(&data[y * n], n, 1, inverse);
+    for (int x = 0; x < n; ++x)
+        fft(&data[x], n, n, inverse);
+}
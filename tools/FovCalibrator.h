@@ -0,0 +1,144 @@
+#pragma once
+#include <complex>
+#include <functional>
+#include <vector>
+#include "Lens.h"
+
+
+
+namespace cr
+{
+namespace lens
+{
+
+
+
+/// Frame grabber function type. Must return next gray (8 bits per pixel,
+/// width * height bytes) video frame captured after last lens command.
+typedef std::function<bool(std::vector<uint8_t>& gray, int& width,
+                           int& height)> FovCalibratorGrabber;
+
+
+
+/**
+ * @brief Automatic FOV calibrator. Sweeps zoom through the whole range by
+ * ZOOM_TO_POS command, estimates image scale change between frames and
+ * calculates dense list of FOV points (LensParams::fovPoints) from known
+ * horizontal FOV at wide end. Scale is estimated by Fourier-Mellin method:
+ * magnitude spectrums of frames (which don't depend on image shift, so
+ * optical axis drift during zoom doesn't matter) are resampled to log-polar
+ * coordinates where scaling becomes shift, and the shift is found by phase
+ * correlation. Each frame is compared with key frame (not with previous
+ * frame) to avoid accumulation of errors, key frame is changed when scale
+ * becomes too big for reliable estimation.
+ */
+class FovCalibrator
+{
+public:
+
+    /**
+     * @brief Class constructor.
+     * @param size Size of frame region (power of 2) used for scale
+     * estimation. Central square region of frame is resampled to this size.
+     */
+    FovCalibrator(int size = 256);
+
+    /**
+     * @brief Class destructor.
+     */
+    ~FovCalibrator();
+
+    /**
+     * @brief Set time to wait for zoom to stop after each command.
+     * @param settleTimeMsec Max time to wait, msec. Zoom is considered
+     * stopped when hardware zoom position is not changed for two polls.
+     * @param pollPeriodMsec Hardware zoom position poll period, msec.
+     */
+    void setSettleTime(int settleTimeMsec, int pollPeriodMsec = 50);
+
+    /**
+     * @brief Estimate scale of second frame relative to first one.
+     * @param gray1 First gray frame.
+     * @param gray2 Second gray frame.
+     * @param width Frames width.
+     * @param height Frames height.
+     * @param scale Output scale: > 1 if objects on second frame are bigger
+     * (zoom in), < 1 if smaller.
+     * @param confidence Output phase correlation peak value (0-1). Values
+     * less than ~0.05 mean that scale is unreliable.
+     * @return TRUE if scale estimated or FALSE if frames too small.
+     */
+    bool estimateScale(const uint8_t* gray1, const uint8_t* gray2, int width,
+                       int height, float& scale, float& confidence);
+
+    /**
+     * @brief Calibrate lens: sweep zoom from wide to tele and build FOV
+     * points. Vertical FOV is calculated from horizontal FOV and frame
+     * aspect ratio (square pixels).
+     * @param lens Lens controller. Must be open.
+     * @param grabber Frame grabber.
+     * @param stepsCount Number of zoom steps (number of points - 1).
+     * @param wideXFovDeg Known horizontal FOV at wide end (zoom position 0),
+     * degree.
+     * @param points Output FOV points.
+     * @return TRUE if calibration done or FALSE in case any errors.
+     */
+    bool calibrate(Lens& lens, FovCalibratorGrabber grabber, int stepsCount,
+                   float wideXFovDeg, std::vector<FovPoint>& points);
+
+private:
+
+    /// Region size.
+    int m_size{256};
+    /// Max time to wait for zoom to stop, msec.
+    int m_settleTimeMsec{0};
+    /// Zoom position poll period, msec.
+    int m_pollPeriodMsec{50};
+    /// Hann window.
+    std::vector<float> m_window;
+    /// High-pass filter for magnitude spectrum.
+    std::vector<float> m_highPass;
+    /// FFT buffer.
+    std::vector<std::complex<float>> m_buffer;
+    /// Log-polar spectrum of first frame.
+    std::vector<std::complex<float>> m_logPolar1;
+    /// Log-polar spectrum of second frame.
+    std::vector<std::complex<float>> m_logPolar2;
+
+    /**
+     * @brief Calculate log-polar magnitude spectrum of frame.
+     * @param gray Gray frame.
+     * @param width Frame width.
+     * @param height Frame height.
+     * @param logPolar Output FFT of log-polar magnitude spectrum.
+     */
+    void getLogPolarSpectrum(const uint8_t* gray, int width, int height,
+                             std::vector<std::complex<float>>& logPolar);
+
+    /**
+     * @brief Wait for zoom to stop.
+     * @param lens Lens controller.
+     * @return Hardware zoom position.
+     */
+    int waitZoom(Lens& lens);
+
+    /**
+     * @brief In-place radix-2 FFT.
+     * @param data Data.
+     * @param n Number of elements (power of 2).
+     * @param step Distance between elements.
+     * @param inverse Inverse transform flag (without normalization).
+     */
+    static void fft(std::complex<float>* data, int n, int step, bool inverse);
+
+    /**
+     * @brief In-place 2D FFT of square array.
+     * @param data Data, n * n elements.
+     * @param n Array size (power of 2).
+     * @param inverse Inverse transform flag (without normalization).
+     */
+    static void fft2d(std::vector<std::complex<float>>& data, int n,
+                      bool inverse);
+};
+}
+}
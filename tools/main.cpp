@@ -0,0 +1,187 @@
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <chrono>
+#include "FovCalibrator.h"
+#include "SimulatedLens.h"
+#include "LensFovTable.h"
+
+
+
+// Link namespaces.
+using namespace cr::lens;
+using namespace std;
+
+
+
+/// Pi.
+#define TOOL_PI 3.14159265358979323846
+/// Simulated frame width.
+#define FRAME_WIDTH 480
+/// Simulated frame height.
+#define FRAME_HEIGHT 360
+
+
+
+/**
+ * @brief Value noise on integer grid with smooth interpolation.
+ * @param x X coordinate.
+ * @param y Y coordinate.
+ * @return Noise value in range 0-1.
+ */
+float valueNoise(double x, double y)
+{
+    auto hash = [](int64_t ix, int64_t iy)
+    {
+        uint32_t h = (uint32_t)(ix * 374761393 + iy * 668265263);
+        h = (h ^ (h >> 13)) * 1274126177;
+        return (float)((h ^ (h >> 16)) & 0xFFFF) / 65535.0f;
+    };
+    double fx = std::floor(x);
+    double fy = std::floor(y);
+    int64_t ix = (int64_t)fx;
+    int64_t iy = (int64_t)fy;
+    float tx = (float)(x - fx);
+    float ty = (float)(y - fy);
+    tx = tx * tx * (3.0f - 2.0f * tx);
+    ty = ty * ty * (3.0f - 2.0f * ty);
+    float top = hash(ix, iy) + tx * (hash(ix + 1, iy) - hash(ix, iy));
+    float bottom = hash(ix, iy + 1) + tx * (hash(ix + 1, iy + 1) -
+                                            hash(ix, iy + 1));
+    return top + ty * (bottom - top);
+}
+
+
+
+/**
+ * @brief Render frame of simulated scene. Scene is fractal noise on plane
+ * perpendicular to optical axis, so it has details at any zoom. Optical
+ * axis drifts during zoom as on real lenses.
+ * @param xFovDeg Horizontal FOV, degree.
+ * @param gray Output gray frame.
+ * @param width Output frame width.
+ * @param height Output frame height.
+ * @return TRUE.
+ */
+bool renderFrame(float xFovDeg, vector<uint8_t>& gray, int& width,
+                 int& height)
+{
+    width = FRAME_WIDTH;
+    height = FRAME_HEIGHT;
+    gray.resize(width * height);
+    double t = std::tan(xFovDeg * TOOL_PI / 360.0);
+    double k = 2.0 * t / width;
+    double driftX = 0.02 / (1.0 + 10.0 * t);
+    double driftY = -0.01 / (1.0 + 10.0 * t);
+    for (int v = 0; v < height; ++v)
+    {
+        for (int u = 0; u < width; ++u)
+        {
+            double x = (u - width / 2.0) * k + driftX;
+            double y = (v - height / 2.0) * k + driftY;
+            float value = 0.0f;
+            float amplitude = 0.5f;
+            double frequency = 4.0;
+            for (int octave = 0; octave < 12; ++octave)
+            {
+                value += amplitude * valueNoise(x * frequency + octave * 17.0,
+                                                y * frequency);
+                amplitude *= 0.75f;
+                frequency *= 2.0;
+            }
+            value = value * 110.0f;
+            gray[v * width + u] = (uint8_t)(value > 255.0f ? 255.0f : value);
+        }
+    }
+    return true;
+}
+
+
+
+// Entry point.
+int main(int argc, char **argv)
+{
+    cout << "#####################################" << endl;
+    cout << "#                                   #" << endl;
+    cout << "# Lens FOV calibrator               #" << endl;
+    cout << "#                                   #" << endl;
+    cout << "#####################################" << endl;
+    cout << endl;
+
+    // Arguments: output file and number of zoom steps.
+    string outputFile = argc > 1 ? argv[1] : "FovPoints.json";
+    int stepsCount = argc > 2 ? atoi(argv[2]) : 64;
+
+    // Simulated lens with "true" FOV table: exponential magnification 30x.
+    LensParams params;
+    params.zoomHwWideLimit = 1000;
+    params.zoomHwTeleLimit = 51000;
+    vector<FovPoint> truePoints;
+    for (int i = 0; i <= 20; ++i)
+    {
+        FovPoint point;
+        point.hwZoomPos = 1000 + i * 2500;
+        double tanX = std::tan(30.0 * TOOL_PI / 180.0) /
+                      std::pow(30.0, i / 20.0);
+        point.xFovDeg = (float)(std::atan(tanX) * 360.0 / TOOL_PI);
+        point.yFovDeg = (float)(std::atan(tanX * FRAME_HEIGHT / FRAME_WIDTH) *
+                                360.0 / TOOL_PI);
+        truePoints.push_back(point);
+    }
+    params.fovPoints = truePoints;
+    SimulatedLens lens;
+    lens.openLens("");
+    lens.initLens(params);
+
+    // Calibrate. Camera renders scene for current lens FOV.
+    FovCalibratorGrabber grabber =
+            [&lens](vector<uint8_t>& gray, int& width, int& height)
+    {
+        return renderFrame(lens.getParam(LensParam::X_FOV_DEG), gray,
+                           width, height);
+    };
+    FovCalibrator calibrator;
+    vector<FovPoint> points;
+    auto start = chrono::steady_clock::now();
+    bool result = calibrator.calibrate(lens, grabber, stepsCount,
+                                       truePoints.front().xFovDeg, points);
+    double sec = chrono::duration<double>(
+                chrono::steady_clock::now() - start).count();
+    if (!result)
+    {
+        cout << "Calibration failed" << endl;
+        return 1;
+    }
+
+    // Compare with true FOV.
+    LensFovTable trueTable(truePoints);
+    float maxError = 0.0f;
+    for (const FovPoint& point : points)
+    {
+        float xFov = 0.0f;
+        float yFov = 0.0f;
+        trueTable.getFov((float)point.hwZoomPos, xFov, yFov);
+        float error = std::fabs(point.xFovDeg - xFov) / xFov * 100.0f;
+        maxError = error > maxError ? error : maxError;
+        cout << "hwZoomPos " << point.hwZoomPos << " xFov " << point.xFovDeg
+             << " (true " << xFov << ")" << endl;
+    }
+    cout << points.size() << " points in " << sec << " sec, max error " <<
+            maxError << " %" << endl;
+
+    // Write FOV points to file.
+    LensParams out;
+    lens.getParams(out);
+    out.fovPoints = points;
+    cr::utils::ConfigReader config;
+    config.set(out, "lensParams");
+    if (!config.writeToFile(outputFile))
+    {
+        cout << "Can't write file " << outputFile << endl;
+        return 1;
+    }
+    cout << "FOV points written to " << outputFile << endl;
+
+    // Simulated calibration is used as CI check.
+    return maxError < 2.0f ? 0 : 1;
+}